@@ -0,0 +1,1179 @@
+// Benchmarks for the real-time parts of SENTINEL
+// Build with optimisations (see build.sh), the numbers in documentation/performance.md come from this program
+
+#include "Sensing.hpp"
+#include "Recovery/apogee.hpp"
+#include "Recovery/recovery.hpp"
+#include "Recovery/landing.hpp"
+#include "Scheduler.hpp"
+#include "Control/gridfins.hpp"
+#include "Control/pid.hpp"
+#include "Control/allocation.hpp"
+#include "Control/commands.hpp"
+#include "Config.hpp"
+#include "Simulation.hpp"
+#include "logger/ActualLogger.hpp"
+#include "Telemetry.hpp"
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+/// @brief Latency statistics of a batch of timed calls
+struct LatencyReport{
+    double MeanNs;
+    double P99Ns;
+    double MaxNs;
+};
+
+/// @brief Sorts the samples in place and summarises them
+LatencyReport Summarise(vector<double>& Samples){
+    LatencyReport Report{0.0, 0.0, 0.0};
+    if(Samples.empty()) {return Report;}
+
+    double Sum = 0.0;
+    for(double s : Samples) {Sum += s;}
+    sort(Samples.begin(), Samples.end());
+
+    Report.MeanNs = Sum / Samples.size();
+    Report.P99Ns = Samples[size_t(Samples.size() * 0.99)];
+    Report.MaxNs = Samples.back();
+    return Report;
+}
+
+void PrintReport(const string& Name, const LatencyReport& Report){
+    cout << left << setw(40) << Name << right << fixed << setprecision(1)
+         << " mean " << setw(9) << Report.MeanNs << " ns"
+         << "   p99 " << setw(9) << Report.P99Ns << " ns"
+         << "   max " << setw(10) << Report.MaxNs << " ns" << endl;
+}
+
+/// @brief Times Calls invocations of Function one by one for the tail latencies, then once more as a
+/// single batch for the mean (so the mean does not include the cost of reading the clock)
+template<typename F>
+LatencyReport TimeEach(int Calls, F Function){
+    vector<double> Samples(Calls);
+    for(int i = 0; i < Calls; i++){
+        auto Start = chrono::steady_clock::now();
+        Function(i);
+        auto End = chrono::steady_clock::now();
+        Samples[i] = chrono::duration<double, nano>(End - Start).count();
+    }
+    LatencyReport Report = Summarise(Samples);
+
+    auto Start = chrono::steady_clock::now();
+    for(int i = 0; i < Calls; i++){
+        Function(i);
+    }
+    auto End = chrono::steady_clock::now();
+    Report.MeanNs = chrono::duration<double, nano>(End - Start).count() / Calls;
+    return Report;
+}
+
+/// Keeps results alive so the optimiser cannot drop the work being timed
+volatile float Sink;
+
+void BenchmarkAHRS(){
+    cout << endl << "== AHRS (one IMU step) ==" << endl;
+    const int Steps = 200000;
+    const float dt = 0.001f;
+
+    // Slow coning motion with a level magnetometer, so both filters have real work to do
+    vector<RocketPhysics::Vector3D> Gyro, Accel, Mag;
+    Gyro.reserve(Steps); Accel.reserve(Steps); Mag.reserve(Steps);
+    for(int i = 0; i < Steps; i++){
+        float t = i * dt;
+        Gyro.emplace_back(0.2f * sin(t), 0.2f * cos(t), 0.05f, 'R');
+        Accel.emplace_back(0.3f * sin(t), 0.3f * cos(t), 9.8f + 20.0f * (t < 3.0f), 'A');
+        Mag.emplace_back(0.22f, 0.0f, -0.4f, 'M');
+    }
+
+    RocketSensors::AHRS Complementary(RocketSensors::AHRS::Complementary, 1000.0f);
+    RocketSensors::AHRS Madgwick(RocketSensors::AHRS::Madgwick, 1000.0f);
+    RocketPhysics::Vector3D NoMag(0, 0, 0, 'M');
+
+    PrintReport("Complementary, IMU + mag", TimeEach(Steps, [&](int i){
+        Complementary.Update(Gyro[i], Accel[i], Mag[i], dt); }));
+    PrintReport("Madgwick, IMU + mag", TimeEach(Steps, [&](int i){
+        Madgwick.Update(Gyro[i], Accel[i], Mag[i], dt); }));
+    PrintReport("Madgwick, IMU only", TimeEach(Steps, [&](int i){
+        Madgwick.Update(Gyro[i], Accel[i], NoMag, dt); }));
+    PrintReport("Barometer correction", TimeEach(Steps, [&](int i){
+        Madgwick.UpdateBarometer(1013.25f - i * 1e-4f); }));
+
+    // Full path through the sensor registry, including the deadline checks
+    RocketSensors::BinarySearchTree Sensors;
+    Sensors.create('G', 10.0f);
+    Sensors.create('A', 10.0f);
+    Sensors.create('M', 10.0f);
+    Sensors.create('B', 10.0f);
+    RocketSensors::AHRS Registry(RocketSensors::AHRS::Madgwick, 1000.0f);
+    Registry.Bind(Sensors);
+
+    const int RegistrySteps = 20000;
+    chrono::milliseconds Now = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch());
+    for(int i = 0; i < 2 * RegistrySteps; i++){
+        Sensors.Find('G')->Insert(Gyro[i], Now);
+        Sensors.Find('A')->Insert(Accel[i], Now);
+        Sensors.Find('M')->Insert(Mag[i], Now);
+        Sensors.Find('B')->Insert(1013.25f, Now);
+    }
+    PrintReport("Madgwick, Step() from registry", TimeEach(RegistrySteps, [&](int){
+        Registry.Step(); }));
+
+    Sink = Complementary.GetPitch() + Madgwick.GetPitch() + Registry.GetPitch();
+}
+
+/// @brief A well conditioned symmetric positive definite test matrix
+template<size_t N>
+RocketPhysics::Matrix<N, N> TestSPD(){
+    RocketPhysics::Matrix<N, N> A;
+    for(size_t i = 0; i < N; i++){
+        for(size_t j = 0; j < N; j++) {A(i, j) = 1.0f / (1.0f + i + j);}
+        A(i, i) += float(N);
+    }
+    return A;
+}
+
+template<size_t N>
+void BenchmarkMatrixSize(int Calls){
+    RocketPhysics::Matrix<N, N> A = TestSPD<N>(), B = TestSPD<N>() * 0.5f, L;
+    RocketPhysics::Vector<N> b;
+    for(size_t i = 0; i < N; i++) {b[i] = float(i);}
+    string Size = to_string(N) + "x" + to_string(N);
+
+    // Each call perturbs one input so the work cannot be hoisted out of the loop
+    PrintReport(Size + " product", TimeEach(Calls, [&](int i){
+        B(0, 0) = float(i & 7); Sink = (A * B)(N - 1, N - 1); }));
+    PrintReport(Size + " matrix * vector", TimeEach(Calls, [&](int i){
+        b[0] = float(i & 7); Sink = (A * b)[N - 1]; }));
+    PrintReport(Size + " Cholesky + solve", TimeEach(Calls, [&](int i){
+        b[0] = float(i & 7); RocketPhysics::Cholesky(A, L); Sink = RocketPhysics::CholeskySolve(L, b)[N - 1]; }));
+    PrintReport(Size + " LU + solve", TimeEach(Calls, [&](int i){
+        b[0] = float(i & 7); RocketPhysics::LUDecomposition<N> LU(A); Sink = LU.Solve(b)[N - 1]; }));
+    PrintReport(Size + " inverse", TimeEach(Calls, [&](int i){
+        A(0, 0) = float(N + 1 + (i & 7)); RocketPhysics::Inverse(A, B); Sink = B(0, 0); }));
+}
+
+void BenchmarkMatrix(){
+    cout << endl << "== Fixed size linear algebra ==" << endl;
+    BenchmarkMatrixSize<3>(200000);
+    BenchmarkMatrixSize<4>(200000);
+    BenchmarkMatrixSize<6>(100000);
+    BenchmarkMatrixSize<9>(50000);
+}
+
+/// @brief Times one pass of a batch kernel over Samples vectors, reported per sample
+template<typename F>
+void TimeBatch(const string& Name, size_t Samples, int Passes, F Kernel){
+    auto Start = chrono::steady_clock::now();
+    for(int p = 0; p < Passes; p++) {Kernel();}
+    auto End = chrono::steady_clock::now();
+    double NsPerSample = chrono::duration<double, nano>(End - Start).count() / (double(Passes) * Samples);
+    cout << left << setw(40) << Name << right << fixed << setprecision(2)
+         << " " << setw(8) << NsPerSample << " ns/sample  " << setw(8) << setprecision(1) << 1e3 / NsPerSample << " M samples/s" << endl;
+}
+
+void BenchmarkVectorBatch(){
+    cout << endl << "== Vector batches (structure of arrays) ==" << endl;
+    const size_t Sizes[2] = {4096, 1 << 20};
+    for(size_t n : Sizes){
+        RocketPhysics::VectorBatch3D A(n, 'A'), B(n, 'A'), R(n);
+        vector<float> Scalars(n);
+        for(size_t i = 0; i < n; i++){
+            A.Insert(RocketPhysics::Vector3D(sin(i * 0.01f), cos(i * 0.01f), 9.8f, 'A'));
+            B.Insert(RocketPhysics::Vector3D(0.1f, 0.2f, i * 1e-4f, 'A'));
+        }
+        int Passes = int((1 << 24) / n);
+        string Tag = " (" + to_string(n) + ")";
+
+        TimeBatch("Add" + Tag, n, Passes, [&](){ A.Add(B, R); Sink = R.X()[n - 1]; });
+        TimeBatch("Dot" + Tag, n, Passes, [&](){ A.Dot(B, Scalars.data()); Sink = Scalars[n - 1]; });
+        TimeBatch("Cross" + Tag, n, Passes, [&](){ A.Cross(B, R); Sink = R.X()[n - 1]; });
+        TimeBatch("Norm" + Tag, n, Passes, [&](){ A.Norm(Scalars.data()); Sink = Scalars[n - 1]; });
+        TimeBatch("Normalize" + Tag, n, Passes, [&](){ A.Normalize(R); Sink = R.X()[n - 1]; });
+
+        // The same cross product through the Vector3D operators, for comparison
+        TimeBatch("Vector3D cross loop" + Tag, n, Passes, [&](){
+            for(size_t i = 0; i < n; i++) {R.Set(i, A.Get(i) ^ B.Get(i));}
+            Sink = R.X()[n - 1]; });
+    }
+}
+
+void BenchmarkRotation(){
+    cout << endl << "== Body to world frame transforms ==" << endl;
+    const size_t n = 4096;
+    RocketPhysics::VectorBatch3D Body(n, 'A'), World(n);
+    vector<RocketPhysics::Quaternion> Attitudes(n);
+    for(size_t i = 0; i < n; i++){
+        Body.Insert(RocketPhysics::Vector3D(sin(i * 0.01f), cos(i * 0.01f), 9.8f, 'A'));
+        Attitudes[i] = RocketPhysics::Quaternion::FromEuler(i * 1e-4f, i * 2e-4f, i * 3e-4f);
+    }
+    RocketPhysics::Quaternion q = RocketPhysics::Quaternion::FromEuler(0.1f, 0.2f, 0.3f);
+    int Passes = 4096;
+
+    TimeBatch("Scalar Rotate(), one attitude", n, Passes, [&](){
+        for(size_t i = 0; i < n; i++) {World.Set(i, q.Rotate(Body.Get(i)));}
+        Sink = World.X()[n - 1]; });
+    TimeBatch("Batch Rotate(), one attitude", n, Passes, [&](){
+        q.Rotate(Body, World); Sink = World.X()[n - 1]; });
+    TimeBatch("Scalar Rotate(), per sample attitude", n, Passes, [&](){
+        for(size_t i = 0; i < n; i++) {World.Set(i, Attitudes[i].Rotate(Body.Get(i)));}
+        Sink = World.X()[n - 1]; });
+    TimeBatch("Batch Rotate(), per sample attitude", n, Passes, [&](){
+        RocketPhysics::Quaternion::Rotate(Attitudes.data(), Body, World); Sink = World.X()[n - 1]; });
+}
+
+void BenchmarkTrajectory(){
+    cout << endl << "== Trajectory integration (one IMU sample) ==" << endl;
+    const int Steps = 200000;
+    const float dt = 0.001f;
+
+    // Boost, burnout and coast with a little vibration on top
+    vector<RocketPhysics::Vector3D> Accel;
+    Accel.reserve(Steps);
+    for(int i = 0; i < Steps; i++){
+        float t = i * dt;
+        float Thrust = t < 3.0f ? 40.0f : -9.8f;
+        Accel.emplace_back(0.5f * sin(40.0f * t), 0.5f * cos(40.0f * t), Thrust + 2.0f * sin(300.0f * t), 'A');
+    }
+
+    RocketSensors::TrajectoryIntegrator Fixed, Adaptive(RocketSensors::TrajectoryIntegrator::AdaptiveRK4);
+    LatencyReport FixedReport = TimeEach(Steps, [&](int i){ Fixed.Step(Accel[i], dt); });
+    LatencyReport AdaptiveReport = TimeEach(Steps, [&](int i){ Adaptive.Step(Accel[i], dt); });
+    PrintReport("Fixed RK4", FixedReport);
+    PrintReport("Adaptive RK4", AdaptiveReport);
+    cout << fixed << setprecision(2)
+         << "Fixed RK4 " << 1e3 / FixedReport.MeanNs << " M steps/s, adaptive RK4 " << 1e3 / AdaptiveReport.MeanNs
+         << " M steps/s (" << Adaptive.GetAttemptsPerStep() << " step comparisons per sample)" << endl;
+
+    PrintReport("GPS correction", TimeEach(Steps, [&](int i){
+        Fixed.CorrectGPS(28.5 + i * 1e-9, -80.6, 100.0); }));
+
+    Sink = Fixed.GetPosition().GetZ() + Adaptive.GetPosition().GetZ();
+}
+
+/// @brief One 10 Hz epoch of a multi-constellation receiver: GGA, RMC, a GSA per constellation, three GSV
+/// each from GPS, GLONASS, Galileo and BeiDou, NAV-PVT and a 40 satellite NAV-SAT
+void AppendGPSEpoch(vector<uint8_t>& Stream, const RocketSensors::GPSFix& Fix){
+    char Text[RocketSensors::GPSParser::MaxSentence + 1];
+    uint8_t Binary[600], Satellites[8 + 12 * 40] = {};
+    auto Add = [&](const void* Data, size_t Length) { Stream.insert(Stream.end(), (const uint8_t*)Data, (const uint8_t*)Data + Length); };
+
+    Add(Text, RocketSensors::FormatGGA(Fix, Text, sizeof(Text)));
+    Add(Text, RocketSensors::FormatRMC(Fix, Text, sizeof(Text)));
+    const char* Talkers[4] = {"GP", "GL", "GA", "GB"};
+    for(int c = 0; c < 4; c++){
+        Add(Text, RocketSensors::FinishSentence(Text, snprintf(Text, sizeof(Text), "$GNGSA,A,3,01,03,07,08,11,14,17,19,22,28,30,32,1.2,0.7,0.9,%d", c + 1), sizeof(Text)));
+        for(int m = 1; m <= 3; m++){
+            Add(Text, RocketSensors::FinishSentence(Text, snprintf(Text, sizeof(Text), "$%sGSV,3,%d,10,%02d,45,120,40,%02d,30,200,38,%02d,10,300,35,%02d,60,045,44",
+                Talkers[c], m, 4 * m, 4 * m + 1, 4 * m + 2, 4 * m + 3), sizeof(Text)));
+        }
+    }
+    Add(Binary, RocketSensors::EncodeNavPvt(Fix, Binary, sizeof(Binary)));
+    Add(Binary, RocketSensors::EncodeUBX(0x01, 0x35, Satellites, sizeof(Satellites), Binary, sizeof(Binary)));
+}
+
+void BenchmarkGPS(){
+    cout << endl << "== GPS parser (10 Hz multi-constellation NMEA + UBX) ==" << endl;
+    const int Epochs = 3000; // 5 minutes at 10 Hz
+    vector<uint8_t> Stream;
+    RocketSensors::GPSFix Fix;
+    Fix.Valid = true;
+    Fix.Satellites = 32;
+    Fix.DOP = 0.7f;
+    for(int i = 0; i < Epochs; i++){
+        Fix.TimeOfDay = 45296000 + 100 * i;
+        Fix.Latitude = 34.0691 + 1e-6 * i;
+        Fix.Longitude = 72.6441 + 2e-6 * i;
+        Fix.Altitude = 350.0f + 0.5f * float(i);
+        Fix.VelocityNorth = 3.0f; Fix.VelocityEast = 6.0f; Fix.VelocityUp = 5.0f;
+        AppendGPSEpoch(Stream, Fix);
+    }
+    double BytesPerEpoch = double(Stream.size()) / Epochs;
+
+    // 64 byte chunks, as a UART DMA half buffer would hand them over
+    RocketSensors::GPSParser Parser;
+    TimeBatch("parse, 64 byte chunks (per byte)", Stream.size(), 20, [&](){
+        for(size_t i = 0; i < Stream.size(); i += 64) {Parser.Feed(Stream.data() + i, min<size_t>(64, Stream.size() - i));} });
+    TimeBatch("parse, whole stream (per byte)", Stream.size(), 20, [&](){ Parser.Feed(Stream.data(), Stream.size()); });
+
+    RocketSensors::BinarySearchTree Sensors;
+    Sensors.create('N');
+    Sensors.create('K');
+    RocketSensors::GPSParser Published;
+    Published.Bind(Sensors);
+    Coordinates Logged;
+    Published.SetHandler(RocketSensors::StoreFix<Coordinates>, &Logged);
+    TimeBatch("parse + registry + log record (per byte)", Stream.size(), 2, [&](){ Published.Feed(Stream.data(), Stream.size()); });
+
+    PrintReport("one epoch, 64 byte chunks", TimeEach(Epochs, [&](int i){
+        size_t Begin = size_t(i * BytesPerEpoch), End = size_t((i + 1) * BytesPerEpoch);
+        for(size_t j = Begin; j < End; j += 64) {Parser.Feed(Stream.data() + j, min<size_t>(64, End - j));} }));
+    const RocketSensors::GPSStats& Stats = Parser.GetStats();
+    cout << "  " << fixed << setprecision(0) << BytesPerEpoch << " bytes per epoch (" << BytesPerEpoch * 10.0 * 10.0 / 1000.0
+         << " kbaud at 10 Hz), " << Stats.Fixes << " fixes, " << Stats.ChecksumErrors << " checksum errors, last fix "
+         << setprecision(5) << Parser.GetFix().Latitude << ", " << Parser.GetFix().Longitude << endl;
+}
+
+void BenchmarkApogee(){
+    cout << endl << "== Apogee prediction (100 Hz altitude, 64 sample window) ==" << endl;
+    const double k = 0.0004, dt = 0.01;
+
+    // Reference flight: 3 s boost at 5 g, then a drag-limited coast, integrated finely
+    vector<double> Times, Altitudes;
+    double h = 0.0, v = 0.0, t = 0.0, TrueTime = 0.0, TrueAltitude = 0.0;
+    while(t < 1.0 || v > -20.0){
+        for(int i = 0; i < 10; i++){
+            double a = (t < 3.0 ? 50.0 : 0.0) - GRAVITY - k * v * fabs(v);
+            v += a * dt / 10.0;
+            h += v * dt / 10.0;
+            t += dt / 10.0;
+        }
+        Times.push_back(t);
+        Altitudes.push_back(h);
+        if(h > TrueAltitude) {TrueAltitude = h; TrueTime = t;}
+    }
+
+    const double Leads[4] = {8.0, 4.0, 2.0, 1.0};
+    for(double Noise : {0.0, 0.5, 2.0}){
+        apogeePredictor<64> Predictor;
+        uint32_t Seed = 1;
+        cout << "altitude noise " << setprecision(1) << Noise << " m rms:";
+        for(size_t i = 0; i < Times.size(); i++){
+            Seed = Seed * 1664525u + 1013904223u;
+            double Uniform = (Seed >> 8) / 16777216.0 - 0.5;
+            const apogeeEstimate& e = Predictor.update(float(Times[i]), float(Altitudes[i] + Uniform * Noise * sqrt(12.0)));
+            for(double Lead : Leads){
+                if(fabs(TrueTime - Times[i] - Lead) < dt / 2){
+                    cout << "  " << setprecision(0) << Lead << " s before: " << setprecision(2)
+                         << e.altitude - TrueAltitude << " m, " << e.time - TrueTime << " s";
+                }
+            }
+        }
+        cout << endl;
+    }
+
+    apogeePredictor<64> Predictor;
+    size_t n = Times.size();
+    PrintReport("apogeePredictor::update", TimeEach(int(n) * 20, [&](int i){
+        size_t j = size_t(i) % n;
+        if(j == 0) {Predictor.reset();}
+        Sink = Predictor.update(float(Times[j]), float(Altitudes[j])).altitude; }));
+}
+
+void BenchmarkAtmosphere(){
+    cout << endl << "== Standard atmosphere (tables vs closed form) ==" << endl;
+    const size_t n = 4096;
+    vector<float> Pressures(n), Altitudes(n), Out(n);
+    for(size_t i = 0; i < n; i++){
+        Pressures[i] = 100.0f + 1000.0f * (i * 0.618034f - floor(i * 0.618034f));
+        Altitudes[i] = 15000.0f * (i * 0.414214f - floor(i * 0.414214f));
+    }
+    int Passes = 4096;
+
+    TimeBatch("Altitude, closed form (pow)", n, Passes, [&](){
+        for(size_t i = 0; i < n; i++) {Out[i] = RocketPhysics::Atmosphere::ClosedFormAltitude(Pressures[i]);}
+        Sink = Out[n - 1]; });
+    TimeBatch("Altitude, table", n, Passes, [&](){
+        for(size_t i = 0; i < n; i++) {Out[i] = RocketPhysics::Atmosphere::Altitude(Pressures[i]);}
+        Sink = Out[n - 1]; });
+    TimeBatch("Altitude, table column", n, Passes, [&](){
+        RocketPhysics::Atmosphere::Altitude(Pressures.data(), Out.data(), n); Sink = Out[n - 1]; });
+    TimeBatch("Density, closed form (pow/exp)", n, Passes, [&](){
+        for(size_t i = 0; i < n; i++) {Out[i] = RocketPhysics::Atmosphere::ClosedFormDensity(Altitudes[i]);}
+        Sink = Out[n - 1]; });
+    TimeBatch("Density, table column", n, Passes, [&](){
+        RocketPhysics::Atmosphere::Density(Altitudes.data(), Out.data(), n); Sink = Out[n - 1]; });
+    TimeBatch("Speed of sound, closed form (sqrt)", n, Passes, [&](){
+        for(size_t i = 0; i < n; i++) {Out[i] = RocketPhysics::Atmosphere::ClosedFormSpeedOfSound(Altitudes[i]);}
+        Sink = Out[n - 1]; });
+    TimeBatch("Speed of sound, table column", n, Passes, [&](){
+        RocketPhysics::Atmosphere::SpeedOfSound(Altitudes.data(), Out.data(), n); Sink = Out[n - 1]; });
+
+    // Worst errors against the double precision ISA equations, by pressure range
+    const float Floors[4] = {10.0f, 55.0f, 100.0f, 200.0f};
+    for(float Floor : Floors){
+        double TableError = 0.0, ClosedError = 0.0;
+        for(float p = Floor; p <= 1100.0f; p += 0.0137f){
+            double Reference = RocketPhysics::ISA::Altitude(p * 100.0);
+            TableError = max(TableError, fabs(RocketPhysics::Atmosphere::Altitude(p) - Reference));
+            ClosedError = max(ClosedError, fabs(RocketPhysics::Atmosphere::ClosedFormAltitude(p) - Reference));
+        }
+        cout << "Altitude error " << setprecision(0) << Floor << "-1100 hPa: table " << setprecision(3) << TableError
+             << " m, closed form " << ClosedError << " m" << endl;
+    }
+    double DensityError = 0.0, SoundError = 0.0;
+    for(float h = -1000.0f; h <= 32000.0f; h += 0.77f){
+        double Reference = RocketPhysics::ISA::Density(h);
+        DensityError = max(DensityError, fabs(RocketPhysics::Atmosphere::Density(h) - Reference) / Reference);
+        SoundError = max(SoundError, fabs(RocketPhysics::Atmosphere::SpeedOfSound(h) - RocketPhysics::ISA::SpeedOfSound(h)));
+    }
+    cout << "Density relative error " << scientific << setprecision(1) << DensityError << ", speed of sound error "
+         << SoundError << " m/s" << fixed << endl;
+}
+
+void BenchmarkExecutive(){
+    cout << endl << "== Control executive (1 kHz, AHRS + trajectory step per cycle) ==" << endl;
+    RocketSensors::AHRS Filter(RocketSensors::AHRS::Madgwick, 1000.0f);
+    RocketSensors::TrajectoryIntegrator Track;
+    RocketPhysics::Vector3D Gyro(0.01f, 0.02f, 0.0f, 'R'), Accel(0.1f, 0.0f, 29.0f, 'A'), Mag(0.22f, 0.0f, -0.4f, 'M');
+
+    cout << (enableRealtime() ? "SCHED_FIFO" : "SCHED_OTHER (no permission for SCHED_FIFO)") << endl;
+    ControlExecutive Executive(1000000);
+    LatencyMonitor Latency;
+    // The samples are taken as the cycle starts, so the sample age is only the clock read
+    Executive.setStage(ControlExecutive::SENSE, [&](){ Latency.sensed(0, monotonicNs()); });
+    Executive.setStage(ControlExecutive::ESTIMATE, [&](){
+        Filter.Update(Gyro, Accel, Mag, 0.001f);
+        Track.Step(Filter, 0.001f); });
+    Executive.setStage(ControlExecutive::CONTROL, [&](){
+        Sink = Filter.GetPitch() + Track.GetPosition().GetZ();
+        Latency.controlled(monotonicNs()); });
+    Executive.setStage(ControlExecutive::ACTUATE, [&](){ Latency.actuated(monotonicNs()); });
+    Executive.run(5000);
+    Executive.report(cout);
+    Latency.report(cout);
+}
+
+void BenchmarkLatencyHistogram(){
+    cout << endl << "== Latency histograms ==" << endl;
+    LatencyHistogram Histogram;
+    PrintReport("record", TimeEach(1000000, [&](int i){ Histogram.record(int64_t(i) * 37); }));
+    LatencyMonitor Monitor;
+    PrintReport("sensed + controlled + actuated", TimeEach(1000000, [&](int i){
+        Monitor.sensed(1000000 + i, i); Monitor.controlled(i + 2000); Monitor.actuated(i + 3000); }));
+    PrintReport("monitor snapshot (4 histograms)", TimeEach(2000, [&](int){
+        Sink = float(Monitor.snapshot().stages[LatencyMonitor::END_TO_END].p99Ns); }));
+}
+
+/// @brief Busy work standing in for a task body
+void Spin(int64_t Ns){
+    int64_t End = monotonicNs() + Ns;
+    while(monotonicNs() < End) {}
+}
+
+void BenchmarkScheduler(){
+    cout << endl << "== Task scheduler (sense 1 kHz, fusion 500 Hz, control 200 Hz, log 50 Hz, telemetry 50 Hz) ==" << endl;
+    cout << (enableRealtime() ? "SCHED_FIFO" : "SCHED_OTHER (no permission for SCHED_FIFO)") << endl;
+    const TaskScheduler::Policy Policies[2] = {TaskScheduler::Policy::EDF, TaskScheduler::Policy::RATE_MONOTONIC};
+
+    for(TaskScheduler::Policy Policy : Policies){
+        TaskScheduler Scheduler(Policy);
+        // Jobs use about 70% of their budget
+        Scheduler.addTask("sense", 1000000, 1000000, 50000, [](){ Spin(35000); });
+        Scheduler.addTask("fusion", 2000000, 2000000, 100000, [](){ Spin(70000); });
+        Scheduler.addTask("control", 5000000, 5000000, 300000, [](){ Spin(210000); });
+        Scheduler.addTask("log", 20000000, 20000000, 500000, [](){ Spin(350000); });
+
+        // A 2 ms telemetry frame every 100 ms would block the 1 kHz sensing task past its deadline, so it is sent as 400 us chunks at 50 Hz
+        bool Whole = Scheduler.admissible(100000000, 100000000, 2000000);
+        Scheduler.addTask("telemetry", 20000000, 20000000, 400000, [](){ Spin(280000); });
+        cout << "2 ms telemetry job " << (Whole ? "admitted" : "rejected") << ", 400 us chunks admitted" << endl;
+
+        Scheduler.run(2000000000);
+        Scheduler.report(cout);
+    }
+}
+
+void BenchmarkFinMixing(){
+    cout << endl << "== Grid fin mixing (pitch, yaw, roll to every fin) ==" << endl;
+    const int FinCounts[3] = {4, 8, 16};
+    for(int Count : FinCounts){
+        gridSystem Fins(Count);
+        for(int i = 0; i < Count; i++) {Fins.addFin(i, i & 1, (i >> 1) & 1);}
+        PrintReport(to_string(Count) + " fins", TimeEach(200000, [&](int i){
+            Fins.mix(float(i & 63) - 32.0f, 10.0f, 2.0f); Sink = Fins.fins[Count - 1].angle; }));
+    }
+}
+
+void BenchmarkPID(){
+    cout << endl << "== PID bank (filtered derivative, anti-windup, rate limit) ==" << endl;
+    const int Loops = 16, Steps = 100000;
+    pidBank<Loops> Bank;
+    gainSchedule<8> Schedule;
+    for(int p = 0; p < 8; p++) {Schedule.addPoint(p * 5000.0f, pidGains(2.0f / (1 + p), 0.5f, 0.05f, 0.1f));}
+
+    for(int i = 0; i < Loops; i++){
+        pidConfig Config(-60.0f, 60.0f);
+        Config.derivativeCutoff = 30.0f;
+        Config.rateLimit = 600.0f;
+        Config.windup = (i & 1) ? BACK_CALCULATION : CLAMPING;
+        Bank.add(pidGains(1.0f, 0.5f, 0.05f), Config);
+    }
+
+    float Setpoints[Loops], Measurements[Loops], Outputs[Loops];
+    for(int i = 0; i < Loops; i++) {Setpoints[i] = float(i); Measurements[i] = 0.0f;}
+
+    PrintReport("16 loops, updateAll", TimeEach(Steps, [&](int k){
+        Measurements[k & (Loops - 1)] += 0.01f;
+        Bank.updateAll(Setpoints, Measurements, Outputs, 0.001f);
+        Sink = Outputs[Loops - 1]; }));
+    PrintReport("16 loops, gain schedule + updateAll", TimeEach(Steps, [&](int k){
+        float q = dynamicPressure(1.0f, float(k & 255));
+        Measurements[k & (Loops - 1)] -= 0.01f;
+        for(int i = 0; i < Loops; i++) {Bank.schedule(i, Schedule, q);}
+        Bank.updateAll(Setpoints, Measurements, Outputs, 0.001f);
+        Sink = Outputs[Loops - 1]; }));
+}
+
+void BenchmarkAllocation(){
+    cout << endl << "== Control allocation (gimbal + 16 fins, redistributed pseudo-inverse) ==" << endl;
+    gridSystem Fins(16);
+    for(int i = 0; i < 16; i++) {Fins.addFin(i, i & 1, (i >> 1) & 1);}
+    controlAllocator Allocator;
+    Allocator.configure(Fins, 8.0f, 60.0f, 300.0f);
+    Allocator.setEffectiveness(Fins, 50.0f, 10.0f);
+
+    // Random demands from well inside the envelope to far outside it (position limits only), and a smooth
+    // demand at 1 kHz where the rate limits also bind
+    const int Calls = 100000;
+    vector<RocketPhysics::Vector<3>> Random(Calls), Smooth(Calls);
+    uint32_t Seed = 7;
+    for(int i = 0; i < Calls; i++){
+        for(int r = 0; r < 3; r++){
+            Seed = Seed * 1664525u + 1013904223u;
+            Random[i][r] = ((Seed >> 8) / 16777216.0f - 0.5f) * 12000.0f;
+        }
+        float t = i * 0.001f;
+        Smooth[i] = RocketPhysics::Vector<3>{1200.0f * sin(3.0f * t), 900.0f * cos(2.0f * t), 400.0f * sin(5.0f * t)};
+    }
+
+    const vector<RocketPhysics::Vector<3>>* Sets[2] = {&Random, &Smooth};
+    const float Periods[2] = {0.0f, 0.001f};
+    const string Names[2] = {"allocate(), random demand", "allocate(), smooth demand at 1 kHz"};
+    for(int k = 0; k < 2; k++){
+        const vector<RocketPhysics::Vector<3>>& Moments = *Sets[k];
+        int MostPasses = 0, Unmet = 0;
+        for(int i = 0; i < Calls; i++){
+            if(!Allocator.allocate(Moments[i], Periods[k])) {Unmet++;}
+            MostPasses = max(MostPasses, Allocator.lastIterations);
+        }
+        PrintReport(Names[k], TimeEach(Calls, [&](int i){
+            Allocator.allocate(Moments[i], Periods[k]); Sink = Allocator.position[17]; }));
+        cout << "  most passes " << MostPasses << ", saturated in " << Unmet << " of " << Calls << " calls" << endl;
+    }
+}
+
+/// @brief One producer thread sends Count commands to a consumer spinning on tryPop, which records the
+/// enqueue to execute latency of each
+template<typename Ring>
+LatencyReport CommandLatency(Ring& Commands, int Count){
+    vector<double> Latencies;
+    Latencies.reserve(Count);
+
+    thread Producer([&](){
+        for(int i = 0; i < Count; i++){
+            command c{CMD_PITCH, 0, uint16_t(i), float(i & 15), monotonicNs()};
+            while(!Commands.tryPush(c)) {this_thread::yield();}
+            if((i & 63) == 63) {this_thread::yield();}
+        }
+    });
+
+    command c;
+    while(int(Latencies.size()) < Count){
+        if(Commands.tryPop(c)) {Latencies.push_back(double(monotonicNs() - c.issuedNs));}
+        else {this_thread::yield();}
+    }
+    Producer.join();
+    return Summarise(Latencies);
+}
+
+void BenchmarkCommands(){
+    cout << endl << "== Command rings (16 byte commands) ==" << endl;
+    spscRing<command, 256> Spsc;
+    mpscRing<command, 256> Mpsc;
+    command c{CMD_SET_FIN, 1, 0, 5.0f, 0};
+
+    PrintReport("SPSC tryPush + tryPop, one thread", TimeEach(1000000, [&](int i){
+        c.sequence = uint16_t(i); Spsc.tryPush(c); command Out{}; Spsc.tryPop(Out); Sink = Out.value; }));
+    PrintReport("MPSC tryPush + tryPop, one thread", TimeEach(1000000, [&](int i){
+        c.sequence = uint16_t(i); Mpsc.tryPush(c); command Out{}; Mpsc.tryPop(Out); Sink = Out.value; }));
+    PrintReport("SPSC enqueue to execute, two threads", CommandLatency(Spsc, 200000));
+    PrintReport("MPSC enqueue to execute, two threads", CommandLatency(Mpsc, 200000));
+}
+
+void BenchmarkRecovery(){
+    cout << endl << "== Recovery sequencer (5 charges) ==" << endl;
+    parachute Chutes[5];
+    recoveryController Recovery;
+    for(int i = 0; i < 5; i++){
+        Chutes[i].DeploySequence = i;
+        Recovery.addAction(Chutes[i], i < 2 ? PHASE_APOGEE : PHASE_MAIN, 0.5f * float(i));
+    }
+    Recovery.update(0.0f, 0.0f, 0.0f, 50.0f);
+    Recovery.update(0.1f, 0.0f, 0.0f, 50.0f);
+    PrintReport("update, ascent (no transition)", TimeEach(1000000, [&](int i){
+        Sink = float(Recovery.update(0.2f + 1e-6f * float(i), 100.0f, 50.0f, 10.0f)); }));
+
+    // A whole flight at 100 Hz: 1 s boost, coast to apogee, 20 m/s under the drogue, 5 m/s under the main
+    const int Cycles = 6000;
+    vector<float> Heights(Cycles), Speeds(Cycles), Accels(Cycles);
+    float h = 0.0f, v = 0.0f;
+    for(int i = 0; i < Cycles; i++){
+        float t = 0.01f * float(i);
+        float a = t < 1.0f ? 40.0f : -9.8f;
+        v = max(v + a * 0.01f, h > 150.0f ? -20.0f : -5.0f);
+        h = max(0.0f, h + v * 0.01f);
+        if(h == 0.0f && t > 2.0f) {v = 0.0f;}
+        Heights[i] = h; Speeds[i] = v; Accels[i] = t < 1.0f ? 50.0f : 0.0f;
+    }
+    int Landed = 0;
+    TimeBatch("update, pad to landing (per cycle)", Cycles, 200, [&](){
+        Recovery.reset();
+        for(int i = 0; i < Cycles; i++) {Recovery.update(0.01f * float(i), Heights[i], Speeds[i], Accels[i]);}
+        Landed += Recovery.getPhase() == PHASE_LANDED; });
+    cout << "  " << Landed << " of 200 flights landed, " << Recovery.firedCount() << " charges fired, trigger to pyro less delay max "
+         << fixed << setprecision(1) << Recovery.latency().snapshot().maxNs / 1e6 << " ms" << endl;
+}
+
+void BenchmarkLanding(){
+    cout << endl << "== Landing prediction (one fix under the drogue) ==" << endl;
+    landingPredictor Landing;
+    Landing.setPad(34.0691, 72.6441);
+    RocketSensors::GPSFix Fix;
+    Fix.Valid = Fix.HaveVelocity = true;
+    Fix.Latitude = 34.0691;
+    Fix.Longitude = 72.6441;
+    Fix.VelocityNorth = 4.0f;
+    Fix.VelocityEast = 2.0f;
+    for(int i = 0; i < 300; i++) {Landing.update(0.1f * float(i), Fix, 10.0f * float(i), 100.0f, PHASE_ASCENT);}
+    const float Altitudes[3] = {300.0f, 1000.0f, 3000.0f};
+    for(float Altitude : Altitudes){
+        PrintReport("update at " + to_string(int(Altitude)) + " m", TimeEach(100000, [&](int i){
+            Landing.update(30.0f + 1e-4f * float(i), Fix, Altitude, -20.0f, PHASE_DROGUE);
+            Sink = Landing.prediction().north; }));
+    }
+    PrintReport("ellipse (32 predictions)", TimeEach(100000, [&](int){ Sink = Landing.ellipse().major; }));
+}
+
+void BenchmarkVehicleConfig(){
+    cout << endl << "== Vehicle file (vehicle.ini) ==" << endl;
+    ifstream File("vehicle.ini", ios::binary);
+    if(!File){
+        cout << "  vehicle.ini not found, run from the repository root" << endl;
+        return;
+    }
+    stringstream Buffer;
+    Buffer << File.rdbuf();
+    string Text = Buffer.str();
+
+    VehicleConfig Vehicle;
+    PrintReport("parse + validate", TimeEach(20000, [&](int){
+        Vehicle.parse(Text); Sink = float(Vehicle.fins.size()); }));
+    PrintReport("parse + build fins and chutes", TimeEach(20000, [&](int){
+        Vehicle.parse(Text);
+        gridSystem Fins(Vehicle.finCount);
+        Vehicle.buildFins(Fins);
+        vector<parachute> Chutes = Vehicle.makeParachutes();
+        Sink = Fins.mixing(0, 0) + float(Chutes.size()); }));
+}
+
+void BenchmarkSimulation(){
+    cout << endl << "== 6-DOF simulator ==" << endl;
+    RocketSimulation::FlightSimulator Flight(RocketSimulation::VehicleModel(), RocketSimulation::Motor::Example(),
+                                             RocketSimulation::Wind(5.0f, 0.3f), RocketSimulation::SensorNoise(), 1, 0.0f);
+    Flight.SetFinLayout(0, true, true);
+    Flight.SetFinAngle(0, 2.0f);
+    PrintReport("RK4 step, 2 ms", TimeEach(20000, [&](int){
+        if(!Flight.Step(0.002f)) {Flight.Reset(1);}
+        Sink = Flight.GetState().Position.GetZ(); }));
+    PrintReport("Sensor sample", TimeEach(20000, [&](int){ Sink = Flight.Sample().PressureHPa; }));
+
+    VehicleConfig Vehicle;
+    ifstream File("vehicle.ini");
+    if(!File || !Vehicle.load("vehicle.ini")){
+        cout << "  vehicle.ini not found, run from the repository root" << endl;
+        return;
+    }
+    const int Flights = 20;
+    double Simulated = 0.0, Elapsed = 0.0, DrogueError = 0.0, MainError = 0.0;
+    int Predicted = 0;
+    for(int i = 0; i < Flights; i++){
+        RocketSimulation::ClosedLoopFlight Closed(Vehicle, RocketSimulation::VehicleModel(), RocketSimulation::Motor::Example(),
+                                                  RocketSimulation::Wind(5.0f, 0.3f), RocketSimulation::SensorNoise(), uint64_t(i + 1));
+        auto Start = chrono::steady_clock::now();
+        RocketSimulation::FlightResult Result = Closed.Run();
+        Elapsed += chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+        Simulated += Result.Record.LandingTime;
+        if(Result.DroguePredictionError >= 0.0f && Result.MainPredictionError >= 0.0f){
+            DrogueError += Result.DroguePredictionError;
+            MainError += Result.MainPredictionError;
+            Predicted++;
+        }
+    }
+    cout << "  closed loop flight (100 Hz control, 2 ms physics)  " << fixed << setprecision(1)
+         << 1000.0 * Elapsed / Flights << " ms per " << Simulated / Flights << " s flight, "
+         << setprecision(0) << Simulated / Elapsed << "x real time" << endl;
+    if(Predicted){
+        cout << "  landing prediction error, first fix under the drogue " << setprecision(1) << DrogueError / Predicted
+             << " m, at main deployment " << MainError / Predicted << " m (mean of " << Predicted << " flights)" << endl;
+    }
+}
+
+void BenchmarkMonteCarlo(){
+    cout << endl << "== Monte Carlo dispersion ==" << endl;
+    VehicleConfig Vehicle;
+    ifstream File("vehicle.ini");
+    if(!File || !Vehicle.load("vehicle.ini")){
+        cout << "  vehicle.ini not found, run from the repository root" << endl;
+        return;
+    }
+    RocketSimulation::MonteCarloRunner Runner(Vehicle, RocketSimulation::VehicleModel(), RocketSimulation::Motor::Example());
+    const int Flights = 200;
+    const uint64_t Seed = 2024;
+
+    auto Start = chrono::steady_clock::now();
+    vector<RocketSimulation::FlightOutcome> Serial = Runner.RunSerial(Flights, Seed);
+    double SerialSeconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+    cout << "  serial              " << fixed << setprecision(0) << Flights / SerialSeconds << " flights/s" << endl;
+
+    unsigned Cores = thread::hardware_concurrency();
+    vector<unsigned> Counts = {1, 2, 4};
+    if(Cores > 4) {Counts.push_back(Cores);}
+    for(unsigned Threads : Counts){
+        WorkStealingPool Pool(Threads);
+        Start = chrono::steady_clock::now();
+        vector<RocketSimulation::FlightOutcome> Parallel = Runner.Run(Flights, Seed, Pool);
+        double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+        bool Same = true;
+        for(int i = 0; i < Flights; i++){
+            Same = Same && Parallel[i].Apogee == Serial[i].Apogee && Parallel[i].LandingX == Serial[i].LandingX;
+        }
+        cout << "  " << setw(2) << Threads << " threads          " << setprecision(0) << Flights / Seconds
+             << " flights/s, speedup " << setprecision(2) << SerialSeconds / Seconds << ", " << Pool.steals()
+             << " steals" << (Same ? "" : ", OUTCOMES DIFFER FROM SERIAL") << endl;
+    }
+    cout << "  hardware threads " << Cores << endl;
+    RocketSimulation::Summarise(Serial).Report(cout);
+}
+
+/// @brief A climbing, turning vehicle sampled at 100 Hz, as the flight log records it
+vector<Logs> TelemetryFlight(int Samples){
+    vector<Logs> Flight(Samples);
+    for(int i = 0; i < Samples; i++){
+        double t = 0.01 * i;
+        Logs& l = Flight[i];
+        l.timestamp = 1000.0 + t;
+        l.gps = Coordinates(34.0691 + 1e-6 * t, 72.6441 + 2e-6 * t, 350.0 + 80.0 * t - 0.4 * t * t);
+        l.bearing = fmod(10.0 * t, 360.0);
+        l.velocity = 80.0 - 0.8 * t;
+        l.acceleration = -4.0 + sin(t);
+        l.temperature = 25.0 - 0.0065 * 80.0 * t;
+        l.pressure = 970.0 - 0.1 * t;
+    }
+    return Flight;
+}
+
+void BenchmarkTelemetry(){
+    cout << endl << "== Telemetry frames (Logs records, COBS + CRC) ==" << endl;
+    const int Samples = 20000;
+    vector<Logs> Flight = TelemetryFlight(Samples);
+
+    DataLogger Formatter("/dev/null");
+    double CsvBytes = 0.0;
+    for(const Logs& l : Flight) {CsvBytes += Formatter.formatDataForFile(l).size() + 1;}
+    cout << "  formatDataForFile line   " << fixed << setprecision(1) << CsvBytes / Samples << " bytes per sample" << endl;
+
+    // Bytes on the wire per sample for one record per frame and for full frames
+    uint8_t Wire[TELEMETRY_MAX_ENCODED];
+    for(TelemetryCheck Check : {CHECK_CRC16, CHECK_CRC32}){
+        for(size_t Limit : {size_t(32), size_t(128), TELEMETRY_MAX_FRAME}){
+            TelemetryFrameWriter Writer(Check, Limit);
+            size_t Bytes = 0, Frames = 0;
+            for(int i = 0; i < Samples; ){
+                Writer.begin(uint16_t(Frames));
+                while(i < Samples && Writer.append<LogMessage>(Flight[i])) {i++;}
+                Bytes += Writer.finish(Wire);
+                Frames++;
+            }
+            cout << "  " << (Check == CHECK_CRC32 ? "CRC-32" : "CRC-16") << ", frames of " << setw(3) << Limit << " bytes "
+                 << setw(6) << setprecision(1) << double(Bytes) / Samples << " bytes per sample, "
+                 << setprecision(1) << double(Samples) / Frames << " samples per frame" << endl;
+        }
+    }
+
+    // Full 255 byte frames, 10 records each
+    TelemetryFrameWriter Writer(CHECK_CRC16);
+    const int PerFrame = int((TELEMETRY_MAX_FRAME - TELEMETRY_HEADER_BYTES - 2) * 8 / LogMessage::MESSAGE_BITS);
+    const int Frames = Samples / PerFrame;
+    vector<vector<uint8_t>> Encoded(Frames);
+    PrintReport("encode, " + to_string(PerFrame) + " records per frame", TimeEach(Frames, [&](int f){
+        Writer.begin(uint16_t(f));
+        for(int i = 0; i < PerFrame; i++) {Writer.append<LogMessage>(Flight[f * PerFrame + i]);}
+        size_t Length = Writer.finish(Wire);
+        Sink = Wire[Length / 2]; }));
+    for(int f = 0; f < Frames; f++){
+        Writer.begin(uint16_t(f));
+        for(int i = 0; i < PerFrame; i++) {Writer.append<LogMessage>(Flight[f * PerFrame + i]);}
+        size_t Length = Writer.finish(Wire);
+        Encoded[f].assign(Wire, Wire + Length - 1);
+    }
+    TelemetryFrameReader Reader(CHECK_CRC16);
+    double Error = 0.0;
+    int Decoded = 0;
+    PrintReport("decode, " + to_string(PerFrame) + " records per frame", TimeEach(Frames, [&](int f){
+        TelemetryCodec<LogMessage>::decode(Reader, Encoded[f].data(), Encoded[f].size(), [&](auto, const Logs& l){
+            Sink = float(l.gps.altitude); });
+    }));
+    for(int f = 0; f < Frames; f++){
+        int Index = f * PerFrame;
+        TelemetryCodec<LogMessage>::decode(Reader, Encoded[f].data(), Encoded[f].size(), [&](auto, const Logs& l){
+            Error = max(Error, fabs(l.gps.altitude - Flight[Index++].gps.altitude));
+            Decoded++; });
+    }
+
+    vector<uint8_t> Block(TELEMETRY_MAX_FRAME);
+    for(size_t i = 0; i < Block.size(); i++) {Block[i] = uint8_t(i * 37 + 11);}
+    TimeBatch("CRC-16 (per byte)", Block.size(), 200000, [&](){ Sink = crc16(Block.data(), Block.size()); });
+    TimeBatch("CRC-32 (per byte)", Block.size(), 200000, [&](){ Sink = float(crc32(Block.data(), Block.size())); });
+    TimeBatch("COBS encode (per byte)", Block.size(), 200000, [&](){ Sink = float(cobsEncode(Block.data(), Block.size(), Wire)); });
+    cout << "  " << Decoded << " of " << Frames * PerFrame << " records decoded, worst altitude error "
+         << setprecision(3) << Error * 100.0 << " cm" << endl;
+}
+
+/// @brief One 60 s flight through the scheduler: a 100 Hz control loop offering attitude, GPS and housekeeping
+/// every cycle and an event at apogee and at main deployment
+void FlyTelemetry(TelemetryScheduler& Link, int Events, int Attitude, int GPS, int Housekeeping){
+    uint8_t Out[TELEMETRY_MAX_ENCODED];
+    RocketSensors::GPSFix Fix;
+    Fix.Valid = true;
+    HousekeepingSample Health;
+    for(int i = 0; i < 6000; i++){
+        double t = 0.01 * i;
+        if(i == 1500 || i == 4500) {Link.offer<EventMessage>(Events, FlightEvent(t, i == 1500 ? PHASE_APOGEE : PHASE_MAIN, 450.0), t);}
+        Link.offer<AttitudeMessage>(Attitude, AttitudeSample(t, sin(t), cos(t), 0.1 * t), t);
+        Fix.TimeOfDay = uint32_t(45296000 + 10 * i);
+        Fix.Latitude = 34.0691 + 1e-7 * i;
+        Link.offer<GPSMessage>(GPS, Fix, t);
+        Health.time = t;
+        Link.offer<HousekeepingMessage>(Housekeeping, Health, t);
+        Link.poll(t, Out);
+    }
+}
+
+void BenchmarkTelemetryScheduler(){
+    cout << endl << "== Telemetry scheduler (attitude 50 Hz, GPS 5 Hz, housekeeping 1 Hz, events) ==" << endl;
+    for(double Budget : {2000.0, 960.0, 480.0, 240.0}){
+        TelemetryScheduler Link(Budget);
+        int Events = Link.addStream<EventMessage>("events", 0, 0.0, 16);
+        int Attitude = Link.addStream<AttitudeMessage>("attitude", 1, 50.0);
+        int GPS = Link.addStream<GPSMessage>("gps", 2, 5.0);
+        int Housekeeping = Link.addStream<HousekeepingMessage>("housekeeping", 3, 1.0);
+        FlyTelemetry(Link, Events, Attitude, GPS, Housekeeping);
+        cout << "  " << fixed << setprecision(0) << setw(5) << Budget << " B/s  " << setprecision(1)
+             << setw(5) << 100.0 * Link.utilisation() << "% used, " << setw(3) << Link.frameCount() << " frames";
+        for(int i : {Attitude, GPS, Housekeeping}){
+            cout << ", " << Link.streamName(i) << " " << setprecision(1) << Link.achievedRate(i) << " Hz ("
+                 << Link.stats(i).dropped << " dropped)";
+        }
+        cout << ", events delay max " << setprecision(0) << 1000.0 * Link.stats(Events).maxDelay << " ms" << endl;
+    }
+
+    // Cost per control cycle: four offers (three decimated most of the time) and a poll, a frame every few cycles
+    TelemetryScheduler Link(960.0);
+    int Events = Link.addStream<EventMessage>("events", 0, 0.0, 16);
+    int Attitude = Link.addStream<AttitudeMessage>("attitude", 1, 50.0);
+    int GPS = Link.addStream<GPSMessage>("gps", 2, 5.0);
+    int Housekeeping = Link.addStream<HousekeepingMessage>("housekeeping", 3, 1.0);
+    uint8_t Out[TELEMETRY_MAX_ENCODED];
+    RocketSensors::GPSFix Fix;
+    HousekeepingSample Health;
+    size_t Frames = 0;
+    PrintReport("offer x3 + poll, per 100 Hz cycle", TimeEach(200000, [&](int i){
+        double t = 0.01 * i;
+        Link.offer<AttitudeMessage>(Attitude, AttitudeSample(t, 1.0, 2.0, 3.0), t);
+        Link.offer<GPSMessage>(GPS, Fix, t);
+        Link.offer<HousekeepingMessage>(Housekeeping, Health, t);
+        Frames += Link.poll(t, Out) > 0; }));
+    Sink = float(Frames + Events);
+}
+
+/// @brief A radio that flips bits at random and loses bursts of bytes to fades, the bytes of a burst turning to noise
+vector<uint8_t> LossyChannel(const vector<uint8_t>& Stream, double BitErrorRate, double BurstsPerByte, int BurstBytes, uint64_t Seed){
+    RocketSimulation::Random Noise(Seed);
+    vector<uint8_t> Out(Stream);
+    double ByteErrorRate = 1.0 - pow(1.0 - BitErrorRate, 8.0);
+    for(size_t i = 0; i < Out.size(); i++){
+        if(Noise.Uniform() < BurstsPerByte){
+            for(size_t End = min(Out.size(), i + size_t(BurstBytes)); i < End; i++) {Out[i] = uint8_t(Noise.Next());}
+        }
+        else if(Noise.Uniform() < ByteErrorRate) {Out[i] ^= uint8_t(1u << (Noise.Next() % 8));}
+    }
+    return Out;
+}
+
+/// @brief Telemetry frames that get through a lossy channel, in percent, with FEC blocks of Data + Parity
+/// frames (Parity 0 for none), and the wire bytes per telemetry byte
+double ThroughChannel(const vector<vector<uint8_t>>& Frames, int Data, int Parity, double BitErrorRate,
+                      double BurstsPerByte, int BurstBytes, double& Expansion){
+    vector<uint8_t> Stream;
+    size_t Payload = 0;
+    FecEncoder Encoder(Data, Parity);
+    auto Send = [&](const uint8_t* Wire, size_t Length){ Stream.insert(Stream.end(), Wire, Wire + Length); };
+    for(const vector<uint8_t>& Frame : Frames){
+        Payload += Frame.size();
+        if(Parity == 0) {Send(Frame.data(), Frame.size());}
+        else {Encoder.encode(Frame.data(), Frame.size(), Send);}
+    }
+    if(Parity > 0) {Encoder.flush(Send);}
+    Expansion = double(Stream.size()) / double(Payload);
+
+    vector<uint8_t> Received = LossyChannel(Stream, BitErrorRate, BurstsPerByte, BurstBytes, 7);
+    TelemetryFrameReader Reader(CHECK_CRC16);
+    FecDecoder Decoder;
+    vector<bool> Seen(Frames.size(), false);
+    auto Deliver = [&](const uint8_t* Wire, size_t Length){
+        if(Reader.open(Wire, Length) == FRAME_OK && Reader.sequence() < Seen.size()) {Seen[Reader.sequence()] = true;}
+    };
+    size_t Start = 0;
+    for(size_t i = 0; i < Received.size(); i++){
+        if(Received[i] != 0) {continue;}
+        if(Parity == 0) {Deliver(&Received[Start], i - Start);}
+        else {Decoder.receive(&Received[Start], i - Start, Deliver);}
+        Start = i + 1;
+    }
+    return 100.0 * double(count(Seen.begin(), Seen.end(), true)) / double(Frames.size());
+}
+
+void BenchmarkFEC(){
+    cout << endl << "== Reed-Solomon FEC (GF(256), blocks of telemetry frames) ==" << endl;
+    const size_t Region = 4096;
+    vector<uint8_t> In(Region), Out(Region);
+    for(size_t i = 0; i < Region; i++) {In[i] = uint8_t(i * 131 + 7);}
+    TimeBatch("gfMulAdd, table (per byte)", Region, 20000, [&](){ gfMulAddTable(Out.data(), In.data(), 0x53, Region); Sink = Out[99]; });
+    if(gfShuffleAvailable()){
+        TimeBatch("gfMulAdd, PSHUFB (per byte)", Region, 20000, [&](){ gfMulAddShuffle(Out.data(), In.data(), 0x53, Region); Sink = Out[99]; });
+    }
+    else {cout << "  PSHUFB kernel not built (ROCKET_NO_SIMD) or no SSSE3 here" << endl;}
+
+    // One RS(255, 223) codeword: 32 parity bytes, up to 16 errors or 32 erasures
+    ReedSolomon Code(32);
+    uint8_t Codeword[255], Damaged[255];
+    for(int i = 0; i < 223; i++) {Codeword[i] = uint8_t(i * 17 + 3);}
+    PrintReport("RS(255,223) encode", TimeEach(20000, [&](int i){
+        Codeword[0] = uint8_t(i);
+        Code.encode(Codeword, 223, Codeword + 223);
+        Sink = Codeword[230]; }));
+    Codeword[0] = 0;
+    Code.encode(Codeword, 223, Codeword + 223);
+    int Erasures[32];
+    auto Damage = [&](int i, int Errors){
+        memcpy(Damaged, Codeword, 255);
+        for(int e = 0; e < Errors; e++){
+            Erasures[e % 32] = (i + e * 15) % 255;
+            Damaged[Erasures[e % 32]] ^= uint8_t(e + 1);
+        }
+    };
+    PrintReport("RS(255,223) decode, clean", TimeEach(20000, [&](int){
+        Damage(0, 0);
+        Sink = float(Code.decode(Damaged, 255)); }));
+    PrintReport("RS(255,223) decode, 16 errors", TimeEach(20000, [&](int i){
+        Damage(i, 16);
+        Sink = float(Code.decode(Damaged, 255)); }));
+    PrintReport("RS(255,223) decode, 32 erasures", TimeEach(20000, [&](int i){
+        Damage(i, 32);
+        Sink = float(Code.decode(Damaged, 255, Erasures, 32)); }));
+    PrintReport("RS(255,223) decode, 17 errors (too many)", TimeEach(20000, [&](int i){
+        Damage(i, 17);
+        Sink = float(Code.decode(Damaged, 255)); }));
+    int Corrected = 0, Refused = 0;
+    for(int i = 0; i < 1000; i++){
+        Damage(i, 16);
+        Corrected += Code.decode(Damaged, 255) == 16 && memcmp(Damaged, Codeword, 255) == 0;
+        Damage(i, 17);
+        Refused += Code.decode(Damaged, 255) < 0;
+    }
+    cout << "  16 errors corrected in " << Corrected << " of 1000 codewords, 17 refused in " << Refused << " of 1000" << endl;
+
+    // Full 255 byte telemetry frames of Logs records, through blocks of 4 + 2
+    const int Samples = 20000;
+    vector<Logs> Flight = TelemetryFlight(Samples);
+    TelemetryFrameWriter Writer(CHECK_CRC16);
+    vector<vector<uint8_t>> Frames;
+    uint8_t Wire[TELEMETRY_MAX_ENCODED];
+    for(int i = 0; i < Samples; ){
+        Writer.begin(uint16_t(Frames.size()));
+        while(i < Samples && Writer.append<LogMessage>(Flight[i])) {i++;}
+        size_t Length = Writer.finish(Wire);
+        Frames.emplace_back(Wire, Wire + Length);
+    }
+    const int Count = int(Frames.size());
+    vector<vector<uint8_t>> Coded;
+    FecEncoder Encoder(4, 2);
+    PrintReport("FecEncoder 4+2, per telemetry frame", TimeEach(Count, [&](int f){
+        Encoder.encode(Frames[f].data(), Frames[f].size(), [&](const uint8_t* w, size_t l){ Sink = w[l / 2]; }); }));
+    FecEncoder Fresh(4, 2);
+    for(int f = 0; f < Count; f++){
+        Fresh.encode(Frames[f].data(), Frames[f].size(), [&](const uint8_t* w, size_t l){ Coded.emplace_back(w, w + l - 1); });
+    }
+    // Two of every six frames lost, the most a 4 + 2 block survives; the first and fourth of each block
+    FecDecoder Decoder;
+    size_t Rebuilt = 0;
+    auto Drop = [](size_t i){ return i % 6 == 0 || i % 6 == 3; };
+    PrintReport("FecDecoder 4+2, per frame, 2 of 6 lost", TimeEach(int(Coded.size()), [&](int i){
+        if(!Drop(size_t(i))) {Decoder.receive(Coded[i].data(), Coded[i].size(), [&](const uint8_t*, size_t l){ Rebuilt += l; });}
+    }));
+    Decoder.flush();
+    cout << "  "; Decoder.report(cout);
+
+    // A 9600 baud radio: bit errors, and fades that turn 100 bytes into noise
+    cout << "  Telemetry frames through a lossy channel, " << Count << " frames of 255 bytes:" << endl;
+    struct Channel{ const char* Name; double BitErrorRate, BurstsPerByte; int BurstBytes; };
+    const Channel Channels[] = {{"BER 1e-5", 1e-5, 0.0, 0}, {"BER 1e-4", 1e-4, 0.0, 0},
+                                {"fade per 10 kB", 0.0, 1e-4, 100}, {"fade per 2 kB", 0.0, 5e-4, 100},
+                                {"BER 1e-4 + fade per 2 kB", 1e-4, 5e-4, 100}};
+    const int Shapes[][2] = {{1, 0}, {8, 2}, {4, 2}, {8, 4}, {4, 4}};
+    cout << "  " << left << setw(26) << "FEC" << right;
+    for(const Channel& c : Channels) {cout << setw(26) << c.Name;}
+    cout << endl;
+    for(const auto& Shape : Shapes){
+        double Expansion = 1.0;
+        string Name = Shape[1] == 0 ? "none" : to_string(Shape[0]) + "+" + to_string(Shape[1]);
+        vector<double> Through;
+        for(const Channel& c : Channels) {Through.push_back(ThroughChannel(Frames, Shape[0], Shape[1], c.BitErrorRate, c.BurstsPerByte, c.BurstBytes, Expansion));}
+        ostringstream Label;
+        Label << Name << " (x" << fixed << setprecision(2) << Expansion << " bytes)";
+        cout << "  " << left << setw(26) << Label.str() << right;
+        for(double t : Through) {cout << setw(25) << setprecision(1) << t << "%";}
+        cout << endl;
+    }
+    Sink = float(Rebuilt);
+}
+
+void BenchmarkGroundStation(){
+    cout << endl << "== Ground station (bytes to ordered Logs records) ==" << endl;
+    const int Samples = 20000;
+    vector<Logs> Flight = TelemetryFlight(Samples);
+    TelemetryFrameWriter Writer(CHECK_CRC16);
+    vector<vector<uint8_t>> Frames;
+    uint8_t Wire[TELEMETRY_MAX_ENCODED];
+    for(int i = 0; i < Samples; ){
+        Writer.begin(uint16_t(Frames.size()));
+        while(i < Samples && Writer.append<LogMessage>(Flight[i])) {i++;}
+        size_t Length = Writer.finish(Wire);
+        Frames.emplace_back(Wire, Wire + Length);
+    }
+    const int Count = int(Frames.size());
+
+    // The stream as the radio hands it over, 64 bytes at a time: in order; neighbours swapped and one frame in
+    // a hundred lost; and through FEC 4+2 with two frames of every six lost
+    vector<uint8_t> InOrder, Shuffled, Coded;
+    for(int f = 0; f < Count; f++) {InOrder.insert(InOrder.end(), Frames[f].begin(), Frames[f].end());}
+    for(int f = 0; f < Count; f++){
+        int From = f % 2 == 0 ? min(f + 1, Count - 1) : f - 1;
+        if(From % 100 != 50) {Shuffled.insert(Shuffled.end(), Frames[From].begin(), Frames[From].end());}
+    }
+    FecEncoder Encoder(4, 2);
+    size_t Index = 0;
+    auto Send = [&](const uint8_t* w, size_t l){ if(Index % 6 != 0 && Index % 6 != 3) {Coded.insert(Coded.end(), w, w + l);} Index++; };
+    for(int f = 0; f < Count; f++) {Encoder.encode(Frames[f].data(), Frames[f].size(), Send);}
+    Encoder.flush(Send);
+
+    auto Ingest = [&](const vector<uint8_t>& Stream, DataLogger* Log, int Fec, GroundStats& Stats){
+        GroundStation Ground(Log, CHECK_CRC16, Fec);
+        for(size_t i = 0; i < Stream.size(); i += 64) {Ground.receive(Stream.data() + i, min<size_t>(64, Stream.size() - i));}
+        Ground.flush();
+        Stats = Ground.stats();
+        Sink = float(Ground.MaxAltitude());
+    };
+    DataLogger Log("/dev/null");
+    GroundStats Stats;
+    struct Case{ const char* Name; const vector<uint8_t>* Stream; DataLogger* Log; int Fec; };
+    const Case Cases[] = {{"in order, no logger", &InOrder, nullptr, 0}, {"in order, into a DataLogger", &InOrder, &Log, 0},
+                          {"swapped, 1% lost", &Shuffled, nullptr, 0}, {"FEC 4+2, 2 of 6 lost", &Coded, nullptr, 4}};
+    for(const Case& c : Cases){
+        auto Start = chrono::steady_clock::now();
+        const int Passes = 20;
+        for(int p = 0; p < Passes; p++) {Ingest(*c.Stream, c.Log, c.Fec, Stats);}
+        double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count() / Passes;
+        Log.clearCache();
+        cout << "  " << left << setw(30) << c.Name << right << fixed << setprecision(1) << setw(8)
+             << 1e-6 * double(c.Stream->size()) / Seconds << " MB/s " << setw(8) << 1e-6 * double(Stats.logs) / Seconds
+             << " M records/s, " << Stats.logs << " of " << Samples << " records, " << Stats.gaps << " gaps, "
+             << Stats.waited << " waited" << endl;
+    }
+    cout << "  a 9600 baud radio carries 960 B/s, about 40 records/s" << endl;
+}
+
+void BenchmarkRadioLink(){
+    cout << endl << "== Telemetry over a simulated 9600 baud radio (60 s flights, vehicle.ini streams) ==" << endl;
+    using RocketSimulation::RadioSettings;
+    using RocketSimulation::LinkSettings;
+    using RocketSimulation::LinkReport;
+    struct Channel{ const char* Name; double BitErrorRate, FadeRate, ReorderRate; };
+    const Channel Channels[] = {{"clean", 0.0, 0.0, 0.0}, {"BER 1e-4", 1e-4, 0.0, 0.0}, {"a 0.1 s fade every 5 s", 0.0, 0.2, 0.0},
+                                {"10% of packets up to 0.3 s late", 0.0, 0.0, 0.1}, {"all three", 1e-4, 0.2, 0.1}};
+    struct Setting{ int MaxFrame, Data, Parity; double Share; };
+    const Setting Settings[] = {{255, 0, 0, 1.0}, {128, 0, 0, 1.0}, {64, 0, 0, 1.0}, {255, 8, 2, 1.0}, {128, 8, 2, 1.0},
+                                {255, 4, 2, 1.0}, {255, 4, 4, 1.0}, {255, 8, 2, 0.9}};
+    auto Start = chrono::steady_clock::now();
+    int Flights = 0;
+    for(const Channel& c : Channels){
+        RadioSettings Radio;
+        Radio.BitErrorRate = c.BitErrorRate;
+        Radio.FadeRate = c.FadeRate;
+        Radio.ReorderRate = c.ReorderRate;
+        Radio.ReorderDelay = 0.3;
+        cout << "  " << c.Name << endl;
+        cout << "    " << left << setw(28) << "frame, FEC, budget" << right << setw(10) << "samples" << setw(10) << "events"
+             << setw(12) << "goodput" << setw(11) << "on air" << setw(24) << "latency p50/p99/max" << setw(8) << "gaps" << endl;
+        for(const Setting& s : Settings){
+            LinkSettings Link;
+            Link.MaxFrame = s.MaxFrame;
+            Link.FecData = s.Data;
+            Link.FecParity = s.Parity;
+            Link.Budget = s.Share * Radio.Bandwidth;
+            LinkReport r = RocketSimulation::FlyLink(Link, Radio, 11);
+            Flights++;
+            ostringstream Label, Latency;
+            Label << s.MaxFrame << " B, " << (s.Data ? to_string(s.Data) + "+" + to_string(s.Parity) : string("none")) << ", "
+                  << int(100.0 * s.Share + 0.5) << "%";
+            Latency << fixed << setprecision(2) << r.LatencyP50 << " / " << r.LatencyP99 << " / " << r.LatencyMax << " s";
+            cout << "    " << left << setw(28) << Label.str() << right << fixed << setprecision(1) << setw(9)
+                 << 100.0 * r.Recovered << "%" << setw(6) << r.EventsReceived << " of " << r.EventsSent << setw(8) << r.Goodput
+                 << " B/s" << setw(7) << r.WireRate << " B/s" << setw(24) << Latency.str() << setw(8) << r.Gaps << endl;
+        }
+    }
+    double Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+    cout << "  " << Flights << " flights of 60 s simulated in " << fixed << setprecision(2) << Seconds << " s" << endl;
+}
+
+int main(){
+    cout << "SENTINEL benchmarks" << endl;
+
+    BenchmarkAHRS();
+    BenchmarkMatrix();
+    BenchmarkVectorBatch();
+    BenchmarkRotation();
+    BenchmarkTrajectory();
+    BenchmarkGPS();
+    BenchmarkApogee();
+    BenchmarkRecovery();
+    BenchmarkLanding();
+    BenchmarkAtmosphere();
+    BenchmarkFinMixing();
+    BenchmarkPID();
+    BenchmarkAllocation();
+    BenchmarkCommands();
+    BenchmarkVehicleConfig();
+    BenchmarkSimulation();
+    BenchmarkMonteCarlo();
+    BenchmarkLatencyHistogram();
+    BenchmarkScheduler();
+    BenchmarkExecutive();
+    BenchmarkTelemetry();
+    BenchmarkTelemetryScheduler();
+    BenchmarkFEC();
+    BenchmarkGroundStation();
+    BenchmarkRadioLink();
+
+    cout << endl;
+    return 0;
+}
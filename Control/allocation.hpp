@@ -0,0 +1,193 @@
+// Code for sharing a commanded moment between the thrust vectoring gimbal and the grid fins
+
+#pragma once
+
+#include "gridfins.hpp"
+#include "thrustvectoring.hpp"
+#include "../Sensing/Matrix.hpp"
+using namespace std;
+
+const int MAX_ACTUATORS = 2 + MAX_FINS;
+
+// Moments are (pitch, yaw, roll). Actuator 0 is the gimbal yaw axis (axis1), actuator 1 the gimbal pitch
+// axis (axis2), then one actuator per fin in gridSystem::fins order. All positions are in degrees
+class controlAllocator
+{
+public:
+    int count;
+    RocketPhysics::Matrix<3, MAX_ACTUATORS> effectiveness; // moment per degree of each actuator
+
+    float lower[MAX_ACTUATORS], upper[MAX_ACTUATORS]; // position limits
+    float rate[MAX_ACTUATORS];                        // degrees per second, 0 for no limit
+    float weight[MAX_ACTUATORS];                      // higher weight = used less
+    float position[MAX_ACTUATORS];                    // last commanded positions
+
+    int lastIterations;                               // redistribution passes in the last allocate()
+    RocketPhysics::Vector<3> achieved;                // moment produced by the last allocation
+
+    controlAllocator() : count(0), lastIterations(0)
+    {
+        for (int i = 0; i < MAX_ACTUATORS; i++)
+        {
+            lower[i] = upper[i] = rate[i] = position[i] = 0;
+            weight[i] = 1;
+        }
+    }
+
+    // Sets up the gimbal axes and every fin of the grid system, with unit effectiveness
+    void configure(const gridSystem &fins, float gimbalLimit, float gimbalRate, float finRate)
+    {
+        count = 2 + int(fins.fins.size());
+        for (int i = 0; i < count; i++)
+        {
+            float limit = i < 2 ? gimbalLimit : fins.maxAngle;
+            lower[i] = -limit;
+            upper[i] = limit;
+            rate[i] = i < 2 ? gimbalRate : finRate;
+            weight[i] = 1;
+            position[i] = 0;
+        }
+        setEffectiveness(fins, 1.0f, 1.0f);
+    }
+
+    // Call whenever thrust or dynamic pressure changes: the gimbal moment scales with thrust times the
+    // nozzle arm, the fin moment with dynamic pressure. A burnt out motor is simply 0 here
+    void setEffectiveness(const gridSystem &fins, float gimbalMomentPerDegree, float finMomentPerDegree)
+    {
+        effectiveness = RocketPhysics::Matrix<3, MAX_ACTUATORS>::Zero();
+        effectiveness(1, 0) = gimbalMomentPerDegree; // axis1 yaws
+        effectiveness(0, 1) = gimbalMomentPerDegree; // axis2 pitches
+        for (int i = 2; i < count; i++)
+        {
+            const gridfin &g = fins.fins[i - 2];
+            effectiveness(0, i) = g.mount.front ? finMomentPerDegree : -finMomentPerDegree;
+            effectiveness(1, i) = g.mount.left ? finMomentPerDegree : -finMomentPerDegree;
+            effectiveness(2, i) = finMomentPerDegree;
+        }
+    }
+
+    // Redistributed weighted pseudo-inverse: solve for the free actuators, pin every actuator that would
+    // leave its range (position limits narrowed by the rate limits over dt) at the bound, and solve again
+    // for the rest of the moment. At most one pass per actuator, so the worst case is bounded.
+    // Returns true if the moment is met within the limits
+    bool allocate(const RocketPhysics::Vector<3> &moment, float dt)
+    {
+        float lo[MAX_ACTUATORS], hi[MAX_ACTUATORS], u[MAX_ACTUATORS];
+        bool pinned[MAX_ACTUATORS];
+
+        for (int i = 0; i < count; i++)
+        {
+            lo[i] = lower[i];
+            hi[i] = upper[i];
+            if (rate[i] > 0 && dt > 0)
+            {
+                lo[i] = max(lo[i], position[i] - rate[i] * dt);
+                hi[i] = min(hi[i], position[i] + rate[i] * dt);
+            }
+            pinned[i] = lo[i] >= hi[i];
+            u[i] = pinned[i] ? lo[i] : 0.0f;
+            if (!pinned[i] && (lo[i] > 0 || hi[i] < 0))
+            {
+                // Zero is out of reach this cycle, start from the nearest reachable position
+                u[i] = lo[i] > 0 ? lo[i] : hi[i];
+            }
+        }
+
+        lastIterations = 0;
+        for (int pass = 0; pass <= count; pass++)
+        {
+            lastIterations++;
+
+            // Moment still needed from the free actuators, on top of what the pinned and preset ones give
+            RocketPhysics::Vector<3> remaining = moment;
+            for (int i = 0; i < count; i++)
+                for (int r = 0; r < 3; r++)
+                    remaining[r] -= effectiveness(r, i) * u[i];
+
+            // A = B W^-1 B^T over the free actuators, lightly damped so a rank deficient set still solves
+            RocketPhysics::Matrix<3, 3> A;
+            for (int i = 0; i < count; i++)
+            {
+                if (pinned[i])
+                    continue;
+                for (int r = 0; r < 3; r++)
+                    for (int c = 0; c < 3; c++)
+                        A(r, c) += effectiveness(r, i) * effectiveness(c, i) / weight[i];
+            }
+            float damping = 1e-6f * (A.Trace() + 1e-12f);
+            for (int r = 0; r < 3; r++)
+                A(r, r) += damping;
+
+            RocketPhysics::Matrix<3, 3> L;
+            if (!RocketPhysics::Cholesky(A, L))
+                break;
+            RocketPhysics::Vector<3> lambda = RocketPhysics::CholeskySolve(L, remaining);
+
+            bool violated = false;
+            for (int i = 0; i < count; i++)
+            {
+                if (pinned[i])
+                    continue;
+                float du = (effectiveness(0, i) * lambda[0] + effectiveness(1, i) * lambda[1] + effectiveness(2, i) * lambda[2]) / weight[i];
+                u[i] += du;
+                if (u[i] > hi[i] || u[i] < lo[i])
+                    violated = true;
+            }
+            if (!violated)
+                break;
+
+            // Pin the violators and take their share back out of what the others must produce
+            for (int i = 0; i < count; i++)
+            {
+                if (pinned[i])
+                    continue;
+                if (u[i] > hi[i])
+                {
+                    u[i] = hi[i];
+                    pinned[i] = true;
+                }
+                else if (u[i] < lo[i])
+                {
+                    u[i] = lo[i];
+                    pinned[i] = true;
+                }
+            }
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            // The last pass may stop on the damping limit, keep the result inside the box regardless
+            position[i] = u[i] > hi[i] ? hi[i] : (u[i] < lo[i] ? lo[i] : u[i]);
+        }
+
+        achieved = RocketPhysics::Vector<3>();
+        for (int i = 0; i < count; i++)
+            for (int r = 0; r < 3; r++)
+                achieved[r] += effectiveness(r, i) * position[i];
+
+        return (achieved - moment).Norm() <= 1e-3f * (moment.Norm() + 1.0f);
+    }
+
+    // Moment that the given gimbal and fin positions produce with the current effectiveness, to turn laws
+    // written per actuator into one demand for allocate()
+    RocketPhysics::Vector<3> moment(const gimbal &engine, const gridSystem &fins) const
+    {
+        RocketPhysics::Vector<3> m;
+        for (int r = 0; r < 3; r++)
+        {
+            m[r] = effectiveness(r, 0) * engine.axis1 + effectiveness(r, 1) * engine.axis2;
+            for (int i = 2; i < count; i++)
+                m[r] += effectiveness(r, i) * fins.fins[i - 2].angle;
+        }
+        return m;
+    }
+
+    // Writes the allocated positions to the hardware models
+    void apply(gimbal &engine, gridSystem &fins) const
+    {
+        engine.axis1 = position[0];
+        engine.axis2 = position[1];
+        for (int i = 2; i < count; i++)
+            fins.fins[i - 2].angle = position[i];
+    }
+};
@@ -0,0 +1,165 @@
+// Code for passing commands from the ground / command thread to the control loop
+// Commands are small fixed size structs moved through bounded lock-free rings, so nothing is allocated,
+// copied as text or thrown on the way
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+enum commandOpcode : uint8_t
+{
+    CMD_NOP = 0,
+    CMD_SET_FIN,       // target = fin index, value = angle in degrees
+    CMD_SET_GIMBAL,    // target = axis (1 or 2), value = angle in degrees
+    CMD_PITCH,         // value = pitch command in degrees, through the fin mixing
+    CMD_YAW,           // value = yaw command in degrees, through the fin mixing
+    CMD_AIRBRAKE,      // every fin to its limit
+    CMD_DEPLOY_CHUTE,  // target = parachute deploy sequence number
+    CMD_ABORT,
+    CMD_AUTO           // hands the fins back to the control loop after a manual fin command
+};
+
+// CMD_SET_FIN, CMD_PITCH, CMD_YAW and CMD_AIRBRAKE put the fins under manual control: the control loop
+// stops steering them until CMD_AUTO, otherwise its next cycle would overwrite the command
+
+struct command
+{
+    uint8_t opcode;
+    uint8_t target;
+    uint16_t sequence;
+    float value;
+    int64_t issuedNs; // monotonic time when the command was sent, for latency measurement
+};
+
+static_assert(sizeof(command) == 16, "commands should stay one 16 byte record");
+
+// Single producer, single consumer ring. capacity must be a power of two; one thread may call tryPush
+// and one other thread tryPop, both return false instead of blocking or throwing
+template <typename T, size_t capacity>
+class spscRing
+{
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+private:
+    // Producer and consumer indices on separate cache lines so the two threads do not share one
+    alignas(64) atomic<size_t> head; // next slot to read
+    alignas(64) atomic<size_t> tail; // next slot to write
+    alignas(64) T slots[capacity];
+
+public:
+    spscRing() : head(0), tail(0) {}
+
+    bool tryPush(const T &item)
+    {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == capacity)
+            return false;
+        slots[t & (capacity - 1)] = item;
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &item)
+    {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire))
+            return false;
+        item = slots[h & (capacity - 1)];
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const { return head.load(memory_order_acquire) == tail.load(memory_order_acquire); }
+    size_t size() const { return tail.load(memory_order_acquire) - head.load(memory_order_acquire); }
+};
+
+// Multiple producer, single consumer ring: every slot carries a sequence number telling producers whether
+// it is free and the consumer whether it is filled (bounded queue after D. Vyukov)
+template <typename T, size_t capacity>
+class mpscRing
+{
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+private:
+    struct cell
+    {
+        atomic<size_t> sequence;
+        T data;
+    };
+
+    alignas(64) atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos; // only the consumer touches it
+    alignas(64) cell cells[capacity];
+
+public:
+    mpscRing() : enqueuePos(0), dequeuePos(0)
+    {
+        for (size_t i = 0; i < capacity; i++)
+            cells[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    bool tryPush(const T &item)
+    {
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+        cell *c;
+        while (true)
+        {
+            c = &cells[pos & (capacity - 1)];
+            size_t seq = c->sequence.load(memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+        c->data = item;
+        c->sequence.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &item)
+    {
+        cell *c = &cells[dequeuePos & (capacity - 1)];
+        size_t seq = c->sequence.load(memory_order_acquire);
+        if (intptr_t(seq) - intptr_t(dequeuePos + 1) < 0)
+            return false; // empty, or the producer that claimed this slot has not finished writing
+        item = c->data;
+        c->sequence.store(dequeuePos + capacity, memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+};
+
+// Enqueue-to-execute latency of the commands run by the control loop
+struct commandLatency
+{
+    uint64_t count;
+    int64_t minNs, maxNs;
+    double totalNs;
+
+    commandLatency() : count(0), minNs(0), maxNs(0), totalNs(0) {}
+
+    void record(int64_t ns)
+    {
+        if (count == 0 || ns < minNs)
+            minNs = ns;
+        if (ns > maxNs)
+            maxNs = ns;
+        totalNs += double(ns);
+        count++;
+    }
+
+    double meanNs() const { return count ? totalNs / double(count) : 0.0; }
+};
@@ -1,9 +1,13 @@
+#pragma once
+
 #include <iostream>
 #include <string>
 #include <list>
+#include <vector>
 #include <cstdlib> // using this for system
 #include <thread> // using this for sleep
 #include <chrono> // for timing
+#include "../Sensing/Matrix.hpp"
 using namespace std;
 
 /// @brief Sleeps for a certain amount of milliseconds
@@ -35,22 +39,41 @@ public:
     }
 };
 
+const int MAX_FINS = 16;
+
 class gridSystem // Graph to connect the grid fins together and control them
 {
 public:
-    int numV; // Number of Grid Fins
-    list<gridfin> *adj;
+    int numV;          // Number of Grid Fins
+    list<int> *adj;    // Fin numbers of the fins sharing a side with each fin (layout only, not used by the control loop)
+    vector<gridfin> fins; // Every fin exactly once, contiguous, in the order they were added
+
+    // Row i maps (pitch, yaw, roll) in degrees to the angle of fins[i] in degrees, rows past fins.size() are zero
+    RocketPhysics::Matrix<MAX_FINS, 3> mixing;
+    float pitchGain, yawGain, rollGain;
+    float maxAngle; // Saturation limit of every fin, degrees
 
     gridSystem(int V)
     {
         this->numV = V;
-        adj = new list<gridfin>[V];
+        adj = new list<int>[V];
+        fins.reserve(V);
+        pitchGain = yawGain = 60.0f / 360.0f;
+        rollGain = 60.0f / 360.0f;
+        maxAngle = 60.0f;
     }
 
+    ~gridSystem()
+    {
+        delete[] adj;
+    }
+
+    gridSystem(const gridSystem &) = delete;
+    gridSystem &operator=(const gridSystem &) = delete;
+
     void addNew()
     {
         int n;
-        string t;
         bool l, f;
 
         cout << "Please set the grid fin number: ";
@@ -60,28 +83,67 @@ public:
         cout << "Please enter 1 if fin is front mounted, 0 if back mounted: ";
         cin >> f;
 
+        if (!addFin(n, l, f))
+            cout << "Fin " << n << " ignored, the number must be unused and below " << numV << endl;
+    }
+
+    // Adds a fin to the layout and its row to the mixing matrix, false if the number is out of range or taken
+    bool addFin(int n, bool l, bool f)
+    {
+        if (n < 0 || n >= numV || int(fins.size()) >= MAX_FINS)
+            return false;
+        for (auto &g : fins)
+        {
+            if (g.num == n)
+                return false;
+        }
+
         gridfin gnew(n, l, f);
 
-        for (int i = 0; i < numV; i++)
+        for (auto &g : fins)
         {
-            for (auto temp : adj[i])
+            if ((g.mount.left == gnew.mount.left) || (g.mount.front == gnew.mount.front))
             {
-                if ((temp.mount.left == gnew.mount.left) || (temp.mount.front == gnew.mount.front))
-                {
-                    adj[i].push_back(gnew);
-                    adj[gnew.num].push_back(temp); // Add bidirectional connection
-                }
+                adj[g.num].push_back(gnew.num);
+                adj[gnew.num].push_back(g.num); // Add bidirectional connection
             }
         }
+
+        fins.push_back(gnew);
+        buildMixing();
+        return true;
+    }
+
+    void setGains(float pitch, float yaw, float roll, float limit = 60.0f)
+    {
+        pitchGain = pitch;
+        yawGain = yaw;
+        rollGain = roll;
+        maxAngle = limit;
+        buildMixing();
     }
 
-    void printGraphRecursive(int v)
+    // Front fins turn with pitch and back fins against it, left fins with yaw and right fins against it,
+    // every fin turns the same way for roll
+    void buildMixing()
     {
-        cout << "-> " << v;
+        mixing = RocketPhysics::Matrix<MAX_FINS, 3>::Zero();
+        for (size_t i = 0; i < fins.size(); i++)
+        {
+            mixing(i, 0) = fins[i].mount.front ? pitchGain : -pitchGain;
+            mixing(i, 1) = fins[i].mount.left ? yawGain : -yawGain;
+            mixing(i, 2) = rollGain;
+        }
+    }
 
-        for (auto x : adj[v])
+    // Commands every fin at once: one matrix-vector product, then saturation
+    void mix(float pitch, float yaw, float roll = 0.0f)
+    {
+        RocketPhysics::Vector<MAX_FINS> angles = mixing * RocketPhysics::Vector<3>{pitch, yaw, roll};
+        for (size_t i = 0; i < fins.size(); i++)
         {
-            printGraphRecursive(x.num);
+            float a = angles[i];
+            fins[i].angle = a > maxAngle ? maxAngle : (a < -maxAngle ? -maxAngle : a);
         }
     }
 
@@ -89,149 +151,41 @@ public:
     {
         for (int v = 0; v < numV; ++v)
         {
-            cout << "Adjacency list of vertex " << v << ":\n head ";
-            printGraphRecursive(v);
+            cout << "Adjacency list of vertex " << v << ":\n head -> " << v;
+            for (int x : adj[v])
+            {
+                cout << " -> " << x;
+            }
             cout << endl;
         }
     }
 };
 
+// Runs every control cycle, so no console output or sleeping in here.
+// Turns the fins against the measured pitch and yaw, like gimbal::keepvertical: a positive fin command
+// (gpitch, gyaw, mix) produces a positive moment, so holding the nose up needs the negative one
 void gkeepvertical(gridSystem &graph, float pitch, float yaw)
 {
-    cout << "Control Loop engaged. " << endl
-         << "Current Yaw: " << yaw << " degrees, Pitch: " << pitch << " degrees." << endl;
-    sleep_for(2000);
-    cout << "Rocket trajectory correcting..." << endl;
-
-    for (int i = 0; i < graph.numV; i++)
-    {
-        for (auto &g : graph.adj[i])
-        {
-            if (pitch > 0)
-            { // Nose Up
-                if (g.mount.front == true)
-                {
-                    g.angle = ((pitch * 60) / 360);
-                }
-                else
-                {
-                    g.angle = -1 * ((pitch * 60) / 360);
-                }
-            }
-            else if (pitch < 0)
-            { // Nose Down
-                if (g.mount.front == true)
-                {
-                    g.angle = -1 * ((pitch * 60) / 360);
-                }
-                else
-                {
-                    g.angle = ((pitch * 60) / 360);
-                }
-            }
-
-            if (yaw > 0)
-            { // Veer Right
-                if (g.mount.left == true)
-                {
-                    g.angle += ((yaw * 60) / 360);
-                }
-                else
-                {
-                    g.angle -= ((yaw * 60) / 360);
-                }
-            }
-            else if (yaw < 0)
-            { // Veer Left
-                if (g.mount.left == true)
-                {
-                    g.angle -= ((yaw * 60) / 360);
-                }
-                else
-                {
-                    g.angle += ((yaw * 60) / 360);
-                }
-            }
-            
-        }
-    }
+    graph.mix(-pitch, -yaw);
 }
 
 void gyaw(gridSystem &graph, float yaw)
 {
-
     cout << "Yawing to " << yaw << " degrees" << endl;
-    for (int i = 0; i < graph.numV; i++)
-    {
-        for (auto &g : graph.adj[i])
-        {
-            if (yaw > 0)
-            { // Veer Right
-                if (g.mount.left == 1)
-                {
-                    g.angle = ((yaw * 60) / 360);
-                }
-                else
-                {
-                    g.angle = -1 * ((yaw * 60) / 360);
-                }
-            }
-            else if (yaw < 0)
-            { // Veer Left
-                if (g.mount.left == 1)
-                {
-                    g.angle = -1 * ((yaw * 60) / 360);
-                }
-                else
-                {
-                    g.angle = ((yaw * 60) / 360);
-                }
-            }
-        }
-    }
+    graph.mix(0.0f, yaw);
 }
 
 void gpitch(gridSystem &graph, float pitch)
 {
     cout << "Pitching to " << pitch << " degrees" << endl;
-    for (int i = 0; i < graph.numV; i++)
-    {
-        for (auto &g : graph.adj[i])
-        {
-            if (pitch > 0)
-            { // Nose Up
-                if (g.mount.front == 1)
-                {
-                    g.angle = ((pitch * 60) / 360);
-                }
-                else
-                {
-                    g.angle = -1 * ((pitch * 60) / 360);
-                }
-            }
-            else if (pitch < 0)
-            { // Nose Down
-                if (g.mount.front == 1)
-                {
-                    g.angle = -1 * ((pitch * 60) / 360);
-                }
-                else
-                {
-                    g.angle = ((pitch * 60) / 360);
-                }
-            }
-        }
-    }
+    graph.mix(pitch, 0.0f);
 }
 
 void airbrake(gridSystem &graph)
 {
     cout << "Airbrake System engaged. Rocket velocity reduced" << endl;
-    for (int i = 0; i < graph.numV; i++)
+    for (auto &g : graph.fins)
     {
-        for (auto &g : graph.adj[i])
-        {
-            g.angle = 60;
-        }
+        g.angle = graph.maxAngle;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,203 @@
+// Code for PID / PIDF control loops
+// All loops of a vehicle live in one pidBank, so their state sits in a few contiguous arrays and
+// updating every loop in a cycle touches no heap memory
+
+#pragma once
+
+#include <cmath>
+using namespace std;
+
+struct pidGains
+{
+    float kp, ki, kd;
+    float kf; // feedforward on the setpoint
+
+    pidGains(float p = 0, float i = 0, float d = 0, float f = 0) : kp(p), ki(i), kd(d), kf(f) {}
+};
+
+enum antiWindup
+{
+    CLAMPING = 0,     // stop integrating while the output is held back (saturation or rate limit) in the direction of the error
+    BACK_CALCULATION  // bleed the integral by backCalculationGain * (limited output - unlimited output)
+};
+
+struct pidConfig
+{
+    float outMin, outMax;       // output saturation
+    float rateLimit;            // largest output change per second, 0 for none
+    float derivativeCutoff;     // low pass corner on the derivative in Hz, 0 for no filter
+    antiWindup windup;
+    float backCalculationGain;  // 1/s, used with BACK_CALCULATION
+
+    pidConfig(float lo = -1e30f, float hi = 1e30f)
+        : outMin(lo), outMax(hi), rateLimit(0), derivativeCutoff(0), windup(CLAMPING), backCalculationGain(1) {}
+};
+
+struct pidState
+{
+    float integral;     // already multiplied by ki, so changing gains does not bump the output
+    float derivative;   // filtered derivative of the measurement
+    float lastMeasurement;
+    float output;
+    bool started;
+};
+
+// Gain table over a scheduling variable (dynamic pressure, airspeed, ...) with linear interpolation
+// between points and the end points held outside the table
+template <int maxPoints = 8>
+class gainSchedule
+{
+private:
+    float x[maxPoints];
+    pidGains gains[maxPoints];
+    int count;
+
+public:
+    gainSchedule() : count(0) {}
+
+    // Points may be added in any order, false when the table is full
+    bool addPoint(float at, const pidGains &g)
+    {
+        if (count == maxPoints)
+            return false;
+
+        int i = count++;
+        while (i > 0 && x[i - 1] > at)
+        {
+            x[i] = x[i - 1];
+            gains[i] = gains[i - 1];
+            i--;
+        }
+        x[i] = at;
+        gains[i] = g;
+        return true;
+    }
+
+    pidGains lookup(float at) const
+    {
+        if (count == 0)
+            return pidGains();
+        if (at <= x[0])
+            return gains[0];
+        if (at >= x[count - 1])
+            return gains[count - 1];
+
+        int i = 1;
+        while (x[i] < at)
+            i++;
+
+        float t = (at - x[i - 1]) / (x[i] - x[i - 1]);
+        const pidGains &a = gains[i - 1], &b = gains[i];
+        return pidGains(a.kp + t * (b.kp - a.kp), a.ki + t * (b.ki - a.ki),
+                        a.kd + t * (b.kd - a.kd), a.kf + t * (b.kf - a.kf));
+    }
+};
+
+// q = rho v^2 / 2 in Pa, the usual scheduling variable for aerodynamic surfaces
+inline float dynamicPressure(float density, float airspeed)
+{
+    return 0.5f * density * airspeed * airspeed;
+}
+
+// One step of a PIDF loop. The derivative acts on the measurement, so setpoint steps do not kick the output
+inline float pidStep(const pidGains &g, const pidConfig &c, pidState &s, float setpoint, float measurement, float dt)
+{
+    if (!s.started)
+    {
+        s.lastMeasurement = measurement;
+        s.derivative = 0;
+        s.started = true;
+    }
+
+    float error = setpoint - measurement;
+
+    float rawDerivative = dt > 0 ? -(measurement - s.lastMeasurement) / dt : 0.0f;
+    if (c.derivativeCutoff > 0 && dt > 0)
+    {
+        float tau = 1.0f / (6.2831853f * c.derivativeCutoff);
+        s.derivative += dt / (tau + dt) * (rawDerivative - s.derivative);
+        if (fabs(s.derivative) < 1e-20f)
+            s.derivative = 0; // a decaying filter would otherwise end in slow denormals
+    }
+    else
+    {
+        s.derivative = rawDerivative;
+    }
+    s.lastMeasurement = measurement;
+
+    float unsaturated = g.kf * setpoint + g.kp * error + s.integral + g.kd * s.derivative;
+    float limited = unsaturated > c.outMax ? c.outMax : (unsaturated < c.outMin ? c.outMin : unsaturated);
+
+    if (c.rateLimit > 0 && dt > 0)
+    {
+        float step = c.rateLimit * dt;
+        if (limited > s.output + step)
+            limited = s.output + step;
+        else if (limited < s.output - step)
+            limited = s.output - step;
+    }
+
+    if (c.windup == BACK_CALCULATION)
+    {
+        s.integral += (g.ki * error + c.backCalculationGain * (limited - unsaturated)) * dt;
+    }
+    else
+    {
+        // Either limit holds the output back, the rate limit while it slews just as the saturation
+        bool pushingHigh = limited < unsaturated && error > 0;
+        bool pushingLow = limited > unsaturated && error < 0;
+        if (!pushingHigh && !pushingLow)
+            s.integral += g.ki * error * dt;
+    }
+
+    s.output = limited;
+    return limited;
+}
+
+// A fixed number of control loops with their gains, limits and state each stored in one array
+template <int maxLoops = 16>
+class pidBank
+{
+public:
+    pidGains gains[maxLoops];
+    pidConfig config[maxLoops];
+    pidState state[maxLoops];
+    int count;
+
+    pidBank() : count(0) {}
+
+    // Returns the index of the new loop, or -1 when the bank is full
+    int add(const pidGains &g, const pidConfig &c = pidConfig())
+    {
+        if (count == maxLoops)
+            return -1;
+        gains[count] = g;
+        config[count] = c;
+        reset(count);
+        return count++;
+    }
+
+    void reset(int loop)
+    {
+        state[loop] = pidState{0, 0, 0, 0, false};
+    }
+
+    float update(int loop, float setpoint, float measurement, float dt)
+    {
+        return pidStep(gains[loop], config[loop], state[loop], setpoint, measurement, dt);
+    }
+
+    // Updates every loop: outputs[i] from setpoints[i] and measurements[i]
+    void updateAll(const float *setpoints, const float *measurements, float *outputs, float dt)
+    {
+        for (int i = 0; i < count; i++)
+            outputs[i] = pidStep(gains[i], config[i], state[i], setpoints[i], measurements[i], dt);
+    }
+
+    // Loads the gains of a loop from a schedule, e.g. once per cycle with the current dynamic pressure
+    template <int points>
+    void schedule(int loop, const gainSchedule<points> &table, float at)
+    {
+        gains[loop] = table.lookup(at);
+    }
+};
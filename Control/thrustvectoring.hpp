@@ -1,5 +1,7 @@
 // Code for basic thrust vectoring using a gimbaled engine
 
+#pragma once
+
 #include <iostream>
 using namespace std;
 
@@ -26,16 +28,15 @@ class gimbal
 
     void pitch(float pitch)
     {
-        axis1 = gimbal_constant*pitch;
+        axis2 = gimbal_constant*pitch;
         cout << "Pitching to " << pitch << " degrees."<< endl;
     }
 
+    // Runs every control cycle, so no console output in here
     void keepvertical(float pitch, float yaw)
     {
         axis1 = gimbal_constant*yaw*-1;
-        axis1 = gimbal_constant*pitch*-1;
-
-        cout << "Control loop engaged. Rocket trajectory stabilized." << endl;
+        axis2 = gimbal_constant*pitch*-1;
     }
 };
 
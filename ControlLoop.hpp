@@ -2,97 +2,73 @@
 #include <unistd.h>
 using namespace std;
 #include "./Control/gridfins.hpp"
+#include "./Control/thrustvectoring.hpp"
+#include "./Control/pid.hpp"
+#include "./Control/commands.hpp"
 #include "./Recovery/parachute.hpp"
+#include "./Recovery/apogee.hpp"
+#include "./Recovery/recovery.hpp"
+#include <utility>
 
 void bubbleSort(parachute* arr, int n) {
     for (int i = 0; i < n - 1; i++) {
         for (int j = 0; j < n - i - 1; j++) {
             if (arr[j].DeploySequence > arr[j + 1].DeploySequence) {
-                // Swap arr[j] and arr[j+1]
-                int temp = arr[j].DeploySequence;
-                arr[j].DeploySequence = arr[j + 1].DeploySequence;
-                arr[j +1].DeploySequence = temp;
+                // Swap the whole parachutes, so each keeps its own charge state
+                swap(arr[j], arr[j + 1]);
             }
         }
     }
 }
 
-struct Node
+// Runs one command taken from the command ring, returns false when the command asks to abort.
+// manualFins is set by the fin commands and cleared by CMD_AUTO; the control stage skips
+// gkeepvertical while it is set. Chute commands go through the recovery sequencer, at flight time t,
+// so it does not fire the same charge again
+bool executeCommand(const command &c, gridSystem &fins, gimbal &engine, float gimbalLimit,
+                    recoveryController &recovery, float t, bool &manualFins)
 {
-    string data;
-    Node *next;
-
-    Node(string d)
-    {
-        this->data = d;
-        next = nullptr;
-    }
-};
-
-class ControlQueue
-{
-private:
-    Node *front;
-    Node *rear;
-
-public:
-    ControlQueue()
+    switch (c.opcode)
     {
-        front = nullptr;
-        rear = nullptr;
-    }
-
-    // Check if the queue is empty
-    bool isEmpty() const
-    {
-        return front == nullptr;
-    }
-
-    // Enqueue: Add an element to the rear of the queue
-    void enqueue(string value)
-    {
-        Node *newNode = new Node(value);
-
-        if (isEmpty())
-        {
-            front = rear = newNode;
-        }
-        else
+    case CMD_SET_FIN:
+        if (c.target < fins.fins.size())
         {
-            rear->next = newNode;
-            rear = newNode;
+            fins.fins[c.target].angle = c.value > fins.maxAngle ? fins.maxAngle : (c.value < -fins.maxAngle ? -fins.maxAngle : c.value);
+            manualFins = true;
         }
-    }
-
-    // Dequeue: Remove and return the element from the front of the queue
-    string dequeue()
+        break;
+    case CMD_SET_GIMBAL:
     {
-        if (isEmpty())
-        {
-            throw std::runtime_error("Queue is empty");
-        }
-
-        string data = front->data;
-        Node *temp = front;
-        front = front->next;
-
-        if (front == nullptr)
-        {
-            rear = nullptr; // If front becomes null, rear also becomes null
-        }
-
-        delete temp;
-        return data;
+        float angle = c.value > gimbalLimit ? gimbalLimit : (c.value < -gimbalLimit ? -gimbalLimit : c.value);
+        if (c.target == 1)
+            engine.axis1 = angle;
+        else if (c.target == 2)
+            engine.axis2 = angle;
+        break;
     }
-
-    // Get the front element (without removing it)
-    string frontElement() const
-    {
-        if (isEmpty())
-        {
-            throw std::runtime_error("Queue is empty");
-        }
-
-        return front->data;
+    case CMD_PITCH:
+        fins.mix(c.value, 0.0f);
+        manualFins = true;
+        break;
+    case CMD_YAW:
+        fins.mix(0.0f, c.value);
+        manualFins = true;
+        break;
+    case CMD_AIRBRAKE:
+        for (auto &g : fins.fins)
+            g.angle = fins.maxAngle;
+        manualFins = true;
+        break;
+    case CMD_DEPLOY_CHUTE:
+        recovery.manualDeploy(c.target, t); // announced after the loop
+        break;
+    case CMD_ABORT:
+        return false;
+    case CMD_AUTO:
+        manualFins = false;
+        break;
+    default:
+        break; // CMD_NOP
     }
-};
+    return true;
+}
@@ -0,0 +1,277 @@
+// Contains code for predicting apogee from the live altitude stream
+
+#pragma once
+
+#include <cmath>
+using namespace std;
+
+#ifndef GRAVITY
+    #define GRAVITY 9.80655
+#endif
+
+struct apogeeEstimate
+{
+    float time;         // predicted time of apogee, on the same clock as the samples (s)
+    float altitude;     // predicted apogee altitude (m)
+    float velocity;     // smoothed vertical velocity now (m/s)
+    float acceleration; // smoothed vertical acceleration over the window (m/s^2)
+    float drag;         // estimated drag parameter k = rho*Cd*A / (2m) (1/m), 0 during boost
+    bool coasting;      // burnout has been seen, so the ballistic model applies
+    bool passed;        // the vertical velocity has crossed zero
+    bool valid;         // enough samples in the window to fit
+};
+
+// Streams altitude (and optionally vertical velocity) samples through a sliding window least-squares fit,
+// then extrapolates the fitted state ballistically with quadratic drag:
+//   dv/dt = -g - k v^2  =>  apogee after t = atan(v sqrt(k/g)) / sqrt(g k),  h + ln(1 + k v^2 / g) / (2k)
+// The fit uses running sums, so update() costs the same for every sample except for a re-centring
+// pass over the window once per windowSize samples (keeps the sums well conditioned)
+template <int windowSize = 32>
+class apogeePredictor
+{
+private:
+    float times[windowSize];
+    float altitudes[windowSize];
+    float velocities[windowSize];
+    int head, count;
+    bool haveVelocity;
+
+    // Running sums over the window with t measured from epoch: t^0..t^4, h t^0..t^2, v t^0..t^1
+    double epoch;
+    double st[5], sh[3], sv[2];
+    int sinceRecentre;
+
+    // Least-squares fit of the excess deceleration d = k v^2 over the whole coast, so the drag
+    // estimate keeps improving instead of following the noise in one window
+    double dragSumVD, dragSumV4;
+    bool burnout;
+
+    apogeeEstimate latest;
+
+    void addSums(double t, double h, double v, double sign)
+    {
+        double tk = 1.0;
+        for (int k = 0; k < 5; k++)
+        {
+            st[k] += sign * tk;
+            if (k < 3)
+                sh[k] += sign * h * tk;
+            if (k < 2)
+                sv[k] += sign * v * tk;
+            tk *= t;
+        }
+    }
+
+    // Rebuilds the sums around the oldest sample in the window
+    void recentre()
+    {
+        int oldest = (head - count + windowSize) % windowSize;
+        epoch = times[oldest];
+        for (int k = 0; k < 5; k++)
+            st[k] = 0.0;
+        sh[0] = sh[1] = sh[2] = sv[0] = sv[1] = 0.0;
+
+        for (int i = 0; i < count; i++)
+        {
+            int j = (oldest + i) % windowSize;
+            addSums(times[j] - epoch, altitudes[j], velocities[j], 1.0);
+        }
+        sinceRecentre = 0;
+    }
+
+    // Fits h = a + b t + c t^2 over the window (t from epoch); false if the normal equations are singular
+    bool fitAltitude(double &a, double &b, double &c) const
+    {
+        double m00 = st[0], m01 = st[1], m02 = st[2], m11 = st[2], m12 = st[3], m22 = st[4];
+        double det = m00 * (m11 * m22 - m12 * m12) - m01 * (m01 * m22 - m12 * m02) + m02 * (m01 * m12 - m11 * m02);
+        if (fabs(det) < 1e-12 * (m00 * m11 * m22 + 1e-30))
+            return false;
+
+        // Cramer's rule on the symmetric 3x3 system
+        a = (sh[0] * (m11 * m22 - m12 * m12) - m01 * (sh[1] * m22 - m12 * sh[2]) + m02 * (sh[1] * m12 - m11 * sh[2])) / det;
+        b = (m00 * (sh[1] * m22 - m12 * sh[2]) - sh[0] * (m01 * m22 - m12 * m02) + m02 * (m01 * sh[2] - sh[1] * m02)) / det;
+        c = (m00 * (m11 * sh[2] - sh[1] * m12) - m01 * (m01 * sh[2] - sh[1] * m02) + sh[0] * (m01 * m12 - m11 * m02)) / det;
+        return true;
+    }
+
+    // Fits v = p + q t over the window (t from epoch)
+    bool fitVelocity(double &p, double &q) const
+    {
+        double det = st[0] * st[2] - st[1] * st[1];
+        if (fabs(det) < 1e-12 * (st[0] * st[2] + 1e-30))
+            return false;
+        p = (sv[0] * st[2] - st[1] * sv[1]) / det;
+        q = (st[0] * sv[1] - st[1] * sv[0]) / det;
+        return true;
+    }
+
+    void predict()
+    {
+        latest.valid = false;
+        if (count < 4)
+            return;
+
+        double a, b, c;
+        if (!fitAltitude(a, b, c))
+            return;
+
+        int newest = (head - 1 + windowSize) % windowSize;
+        double now = times[newest] - epoch;
+        double mid = 0.5 * (now + (times[(head - count + windowSize) % windowSize] - epoch));
+
+        double h = a + b * now + c * now * now;
+        double v = b + 2.0 * c * now;
+        double vMid = b + 2.0 * c * mid;
+        double acc = 2.0 * c;
+
+        double p, q;
+        if (haveVelocity && fitVelocity(p, q))
+        {
+            v = p + q * now;
+            vMid = p + q * mid;
+            acc = q;
+        }
+
+        // Drag from the deceleration in excess of gravity, evaluated at the middle of the window.
+        // Burnout is latched on the first full window decelerating at about g or more
+        double g = GRAVITY;
+        if (!burnout && count == windowSize && acc <= -g * 0.98)
+            burnout = true;
+        bool coasting = burnout;
+        if (coasting && count == windowSize && vMid > 1.0)
+        {
+            dragSumVD += vMid * vMid * (-acc - g);
+            dragSumV4 += vMid * vMid * vMid * vMid;
+        }
+        double k = (dragSumV4 > 0.0) ? fmax(0.0, dragSumVD / dragSumV4) : 0.0;
+
+        if (coasting && !haveVelocity && dragSumV4 > 0.0)
+        {
+            // With the deceleration known from the model, only a line through h - acc t^2 / 2 is left to fit,
+            // which differentiates the altitude noise far less than the free quadratic
+            double model = -g - k * vMid * fabs(vMid);
+            double half = 0.5 * model;
+            double r0 = sh[0] - half * st[2], r1 = sh[1] - half * st[3];
+            double det = st[0] * st[2] - st[1] * st[1];
+            if (fabs(det) > 1e-12 * (st[0] * st[2] + 1e-30))
+            {
+                double alpha = (r0 * st[2] - st[1] * r1) / det;
+                double beta = (st[0] * r1 - st[1] * r0) / det;
+                a = alpha;
+                b = beta;
+                c = half;
+                h = a + b * now + c * now * now;
+                v = b + 2.0 * c * now;
+            }
+        }
+
+        latest.velocity = float(v);
+        latest.acceleration = float(acc);
+        latest.drag = float(k);
+        latest.coasting = coasting;
+        latest.passed = v <= 0.0;
+        latest.valid = true;
+
+        if (v <= 0.0)
+        {
+            // Already past apogee: report the top of the fitted parabola if it is inside the window
+            double top = (c < 0.0) ? -b / (2.0 * c) : now;
+            top = fmin(top, now);
+            latest.time = float(epoch + top);
+            latest.altitude = float(a + b * top + c * top * top);
+            return;
+        }
+
+        double dt, dh;
+        if (k * v * v > 1e-6 * g)
+        {
+            dt = atan(v * sqrt(k / g)) / sqrt(g * k);
+            dh = log1p(k * v * v / g) / (2.0 * k);
+        }
+        else
+        {
+            // Drag negligible, or still under thrust: plain ballistic, an upper bound after burnout
+            dt = v / g;
+            dh = v * v / (2.0 * g);
+        }
+        latest.time = float(epoch + now + dt);
+        latest.altitude = float(h + dh);
+    }
+
+public:
+    apogeePredictor()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        head = count = sinceRecentre = 0;
+        haveVelocity = false;
+        epoch = 0.0;
+        for (int k = 0; k < 5; k++)
+            st[k] = 0.0;
+        sh[0] = sh[1] = sh[2] = sv[0] = sv[1] = 0.0;
+        dragSumVD = dragSumV4 = 0.0;
+        burnout = false;
+        latest = apogeeEstimate{0, 0, 0, 0, 0, false, false, false};
+    }
+
+    // Adds an altitude sample (m) taken at time t (s) and returns the new prediction
+    const apogeeEstimate &update(float t, float altitude)
+    {
+        return push(t, altitude, 0.0f, false);
+    }
+
+    // Adds an altitude sample together with a vertical velocity measurement (m/s), e.g. from the AHRS
+    // or the trajectory integrator, which is fitted instead of differentiating the altitude
+    const apogeeEstimate &update(float t, float altitude, float verticalVelocity)
+    {
+        return push(t, altitude, verticalVelocity, true);
+    }
+
+    const apogeeEstimate &estimate() const
+    {
+        return latest;
+    }
+
+    // Seconds until the predicted apogee, measured from time t (negative once it has passed)
+    float timeToApogee(float t) const
+    {
+        return latest.time - t;
+    }
+
+private:
+    const apogeeEstimate &push(float t, float altitude, float verticalVelocity, bool withVelocity)
+    {
+        if (withVelocity != haveVelocity && count > 0)
+        {
+            // Switching between fitting velocity and differentiating altitude: start the window again
+            reset();
+        }
+        haveVelocity = withVelocity;
+
+        if (count == 0)
+            epoch = t;
+
+        if (count == windowSize)
+        {
+            int oldest = head;
+            addSums(times[oldest] - epoch, altitudes[oldest], velocities[oldest], -1.0);
+            count--;
+        }
+
+        times[head] = t;
+        altitudes[head] = altitude;
+        velocities[head] = verticalVelocity;
+        addSums(t - epoch, altitude, verticalVelocity, 1.0);
+        head = (head + 1) % windowSize;
+        count++;
+
+        if (++sinceRecentre >= windowSize)
+            recentre();
+
+        predict();
+        return latest;
+    }
+};
@@ -0,0 +1,383 @@
+// Contains the landing predictor: where the vehicle will come down, for the recovery crew. Each GPS fix under the
+// chutes integrates the rest of the descent from the fix and the barometric altitude, with the parachute descent
+// rates and a wind profile learnt from the drift on the way up and refined on the way down
+
+#pragma once
+
+#include "recovery.hpp"
+#include "../Sensing/GPS.hpp"
+#include <cmath>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+using namespace std;
+
+struct descentModel
+{
+    float drogueRate;   // m/s of descent under the apogee chutes, in the air at the pad
+    float mainRate;     // m/s under the main chutes
+    float binHeight;    // m of altitude per wind profile band
+    float rateGain;     // share of the nominal descent rate replaced by the measured one per fix, 0 to 1
+    float settleTime;   // s after a chute opens before its descent rate is measured
+    float shear;        // wind shear exponent below the vehicle, 1/7 over open ground
+
+    descentModel()
+        : drogueRate(20.0f), mainRate(5.0f), binHeight(50.0f), rateGain(0.2f), settleTime(2.0f),
+          shear(1.0f / 7.0f) {}
+};
+
+// Horizontal wind by altitude band, from the horizontal GPS velocity. Ascent and descent samples are kept apart:
+// under the chutes the vehicle moves with the air, on the way up it only partly does, least of all near the ground
+// where it is fastest. So a band the descent has measured uses that, a band below the vehicle takes the last
+// descent measurement down the power law shear profile, and only before the first descent sample (or above the
+// descent) does the ascent drift stand in, from the nearest band that has some
+class windProfile
+{
+public:
+    static const int BINS = 64;
+
+private:
+    struct band
+    {
+        float north, east; // m/s, the way the air moves to
+        float weight;
+    };
+
+    band ascent[BINS], descent[BINS];
+    float binHeight;
+    float shear;
+    float lastAltitude, lastNorth, lastEast; // latest descent sample, lastAltitude < 0 before the first
+    int descentBin;
+
+    static void add(band &b, float north, float east, float weight)
+    {
+        b.weight += weight;
+        b.north += (north - b.north) * weight / b.weight;
+        b.east += (east - b.east) * weight / b.weight;
+    }
+
+public:
+    windProfile(float binHeight = 50.0f, float shearExponent = 1.0f / 7.0f) { reset(binHeight, shearExponent); }
+
+    void reset(float height, float shearExponent)
+    {
+        binHeight = height > 0.0f ? height : 50.0f;
+        shear = shearExponent;
+        for (int i = 0; i < BINS; i++)
+            ascent[i] = descent[i] = band{0.0f, 0.0f, 0.0f};
+        lastAltitude = -1.0f;
+        lastNorth = lastEast = 0.0f;
+        descentBin = BINS;
+    }
+
+    float height() const { return binHeight; }
+
+    // Band holding the altitude just below altitude (m above the pad), the top band takes everything above it
+    int binOf(float altitude) const
+    {
+        int b = int(ceil(altitude / binHeight)) - 1;
+        return b < 0 ? 0 : (b >= BINS ? BINS - 1 : b);
+    }
+
+    void observeAscent(float altitude, float north, float east)
+    {
+        add(ascent[binOf(altitude)], north, east, 1.0f);
+    }
+
+    void observeDescent(float altitude, float north, float east)
+    {
+        int b = binOf(altitude);
+        add(descent[b], north, east, 1.0f);
+        lastAltitude = altitude > 1.0f ? altitude : 1.0f;
+        lastNorth = north;
+        lastEast = east;
+        descentBin = b;
+    }
+
+    // The wind in every band, two passes over the bands
+    void resolve(float *north, float *east) const
+    {
+        int first = -1;
+        float n = 0.0f, e = 0.0f;
+        for (int i = 0; i < BINS; i++)
+        {
+            if (ascent[i].weight > 0.0f)
+            {
+                n = ascent[i].north;
+                e = ascent[i].east;
+                if (first < 0)
+                {
+                    first = i;
+                    for (int j = 0; j < i; j++)
+                    {
+                        north[j] = n;
+                        east[j] = e;
+                    }
+                }
+            }
+            north[i] = n;
+            east[i] = e;
+        }
+        for (int i = 0; i < BINS; i++)
+        {
+            if (descent[i].weight > 0.0f)
+            {
+                north[i] = descent[i].north;
+                east[i] = descent[i].east;
+            }
+            else if (lastAltitude > 0.0f && i < descentBin)
+            {
+                float scale = pow((float(i) + 0.5f) * binHeight / lastAltitude, shear);
+                north[i] = lastNorth * scale;
+                east[i] = lastEast * scale;
+            }
+        }
+    }
+
+    bool learnt(int bin) const { return ascent[bin].weight > 0.0f || descent[bin].weight > 0.0f; }
+};
+
+struct landingPrediction
+{
+    bool valid;
+    float time;                // s, when it was made
+    double latitude, longitude;
+    float north, east;         // m from the pad
+    float timeToLanding;       // s
+};
+
+// Spread of the recent predictions: 1 sigma semi-axes, the major axis heading in degrees from north towards east
+struct landingEllipse
+{
+    int samples;
+    float north, east;         // m from the pad, mean
+    float major, minor;        // m
+    float heading;             // degrees
+};
+
+// Call update() with every GPS fix, from the pad on. Ascent fixes teach the wind profile; from the first chute on,
+// every fix makes a prediction. A prediction walks the wind bands from the current altitude to the ground, at most
+// BINS + 2 steps, so its cost is bounded whatever the altitude. The last HISTORY predictions give the ellipse
+class landingPredictor
+{
+public:
+    static const int HISTORY = 32;
+
+private:
+    windProfile wind;
+    double padLatitude, padLongitude;
+    bool havePad;
+    float lastTime, lastNorth, lastEast;
+    bool haveLast;
+    recoveryPhase lastPhase;
+    float phaseSince;
+    float drogueScale, mainScale; // measured over nominal descent rate
+    landingPrediction latest;
+    landingPrediction history[HISTORY];
+    int historyCount, historyNext;
+
+    // Descent rate grows with height as the air thins: v ~ 1 / sqrt(density), density scale height 8.5 km
+    static float densityFactor(float altitude) { return exp(altitude / 17000.0f); }
+
+    void predict(float t, float north, float east, float altitude, recoveryPhase phase)
+    {
+        float windNorth[windProfile::BINS], windEast[windProfile::BINS];
+        wind.resolve(windNorth, windEast);
+
+        float z = altitude > 0.0f ? altitude : 0.0f;
+        float elapsed = 0.0f;
+        while (z > 0.0f)
+        {
+            int b = wind.binOf(z);
+            float bottom = float(b) * wind.height();
+            if (bottom >= z) // rounding at a band edge
+                bottom = b > 0 ? float(b - 1) * wind.height() : 0.0f;
+            bool underMain = phase >= PHASE_MAIN || z <= mainAltitude;
+            if (!underMain && bottom < mainAltitude)
+                bottom = mainAltitude;
+            float rate = (underMain ? model.mainRate * mainScale : model.drogueRate * drogueScale) * densityFactor(0.5f * (z + bottom));
+            float dt = (z - bottom) / rate;
+            north += windNorth[b] * dt;
+            east += windEast[b] * dt;
+            elapsed += dt;
+            z = bottom;
+        }
+
+        latest.valid = true;
+        latest.time = t;
+        latest.north = north;
+        latest.east = east;
+        latest.timeToLanding = elapsed;
+        toGeodetic(north, east, latest.latitude, latest.longitude);
+        history[historyNext] = latest;
+        historyNext = (historyNext + 1) % HISTORY;
+        if (historyCount < HISTORY)
+            historyCount++;
+    }
+
+public:
+    descentModel model;
+    float mainAltitude; // m above the pad, where the main chutes take over (recoveryLimits::mainAltitude)
+
+    landingPredictor(const descentModel &descent = descentModel(), float mainAltitude = 150.0f)
+        : havePad(false), model(descent), mainAltitude(mainAltitude) { reset(); }
+
+    // Forgets the flight, keeping the pad if one was set
+    void reset()
+    {
+        wind.reset(model.binHeight, model.shear);
+        haveLast = false;
+        lastPhase = PHASE_ARMED;
+        phaseSince = 0.0f;
+        drogueScale = mainScale = 1.0f;
+        latest = landingPrediction{false, 0.0f, 0.0, 0.0, 0.0f, 0.0f, 0.0f};
+        historyCount = historyNext = 0;
+    }
+
+    // The origin of north and east; without it the first fix is taken as the pad
+    void setPad(double latitude, double longitude)
+    {
+        padLatitude = latitude;
+        padLongitude = longitude;
+        havePad = true;
+    }
+
+    void toLocal(double latitude, double longitude, float &north, float &east) const
+    {
+        const double metres = 6371000.0 * 3.14159265358979323846 / 180.0;
+        north = float((latitude - padLatitude) * metres);
+        east = float((longitude - padLongitude) * metres * cos(padLatitude * 3.14159265358979323846 / 180.0));
+    }
+
+    void toGeodetic(float north, float east, double &latitude, double &longitude) const
+    {
+        const double metres = 6371000.0 * 3.14159265358979323846 / 180.0;
+        latitude = padLatitude + north / metres;
+        longitude = padLongitude + east / (metres * cos(padLatitude * 3.14159265358979323846 / 180.0));
+    }
+
+    // One GPS fix
+    // t: s, altitude: barometric, m above the pad, verticalVelocity: m/s up positive, phase: from recoveryController
+    // Returns true if it made a new prediction
+    bool update(float t, const RocketSensors::GPSFix &fix, float altitude, float verticalVelocity, recoveryPhase phase)
+    {
+        if (!fix.Valid)
+            return false;
+        if (!havePad)
+            setPad(fix.Latitude, fix.Longitude);
+        if (phase != lastPhase)
+        {
+            lastPhase = phase;
+            phaseSince = t;
+        }
+
+        float north, east;
+        toLocal(fix.Latitude, fix.Longitude, north, east);
+        float velocityNorth = 0.0f, velocityEast = 0.0f;
+        bool moving = fix.HaveVelocity;
+        if (moving)
+        {
+            velocityNorth = fix.VelocityNorth;
+            velocityEast = fix.VelocityEast;
+        }
+        else if (haveLast && t > lastTime)
+        {
+            velocityNorth = (north - lastNorth) / (t - lastTime);
+            velocityEast = (east - lastEast) / (t - lastTime);
+            moving = true;
+        }
+        lastTime = t;
+        lastNorth = north;
+        lastEast = east;
+        haveLast = true;
+
+        switch (phase)
+        {
+        case PHASE_ASCENT:
+        case PHASE_APOGEE:
+            if (moving)
+                wind.observeAscent(altitude, velocityNorth, velocityEast);
+            return false;
+        case PHASE_DROGUE:
+        case PHASE_MAIN:
+        {
+            if (moving)
+                wind.observeDescent(altitude, velocityNorth, velocityEast);
+            float nominal = (phase == PHASE_MAIN ? model.mainRate : model.drogueRate) * densityFactor(altitude);
+            if (t - phaseSince >= model.settleTime && verticalVelocity < 0.0f && nominal > 0.0f)
+            {
+                float &scale = phase == PHASE_MAIN ? mainScale : drogueScale;
+                scale += model.rateGain * (-verticalVelocity / nominal - scale);
+                if (scale < 0.1f)
+                    scale = 0.1f;
+            }
+            predict(t, north, east, altitude, phase);
+            return true;
+        }
+        case PHASE_LANDED:
+            predict(t, north, east, 0.0f, phase);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    const landingPrediction &prediction() const { return latest; }
+    const windProfile &windEstimate() const { return wind; }
+    int predictions() const { return historyCount; }
+
+    landingEllipse ellipse() const
+    {
+        landingEllipse e = {historyCount, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+        if (historyCount == 0)
+            return e;
+        double sumNorth = 0.0, sumEast = 0.0;
+        for (int i = 0; i < historyCount; i++)
+        {
+            sumNorth += history[i].north;
+            sumEast += history[i].east;
+        }
+        double meanNorth = sumNorth / historyCount, meanEast = sumEast / historyCount;
+        e.north = float(meanNorth);
+        e.east = float(meanEast);
+        if (historyCount < 2)
+            return e;
+
+        double nn = 0.0, ee = 0.0, ne = 0.0;
+        for (int i = 0; i < historyCount; i++)
+        {
+            double dn = history[i].north - meanNorth, de = history[i].east - meanEast;
+            nn += dn * dn;
+            ee += de * de;
+            ne += dn * de;
+        }
+        nn /= historyCount - 1;
+        ee /= historyCount - 1;
+        ne /= historyCount - 1;
+        double centre = 0.5 * (nn + ee), radius = sqrt(0.25 * (nn - ee) * (nn - ee) + ne * ne);
+        e.major = float(sqrt(centre + radius));
+        e.minor = float(sqrt(max(0.0, centre - radius)));
+        e.heading = float(0.5 * atan2(2.0 * ne, nn - ee) * 180.0 / 3.14159265358979323846);
+        if (e.heading < 0.0f)
+            e.heading += 180.0f;
+        return e;
+    }
+
+    // For the recovery crew; call outside the control loop
+    void report(ostream &out) const
+    {
+        if (!latest.valid)
+        {
+            out << "Landing prediction: none yet" << endl;
+            return;
+        }
+        landingEllipse e = ellipse();
+        StreamStateGuard restore(out);
+
+        out << fixed << setprecision(6) << "Landing prediction: " << latest.latitude << ", " << latest.longitude
+            << setprecision(1) << " (" << latest.north << " m north, " << latest.east << " m east of the pad), in "
+            << latest.timeToLanding << " s" << endl;
+        out << "  1 sigma ellipse " << e.major << " x " << e.minor << " m, major axis " << e.heading << " deg, over the last "
+            << e.samples << " predictions" << endl;
+    }
+};
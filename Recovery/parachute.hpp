@@ -1,6 +1,9 @@
 // Contains code for deployment of parachute
 
+#pragma once
+
 #include <iostream>
+#include "../Sensing/GPS.hpp"
 using namespace std;
 
 struct GPS
@@ -8,17 +11,23 @@ struct GPS
     float lat, lon;
 };
 
+// Latest fix from the GPS parser (RocketSensors::GPSParser), fed from the receiver stream
 GPS getpos()
 {
-    //In real world application this will be pulling values from GPS module
-
     GPS coord;
 
+    const RocketSensors::GPSFix &fix = RocketSensors::LatestFix();
+    if (fix.Valid)
+    {
+        coord.lat = float(fix.Latitude);
+        coord.lon = float(fix.Longitude);
+        return coord;
+    }
+
+    // No fix yet: the launch site, GIKI
     coord.lat = 34.0691;
     coord.lon = 72.6441;
 
-    //For now using coordinates of GIKI
-
     return coord;
 }
 
@@ -33,11 +42,17 @@ class parachute
         pyrocharge = 0;
     }
 
+    // Fires the pyro charge; no output, safe in the control loop
+    void fire()
+    {
+        pyrocharge = 1;
+    }
+
     void deploychute()
     {
         GPS pos = getpos();
         
-        pyrocharge = 1;
+        fire();
         cout << "Chute #" << DeploySequence << " engaged." << endl << "Parachute Deployed at " << pos.lat << ", " << pos.lon << endl; 
 
         // cout << "Rocket Coordinates: " << endl;
@@ -0,0 +1,268 @@
+// Contains the recovery sequencer: a state machine over the live altitude, vertical velocity and acceleration,
+// and a deploy queue that fires each parachute a set delay after its trigger
+
+#pragma once
+
+#include "parachute.hpp"
+#include "../scheduler/BinaryHeap.hpp"
+#include "../scheduler/LatencyMonitor.hpp"
+#include <vector>
+#include <cmath>
+#include <ostream>
+#include <iomanip>
+using namespace std;
+
+#ifndef GRAVITY
+    #define GRAVITY 9.80655
+#endif
+
+enum recoveryPhase
+{
+    PHASE_ARMED = 0, // on the pad
+    PHASE_ASCENT,    // liftoff seen
+    PHASE_APOGEE,    // apogee seen, apogee charges pending
+    PHASE_DROGUE,    // the first apogee charge has fired
+    PHASE_MAIN,      // below the main deployment altitude
+    PHASE_LANDED,
+    PHASE_COUNT
+};
+
+inline const char *phaseName(recoveryPhase p)
+{
+    static const char *names[PHASE_COUNT] = {"armed", "ascent", "apogee", "drogue", "main", "landed"};
+    return p >= 0 && p < PHASE_COUNT ? names[p] : "?";
+}
+
+struct recoveryLimits
+{
+    float liftoffAcceleration; // m/s^2 of measured acceleration that means the motor has lit
+    float confirmTime;         // s a condition must hold before the phase changes, rejects single noisy samples
+    float minApogeeAltitude;   // m above the pad, a falling vehicle lower than this is not at apogee
+    float apogeeTimeout;       // s after liftoff at which apogee is declared anyway, 0 for none
+    float mainAltitude;        // m above the pad
+    float landedSpeed;         // m/s
+    float landedTime;          // s below landedSpeed before landing is declared
+
+    recoveryLimits()
+        : liftoffAcceleration(2.0f * float(GRAVITY)), confirmTime(0.05f), minApogeeAltitude(10.0f), apogeeTimeout(0.0f),
+          mainAltitude(150.0f), landedSpeed(1.0f), landedTime(2.0f) {}
+};
+
+struct deployAction
+{
+    parachute *chute;
+    recoveryPhase trigger; // the phase whose start fires it: PHASE_APOGEE or PHASE_MAIN
+    float delay;           // s after the trigger
+    float triggeredAt;     // s, when the trigger condition was first met, -1 before
+    float due;             // s, triggeredAt + delay
+    float firedAt;         // s, -1 until fired
+    bool manual;           // fired by manualDeploy rather than by its trigger
+};
+
+// Call update() once per control cycle with the latest samples. Only the exit condition of the current phase
+// is evaluated, and the deploy queue is a binary heap ordered by due time (then DeploySequence) that only holds
+// the charges whose trigger has happened, so a cycle costs a few comparisons plus O(log n) per charge fired.
+// Charges are only marked fired (parachute::fire) in the loop; announce them with report() afterwards.
+// Trigger-to-pyro latency, from the sample on which the trigger condition first held to the charge firing
+// (less its programmed delay), is kept in a LatencyHistogram in nanoseconds of sample time
+class recoveryController
+{
+private:
+    struct queued
+    {
+        float due;
+        int sequence;
+        int action;
+    };
+    struct dueFirst
+    {
+        bool operator()(const queued &a, const queued &b) const
+        {
+            return a.due < b.due || (a.due == b.due && a.sequence < b.sequence);
+        }
+    };
+
+    vector<deployAction> actions;
+    vector<int> waiting[PHASE_COUNT]; // actions by trigger phase, moved to the queue when it starts
+    BinaryHeap<queued, dueFirst> queue;
+
+    recoveryPhase phase;
+    float phaseStart[PHASE_COUNT]; // s, -1 for phases not reached
+    float conditionSince;          // s, since when the current exit condition has held, -1 if it does not
+    float liftoffTime;
+    int fired;
+    LatencyHistogram triggerToPyro;
+
+    // True once condition has held for duration, remembering when it started to hold
+    bool held(bool condition, float t, float duration)
+    {
+        if (!condition)
+        {
+            conditionSince = -1.0f;
+            return false;
+        }
+        if (conditionSince < 0.0f)
+            conditionSince = t;
+        return t - conditionSince >= duration;
+    }
+
+    void enter(recoveryPhase next, float t, float triggeredAt)
+    {
+        phase = next;
+        phaseStart[next] = t;
+        conditionSince = -1.0f;
+        for (int i : waiting[next])
+        {
+            deployAction &a = actions[i];
+            if (a.firedAt >= 0.0f)
+                continue; // already deployed by command
+            a.triggeredAt = triggeredAt;
+            a.due = triggeredAt + a.delay;
+            queue.push(queued{a.due, a.chute->DeploySequence, i});
+        }
+    }
+
+public:
+    recoveryLimits limits;
+
+    recoveryController() { reset(); }
+
+    // Back to the pad, keeping the registered charges
+    void reset()
+    {
+        phase = PHASE_ARMED;
+        for (int p = 0; p < PHASE_COUNT; p++)
+            phaseStart[p] = -1.0f;
+        phaseStart[PHASE_ARMED] = 0.0f;
+        conditionSince = -1.0f;
+        liftoffTime = -1.0f;
+        fired = 0;
+        queue.clear();
+        for (deployAction &a : actions)
+        {
+            a.triggeredAt = a.due = a.firedAt = -1.0f;
+            a.manual = false;
+            a.chute->pyrocharge = 0;
+        }
+        triggerToPyro.reset();
+    }
+
+    // Registers a parachute to fire delay seconds after trigger, at setup. The parachute must outlive the
+    // controller. False for a trigger other than apogee or main, or a negative delay
+    bool addAction(parachute &chute, recoveryPhase trigger, float delay = 0.0f)
+    {
+        if ((trigger != PHASE_APOGEE && trigger != PHASE_MAIN) || !(delay >= 0.0f))
+            return false;
+        actions.push_back(deployAction{&chute, trigger, delay, -1.0f, -1.0f, -1.0f, false});
+        waiting[trigger].push_back(int(actions.size()) - 1);
+        queue.reserve(actions.size());
+        return true;
+    }
+
+    // One control cycle
+    // t: sample time in seconds, altitude above the pad (m), vertical velocity (m/s, up positive),
+    // acceleration: magnitude of the measured specific force (m/s^2)
+    recoveryPhase update(float t, float altitude, float verticalVelocity, float acceleration)
+    {
+        switch (phase)
+        {
+        case PHASE_ARMED:
+            if (held(acceleration > limits.liftoffAcceleration, t, limits.confirmTime))
+            {
+                liftoffTime = conditionSince;
+                enter(PHASE_ASCENT, t, conditionSince);
+            }
+            break;
+        case PHASE_ASCENT:
+            if (held(verticalVelocity <= 0.0f && altitude > limits.minApogeeAltitude, t, limits.confirmTime))
+                enter(PHASE_APOGEE, t, conditionSince);
+            else if (limits.apogeeTimeout > 0.0f && t - liftoffTime >= limits.apogeeTimeout)
+                enter(PHASE_APOGEE, t, liftoffTime + limits.apogeeTimeout);
+            break;
+        case PHASE_DROGUE:
+            if (held(altitude < limits.mainAltitude, t, limits.confirmTime))
+                enter(PHASE_MAIN, t, conditionSince);
+            break;
+        case PHASE_MAIN:
+            if (held(fabs(verticalVelocity) < limits.landedSpeed, t, limits.landedTime))
+                enter(PHASE_LANDED, t, conditionSince);
+            break;
+        default:
+            break; // PHASE_APOGEE waits for its first charge, PHASE_LANDED is final
+        }
+
+        while (!queue.empty() && queue.top().due <= t)
+        {
+            deployAction &a = actions[queue.pop().action];
+            if (a.firedAt >= 0.0f)
+                continue; // deployed by command while it waited
+            a.chute->fire();
+            a.firedAt = t;
+            fired++;
+            triggerToPyro.record(int64_t(double(t - a.due) * 1e9));
+            if (phase == PHASE_APOGEE && a.trigger == PHASE_APOGEE)
+                enter(PHASE_DROGUE, t, t);
+        }
+        if (phase == PHASE_APOGEE && queue.empty())
+            enter(PHASE_DROGUE, t, t); // no apogee charge left to fire
+
+        return phase;
+    }
+
+    // Ground command: fires the charges of the parachute with this deploy sequence now, whatever the phase,
+    // and marks their actions fired so update() does not fire them again. A manual apogee charge during
+    // PHASE_APOGEE moves on to PHASE_DROGUE as an automatic one would. False if no unfired action uses it
+    bool manualDeploy(int sequence, float t)
+    {
+        bool found = false;
+        for (deployAction &a : actions)
+        {
+            if (a.chute->DeploySequence != sequence || a.firedAt >= 0.0f)
+                continue;
+            a.chute->fire();
+            a.firedAt = t;
+            a.manual = true;
+            fired++;
+            found = true;
+            if (phase == PHASE_APOGEE && a.trigger == PHASE_APOGEE)
+                enter(PHASE_DROGUE, t, t);
+        }
+        return found;
+    }
+
+    recoveryPhase getPhase() const { return phase; }
+
+    // When a phase started (s), -1 if it has not
+    float phaseTime(recoveryPhase p) const { return phaseStart[p]; }
+
+    int actionCount() const { return int(actions.size()); }
+    int firedCount() const { return fired; }
+    const deployAction &action(int i) const { return actions[i]; }
+    const LatencyHistogram &latency() const { return triggerToPyro; }
+
+    // Announces the phases reached and each charge, fired or not; call outside the control loop
+    void report(ostream &out) const
+    {
+        StreamStateGuard restore(out);
+
+        out << fixed << setprecision(2) << "Recovery: " << phaseName(phase) << ", " << fired << " of " << actions.size()
+            << " charges fired" << endl;
+        for (int p = PHASE_ASCENT; p < PHASE_COUNT; p++)
+        {
+            if (phaseStart[p] >= 0.0f)
+                out << "  " << left << setw(7) << phaseName(recoveryPhase(p)) << right << " at " << phaseStart[p] << " s" << endl;
+        }
+        for (const deployAction &a : actions)
+        {
+            out << "  chute #" << a.chute->DeploySequence << " (" << phaseName(a.trigger) << " + " << a.delay << " s) ";
+            if (a.manual)
+                out << "fired by command at " << a.firedAt << " s" << endl;
+            else if (a.firedAt >= 0.0f)
+                out << "fired at " << a.firedAt << " s, " << (a.firedAt - a.triggeredAt) << " s after its trigger" << endl;
+            else
+                out << "not fired" << endl;
+        }
+        if (triggerToPyro.count())
+            out << "  trigger to pyro, less delay: max " << triggerToPyro.snapshot().maxNs / 1e6 << " ms" << endl;
+    }
+};
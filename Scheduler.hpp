@@ -0,0 +1,4 @@
+#include "./scheduler/Executive.hpp"
+#include "./scheduler/TaskScheduler.hpp"
+#include "./scheduler/WorkStealingPool.hpp"
+#include "./scheduler/LatencyMonitor.hpp"
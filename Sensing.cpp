@@ -1,4 +1,27 @@
 #include "Sensing.hpp"
+#include "Recovery/apogee.hpp"
+#include "scheduler/Executive.hpp"
+#include "scheduler/TaskScheduler.hpp"
+#include "Control/gridfins.hpp"
+#include "Control/pid.hpp"
+#include "Control/allocation.hpp"
+#include "Control/commands.hpp"
+#include "ControlLoop.hpp"
+#include "config/VehicleConfig.hpp"
+#include "Simulation/Simulator.hpp"
+#include "Simulation/SensorFeed.hpp"
+#include "Simulation/Dispersion.hpp"
+#include "Simulation/MonteCarlo.hpp"
+#include "Simulation/RadioLink.hpp"
+#include "scheduler/WorkStealingPool.hpp"
+#include "scheduler/LatencyMonitor.hpp"
+#include "Recovery/recovery.hpp"
+#include "Recovery/landing.hpp"
+#include "logger/ActualLogger.hpp"
+#include "telemetry/FlightMessages.hpp"
+#include "telemetry/TelemetryScheduler.hpp"
+#include "telemetry/FecLink.hpp"
+#include "telemetry/GroundStation.hpp"
 #include <iostream>
 #include <cassert> // using this for unit tests 
 #include <cstdlib> // using this for system
@@ -6,6 +29,7 @@
 #include <chrono> // for timing
 #include <fstream> // for file handling
 #include <sstream> // for string streams
+#include <vector> // for test data
 
 #if BUILD_PLATFORM == LINUX
     #define CLEAR_SCREEN "clear"
@@ -16,13 +40,6 @@
 using namespace std;
 
 
-/// @brief Sleeps for a certain amount of milliseconds
-/// Credits to HighCommander4 on StackOverflow: https://stackoverflow.com/questions/4184468/sleep-for-milliseconds 
-/// @param milliseconds time to sleep for in milliseconds
-void sleep_for(unsigned int milliseconds) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
-}
-
 void ShowFastList(RocketSensors::FastList the_list, string Name){
     RocketSensors::Node NodeBuffer = the_list.ReadSequential();
     cout << endl << Name << " -> ";
@@ -62,6 +79,20 @@ void ShowDataWithinDeadline(RocketSensors::DeadlineStack the_stack, string Name)
     }
 }
 
+/// @brief GPS handler that keeps every fix, Context is a vector<GPSFix>
+void CollectFix(const RocketSensors::GPSFix& Fix, void* Context){
+    static_cast<vector<RocketSensors::GPSFix>*>(Context)->push_back(Fix);
+}
+
+/// @brief Feeds Stream to Parser in chunks of 1 to 64 bytes
+void FeedInChunks(RocketSensors::GPSParser& Parser, const vector<uint8_t>& Stream, RocketSimulation::Random& Generator){
+    for(size_t i = 0; i < Stream.size();){
+        size_t Chunk = min(Stream.size() - i, size_t(1 + Generator.Next() % 64));
+        Parser.Feed(Stream.data() + i, Chunk);
+        i += Chunk;
+    }
+}
+
 int main(){
     // Declare example data 
     RocketPhysics::Vector2D ExampleA(22.3f, 31.4f, false, 'F');
@@ -103,6 +134,1292 @@ int main(){
         assert(ExampleD.GetAll()[2] == ExampleD.GetZ());
         assert(ExampleD.GetType() == 'V');
 
+        // Value returning, constexpr vector primitives
+        constexpr RocketPhysics::Vector3D ExampleE(1.0f, 2.0f, 3.0f, 'V');
+        static_assert((ExampleE * 2.0f).GetZ() == 6.0f, "constexpr scaling");
+        static_assert((ExampleE / 2.0f).GetType() == 'V', "scaling keeps the datatype");
+        static_assert(ExampleE * ExampleE == 14.0f, "constexpr dot product");
+        auto [ExampleRadius, ExampleTheta] = ExampleB.GetRadial();
+        assert(abs(ExampleRadius - 100.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(ExampleTheta - 1.1f) < TEST_FLOAT_PRECISION);
+
+        // Batch kernels against the scalar operators (37 samples, so the SIMD tail is exercised too)
+        RocketPhysics::VectorBatch3D BatchA(37, 'V'), BatchB(37, 'V'), BatchR(37);
+        float BatchScalar[37];
+        for(int i = 0; i < 37; i++){
+            BatchA.Insert(RocketPhysics::Vector3D(i * 0.5f, 3.0f - i, 1.0f + i * i * 0.01f, 'V'));
+            BatchB.Insert(RocketPhysics::Vector3D(2.0f - i * 0.1f, i * 0.3f, -1.5f, 'V'));
+        }
+        BatchA.Add(BatchB, BatchR);
+        for(int i = 0; i < 37; i++) {assert((BatchR.Get(i) - (BatchA.Get(i) + BatchB.Get(i))).Magnitude() < TEST_FLOAT_PRECISION);}
+        assert(BatchR.GetType() == 'V' && BatchR.Size() == 37);
+        BatchA.Cross(BatchB, BatchR);
+        for(int i = 0; i < 37; i++) {assert((BatchR.Get(i) - (BatchA.Get(i) ^ BatchB.Get(i))).Magnitude() < TEST_FLOAT_PRECISION);}
+        BatchA.Dot(BatchB, BatchScalar);
+        for(int i = 0; i < 37; i++) {assert(abs(BatchScalar[i] - BatchA.Get(i) * BatchB.Get(i)) < TEST_FLOAT_PRECISION);}
+        BatchA.Norm(BatchScalar);
+        for(int i = 0; i < 37; i++) {assert(abs(BatchScalar[i] - BatchA.Get(i).Magnitude()) < TEST_FLOAT_PRECISION);}
+        BatchA.Set(5, RocketPhysics::Vector3D(0, 0, 0));
+        BatchA.Normalize(BatchA);
+        for(int i = 0; i < 37; i++) {assert(abs(BatchA.Get(i).Magnitude() - (i == 5 ? 0.0f : 1.0f)) < TEST_FLOAT_PRECISION);}
+
+        // Rotations
+        RocketPhysics::Quaternion ExampleQ = RocketPhysics::Quaternion::FromEuler(0.3f, -0.2f, 1.1f);
+        RocketPhysics::Vector3D ExampleQE = ExampleQ.ToEuler();
+        assert(abs(ExampleQE.GetX() - 0.3f) < 1e-5f && abs(ExampleQE.GetY() + 0.2f) < 1e-5f && abs(ExampleQE.GetZ() - 1.1f) < 1e-5f);
+        assert((ExampleQ.Rotate(ExampleE) - RocketPhysics::ToVector3D(ExampleQ.ToDCM() * RocketPhysics::ToColumn(ExampleE))).Magnitude() < 1e-5f);
+        assert(abs(RocketPhysics::Quaternion::FromDCM(ExampleQ.ToDCM()).Dot(ExampleQ) - 1.0f) < 1e-5f);
+        assert((ExampleQ.Inverse().Rotate(ExampleQ.Rotate(ExampleE)) - ExampleE).Magnitude() < 1e-5f);
+        RocketPhysics::Quaternion ExampleQ2 = RocketPhysics::Quaternion::FromAxisAngle(RocketPhysics::Vector3D(0, 0, 1), 1.5707963f);
+        assert((ExampleQ2.Rotate(RocketPhysics::Vector3D(1, 0, 0)) - RocketPhysics::Vector3D(0, 1, 0)).Magnitude() < 1e-5f);
+        assert(((ExampleQ * ExampleQ2).Rotate(ExampleE) - ExampleQ.Rotate(ExampleQ2.Rotate(ExampleE))).Magnitude() < 1e-5f);
+        RocketPhysics::Quaternion ExampleHalf = RocketPhysics::Quaternion::Slerp(RocketPhysics::Quaternion(), ExampleQ2, 0.5f);
+        assert(abs(ExampleHalf.Dot(RocketPhysics::Quaternion::FromAxisAngle(RocketPhysics::Vector3D(0, 0, 1), 0.7853982f)) - 1.0f) < 1e-5f);
+
+        // Batched frame transforms against the scalar reference
+        const int RotationSamples = 1003;
+        RocketPhysics::VectorBatch3D BodyBatch(RotationSamples, 'A'), WorldBatch(RotationSamples);
+        vector<RocketPhysics::Quaternion> Attitudes;
+        for(int i = 0; i < RotationSamples; i++){
+            BodyBatch.Insert(RocketPhysics::Vector3D(sin(i * 0.1f) * 10.0f, cos(i * 0.07f) * 10.0f, 9.8f, 'A'));
+            Attitudes.push_back(RocketPhysics::Quaternion::FromEuler(i * 0.001f, -i * 0.002f, i * 0.003f));
+        }
+        ExampleQ.Rotate(BodyBatch, WorldBatch);
+        for(int i = 0; i < RotationSamples; i++) {assert((WorldBatch.Get(i) - ExampleQ.Rotate(BodyBatch.Get(i))).Magnitude() < 1e-4f);}
+        RocketPhysics::Quaternion::Rotate(Attitudes.data(), BodyBatch, WorldBatch);
+        for(int i = 0; i < RotationSamples; i++) {assert((WorldBatch.Get(i) - Attitudes[i].Rotate(BodyBatch.Get(i))).Magnitude() < 1e-4f);}
+        assert(WorldBatch.Size() == RotationSamples && WorldBatch.GetType() == 'A');
+
+        // Matrix primitives
+        constexpr RocketPhysics::Matrix<2, 2> ExampleM{1.0f, 2.0f, 3.0f, 4.0f};
+        static_assert((ExampleM * RocketPhysics::Matrix<2, 2>::Identity()) == ExampleM, "constexpr product");
+        static_assert(ExampleM.Transpose()(0, 1) == 3.0f, "constexpr transpose");
+        static_assert([](){
+            RocketPhysics::Matrix<2, 2> L;
+            return RocketPhysics::Cholesky(RocketPhysics::Matrix<2, 2>{4.0f, 2.0f, 2.0f, 5.0f}, L) && L(1, 0) == 1.0f && L(1, 1) == 2.0f;
+        }(), "constexpr Cholesky");
+
+        RocketPhysics::Matrix<3, 3> ExampleSPD{4.0f, 12.0f, -16.0f, 12.0f, 37.0f, -43.0f, -16.0f, -43.0f, 98.0f};
+        RocketPhysics::Matrix<3, 3> ExampleL;
+        assert(RocketPhysics::Cholesky(ExampleSPD, ExampleL));
+        assert(abs(ExampleL(0, 0) - 2.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(ExampleL(1, 0) - 6.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(ExampleL(2, 1) - 5.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(ExampleL(2, 2) - 3.0f) < TEST_FLOAT_PRECISION);
+        assert(!RocketPhysics::Cholesky(-ExampleSPD, ExampleL));
+
+        RocketPhysics::Vector<3> ExampleRHS{1.0f, 2.0f, 3.0f};
+        RocketPhysics::Cholesky(ExampleSPD, ExampleL);
+        RocketPhysics::Vector<3> ExampleX = RocketPhysics::CholeskySolve(ExampleL, ExampleRHS);
+        assert(((ExampleSPD * ExampleX) - ExampleRHS).Norm() < TEST_FLOAT_PRECISION);
+
+        RocketPhysics::Matrix<4, 4> ExampleG{0.0f, 2.0f, 1.0f, 4.0f, 1.0f, 1.0f, 0.0f, 2.0f, 3.0f, 0.0f, 1.0f, 1.0f, 2.0f, 1.0f, 5.0f, 0.0f};
+        RocketPhysics::LUDecomposition<4> ExampleLU(ExampleG);
+        assert(!ExampleLU.IsSingular());
+        assert(((ExampleG * ExampleLU.Inverse()) - RocketPhysics::Matrix<4, 4>::Identity()).Norm() < TEST_FLOAT_PRECISION);
+        assert(abs(ExampleLU.Determinant() - 21.0f) < TEST_FLOAT_PRECISION);
+        assert((ExampleG * RocketPhysics::Vector<4>{0.0f, 0.0f, 1.0f, 0.0f}) == (RocketPhysics::Vector<4>{1.0f, 0.0f, 1.0f, 5.0f}));
+        assert(RocketPhysics::LUDecomposition<2>(RocketPhysics::Matrix<2, 2>{1.0f, 2.0f, 2.0f, 4.0f}).IsSingular());
+        // A stream emptied by TryPop takes new samples again
+        RocketSensors::DeadlineStack Refill(1.0f);
+        Refill.Insert(1.0f, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()));
+        assert(Refill.TryPop() && !Refill.TryPop());
+        Refill.Insert(2.0f, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()));
+        assert(Refill.TryPop()->Get1D() == 2.0f);
+
+        // AHRS: both filters settle on a static 20 degree tilt from the pad attitude, a zero sample leaves the
+        // attitude as it was, a specific force well off 1 g (thrust) is gated out, the gyro alone integrates a
+        // rotation, and the vertical channel integrates an accelerometer sample once, not for as long as it is stale
+        RocketPhysics::Vector3D NoSample(0.0f, 0.0f, 0.0f, 'A');
+        RocketPhysics::Vector3D TiltedGravity = RocketPhysics::Quaternion::FromAxisAngle(RocketPhysics::Vector3D(0, 1, 0), 0.3490659f)
+            .Conjugate().Rotate(RocketPhysics::Vector3D(0.0f, 0.0f, float(GRAVITY), 'A'));
+        for(RocketSensors::AHRS::FilterMode Mode : {RocketSensors::AHRS::Complementary, RocketSensors::AHRS::Madgwick}){
+            RocketSensors::AHRS Static(Mode, 100.0f);
+            for(int i = 0; i < 2000; i++) {Static.Update(NoSample, TiltedGravity, NoSample, 0.01f);}
+            assert(abs(Static.GetPitch() - 20.0f) < 0.5f && abs(Static.GetYaw()) < 0.5f);
+            RocketPhysics::Quaternion Settled = Static.GetQuaternion();
+            Static.Update(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, true, true, 0.01f);
+            assert(abs(Static.GetQuaternion().Dot(Settled) - 1.0f) < 1e-5f);
+
+            RocketSensors::AHRS Boosting(Mode, 100.0f);
+            for(int i = 0; i < 500; i++) {Boosting.Update(NoSample, TiltedGravity * 4.0f, NoSample, 0.01f);}
+            assert(abs(Boosting.GetPitch()) < 0.01f && abs(Boosting.GetYaw()) < 0.01f);
+            Boosting.SetAccelGate(0.0f);
+            for(int i = 0; i < 500; i++) {Boosting.Update(NoSample, TiltedGravity * 4.0f, NoSample, 0.01f);}
+            assert(Boosting.GetPitch() > 5.0f);
+
+            RocketSensors::AHRS Rotating(Mode, 100.0f);
+            for(int i = 0; i < 100; i++) {Rotating.Update(RocketPhysics::Vector3D(0.5f, 0.0f, 0.0f, 'R'), NoSample, NoSample, 0.01f);}
+            assert(abs(Rotating.GetYaw() - 28.64789f) < 0.1f && abs(Rotating.GetPitch()) < 0.1f);
+        }
+        // Through the registry: a period without a gyro sample pops nothing, so the accelerometer sample that
+        // arrived in it is still integrated on the next period
+        RocketSensors::BinarySearchTree ImuSensors;
+        ImuSensors.create('G', 1.0f); ImuSensors.create('A', 1.0f);
+        RocketSensors::AHRS Vertical(RocketSensors::AHRS::Complementary, 100.0f);
+        assert(Vertical.Bind(ImuSensors));
+        chrono::milliseconds ImuNow = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch());
+        ImuSensors.Find('A')->Raw.Insert(RocketPhysics::Vector3D(0.0f, 0.0f, float(GRAVITY) + 1.0f, 'A'), ImuNow);
+        assert(!Vertical.Step());
+        for(int i = 0; i < 10; i++){
+            ImuSensors.Find('G')->Raw.Insert(RocketPhysics::Vector3D(0.0f, 0.0f, 0.0f, 'R'), ImuNow);
+            assert(Vertical.Step());
+        }
+        assert(abs(Vertical.GetVerticalVelocity() - 0.01f) < 1e-4f && abs(Vertical.GetAltitude() - 0.00095f) < 1e-5f);
+
+        // Trajectory integration: constant acceleration gives p = a t^2 / 2 in both modes
+        RocketSensors::TrajectoryIntegrator FixedTrack, AdaptiveTrack(RocketSensors::TrajectoryIntegrator::AdaptiveRK4);
+        RocketPhysics::Vector3D Thrust(1.0f, -2.0f, 30.0f, 'A');
+        for(int i = 0; i <= 1000; i++){
+            FixedTrack.Step(Thrust, 0.001f);
+            AdaptiveTrack.Step(Thrust, 0.001f);
+        }
+        assert(abs(FixedTrack.GetTime() - 1.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(FixedTrack.GetPosition().GetZ() - 15.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(FixedTrack.GetPosition().GetY() + 1.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(FixedTrack.GetVelocity().GetZ() - 30.0f) < TEST_FLOAT_PRECISION);
+        assert((AdaptiveTrack.GetPosition() - FixedTrack.GetPosition()).Magnitude() < TEST_FLOAT_PRECISION);
+
+        // A sampled sine is followed to well under a millimetre by the quadratic interpolation
+        RocketSensors::TrajectoryIntegrator SineTrack;
+        for(int i = 0; i <= 2000; i++) {SineTrack.Step(RocketPhysics::Vector3D(0, 0, sin(i * 0.002f), 'A'), 0.002f);}
+        // v = 1 - cos(t), p = t - sin(t) when the first sample is t = 0
+        assert(abs(SineTrack.GetVelocity().GetZ() - (1.0f - cos(4.0f))) < 1e-3f);
+        assert(abs(SineTrack.GetPosition().GetZ() - (4.0f - sin(4.0f))) < 1e-3f);
+
+        // GPS and barometer corrections
+        RocketSensors::TrajectoryIntegrator FixTrack;
+        FixTrack.SetGPSGains(1.0f, 0.0f);
+        FixTrack.CorrectGPS(28.5, -80.6, 3.0);
+        assert(FixTrack.HasOrigin() && FixTrack.GetPosition().Magnitude() < TEST_FLOAT_PRECISION);
+        FixTrack.CorrectGPS(28.5 + 100.0 / 111194.9, -80.6, 13.0);
+        assert(abs(FixTrack.GetPosition().GetX() - 100.0f) < 0.1f && abs(FixTrack.GetPosition().GetZ() - 10.0f) < TEST_FLOAT_PRECISION);
+        FixTrack.SetBaroGains(0.5f, 0.0f);
+        FixTrack.CorrectAltitude(20.0f);
+        assert(abs(FixTrack.GetPosition().GetZ() - 15.0f) < TEST_FLOAT_PRECISION);
+
+        // GPS through the registry: a fix and a ground velocity published on 'N' and 'K' are applied by Correct()
+        RocketSensors::BinarySearchTree NavSensors;
+        NavSensors.create('N', 1.0f); NavSensors.create('K', 1.0f);
+        RocketSensors::TrajectoryIntegrator StreamTrack;
+        assert(StreamTrack.Bind(NavSensors) && !StreamTrack.Correct());
+        StreamTrack.SetGPSGains(1.0f, 0.0f);
+        StreamTrack.SetReceiverVelocityGain(1.0f);
+        chrono::milliseconds NavNow = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch());
+        NavSensors.Find('N')->Raw.Insert(RocketPhysics::Vector3D(28.5f, -80.6f, 3.0f, 'N'), NavNow);
+        NavSensors.Find('K')->Raw.Insert(RocketPhysics::Vector3D(3.0f, 4.0f, 20.0f, 'K'), NavNow);
+        assert(StreamTrack.Correct() && StreamTrack.HasOrigin());
+        // World X is north and Y west; the vertical part of a stream sample is not used
+        RocketPhysics::Vector3D StreamVelocity = StreamTrack.GetVelocity();
+        assert(abs(StreamVelocity.GetX() - 3.0f) < TEST_FLOAT_PRECISION && abs(StreamVelocity.GetY() + 4.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(StreamVelocity.GetZ()) < TEST_FLOAT_PRECISION);
+        StreamTrack.CorrectVelocity(3.0f, 4.0f, 20.0f);
+        assert(abs(StreamTrack.GetVelocity().GetZ() - 20.0f) < TEST_FLOAT_PRECISION);
+
+        // Apogee prediction: on a drag-free coast from 200 m at 100 m/s the prediction converges on the closed form
+        // apogee (t = v/g, h = v^2/2g) within the first second, long before it is reached, from the altitude alone
+        // and with a velocity measurement
+        {
+            apogeePredictor<> FromAltitude, FromVelocity;
+            float TrueTime = 100.0f / float(GRAVITY), TrueAltitude = 200.0f + 100.0f * 100.0f / (2.0f * float(GRAVITY));
+            for(int i = 0; i <= 900; i++){
+                float t = 0.01f * i;
+                float Height = 200.0f + 100.0f * t - 0.5f * float(GRAVITY) * t * t;
+                const apogeeEstimate& a = FromAltitude.update(t, Height);
+                const apogeeEstimate& b = FromVelocity.update(t, Height, 100.0f - float(GRAVITY) * t);
+                if(t >= 1.0f){
+                    assert(a.valid && a.coasting && !a.passed && a.drag < 1e-5f);
+                    assert(abs(a.time - TrueTime) < 0.02f && abs(a.altitude - TrueAltitude) < 0.2f);
+                    assert(b.valid && b.coasting && !b.passed);
+                    assert(abs(b.time - TrueTime) < 0.02f && abs(b.altitude - TrueAltitude) < 0.2f);
+                    assert(abs(FromAltitude.timeToApogee(t) - (TrueTime - t)) < 0.02f);
+                }
+            }
+        }
+
+        // Standard atmosphere: the tables are built by the compiler and agree with the ISA reference values
+        static_assert(RocketPhysics::ISA::LayerPressure(1) > 22632.0 && RocketPhysics::ISA::LayerPressure(1) < 22632.1, "ISA tropopause pressure");
+        assert(abs(RocketPhysics::Atmosphere::Altitude(1013.25f)) < TEST_FLOAT_PRECISION);
+        assert(abs(RocketPhysics::Atmosphere::Altitude(226.32f) - 11000.0f) < 0.1f);
+        assert(abs(RocketPhysics::Atmosphere::Density(0.0f) - 1.225f) < TEST_FLOAT_PRECISION);
+        assert(abs(RocketPhysics::Atmosphere::SpeedOfSound(0.0f) - 340.29f) < TEST_FLOAT_PRECISION);
+        assert(abs(RocketPhysics::Atmosphere::Temperature(15000.0f) - 216.65f) < TEST_FLOAT_PRECISION);
+        for(float p = 100.0f; p < 1100.0f; p += 7.3f){
+            assert(abs(RocketPhysics::Atmosphere::Altitude(p) - RocketPhysics::Atmosphere::ClosedFormAltitude(p)) < 0.1f);
+        }
+        float PressureColumn[3] = {1013.25f, 898.75f, 226.32f};
+        RocketPhysics::Atmosphere::Altitude(PressureColumn, PressureColumn, 3);
+        assert(abs(PressureColumn[1] - 1000.0f) < 0.1f && abs(PressureColumn[2] - 11000.0f) < 0.1f);
+
+        // Control executive: a stage that runs three periods long overruns its cycle, the releases it missed are
+        // skipped rather than run back to back, the slowest cycle and stage show it, and requestStop() ends the run
+        // after the current cycle
+        {
+            ControlExecutive Executive(2000000);
+            uint64_t Cycle = 0;
+            Executive.setStage(ControlExecutive::CONTROL, [&](){
+                if(++Cycle == 3) {sleep_for(6);}
+            });
+            Executive.run(6);
+            const CycleStats& Stats = Executive.getStats();
+            assert(Stats.cycles == 6 && Stats.overruns >= 1 && Stats.skippedReleases >= 3);
+            assert(Stats.maxExecutionNs >= 6000000 && Stats.maxStageNs[ControlExecutive::CONTROL] >= 6000000);
+            assert(Stats.maxStageNs[ControlExecutive::SENSE] == 0 && Stats.minJitterNs >= 0);
+            Executive.setStage(ControlExecutive::LOG, [&](){
+                if(Cycle == 10) {Executive.requestStop();}
+            });
+            assert(Executive.run().cycles == 4 && Cycle == 10);
+            stringstream Report;
+            Executive.report(Report);
+            assert(Report.str().find("4 cycles at 500.0 Hz") != string::npos);
+            // StreamStateGuard, taken by every report(), puts back the flags, precision and fill it found
+            Report.str("");
+            {
+                StreamStateGuard Restore(Report);
+                Report << fixed << setprecision(1) << setfill('*') << 0.125;
+            }
+            Report << ' ' << 0.125 << ' ' << setw(3) << 1;
+            assert(Report.str() == "0.1 0.125   1");
+        }
+
+        // Task scheduler: the heap pops in order and throws when empty; EDF admits a set at U = 1 and rejects one
+        // above it, rate monotonic rejects a set above the Liu-Layland bound its response times do not fit; jobs
+        // released together run by earliest deadline (EDF) or shortest period (RM), and a job that runs past its
+        // deadline and budget is counted as a miss and an overrun every time
+        {
+            BinaryHeap<int, std::less<int>> Heap;
+            vector<int> Keys;
+            for(int i = 0; i < 100; i++) {Keys.push_back(int((i * 7919) % 101)); Heap.push(Keys.back());}
+            sort(Keys.begin(), Keys.end());
+            for(int Key : Keys) {assert(Heap.top() == Key && Heap.pop() == Key);}
+            bool Threw = false;
+            try {Heap.pop();} catch(const runtime_error&) {Threw = true;}
+            assert(Threw && Heap.empty());
+
+            TaskScheduler Full(TaskScheduler::Policy::EDF);
+            assert(Full.addTask("half", 10000000, 10000000, 5000000, [](){}) == 0);
+            assert(Full.addTask("other half", 10000000, 10000000, 5000000, [](){}) == 1);
+            assert(abs(Full.declaredUtilization() - 1.0) < 1e-12);
+            assert(!Full.admissible(10000000, 10000000, 1000000) && Full.addTask("over", 10000000, 10000000, 1000000, [](){}) == -1);
+            assert(Full.taskCount() == 2);
+
+            // U = 0.96 against a two task bound of 0.83: the 6 ms job can wait 5 ms for the other and miss 10 ms
+            TaskScheduler Monotonic(TaskScheduler::Policy::RATE_MONOTONIC);
+            assert(Monotonic.addTask("slow", 14000000, 14000000, 5000000, [](){}) == 0);
+            assert(Monotonic.addTask("fast", 10000000, 10000000, 6000000, [](){}) == -1);
+            assert(Monotonic.addTask("light", 10000000, 10000000, 3000000, [](){}) == 1);
+
+            for(TaskScheduler::Policy Policy : {TaskScheduler::Policy::EDF, TaskScheduler::Policy::RATE_MONOTONIC}){
+                // EDF orders by the deadlines, RM by the periods; both give B, C, A
+                bool Edf = Policy == TaskScheduler::Policy::EDF;
+                TaskScheduler Order(Policy);
+                vector<char> Ran;
+                assert(Order.addTask("A", Edf ? 50000000 : 30000000, 30000000, 1000000, [&](){Ran.push_back('A');}) == 0);
+                assert(Order.addTask("B", Edf ? 50000000 : 10000000, 10000000, 1000000, [&](){Ran.push_back('B');}) == 1);
+                assert(Order.addTask("C", Edf ? 50000000 : 20000000, 20000000, 1000000, [&](){Ran.push_back('C');}) == 2);
+                Order.run(5000000);
+                assert(Ran == vector<char>({'B', 'C', 'A'}));
+            }
+
+            TaskScheduler Late;
+            int Overrunning = Late.addTask("overrun", 10000000, 2000000, 1000000, [](){sleep_for(4);});
+            assert(Overrunning == 0);
+            Late.run(35000000);
+            const TaskStats& Missed = Late.getStats(Overrunning);
+            assert(Missed.completed >= 3 && Missed.deadlineMisses == Missed.completed + Missed.skippedReleases);
+            assert(Missed.budgetOverruns == Missed.completed && Missed.maxExecutionNs >= 4000000);
+        }
+
+        // Grid fins: the mixing matrix turns front fins with pitch and back fins against it, left fins with yaw and
+        // right fins against it, saturates at maxAngle, and gkeepvertical commands the opposite of the measured tilt;
+        // a fin number that is taken or out of range is refused
+        {
+            gridSystem Fins(4);
+            assert(Fins.addFin(0, true, true) && Fins.addFin(1, false, true) && Fins.addFin(2, true, false) && Fins.addFin(3, false, false));
+            assert(!Fins.addFin(2, false, true) && !Fins.addFin(4, true, true) && !Fins.addFin(-1, true, true) && Fins.fins.size() == 4);
+            Fins.mix(10.0f, 0.0f);
+            for(const gridfin& g : Fins.fins) {assert(abs(g.angle - (g.mount.front ? 1.0f : -1.0f) * Fins.pitchGain * 10.0f) < 1e-5f);}
+            Fins.mix(0.0f, -12.0f);
+            for(const gridfin& g : Fins.fins) {assert(abs(g.angle - (g.mount.left ? -1.0f : 1.0f) * Fins.yawGain * 12.0f) < 1e-5f);}
+            Fins.mix(1000.0f, 0.0f);
+            for(const gridfin& g : Fins.fins) {assert(g.angle == (g.mount.front ? Fins.maxAngle : -Fins.maxAngle));}
+            gkeepvertical(Fins, 6.0f, 3.0f);
+            for(const gridfin& g : Fins.fins){
+                float Expected = -(g.mount.front ? 1.0f : -1.0f) * Fins.pitchGain * 6.0f - (g.mount.left ? 1.0f : -1.0f) * Fins.yawGain * 3.0f;
+                assert(abs(g.angle - Expected) < 1e-5f);
+            }
+        }
+
+        // PID: clamping holds the integral while the output is saturated or slewing at the rate limit, back-calculation
+        // bleeds it to where the output just reaches the limit, the rate limit is exact, a setpoint step gives no
+        // derivative kick, and a gain schedule interpolates between its points and holds the end points
+        {
+            pidConfig Saturating(-1.0f, 1.0f);
+            pidState Clamped = {0, 0, 0, 0, false};
+            for(int i = 0; i < 100; i++) {assert(pidStep(pidGains(1, 1), Saturating, Clamped, 10.0f, 0.0f, 0.01f) == 1.0f);}
+            assert(Clamped.integral == 0.0f);
+            assert(pidStep(pidGains(1, 1), Saturating, Clamped, 0.0f, 0.5f, 0.01f) == -0.5f);
+
+            Saturating.windup = BACK_CALCULATION;
+            pidState Bled = {0, 0, 0, 0, false};
+            for(int i = 0; i < 1000; i++) {pidStep(pidGains(1, 1), Saturating, Bled, 10.0f, 0.0f, 0.01f);}
+            assert(abs(Bled.integral - 1.0f) < 0.01f && Bled.output == 1.0f);
+
+            pidConfig Slewing;
+            Slewing.rateLimit = 1.0f;
+            pidState Slew = {0, 0, 0, 0, false};
+            for(int i = 1; i < 100; i++){
+                assert(abs(pidStep(pidGains(1, 1), Slewing, Slew, 1.0f, 0.0f, 0.01f) - 0.01f * i) < 1e-5f);
+                assert(Slew.integral == 0.0f);
+            }
+            pidStep(pidGains(1, 1), Slewing, Slew, 1.0f, 0.0f, 0.01f);
+            pidStep(pidGains(1, 1), Slewing, Slew, 1.0f, 0.0f, 0.01f);
+            assert(Slew.integral > 0.0f);
+
+            pidState Kick = {0, 0, 0, 0, false};
+            assert(pidStep(pidGains(0, 0, 1), pidConfig(), Kick, 0.0f, 2.0f, 0.01f) == 0.0f);
+            assert(pidStep(pidGains(0, 0, 1), pidConfig(), Kick, 10.0f, 2.0f, 0.01f) == 0.0f);
+            assert(abs(pidStep(pidGains(0, 0, 1), pidConfig(), Kick, 10.0f, 2.5f, 0.01f) + 50.0f) < 1e-3f);
+
+            gainSchedule<3> Table;
+            assert(Table.addPoint(1000.0f, pidGains(3, 0.3f)) && Table.addPoint(0.0f, pidGains(1, 0.1f)) && Table.addPoint(500.0f, pidGains(2, 0.2f)));
+            assert(!Table.addPoint(2000.0f, pidGains(4)));
+            assert(abs(Table.lookup(250.0f).kp - 1.5f) < 1e-5f && abs(Table.lookup(750.0f).ki - 0.25f) < 1e-5f);
+            assert(Table.lookup(-10.0f).kp == 1.0f && Table.lookup(5000.0f).kp == 3.0f && Table.lookup(500.0f).kp == 2.0f);
+            assert(gainSchedule<>().lookup(10.0f).kp == 0.0f);
+        }
+
+        // Control allocation: a moment inside the limits is met exactly and stays in the box, one beyond them pins the
+        // actuators that give it at their bounds and reports failure, and a rate limit narrows the box to what the
+        // actuators can reach in one step
+        {
+            gridSystem Fins(4);
+            assert(Fins.addFin(0, true, true) && Fins.addFin(1, false, true) && Fins.addFin(2, true, false) && Fins.addFin(3, false, false));
+            controlAllocator Allocator;
+            Allocator.configure(Fins, 5.0f, 0.0f, 0.0f);
+            Allocator.setEffectiveness(Fins, 2.0f, 0.5f);
+            assert(Allocator.count == 6);
+
+            RocketPhysics::Vector<3> Reachable{6.0f, -3.0f, 0.5f};
+            assert(Allocator.allocate(Reachable, 0.01f) && (Allocator.achieved - Reachable).Norm() < 1e-3f);
+            for(int i = 0; i < Allocator.count; i++) {assert(Allocator.position[i] >= Allocator.lower[i] && Allocator.position[i] <= Allocator.upper[i]);}
+            gimbal Engine(1, 0.0f, 0.0f);
+            Allocator.apply(Engine, Fins);
+            assert((Allocator.moment(Engine, Fins) - Allocator.achieved).Norm() < 1e-4f);
+
+            RocketPhysics::Vector<3> TooMuch{1000.0f, 0.0f, 0.0f};
+            assert(!Allocator.allocate(TooMuch, 0.01f));
+            assert(Allocator.position[1] == Allocator.upper[1]);
+            for(int i = 2; i < Allocator.count; i++){
+                assert(Allocator.position[i] == (Fins.fins[i - 2].mount.front ? Allocator.upper[i] : Allocator.lower[i]));
+            }
+            assert(abs(Allocator.achieved[0] - (2.0f * 5.0f + 4.0f * 0.5f * 60.0f)) < 1e-3f && abs(Allocator.achieved[2]) < 1e-3f);
+
+            Allocator.configure(Fins, 5.0f, 10.0f, 20.0f);
+            Allocator.setEffectiveness(Fins, 2.0f, 0.5f);
+            assert(!Allocator.allocate(RocketPhysics::Vector<3>{5.0f, 0.0f, 0.0f}, 0.01f));
+            assert(abs(Allocator.position[1] - 0.1f) < 1e-6f);
+            for(int i = 2; i < Allocator.count; i++) {assert(abs(Allocator.position[i]) <= 0.2f + 1e-6f);}
+            assert(Allocator.allocate(RocketPhysics::Vector<3>{0.1f, 0.0f, 0.0f}, 0.01f));
+        }
+
+        // Command rings: both take exactly their capacity, refuse the next push, give the commands back in order
+        // and refuse a pop when empty, through enough rounds for the indices to wrap many times. Three producers
+        // on the mpsc ring lose and repeat nothing, and each producer's commands arrive in the order it sent them.
+        // The executor clamps a gimbal command, and a fin command holds the fins until CMD_AUTO
+        {
+            spscRing<command, 8> Spsc;
+            mpscRing<command, 8> Mpsc;
+            command Out{};
+            uint16_t Sent = 0, Received = 0;
+            for(int Round = 0; Round < 100; Round++){
+                int Count = 1 + Round % 8;
+                for(int i = 0; i < Count; i++){
+                    command c{CMD_PITCH, 0, Sent++, float(i), 0};
+                    assert(Spsc.tryPush(c) && Mpsc.tryPush(c));
+                }
+                if(Count == 8){
+                    command Extra{CMD_NOP, 0, 0, 0.0f, 0};
+                    assert(!Spsc.tryPush(Extra) && !Mpsc.tryPush(Extra));
+                }
+                assert(Spsc.size() == size_t(Count));
+                for(int i = 0; i < Count; i++){
+                    assert(Spsc.tryPop(Out) && Out.sequence == Received);
+                    assert(Mpsc.tryPop(Out) && Out.sequence == Received);
+                    Received++;
+                }
+                assert(!Spsc.tryPop(Out) && !Mpsc.tryPop(Out) && Spsc.isEmpty());
+            }
+
+            const int Producers = 3, PerProducer = 20000;
+            static mpscRing<command, 64> Shared;
+            vector<thread> Threads;
+            for(int p = 0; p < Producers; p++){
+                Threads.emplace_back([p]{
+                    for(int i = 0; i < PerProducer; i++){
+                        command c{CMD_SET_FIN, uint8_t(p), uint16_t(i), 0.0f, 0};
+                        while(!Shared.tryPush(c)) this_thread::yield();
+                    }
+                });
+            }
+            vector<int> Next(Producers, 0);
+            for(int Total = 0; Total < Producers * PerProducer;){
+                if(!Shared.tryPop(Out)) continue;
+                assert(Out.target < Producers && Out.sequence == uint16_t(Next[Out.target]));
+                Next[Out.target]++;
+                Total++;
+            }
+            for(thread& t : Threads) t.join();
+            assert(!Shared.tryPop(Out));
+            for(int p = 0; p < Producers; p++) assert(Next[p] == PerProducer);
+
+            gridSystem Fins(4);
+            assert(Fins.addFin(0, true, true) && Fins.addFin(1, false, true) && Fins.addFin(2, true, false) && Fins.addFin(3, false, false));
+            gimbal Engine(1, 0.0f, 0.0f);
+            parachute Drogue;
+            Drogue.DeploySequence = 1;
+            recoveryController Recovery;
+            assert(Recovery.addAction(Drogue, PHASE_APOGEE));
+            bool Manual = false;
+            assert(executeCommand(command{CMD_SET_GIMBAL, 2, 0, 40.0f, 0}, Fins, Engine, 15.0f, Recovery, 0.0f, Manual));
+            assert(Engine.axis2 == 15.0f && Engine.axis1 == 0.0f && !Manual);
+            assert(executeCommand(command{CMD_SET_FIN, 1, 1, 5.0f, 0}, Fins, Engine, 15.0f, Recovery, 0.0f, Manual));
+            assert(Fins.fins[1].angle == 5.0f && Manual);
+            assert(executeCommand(command{CMD_AUTO, 0, 2, 0.0f, 0}, Fins, Engine, 15.0f, Recovery, 0.0f, Manual) && !Manual);
+            assert(!executeCommand(command{CMD_ABORT, 0, 3, 0.0f, 0}, Fins, Engine, 15.0f, Recovery, 0.0f, Manual));
+            assert(executeCommand(command{CMD_DEPLOY_CHUTE, 1, 4, 0.0f, 0}, Fins, Engine, 15.0f, Recovery, 3.0f, Manual));
+            assert(Drogue.pyrocharge && Recovery.firedCount() == 1 && Recovery.action(0).manual && Recovery.action(0).firedAt == 3.0f);
+        }
+
+        // Vehicle file: a valid description parses into its fields and builds its fins and chutes; each kind of
+        // mistake is reported with its line number (or without one, for checks across keys), and one pass
+        // reports every mistake in the file
+        {
+            VehicleConfig Config;
+            string Valid =
+                "[vehicle]\nname = TEST\n"
+                "[fins]\ncount = 2\nmax_angle = 30\nfin = 0, left, front\nfin = 1, right, back   # comment\n"
+                "[parachutes]\nchute = drogue, 1\nchute = main, 2\n"
+                "[sensors]\nsensor = P, 1\nsensor = Y, 1\n"
+                "[control]\nrate_hz = 200\n"
+                "[commands]\ncommand = 0.5, gimbal, 2, 3\n";
+            assert(Config.parse(Valid) && Config.ok() && Config.errorReport().empty());
+            assert(Config.name == "TEST" && Config.finCount == 2 && Config.finMaxAngle == 30.0f && Config.fins.size() == 2);
+            assert(Config.fins[1].number == 1 && !Config.fins[1].left && !Config.fins[1].front);
+            assert(Config.parachutes.size() == 2 && Config.parachutes[1].name == "main" && Config.parachutes[1].sequence == 2);
+            assert(Config.sensors.size() == 2 && Config.controlPeriodNs() == 5000000);
+            assert(Config.uplink.size() == 1 && Config.uplink[0].cmd.opcode == CMD_SET_GIMBAL && Config.uplink[0].cmd.target == 2);
+            gridSystem Fins(Config.finCount);
+            assert(Config.buildFins(Fins) && Fins.fins.size() == 2 && Config.makeParachutes().size() == 2);
+
+            assert(!Config.parse("[fins]\ncount = 2\nfin = 0, left, front\nfin = 0, right, back\n"));
+            assert(Config.errorReport().find("line 4: fin 0 declared twice\n") != string::npos);
+            assert(Config.errorReport().find("[fins] count is 2 but 1 fins are declared\n") != string::npos);
+
+            assert(!Config.parse(Valid + "[wings]\nspan = 2\n"));
+            assert(Config.errorReport() == "line 18: unknown section [wings]\nline 19: unknown key span in [wings]\n");
+
+            assert(!Config.parse(Valid + "[fins]\nsweep = 10\n"));
+            assert(Config.errorReport() == "line 19: unknown key sweep in [fins]\n");
+
+            assert(!Config.parse("[fins]\ncount = 2.5\nfin = 0, left, front\nfin = 1, right, back\n"));
+            assert(Config.errorReport().find("line 2: count must be an integer\n") != string::npos);
+
+            assert(!Config.parse(Valid + "[fins]\ncount = 3\n"));
+            assert(Config.errorReport() == "[fins] count is 3 but 2 fins are declared\n");
+        }
+
+        // A sample outside the deadline window is rejected and counted as stale
+        RocketSensors::DeadlineStack Window(1.0f);
+        Window.Insert(3.0f, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()) - chrono::milliseconds(5000));
+        assert(!Window.TryPop() && !Window.TryPop() && Window.GetStaleCount() == 2);
+
+        // Latency histogram: every bucket holds the values it is reported for, percentiles stay within
+        // 1/32 above the exact value, and the monitor splits sample-to-actuator time into its stages
+        for(int64_t v = 0; v < 5000000; v += 1 + v / 50){
+            size_t b = LatencyHistogram::bucketOf(v);
+            assert(LatencyHistogram::highestIn(b) >= v && (b == 0 || LatencyHistogram::highestIn(b - 1) < v));
+        }
+        {
+            LatencyHistogram Uniform;
+            for(int64_t v = 1; v <= 100000; v++) {Uniform.record(v);}
+            LatencySnapshot u = Uniform.snapshot();
+            assert(u.count == 100000 && u.minNs == 1 && u.maxNs == 100000 && abs(u.meanNs - 50000.5) < 1e-6);
+            assert(u.p50Ns >= 50000 && u.p50Ns <= 50000 + 50000 / 32 && u.p99Ns >= 99000 && u.p99Ns <= 99000 + 99000 / 32);
+            LatencyMonitor Loop;
+            Loop.sensed(1000000, 0);
+            Loop.controlled(20000);
+            Loop.actuated(25000);
+            Loop.actuated(26000); // no sense this cycle
+            Loop.setStaleSamples(3);
+            LatencyMonitor::Snapshot m = Loop.snapshot();
+            assert(m.cycles == 2 && m.staleSamples == 3 && m.stages[LatencyMonitor::END_TO_END].count == 1);
+            assert(m.stages[LatencyMonitor::END_TO_END].maxNs == 1025000 && m.stages[LatencyMonitor::CONTROL_TO_ACTUATE].maxNs == 5000);
+        }
+
+        // Simulator: the thrust curve integrates to its impulse, and a vertical launch in calm air comes
+        // back down on the pad, with the AHRS (fed through the registry) reading vertical through the burn
+        RocketSimulation::Motor ExampleMotor = RocketSimulation::Motor::Example();
+        assert(abs(ExampleMotor.Curve.Impulse(ExampleMotor.Curve.BurnTime()) - ExampleMotor.Curve.TotalImpulse()) < TEST_FLOAT_PRECISION);
+        assert(abs(ExampleMotor.PropellantRemaining(10.0f)) < TEST_FLOAT_PRECISION);
+        RocketSimulation::VehicleModel Upright;
+        Upright.LaunchPitch = 0.0f;
+        RocketSimulation::FlightSimulator Flight(Upright, ExampleMotor, RocketSimulation::Wind(), RocketSimulation::SensorNoise::None(), 1, 0.5f);
+        RocketSensors::BinarySearchTree SimSensors;
+        SimSensors.create('G', 1.0f); SimSensors.create('A', 1.0f); SimSensors.create('B', 1.0f);
+        RocketSimulation::SensorFeed Feed;
+        RocketSensors::AHRS SimAHRS(RocketSensors::AHRS::Complementary, 100.0f);
+        assert(Feed.Bind(SimSensors) == 3 && SimAHRS.Bind(SimSensors));
+        while(!Flight.HasLanded() && Flight.GetTime() < 100.0f){
+            Feed.Publish(Flight.Sample());
+            assert(SimAHRS.Step());
+            if(Flight.IsBurning()) {assert(abs(SimAHRS.GetPitch()) < 1.0f && abs(SimAHRS.GetYaw()) < 1.0f);}
+            for(int i = 0; i < 5; i++) {Flight.Step(0.002f);}
+        }
+        assert(Flight.HasLanded() && Flight.GetRecord().Apogee > 100.0f);
+        assert(Flight.GetRecord().Landing.Magnitude() < 1.0f);
+
+        // Recovery: a one sample spike does not count as liftoff, the phases follow a flight profile at 100 Hz,
+        // and charges fire in due order (ties by deploy sequence) within one cycle plus the confirm time. A charge
+        // deployed by command is not fired again when its trigger comes
+        {
+            parachute Pilot, Drogue, Backup, MainChute;
+            Pilot.DeploySequence = 0; Drogue.DeploySequence = 1; Backup.DeploySequence = 2; MainChute.DeploySequence = 3;
+            recoveryController Recovery;
+            assert(Recovery.addAction(MainChute, PHASE_MAIN, 0.5f) && Recovery.addAction(Backup, PHASE_APOGEE, 1.0f));
+            assert(Recovery.addAction(Drogue, PHASE_APOGEE) && Recovery.addAction(Pilot, PHASE_MAIN));
+            assert(!Recovery.addAction(Pilot, PHASE_LANDED) && !Recovery.addAction(Pilot, PHASE_MAIN, -1.0f));
+            assert(Recovery.update(0.0f, 0.0f, 0.0f, 50.0f) == PHASE_ARMED && Recovery.update(0.01f, 0.0f, 0.0f, 9.8f) == PHASE_ARMED);
+
+            float Height = 0.0f, Speed = 0.0f;
+            for(int i = 0; i < 10000 && Recovery.getPhase() != PHASE_LANDED; i++){
+                float t = 1.0f + 0.01f * i;
+                float Accel = t < 2.0f ? 40.0f : 0.0f;
+                float Descent = Recovery.getPhase() >= PHASE_MAIN ? -5.0f : (Recovery.getPhase() >= PHASE_DROGUE ? -20.0f : -1e9f);
+                Speed = std::max(Speed + ((t < 2.0f ? 30.0f : -9.8f)) * 0.01f, Descent);
+                Height = std::max(0.0f, Height + Speed * 0.01f);
+                if(Height == 0.0f && t > 3.0f) {Speed = 0.0f;}
+                Recovery.update(t, Height, Speed, Accel);
+            }
+            assert(Recovery.getPhase() == PHASE_LANDED && Recovery.firedCount() == 4);
+            assert(Pilot.pyrocharge && Drogue.pyrocharge && Backup.pyrocharge && MainChute.pyrocharge);
+            assert(abs(Recovery.phaseTime(PHASE_ASCENT) - 1.05f) < 0.011f);
+            assert(Recovery.phaseTime(PHASE_APOGEE) > 4.0f && Recovery.phaseTime(PHASE_DROGUE) == Recovery.phaseTime(PHASE_APOGEE));
+            assert(Recovery.phaseTime(PHASE_MAIN) > Recovery.phaseTime(PHASE_DROGUE));
+            const deployAction& MainAction = Recovery.action(0);
+            const deployAction& BackupAction = Recovery.action(1);
+            const deployAction& DrogueAction = Recovery.action(2);
+            const deployAction& PilotAction = Recovery.action(3);
+            assert(DrogueAction.firedAt == Recovery.phaseTime(PHASE_APOGEE) && abs(BackupAction.firedAt - BackupAction.triggeredAt - 1.0f) < 0.011f);
+            assert(PilotAction.firedAt == Recovery.phaseTime(PHASE_MAIN) && abs(MainAction.firedAt - MainAction.triggeredAt - 0.5f) < 0.011f);
+            assert(Recovery.latency().count() == 4 && Recovery.latency().snapshot().maxNs <= int64_t(0.07 * 1e9));
+            Recovery.reset();
+            assert(Recovery.getPhase() == PHASE_ARMED && Recovery.firedCount() == 0 && !Pilot.pyrocharge);
+
+            assert(Recovery.manualDeploy(1, 0.5f) && !Recovery.manualDeploy(1, 0.6f) && Drogue.pyrocharge && Recovery.firedCount() == 1);
+            Recovery.update(1.0f, 0.0f, 0.0f, 40.0f);
+            Recovery.update(1.1f, 0.0f, 0.0f, 40.0f);
+            Recovery.update(2.0f, 100.0f, -1.0f, 0.0f);
+            assert(Recovery.update(2.1f, 100.0f, -1.0f, 0.0f) == PHASE_APOGEE && Recovery.firedCount() == 1);
+            assert(Recovery.update(3.1f, 100.0f, -1.0f, 0.0f) == PHASE_DROGUE && Recovery.firedCount() == 2);
+            assert(DrogueAction.manual && DrogueAction.firedAt == 0.5f && Recovery.latency().count() == 1);
+        }
+
+        // GPS: a receiver capture of GGA, RMC and GSV sentences from several constellations, NAV-PVT and a longer
+        // UBX message, fed whole and in random chunks; then with a byte flipped (the message is dropped, never
+        // published wrong), with many bytes flipped and as pure noise
+        {
+            vector<uint8_t> Capture;
+            vector<RocketSensors::GPSFix> Track;
+            char Text[RocketSensors::GPSParser::MaxSentence + 1];
+            uint8_t Binary[512], Satellites[8 + 12 * 20];
+            for(size_t k = 0; k < sizeof(Satellites); k++) {Satellites[k] = uint8_t(k * 7);}
+            for(int i = 0; i < 40; i++){
+                RocketSensors::GPSFix f;
+                f.Valid = true;
+                f.TimeOfDay = 45296000 + 100 * i;
+                f.Latitude = 34.0691 + 1e-5 * i;
+                f.Longitude = -72.6441 - 2e-5 * i;
+                f.Altitude = 350.0f + 12.5f * i;
+                f.VelocityNorth = 1.5f; f.VelocityEast = -2.0f; f.VelocityUp = 125.0f;
+                f.Satellites = 18; f.DOP = 0.9f; f.HorizontalAccuracy = 1.5f;
+                Track.push_back(f);
+
+                size_t n = RocketSensors::FormatGGA(f, Text, sizeof(Text));
+                Capture.insert(Capture.end(), Text, Text + n);
+                n = RocketSensors::FormatRMC(f, Text, sizeof(Text), "GP");
+                Capture.insert(Capture.end(), Text, Text + n);
+                n = RocketSensors::FinishSentence(Text, snprintf(Text, sizeof(Text), "$GLGSV,1,1,04,65,45,120,40,66,30,200,38,67,10,300,35,68,60,045,44"), sizeof(Text));
+                Capture.insert(Capture.end(), Text, Text + n);
+                n = RocketSensors::EncodeNavPvt(f, Binary, sizeof(Binary));
+                Capture.insert(Capture.end(), Binary, Binary + n);
+                n = RocketSensors::EncodeUBX(0x01, 0x35, Satellites, sizeof(Satellites), Binary, sizeof(Binary)); // NAV-SAT
+                Capture.insert(Capture.end(), Binary, Binary + n);
+            }
+
+            vector<RocketSensors::GPSFix> Expected;
+            RocketSensors::BinarySearchTree GPSSensors;
+            GPSSensors.create('N');
+            GPSSensors.create('K');
+            RocketSensors::GPSParser Whole;
+            assert(Whole.Bind(GPSSensors) == 2 && !Whole.HasFix());
+            Whole.SetHandler(CollectFix, &Expected);
+            assert(Whole.Feed(Capture.data(), Capture.size()) == 120 && Expected.size() == 120);
+            const RocketSensors::GPSStats& Counted = Whole.GetStats();
+            assert(Counted.Sentences == 120 && Counted.Messages == 80 && Counted.ChecksumErrors == 0 && Counted.Malformed == 0 && Counted.Skipped == 0);
+            for(int i = 0; i < 40; i++){
+                const RocketSensors::GPSFix &GGA = Expected[3 * i], &RMC = Expected[3 * i + 1], &PVT = Expected[3 * i + 2];
+                assert(GGA.Source == RocketSensors::GPS_GGA && RMC.Source == RocketSensors::GPS_RMC && PVT.Source == RocketSensors::GPS_NAV_PVT);
+                assert(GGA.TimeOfDay == Track[i].TimeOfDay && RMC.TimeOfDay == Track[i].TimeOfDay && PVT.TimeOfDay == Track[i].TimeOfDay);
+                assert(abs(GGA.Latitude - Track[i].Latitude) < 1e-6 && abs(GGA.Longitude - Track[i].Longitude) < 1e-6);
+                assert(abs(GGA.Altitude - Track[i].Altitude) < 0.06f && GGA.Satellites == 18 && abs(GGA.DOP - 0.9f) < 1e-4f);
+                assert(abs(RMC.VelocityNorth - 1.5f) < 1e-3f && abs(RMC.VelocityEast + 2.0f) < 1e-3f && RMC.HaveVelocity);
+                assert(abs(PVT.Latitude - Track[i].Latitude) < 1e-7 && abs(PVT.Longitude - Track[i].Longitude) < 1e-7);
+                assert(abs(PVT.VelocityUp - 125.0f) < 1e-3f && abs(PVT.HorizontalAccuracy - 1.5f) < 1e-3f && PVT.HaveClimb);
+            }
+            RocketSensors::Node* LastPosition = GPSSensors.Find('N')->Raw.TryPop();
+            RocketSensors::Node* LastVelocity = GPSSensors.Find('K')->Raw.TryPop();
+            assert(LastPosition && abs(LastPosition->Data.Vect3D.GetX() - float(Track.back().Latitude)) < 1e-4f);
+            assert(LastVelocity && abs(LastVelocity->Data.Vect3D.GetZ() - 125.0f) < 1e-3f);
+            delete LastPosition;
+            delete LastVelocity;
+            assert(abs(getpos().lat - float(Track.back().Latitude)) < 1e-4f && abs(getpos().lon - float(Track.back().Longitude)) < 1e-4f);
+
+            Logs Reading;
+            RocketSensors::GPSParser IntoLog;
+            IntoLog.SetHandler(RocketSensors::StoreFix<Coordinates>, &Reading.gps);
+            IntoLog.Feed(Capture.data(), Capture.size());
+            assert(Reading.gps.latitude == Expected.back().Latitude && abs(Reading.gps.altitude - Expected.back().Altitude) < 1e-3);
+
+            RocketSimulation::Random Fuzz(2024);
+            vector<RocketSensors::GPSFix> Got;
+            RocketSensors::GPSParser Chunked;
+            Chunked.SetHandler(CollectFix, &Got);
+            FeedInChunks(Chunked, Capture, Fuzz);
+            assert(Got.size() == Expected.size());
+            for(size_t i = 0; i < Got.size(); i++) {assert(Got[i].Latitude == Expected[i].Latitude && Got[i].TimeOfDay == Expected[i].TimeOfDay && Got[i].Source == Expected[i].Source);}
+
+            for(int Trial = 0; Trial < 300; Trial++){
+                vector<uint8_t> Damaged = Capture;
+                Damaged[Fuzz.Next() % Damaged.size()] ^= uint8_t(1 + Fuzz.Next() % 255);
+                Got.clear();
+                RocketSensors::GPSParser Parser;
+                Parser.SetHandler(CollectFix, &Got);
+                FeedInChunks(Parser, Damaged, Fuzz);
+                assert(Got.size() + 10 >= Expected.size() && Got.size() <= Expected.size());
+                size_t Match = 0;
+                for(const RocketSensors::GPSFix& f : Got){
+                    // fields a message does not carry may differ, as the message that set them can be the one lost
+                    while(Match < Expected.size() && !(Expected[Match].Latitude == f.Latitude && Expected[Match].Longitude == f.Longitude &&
+                          Expected[Match].TimeOfDay == f.TimeOfDay && Expected[Match].Source == f.Source)) {Match++;}
+                    assert(Match < Expected.size());
+                    assert(f.Source == RocketSensors::GPS_RMC || f.Altitude == Expected[Match].Altitude);
+                    assert(f.Source == RocketSensors::GPS_GGA || f.VelocityNorth == Expected[Match].VelocityNorth);
+                    Match++;
+                }
+            }
+            for(int Trial = 0; Trial < 100; Trial++){
+                vector<uint8_t> Damaged(Capture.begin(), Capture.begin() + Fuzz.Next() % Capture.size());
+                int Flips = 1 + int(Fuzz.Next() % 40);
+                for(int i = 0; i < Flips && !Damaged.empty(); i++) {Damaged[Fuzz.Next() % Damaged.size()] = uint8_t(Fuzz.Next());}
+                RocketSensors::GPSParser Parser;
+                FeedInChunks(Parser, Damaged, Fuzz);
+                assert(Parser.GetStats().Fixes <= Expected.size());
+                assert(!Parser.HasFix() || (abs(Parser.GetFix().Latitude) <= 90.0 && abs(Parser.GetFix().Longitude) <= 180.0));
+            }
+            vector<uint8_t> Noise(1 << 16);
+            for(uint8_t& b : Noise) {b = uint8_t(Fuzz.Next());}
+            RocketSensors::GPSParser OnNoise;
+            FeedInChunks(OnNoise, Noise, Fuzz);
+            assert(OnNoise.GetStats().Fixes == 0 && OnNoise.GetStats().Skipped > 0);
+        }
+
+        // GPS, recorded: sentences as logged from three receivers (checksums as they were sent, empty and short
+        // fields, southern and western hemispheres, GSA and GSV that carry no fix), a UBX ACK-ACK as a receiver
+        // answers CFG-PRT, and a NAV-PVT assembled byte by byte from the u-blox interface description; none of it
+        // comes from the encoders above
+        {
+            const char* Recorded =
+                "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"
+                "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n"
+                "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39\r\n"
+                "$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45*75\r\n"
+                "$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76\r\n"
+                "$GPGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38*0A\r\n"
+                "$GPGSV,3,1,11,10,63,137,17,07,61,098,15,05,59,290,20,08,54,157,30*70\r\n"
+                "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43\r\n"
+                "$GPGGA,092751.000,5321.6802,N,00630.3371,W,1,8,1.03,61.7,M,55.3,M,,*75\r\n"
+                "$GPRMC,092751.000,A,5321.6802,N,00630.3371,W,0.06,31.66,280511,,,A*45\r\n"
+                "$GPGGA,092204.999,4250.5589,S,14718.5084,E,1,04,24.4,19.7,M,,,,0000*1F\r\n"
+                "$GPRMC,092204.999,A,4250.5589,S,14718.5084,E,0.00,89.68,211200,,*25\r\n";
+            const uint8_t Ubx[] = {
+                0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x06, 0x01, 0x0F, 0x38,
+                0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x20, 0x3A, 0x1C, 0x07, 0xDB, 0x07, 0x05, 0x1C, 0x09, 0x1B,
+                0x34, 0x07, 0x19, 0x00, 0x00, 0x00, 0x00, 0x84, 0xD7, 0x17, 0x03, 0x01, 0x00, 0x0B, 0x49, 0x52,
+                0x1F, 0xFC, 0x37, 0x4B, 0xCE, 0x1F, 0xA4, 0xC8, 0x01, 0x00, 0x04, 0xF1, 0x00, 0x00, 0x08, 0x07,
+                0x00, 0x00, 0x28, 0x0A, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00, 0xD8, 0xFF, 0xFF, 0xFF, 0xF1, 0xFF,
+                0xFF, 0xFF, 0x7E, 0x00, 0x00, 0x00, 0x30, 0x4F, 0x30, 0x00, 0x5E, 0x01, 0x00, 0x00, 0x80, 0x38,
+                0x01, 0x00, 0xAC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                0x00, 0x00, 0xD1, 0x3A};
+            vector<uint8_t> Fixture(Recorded, Recorded + strlen(Recorded));
+            Fixture.insert(Fixture.end(), Ubx, Ubx + sizeof(Ubx));
+
+            vector<RocketSensors::GPSFix> Fixes;
+            RocketSensors::GPSParser Receiver;
+            Receiver.SetHandler(CollectFix, &Fixes);
+            assert(Receiver.Feed(Fixture.data(), Fixture.size()) == 9 && Fixes.size() == 9);
+            const RocketSensors::GPSStats& Counted = Receiver.GetStats();
+            assert(Counted.Sentences == 12 && Counted.Messages == 2 && Counted.ChecksumErrors == 0 && Counted.Malformed == 0 && Counted.Skipped == 0);
+
+            const RocketSensors::GPSFix &Munich = Fixes[0], &MunichRMC = Fixes[1], &Dublin = Fixes[2], &DublinRMC = Fixes[3];
+            const RocketSensors::GPSFix &Hobart = Fixes[6], &HobartRMC = Fixes[7], &Pvt = Fixes[8];
+            assert(Munich.Source == RocketSensors::GPS_GGA && Munich.TimeOfDay == 45319000);
+            assert(abs(Munich.Latitude - 48.1173) < 1e-9 && abs(Munich.Longitude - (11.0 + 31.0 / 60.0)) < 1e-9);
+            assert(abs(Munich.Altitude - 545.4f) < 1e-3f && Munich.Satellites == 8 && abs(Munich.DOP - 0.9f) < 1e-6f);
+            assert(MunichRMC.Source == RocketSensors::GPS_RMC && MunichRMC.HaveVelocity);
+            assert(abs(sqrt(MunichRMC.VelocityNorth * MunichRMC.VelocityNorth + MunichRMC.VelocityEast * MunichRMC.VelocityEast) - 22.4f * 1852.0f / 3600.0f) < 1e-3f);
+            assert(abs(atan2(MunichRMC.VelocityEast, MunichRMC.VelocityNorth) * 180.0f / 3.14159265f - 84.4f) < 1e-3f);
+            assert(Dublin.TimeOfDay == 34070000 && abs(Dublin.Latitude - (53.0 + 21.6802 / 60.0)) < 1e-9 && abs(Dublin.Longitude + 6.0 + 30.3372 / 60.0) < 1e-9);
+            assert(abs(Dublin.Altitude - 61.7f) < 1e-3f && Dublin.Satellites == 8 && abs(Dublin.DOP - 1.03f) < 1e-6f);
+            assert(DublinRMC.TimeOfDay == 34070000 && abs(DublinRMC.VelocityNorth - 0.02f * 1852.0f / 3600.0f * cos(31.66f * 3.14159265f / 180.0f)) < 1e-5f);
+            assert(Fixes[4].TimeOfDay == 34071000 && abs(Fixes[4].Longitude + 6.0 + 30.3371 / 60.0) < 1e-9 && Fixes[5].Source == RocketSensors::GPS_RMC);
+            assert(Hobart.TimeOfDay == 33724999 && abs(Hobart.Latitude + 42.0 + 50.5589 / 60.0) < 1e-9 && abs(Hobart.Longitude - 147.0 - 18.5084 / 60.0) < 1e-9);
+            assert(Hobart.Satellites == 4 && abs(Hobart.DOP - 24.4f) < 1e-5f && abs(Hobart.Altitude - 19.7f) < 1e-4f);
+            assert(HobartRMC.VelocityNorth == 0.0f && HobartRMC.VelocityEast == 0.0f);
+            assert(Pvt.Source == RocketSensors::GPS_NAV_PVT && Pvt.TimeOfDay == 34072400 && Pvt.Satellites == 11);
+            assert(abs(Pvt.Latitude - 53.3613367) < 1e-9 && abs(Pvt.Longitude + 6.5056183) < 1e-9 && abs(Pvt.Altitude - 61.7f) < 1e-4f);
+            assert(abs(Pvt.VelocityNorth - 0.12f) < 1e-6f && abs(Pvt.VelocityEast + 0.04f) < 1e-6f && abs(Pvt.VelocityUp - 0.015f) < 1e-6f);
+            assert(abs(Pvt.HorizontalAccuracy - 1.8f) < 1e-6f && abs(Pvt.DOP - 1.72f) < 1e-6f);
+
+            RocketSimulation::Random Split(7);
+            Fixes.clear();
+            RocketSensors::GPSParser Chunked;
+            Chunked.SetHandler(CollectFix, &Fixes);
+            FeedInChunks(Chunked, Fixture, Split);
+            assert(Fixes.size() == 9 && Fixes[8].Latitude == Pvt.Latitude && Fixes[6].Longitude == Hobart.Longitude);
+
+            char Angle[16];
+            RocketSensors::FormatAngle(Angle, sizeof(Angle), Dublin.Longitude, 3);
+            assert(string(Angle) == "00630.33720");
+            RocketSensors::FormatAngle(Angle, sizeof(Angle), 47.9999999999, 2);
+            assert(string(Angle) == "4800.00000");
+        }
+
+        // Landing prediction: the wind below the vehicle follows the shear law from the last descent sample, the
+        // descent integrates band by band to the ground, the measured descent rate replaces the nominal one, and
+        // the scatter of recent predictions gives the ellipse
+        {
+            windProfile Profile(50.0f, 1.0f / 7.0f);
+            Profile.observeAscent(25.0f, 0.0f, 3.0f);
+            Profile.observeAscent(475.0f, 0.0f, 6.0f);
+            float ProfileNorth[windProfile::BINS], ProfileEast[windProfile::BINS];
+            Profile.resolve(ProfileNorth, ProfileEast);
+            assert(ProfileEast[0] == 3.0f && ProfileEast[5] == 3.0f && ProfileEast[9] == 6.0f && ProfileEast[40] == 6.0f);
+            Profile.observeDescent(300.0f, 10.0f, 0.0f);
+            Profile.resolve(ProfileNorth, ProfileEast);
+            assert(abs(ProfileNorth[0] - 10.0f * pow(25.0f / 300.0f, 1.0f / 7.0f)) < 1e-4f && ProfileEast[0] == 0.0f);
+            assert(ProfileNorth[5] == 10.0f && ProfileEast[9] == 6.0f && Profile.learnt(5) && !Profile.learnt(20));
+
+            descentModel Calm;
+            Calm.shear = 0.0f;
+            landingPredictor Landing(Calm, 150.0f);
+            Landing.setPad(34.0691, 72.6441);
+            RocketSensors::GPSFix Fix;
+            Fix.Valid = Fix.HaveVelocity = true;
+            Fix.Latitude = 34.0691;
+            Fix.Longitude = 72.6441;
+            assert(!Landing.update(0.0f, Fix, 0.0f, 0.0f, PHASE_ARMED) && !Landing.prediction().valid);
+            Fix.VelocityNorth = 5.0f;
+            assert(Landing.update(20.0f, Fix, 500.0f, -20.0f, PHASE_DROGUE));
+            landingPrediction First = Landing.prediction();
+            assert(First.valid && First.timeToLanding > 46.0f && First.timeToLanding < 47.5f);
+            assert(abs(First.north - 5.0f * First.timeToLanding) < 0.05f && abs(First.east) < 0.01f);
+            double CheckNorth = (First.latitude - 34.0691) * 6371000.0 * 3.14159265358979323846 / 180.0;
+            assert(abs(CheckNorth - First.north) < 0.1);
+            float FirstTime = First.timeToLanding;
+
+            // Drifting with the wind at the nominal rate, the fixes 3 m either side of the track
+            const float NorthMetres = 6371000.0f * 3.14159265358979323846f / 180.0f;
+            for(int i = 1; i <= 30; i++){
+                float North = 2.5f * float(i), East = i % 2 ? 3.0f : -3.0f;
+                Fix.Latitude = 34.0691 + North / NorthMetres;
+                Fix.Longitude = 72.6441 + East / (NorthMetres * cos(34.0691 * 3.14159265358979323846 / 180.0));
+                Landing.update(20.0f + 0.5f * float(i), Fix, 500.0f - 10.0f * float(i), -20.0f, PHASE_DROGUE);
+            }
+            landingEllipse Spread = Landing.ellipse();
+            assert(Spread.samples == 31 && Landing.predictions() == 31 && Spread.major >= Spread.minor);
+            assert(abs(Spread.major - 3.0f) < 0.5f && Spread.minor < 1.0f && abs(Spread.heading - 90.0f) < 10.0f);
+            assert(abs(Spread.north - First.north) < 2.0f);
+
+            // Falling at half the nominal rate doubles the time left, after the chute has settled
+            landingPredictor Slow(Calm, 150.0f);
+            Slow.setPad(34.0691, 72.6441);
+            for(int i = 0; i <= 40; i++) {Slow.update(20.0f + 0.1f * float(i), Fix, 500.0f, -10.0f, PHASE_DROGUE);}
+            assert(Slow.prediction().timeToLanding > 60.0f && Slow.prediction().timeToLanding < 66.0f && FirstTime < 48.0f);
+
+            assert(Landing.update(80.0f, Fix, 0.0f, 0.0f, PHASE_LANDED) && Landing.prediction().timeToLanding == 0.0f);
+            assert(abs(Landing.prediction().latitude - Fix.Latitude) < 1e-9 && abs(Landing.prediction().longitude - Fix.Longitude) < 1e-9);
+            Landing.reset();
+            assert(Landing.update(1.0f, Fix, 100000.0f, -100.0f, PHASE_DROGUE) && Landing.prediction().timeToLanding > 0.0f);
+        }
+
+        // Telemetry frames: the checks match their published check values, COBS leaves no zero inside a frame
+        // and undoes itself, channels come back within half a step, and a damaged frame is never accepted
+        {
+            const uint8_t Digits[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+            assert(crc16(Digits, 9) == 0x29B1 && crc32(Digits, 9) == 0xCBF43926u);
+
+            const uint8_t Short[] = {0x11, 0x22, 0x00, 0x33};
+            uint8_t Stuffed[600], Unstuffed[600];
+            size_t Length = cobsEncode(Short, 4, Stuffed), Decoded;
+            assert(Length == 5 && Stuffed[0] == 3 && Stuffed[3] == 2 && Stuffed[4] == 0x33);
+            RocketSimulation::Random Bytes(11);
+            for(size_t Size : {size_t(0), size_t(1), size_t(253), size_t(254), size_t(255), size_t(508), size_t(509)}){
+                vector<uint8_t> Plain(Size);
+                for(uint8_t& b : Plain) {b = uint8_t(Bytes.Next() % 4 == 0 ? 0 : 1 + Bytes.Next() % 255);}
+                if(Size == 254 || Size == 508) {for(uint8_t& b : Plain) {b = 7;}}
+                Length = cobsEncode(Plain.data(), Size, Stuffed);
+                assert(Length <= cobsMaxEncoded(Size));
+                for(size_t i = 0; i < Length; i++) {assert(Stuffed[i] != 0);}
+                assert(cobsDecode(Stuffed, Length, Unstuffed, Decoded) && Decoded == Size);
+                for(size_t i = 0; i < Size; i++) {assert(Unstuffed[i] == Plain[i]);}
+            }
+
+            uint8_t Packed[64];
+            BitWriter Writer(Packed, sizeof(Packed));
+            for(int Bits = 1; Bits <= 32; Bits++) {Writer.write(0xA5A5A5A5u, Bits);}
+            assert(Writer.overflowed() && Writer.flush() == sizeof(Packed));
+            BitWriter Fits(Packed, sizeof(Packed));
+            for(int Bits = 1; Bits <= 31; Bits++) {Fits.write(0xA5A5A5A5u, Bits);}
+            assert(Fits.flush() == 62 && !Fits.overflowed());
+            BitReader Reader(Packed, 62);
+            for(int Bits = 1; Bits <= 31; Bits++) {assert(Reader.read(Bits) == (0xA5A5A5A5u & ((1u << Bits) - 1u)));}
+            assert(Reader.remaining() == 0 && !Reader.overrun());
+            Reader.read(1);
+            assert(Reader.overrun());
+
+            typedef TelemetryChannel<LogAltitudeField, 20, -1000, 31000> Altitude;
+            assert(Altitude::quantise(-5000.0) == 0 && Altitude::quantise(1e9) == (1u << 20) - 1u && Altitude::quantise(NAN) == 0);
+            assert(abs(Altitude::restore(Altitude::quantise(1234.567)) - 1234.567) <= Altitude::resolution() / 2.0);
+
+            vector<Logs> Sent;
+            TelemetryFrameWriter Frame(CHECK_CRC16);
+            Frame.begin(4242);
+            for(int i = 0; ; i++){
+                Logs l;
+                l.timestamp = 12.345 + i;
+                l.gps = Coordinates(34.0691 + 1e-5 * i, 72.6441 - 1e-5 * i, 1350.25 + i);
+                l.bearing = 359.5;
+                l.velocity = -123.45;
+                l.acceleration = 9.80655;
+                l.temperature = 21.3;
+                l.pressure = 1013.25;
+                if(!Frame.append<LogMessage>(l)) {break;}
+                Sent.push_back(l);
+            }
+            assert(Sent.size() == size_t((TELEMETRY_MAX_FRAME - 5) * 8 / LogMessage::MESSAGE_BITS) && Frame.frameBytes() <= TELEMETRY_MAX_FRAME);
+            uint8_t Wire[TELEMETRY_MAX_ENCODED];
+            size_t WireLength = Frame.finish(Wire);
+            assert(Wire[WireLength - 1] == 0);
+            for(size_t i = 0; i + 1 < WireLength; i++) {assert(Wire[i] != 0);}
+
+            typedef TelemetryCodec<LogMessage> LogCodec;
+            TelemetryFrameReader Received(CHECK_CRC16);
+            vector<Logs> Got;
+            auto Collect = [&](auto, const Logs& l){ Got.push_back(l); };
+            assert(LogCodec::decode(Received, Wire, WireLength - 1, Collect) == FRAME_OK);
+            assert(Received.sequence() == 4242 && Got.size() == Sent.size());
+            for(size_t i = 0; i < Got.size(); i++){
+                assert(abs(Got[i].timestamp - Sent[i].timestamp) < 1e-3 && abs(Got[i].gps.latitude - Sent[i].gps.latitude) < 1e-7);
+                assert(abs(Got[i].gps.longitude - Sent[i].gps.longitude) < 1e-7 && abs(Got[i].gps.altitude - Sent[i].gps.altitude) < 0.02);
+                assert(abs(Got[i].bearing - 359.5) < 0.05 && abs(Got[i].velocity + 123.45) < 0.02 && abs(Got[i].pressure - 1013.25) < 0.01);
+            }
+
+            // Every single byte error, and random bursts, are caught by the stuffing or the check
+            for(size_t i = 0; i + 1 < WireLength; i++){
+                for(uint8_t Flip : {uint8_t(0x01), uint8_t(0x80), uint8_t(0xFF)}){
+                    uint8_t Damaged[TELEMETRY_MAX_ENCODED];
+                    copy(Wire, Wire + WireLength, Damaged);
+                    Damaged[i] ^= Flip;
+                    assert(Received.open(Damaged, WireLength - 1) != FRAME_OK);
+                }
+            }
+            TelemetryFrameWriter Wide(CHECK_CRC32, 64);
+            Wide.begin(7);
+            assert(Wide.append<LogMessage>(Sent[0]) && Wide.append<LogMessage>(Sent[1]) && !Wide.append<LogMessage>(Sent[2]));
+            WireLength = Wide.finish(Wire);
+            TelemetryFrameReader WideReceived(CHECK_CRC32);
+            Got.clear();
+            assert(LogCodec::decode(WideReceived, Wire, WireLength - 1, Collect) == FRAME_OK && Got.size() == 2);
+            assert(Received.open(Wire, WireLength - 1) == FRAME_BAD_CHECK);
+            for(int Trial = 0; Trial < 2000; Trial++){
+                uint8_t Damaged[TELEMETRY_MAX_ENCODED];
+                copy(Wire, Wire + WireLength, Damaged);
+                size_t Start = Bytes.Next() % (WireLength - 1), Burst = 1 + Bytes.Next() % 8;
+                for(size_t i = Start; i < Start + Burst && i + 1 < WireLength; i++) {Damaged[i] = uint8_t(Bytes.Next());}
+                if(equal(Wire, Wire + WireLength, Damaged)) {continue;}
+                assert(WideReceived.open(Damaged, WireLength - 1) != FRAME_OK);
+            }
+
+            typedef TelemetryFormat<2, Logs, TelemetryChannel<LogPressureField, 16, 0, 1100>> PressureMessage;
+            Frame.begin(1);
+            Frame.append<LogMessage>(Sent[0]);
+            Frame.append<PressureMessage>(Sent[0]);
+            WireLength = Frame.finish(Wire);
+            Got.clear();
+            assert(LogCodec::decode(Received, Wire, WireLength - 1, Collect) == FRAME_UNKNOWN_FORMAT && Got.size() == 1);
+            int Pressures = 0;
+            assert((TelemetryCodec<LogMessage, PressureMessage>::decode(Received, Wire, WireLength - 1,
+                [&](auto Format, const Logs&){ Pressures += decltype(Format)::ID == 2; }) == FRAME_OK && Pressures == 1));
+            assert(Received.open(Wire, 2) == FRAME_TOO_SHORT && Received.open(Wire, TELEMETRY_MAX_ENCODED + 1) == FRAME_TOO_LONG);
+        }
+
+        // Telemetry scheduling: streams are held to their rates, the byte budget is never exceeded, a level only
+        // gets what the levels above leave, streams of one level degrade by the same fraction, and an event goes
+        // out at the next poll
+        {
+            auto Fly = [](TelemetryScheduler& Link, int Attitude, int GPS, int Housekeeping, int Events, double Seconds,
+                          vector<vector<uint8_t>>& Frames, double EventAt){
+                uint8_t Out[TELEMETRY_MAX_ENCODED];
+                RocketSensors::GPSFix Fix;
+                Fix.Latitude = 34.0691;
+                Fix.Longitude = 72.6441;
+                for(int i = 0; i < int(Seconds * 100.0); i++){
+                    double t = 0.01 * i;
+                    Link.offer<AttitudeMessage>(Attitude, AttitudeSample(t, 1.0, 2.0, 3.0), t);
+                    Fix.TimeOfDay = uint32_t(1000 * i / 100);
+                    Link.offer<GPSMessage>(GPS, Fix, t);
+                    Link.offer<HousekeepingMessage>(Housekeeping, HousekeepingSample(), t);
+                    if(EventAt >= 0.0 && abs(t - EventAt) < 0.005) {Link.offer<EventMessage>(Events, FlightEvent(t, PHASE_APOGEE, 450.0), t);}
+                    size_t Length = Link.poll(t, Out);
+                    if(Length) {Frames.push_back(vector<uint8_t>(Out, Out + Length));}
+                }
+            };
+
+            TelemetryScheduler Roomy(4000.0);
+            int Attitude = Roomy.addStream<AttitudeMessage>("attitude", 1, 50.0);
+            int GPS = Roomy.addStream<GPSMessage>("gps", 2, 5.0);
+            int Housekeeping = Roomy.addStream<HousekeepingMessage>("housekeeping", 3, 1.0);
+            int Events = Roomy.addStream<EventMessage>("events", 0, 0.0, 16);
+            assert(Roomy.addStream<GPSMessage>("bad", -1, 5.0) == -1 && Roomy.addStream<GPSMessage>("bad", 1, -5.0) == -1);
+            assert(!Roomy.offer<GPSMessage>(Attitude, RocketSensors::GPSFix(), 0.0) && Roomy.stats(Attitude).offered == 0);
+            vector<vector<uint8_t>> Frames;
+            Fly(Roomy, Attitude, GPS, Housekeeping, Events, 10.0, Frames, 5.0);
+            assert(Roomy.stats(Attitude).offered == 1000 && Roomy.stats(Attitude).decimated == 500);
+            assert(Roomy.stats(GPS).decimated == 950 && Roomy.stats(Housekeeping).decimated == 990);
+            for(int i : {Attitude, GPS, Housekeeping}) {assert(Roomy.stats(i).dropped == 0 && Roomy.stats(i).maxDelay <= 0.11 + 1e-9);} // maxLatency, plus up to one poll
+            assert(Roomy.stats(Attitude).sent >= 495 && abs(Roomy.achievedRate(Attitude) - 50.0) < 1.0);
+            assert(Roomy.stats(Events).sent == 1 && Roomy.stats(Events).maxDelay == 0.0);
+
+            // The ground sees every message sent, in frame order, the event at the front of its frame
+            TelemetryFrameReader Ground;
+            uint64_t Decoded[5] = {0, 0, 0, 0, 0};
+            bool EventFirst = false;
+            for(size_t f = 0; f < Frames.size(); f++){
+                int Position = 0;
+                assert(FlightCodec::decode(Ground, Frames[f].data(), Frames[f].size() - 1, [&](auto Format, const auto&){
+                    if(decltype(Format)::ID == 0) {EventFirst = Position == 0;}
+                    Decoded[decltype(Format)::ID]++;
+                    Position++; }) == FRAME_OK);
+                assert(Ground.sequence() == uint16_t(f));
+            }
+            assert(EventFirst && Decoded[0] == 1 && Decoded[2] == Roomy.stats(Attitude).sent && Decoded[3] == Roomy.stats(GPS).sent);
+            assert(Decoded[4] == Roomy.stats(Housekeeping).sent && Roomy.frameCount() == Frames.size());
+
+            // Half the bytes attitude and GPS need: they get the same share of their rates, housekeeping below
+            // them only the bits their messages leave at the end of a frame. The budget holds throughout
+            TelemetryScheduler Tight(300.0);
+            Attitude = Tight.addStream<AttitudeMessage>("attitude", 1, 50.0);
+            GPS = Tight.addStream<GPSMessage>("gps", 1, 5.0);
+            Housekeeping = Tight.addStream<HousekeepingMessage>("housekeeping", 2, 1.0);
+            Events = Tight.addStream<EventMessage>("events", 0, 0.0, 16);
+            Frames.clear();
+            Fly(Tight, Attitude, GPS, Housekeeping, Events, 30.0, Frames, 20.0);
+            size_t Sent = 0;
+            for(const vector<uint8_t>& f : Frames) {Sent += f.size();}
+            assert(double(Sent) <= 300.0 * 30.0 + 2.0 * 258.0);
+            assert(Tight.utilisation() > 0.9 && Tight.stats(Attitude).dropped > 0);
+            double AttitudeShare = Tight.achievedRate(Attitude) / 50.0, GPSShare = Tight.achievedRate(GPS) / 5.0;
+            assert(AttitudeShare > 0.3 && AttitudeShare < 0.9 && abs(AttitudeShare - GPSShare) < 0.1);
+            assert(Tight.stats(Housekeeping).dropped == 0);
+            assert(Tight.stats(Events).sent == 1 && Tight.stats(Events).maxDelay < 0.5);
+
+            TelemetryScheduler Ranked(300.0);
+            int Primary = Ranked.addStream<AttitudeMessage>("primary", 1, 50.0);
+            int Backup = Ranked.addStream<AttitudeMessage>("backup", 2, 50.0);
+            uint8_t Out[TELEMETRY_MAX_ENCODED];
+            for(int i = 0; i < 2000; i++){
+                double t = 0.01 * i;
+                Ranked.offer<AttitudeMessage>(Primary, AttitudeSample(t, 0.0, 0.0, 0.0), t);
+                Ranked.offer<AttitudeMessage>(Backup, AttitudeSample(t, 0.0, 0.0, 0.0), t);
+                Ranked.poll(t, Out);
+            }
+            // the backup only got through on the bucket's initial burst, before either queue had filled a frame
+            assert(Ranked.stats(Primary).sent > 500 && Ranked.stats(Backup).sent < Ranked.stats(Primary).sent / 10);
+
+            Tight.reset();
+            assert(Tight.frameCount() == 0 && Tight.queued(Attitude) == 0 && Tight.stats(Attitude).offered == 0);
+        }
+
+        // Reed-Solomon: the field tables agree with the definition, the PSHUFB kernel with the table one, a codeword
+        // takes up to P/2 errors plus erasures up to P in all, and across frames any k of a block's k + p frames
+        // give back the telemetry frames, in whatever order they arrive
+        {
+            uint8_t Slow = 0;
+            for(int a = 0x53, b = 0xCA; b; b >>= 1){
+                if(b & 1) {Slow ^= uint8_t(a);}
+                a = (a << 1) ^ (a & 0x80 ? 0x11D : 0);
+            }
+            assert(gfMul(0x53, 0xCA) == Slow && gfMul(gfInverse(0x53), 0x53) == 1 && gfAlpha(255) == 1 && gfAlpha(-1) == gfInverse(2));
+            uint8_t In[100], ByTable[100], ByShuffle[100];
+            for(int i = 0; i < 100; i++) {In[i] = uint8_t(i * 29 + 5); ByTable[i] = ByShuffle[i] = uint8_t(i);}
+            gfMulAddTable(ByTable, In, 0x8E, 100);
+            gfMulAddShuffle(ByShuffle, In, 0x8E, 100);
+            assert(memcmp(ByTable, ByShuffle, 100) == 0 && ByTable[7] == (7 ^ gfMul(In[7], 0x8E)));
+
+            ReedSolomon Code(8);
+            uint8_t Word[40], Sent[40];
+            for(int i = 0; i < 32; i++) {Word[i] = uint8_t(i * 7 + 1);}
+            Code.encode(Word, 32, Word + 32);
+            memcpy(Sent, Word, 40);
+            assert(Code.decode(Word, 40) == 0);
+            Word[0] ^= 0xFF; Word[17] ^= 1; Word[33] ^= 0x40; Word[39] ^= 9;
+            assert(Code.decode(Word, 40) == 4 && memcmp(Word, Sent, 40) == 0);
+            int Erased[6] = {2, 3, 4, 20, 21, 36};
+            for(int e : Erased) {Word[e] = 0x77;}
+            Word[10] ^= 0x10;
+            assert(Code.decode(Word, 40, Erased, 6) == 7 && memcmp(Word, Sent, 40) == 0);
+            for(int e = 0; e < 5; e++) {Word[e * 8] ^= uint8_t(e + 1);}
+            assert(Code.decode(Word, 40) == -1 && Word[8] == (Sent[8] ^ 2)); // five errors: refused, left as it was
+
+            // Blocks of 4 + 2: the telemetry frames go out as they come, the parity after the fourth
+            TelemetryFrameWriter Writer;
+            FecEncoder Encoder(4, 2);
+            vector<vector<uint8_t>> Wire;
+            auto Send = [&](const uint8_t* Bytes, size_t Length){ Wire.push_back(vector<uint8_t>(Bytes, Bytes + Length)); };
+            uint8_t Out[TELEMETRY_MAX_ENCODED];
+            for(int f = 0; f < 10; f++){
+                Writer.begin(uint16_t(f));
+                for(int m = 0; m <= f; m++) {Writer.append<AttitudeMessage>(AttitudeSample(f, m, 0.0, 0.0));}
+                Encoder.encode(Out, Writer.finish(Out), Send);
+                assert(Wire.size() == size_t(f + 1 + (f + 1) / 4 * 2));
+            }
+            Encoder.flush(Send);
+            assert(Wire.size() == 18 && Encoder.stats().blocks == 3); // the last block two short, sent empty
+
+            // Two frames of each block lost, the rest in reverse order: all ten telemetry frames come through
+            FecDecoder Decoder;
+            TelemetryFrameReader Ground;
+            vector<int> Seen(10, 0);
+            auto Deliver = [&](const uint8_t* Frame, size_t Length){
+                assert(Ground.open(Frame, Length) == FRAME_OK && Ground.sequence() < 10 && Ground.messages() == Ground.sequence() + 1);
+                Seen[Ground.sequence()]++;
+            };
+            for(int i = 17; i >= 0; i--){
+                if(i % 6 == 1 || i % 6 == 2) {continue;}
+                assert(Decoder.receive(Wire[i].data(), Wire[i].size() - 1, Deliver) == FRAME_OK);
+            }
+            Decoder.flush();
+            for(int n : Seen) {assert(n == 1);}
+            assert(Decoder.stats().recovered == 5 && Decoder.stats().lost == 0);
+
+            // With three good frames of a block, one short, the three damaged by a wrong byte each are mended.
+            // Three lost outright are one too many
+            FecDecoder Lossy;
+            fill(Seen.begin(), Seen.end(), 0);
+            assert(Lossy.receive(Wire[3].data(), Wire[3].size() - 1, Deliver) == FRAME_OK && Seen[3] == 1);
+            for(int i : {0, 1, 2}){
+                vector<uint8_t> Damaged = Wire[i];
+                uint8_t& Byte = Damaged[6 + 2 * i];
+                Byte = Byte == 0x55 ? 0x56 : 0x55;
+                assert(Lossy.receive(Damaged.data(), Damaged.size() - 1, Deliver) == FRAME_BAD_CHECK);
+            }
+            assert(Seen[0] + Seen[1] + Seen[2] == 0);
+            Lossy.receive(Wire[4].data(), Wire[4].size() - 1, Deliver);
+            assert(Seen[0] + Seen[1] + Seen[2] == 0);
+            Lossy.receive(Wire[5].data(), Wire[5].size() - 1, Deliver);
+            assert(Seen[0] == 1 && Seen[1] == 1 && Seen[2] == 1 && Lossy.stats().recovered == 3);
+            assert(Lossy.receive(Wire[6].data(), 3, Deliver) != FRAME_OK);
+            for(int i : {7, 8, 11}) {Lossy.receive(Wire[i].data(), Wire[i].size() - 1, Deliver);}
+            Lossy.flush();
+            assert(Lossy.stats().lost == 2 && Seen[5] == 1 && Seen[6] == 1 && Seen[4] == 0 && Seen[7] == 0);
+        }
+
+        // Ground station, over a loopback standing in for the radio: bytes in chunks of any size, a partial frame and
+        // noise ahead of frames, frames swapped, repeated and lost. The Logs come out in the order they were sent,
+        // the lost frames as one gap, and the running analysis covers every record the logger was given
+        {
+            TelemetryFrameWriter Writer;
+            vector<vector<uint8_t>> Frames;
+            uint8_t Out[TELEMETRY_MAX_ENCODED];
+            for(int f = 0; f < 30; f++){
+                Logs Reading;
+                Reading.timestamp = f;
+                Reading.gps.altitude = 100.0 + 10.0 * f;
+                Reading.velocity = f;
+                Writer.begin(uint16_t(f));
+                Writer.append<LogMessage>(Reading);
+                Writer.append<AttitudeMessage>(AttitudeSample(f, 1.0, 2.0, 3.0));
+                if(f == 15) {Writer.append<EventMessage>(FlightEvent(f, PHASE_APOGEE, 250.0));}
+                Frames.push_back(vector<uint8_t>(Out, Out + Writer.finish(Out)));
+            }
+            vector<uint8_t> Radio(Frames[5].end() - 6, Frames[5].end()); // joined mid-frame
+            auto Send = [&](const uint8_t* Bytes, size_t Length){ Radio.insert(Radio.end(), Bytes, Bytes + Length); };
+            for(int f : {0, 1, 2, 4, 3, 5, 6, 7, 8, 9, 2, -1, 12, 10, 11, 13, 14, 15, 16, 17, 20, 21, 22, 23, 24, 25, 25, 26, 27, 28, 29}){
+                if(f < 0) {Radio.insert(Radio.end(), 400, uint8_t(0x5A)); Radio.push_back(0);} // noise longer than any frame
+                else {Send(Frames[f].data(), Frames[f].size());}
+            }
+
+            const char* LogPath = "GroundStationTest.log";
+            remove(LogPath);
+            DataLogger GroundLog(LogPath);
+            GroundStation Ground(&GroundLog, CHECK_CRC16, 0, 8);
+            assert(Ground.jitterWindow() == 8);
+            vector<double> Times;
+            vector<FrameGap> Gaps;
+            auto Visit = [&](auto Format, const auto& Record){
+                if constexpr (decltype(Format)::ID == LogMessage::ID) {Times.push_back(Record.timestamp);}
+                if constexpr (decltype(Format)::ID == TelemetryGap::ID) {Gaps.push_back(Record);}
+            };
+            for(size_t i = 0; i < Radio.size(); i += 7) {Ground.receive(Radio.data() + i, min<size_t>(7, Radio.size() - i), Visit);}
+            Ground.flush(Visit);
+            const GroundStats& Stats = Ground.stats();
+            assert(Times.size() == 28 && Gaps.size() == 1 && Gaps[0].first == 18 && Gaps[0].frames == 2);
+            for(size_t i = 1; i < Times.size(); i++) {assert(Times[i] > Times[i - 1]);}
+            assert(Stats.rejected == 1 && Stats.discarded == 1 && Stats.late == 2 && Stats.missing == 2 && Stats.events == 1);
+            assert(Stats.bytes == Radio.size() && Ground.latestFlightEvent().code == PHASE_APOGEE);
+            assert(abs(Ground.MaxAltitude() - 390.0) < 0.1 && abs(Ground.latestLogs().timestamp - 29.0) < 0.01);
+            assert(GroundLog.getLatestData() && abs(GroundLog.getLatestData()->velocity - 29.0) < 0.05);
+            assert(abs(Ground.AverageVelocity() - (435.0 - 18.0 - 19.0) / 28.0) < 0.05);
+            GroundLog.clearCache();
+            remove(LogPath);
+
+            // Joining mid-stream, the frames before the first one heard are not flagged as lost
+            GroundStation Late;
+            Times.clear();
+            for(int f : {13, 12, 14, 15, 16, 17, 18, 19, 20, 21, 22}) {Late.receive(Frames[f].data(), Frames[f].size(), Visit);}
+            Late.flush(Visit);
+            assert(Times.size() == 11 && abs(Times[0] - 12.0) < 0.01 && Late.stats().gaps == 0 && Late.stats().late == 0);
+
+            // Through FEC 4+2, parity frames in the loopback too: two frames of a block lost and the rest of it
+            // reordered cost nothing, and the frames rebuilt late still come out in order
+            FecEncoder Encoder(4, 2);
+            vector<vector<uint8_t>> Wire;
+            auto Keep = [&](const uint8_t* Bytes, size_t Length){ Wire.push_back(vector<uint8_t>(Bytes, Bytes + Length)); };
+            for(int f = 0; f < 30; f++) {Encoder.encode(Frames[f].data(), Frames[f].size(), Keep);}
+            Encoder.flush(Keep);
+            GroundStation Coded(nullptr, CHECK_CRC16, 4, 4);
+            assert(Coded.jitterWindow() == 8);
+            Radio.clear();
+            for(size_t b = 0; b < Wire.size(); b += 6){
+                for(size_t i : {size_t(5), size_t(3), size_t(2), size_t(4)}) {if(b + i < Wire.size()) {Send(Wire[b + i].data(), Wire[b + i].size());}}
+            }
+            Times.clear();
+            Gaps.clear();
+            Coded.receive(Radio.data(), Radio.size(), Visit);
+            Coded.flush(Visit);
+            assert(Times.size() == 30 && Gaps.empty() && Coded.stats().late == 0 && Coded.fecStats().recovered == 16);
+            for(size_t i = 0; i < Times.size(); i++) {assert(abs(Times[i] - double(i)) < 0.01);}
+        }
+
+        // Simulated radio: packets queue for the air at the bandwidth and arrive a latency later, noise is the same
+        // for the same seed, and held back packets overtake. A downlink through it comes out whole on a clean
+        // channel, and FEC gets more of it through a noisy one
+        {
+            RocketSimulation::RadioSettings Radio;
+            Radio.Bandwidth = 1000.0;
+            Radio.Latency = 0.05;
+            RocketSimulation::RadioChannel Clean(Radio);
+            uint8_t Packet[100];
+            for(int i = 0; i < 100; i++) {Packet[i] = uint8_t(i + 1);}
+            assert(abs(Clean.Send(0.0, Packet, 100) - 0.15) < 1e-9 && abs(Clean.Send(0.0, Packet, 100) - 0.25) < 1e-9);
+            vector<double> Arrivals;
+            auto Collect = [&](double Arrival, const uint8_t* Bytes, size_t Length){
+                assert(Length == 100 && memcmp(Bytes, Packet, 100) == 0);
+                Arrivals.push_back(Arrival);
+            };
+            assert(Clean.Receive(0.2, Collect) == 1 && Clean.Pending() == 1 && Clean.Receive(1.0, Collect) == 1);
+            assert(Clean.GetStats().Queued > 0.099 && Clean.GetStats().Flipped == 0);
+
+            Radio.BitErrorRate = 1e-3;
+            Radio.FadeRate = 1.0;
+            Radio.ReorderRate = 0.5;
+            Radio.ReorderDelay = 1.0;
+            RocketSimulation::RadioChannel Noisy(Radio, 5), Same(Radio, 5);
+            vector<uint8_t> First, Second;
+            vector<double> Order;
+            for(int p = 0; p < 1000; p++){
+                Packet[0] = uint8_t(p);
+                Noisy.Send(0.1 * p, Packet, 100);
+                Same.Send(0.1 * p, Packet, 100);
+            }
+            Noisy.Receive(1e9, [&](double Arrival, const uint8_t* Bytes, size_t Length){ First.insert(First.end(), Bytes, Bytes + Length); Order.push_back(Arrival); });
+            Same.Receive(1e9, [&](double, const uint8_t* Bytes, size_t Length){ Second.insert(Second.end(), Bytes, Bytes + Length); });
+            const RocketSimulation::RadioStats& Noise = Noisy.GetStats();
+            assert(First == Second && is_sorted(Order.begin(), Order.end()));
+            assert(Noise.Flipped > 600 && Noise.Flipped < 1000 && Noise.Faded > 1000 && Noise.Reordered > 400 && Noise.Reordered < 600);
+
+            RocketSimulation::LinkSettings Link;
+            Link.Duration = 20.0;
+            RocketSimulation::RadioSettings Radio9600;
+            RocketSimulation::LinkReport Whole = RocketSimulation::FlyLink(Link, Radio9600);
+            assert(Whole.Sent > 1000 && Whole.Received == Whole.Sent && Whole.EventsReceived == 3 && Whole.Gaps == 0);
+            assert(Whole.WireRate <= Radio9600.Bandwidth && Whole.LatencyP50 > Radio9600.Latency && Whole.LatencyMax < 1.0);
+
+            Radio9600.BitErrorRate = 2e-4;
+            RocketSimulation::LinkReport Plain = RocketSimulation::FlyLink(Link, Radio9600, 3);
+            assert(Plain.Received < Plain.Sent && Plain.Gaps > 0 && RocketSimulation::FlyLink(Link, Radio9600, 3).Received == Plain.Received);
+            Link.FecData = 4;
+            Link.FecParity = 4;
+            RocketSimulation::LinkReport Coded = RocketSimulation::FlyLink(Link, Radio9600, 3);
+            assert(Coded.Recovered > Plain.Recovered && Coded.Goodput < Whole.Goodput);
+        }
+
+        // Monte Carlo: every index runs exactly once whatever the thread count, tasks may submit more tasks,
+        // a draw depends on its seed alone, a batch flown on three threads matches the same batch flown serially
+        // field for field, and the summary statistics of a known batch come out exact
+        {
+            WorkStealingPool Pool(3);
+            vector<int> Hits(1000, 0);
+            Pool.parallelFor(Hits.size(), 7, [&](size_t i){ Hits[i]++; });
+            for(int h : Hits) {assert(h == 1);}
+            atomic<int> Nested(0);
+            for(int i = 0; i < 10; i++) {Pool.submit([&]{ for(int j = 0; j < 10; j++) {Pool.submit([&]{ Nested++; });} });}
+            Pool.wait();
+            assert(Nested.load() == 100);
+        }
+        RocketSimulation::Random DrawA(42), DrawB(42);
+        RocketSimulation::DispersedInputs InA = RocketSimulation::Draw(RocketSimulation::DispersionModel(), DrawA, Upright, ExampleMotor, RocketSimulation::SensorNoise());
+        RocketSimulation::DispersedInputs InB = RocketSimulation::Draw(RocketSimulation::DispersionModel(), DrawB, Upright, ExampleMotor, RocketSimulation::SensorNoise());
+        assert(InA.SimulatorSeed == InB.SimulatorSeed && InA.Vehicle.DryMass == InB.Vehicle.DryMass && InA.Air.Direction == InB.Air.Direction);
+        RocketSimulation::DispersedInputs Nominal = RocketSimulation::Draw(RocketSimulation::DispersionModel::None(), DrawA, Upright, ExampleMotor, RocketSimulation::SensorNoise());
+        assert(Nominal.Vehicle.DryMass == Upright.DryMass && Nominal.Air.ReferenceSpeed == 0.0f && Nominal.Engine.Curve.TotalImpulse() == ExampleMotor.Curve.TotalImpulse());
+        {
+            VehicleConfig Config;
+            assert(Config.parse("[fins]\ncount = 4\nfin = 0, left, front\nfin = 1, right, front\nfin = 2, left, back\nfin = 3, right, back\n"
+                                "[parachutes]\nchute = drogue, 1\nchute = main, 2\n[sensors]\nsensor = P, 1\n"));
+            RocketSimulation::MonteCarloRunner Runner(Config, Upright, ExampleMotor);
+            WorkStealingPool Pool(3);
+            vector<RocketSimulation::FlightOutcome> Parallel = Runner.Run(6, 7, Pool), Serial = Runner.RunSerial(6, 7);
+            assert(Parallel.size() == 6 && Serial.size() == 6);
+            for(size_t i = 0; i < Serial.size(); i++){
+                const RocketSimulation::FlightOutcome &a = Parallel[i], &b = Serial[i];
+                assert(a.Landed == b.Landed && a.Apogee == b.Apogee && a.LandingX == b.LandingX && a.LandingY == b.LandingY);
+                assert(a.LandingSpeed == b.LandingSpeed && a.SaturationFraction == b.SaturationFraction);
+                assert(a.MaxFinAngle == b.MaxFinAngle && a.PredictionError == b.PredictionError);
+            }
+            assert(Serial[0].Apogee != Serial[1].Apogee);
+        }
+        vector<RocketSimulation::FlightOutcome> Outcomes;
+        for(int i = 0; i < 5; i++) {Outcomes.push_back({i != 4, 100.0f + 10.0f * i, float(i), 0.0f, 5.0f, i == 2 ? 0.5f : 0.0f, 1.0f, i == 1 ? -1.0f : 2.0f * i});}
+        RocketSimulation::DispersionSummary Batch = RocketSimulation::Summarise(Outcomes);
+        assert(Batch.Flights == 5 && Batch.Landed == 4 && Batch.SaturatedFlights == 1);
+        assert(abs(Batch.Apogee.Mean - 120.0f) < TEST_FLOAT_PRECISION && abs(Batch.Apogee.P50 - 120.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(Batch.Apogee.Sigma - sqrt(250.0f)) < 1e-3f && abs(Batch.Apogee.P95 - 138.0f) < 1e-3f);
+        assert(abs(Batch.Landing.MeanX - 1.5f) < TEST_FLOAT_PRECISION && abs(Batch.Landing.CEP50 - 1.0f) < TEST_FLOAT_PRECISION);
+        assert(abs(Batch.Landing.Farthest - 3.0f) < TEST_FLOAT_PRECISION);
+        assert(Batch.PredictionError.Count == 3 && abs(Batch.PredictionError.Mean - 10.0f / 3.0f) < TEST_FLOAT_PRECISION && Batch.PredictionError.Max == 6.0f);
+
         cout << "ALL TESTS PASSED!" << endl;
     #endif
 
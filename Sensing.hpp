@@ -1,5 +1,10 @@
 #include "./Sensing/Physics.hpp"
+#include "./Sensing/Matrix.hpp"
+#include "./Sensing/Atmosphere.hpp"
 #include "./Sensing/SensorData.hpp"
+#include "./Sensing/AHRS.hpp"
+#include "./Sensing/Trajectory.hpp"
+#include "./Sensing/GPS.hpp"
 
 #define ENABLE_UTEST
 #define TEST_FLOAT_PRECISION 0.01
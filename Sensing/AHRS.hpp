@@ -0,0 +1,412 @@
+// Attitude and Heading Reference System
+// Fuses the gyro, accelerometer, magnetometer and barometer streams of the sensor registry into
+// a quaternion attitude and an altitude estimate
+
+#pragma once
+
+#include "Physics.hpp"
+#include "Atmosphere.hpp"
+#include "SensorData.hpp"
+#include <cmath>
+
+namespace RocketSensors{
+
+    /// @brief Frames used by the AHRS
+    /// Body: +Z along the nose, X and Y across the fins
+    /// World: X along the horizontal component of the magnetic field, Z up, Y completing a right handed set
+    /// With these frames the identity attitude is the rocket standing on the pad, so pitch and yaw are
+    /// the deviations of the nose from vertical and roll is the rotation about the long axis
+    ///
+    /// Sensor registry types used by Bind():
+    /// 'G' gyro (Vector3D, rad/s), 'A' accelerometer (Vector3D, m/s^2),
+    /// 'M' magnetometer (Vector3D, any unit), 'B' barometer (scalar, hPa)
+    class AHRS{
+    public:
+        enum FilterMode {Complementary=0, Madgwick};
+
+    private:
+        FilterMode Mode;
+        float SamplePeriod;
+
+        // Attitude (body to world)
+        RocketPhysics::Quaternion Attitude;
+
+        // Filter gains
+        float Beta;  // Madgwick gradient descent gain
+        float Kp;    // Complementary proportional gain (rad/s per unit error)
+        float AccelGate; // m/s^2 off 1 g at which the accelerometer stops correcting the attitude
+
+        // Vertical channel
+        float Altitude;
+        float VerticalVelocity;
+        float GroundAltitude;
+        float AltitudeGain;
+        float VelocityGain;
+        bool BaroInitialised;
+        RocketPhysics::Vector3D LinearAcceleration; // world frame, gravity removed
+
+        // Bound streams (cached once so Step() never searches the tree)
+        DeadlineStack* GyroRaw;
+        DeadlineStack* AccelRaw;
+        DeadlineStack* MagRaw;
+        DeadlineStack* BaroRaw;
+
+        // Last valid samples, reused when a stream has nothing within its deadline
+        float Acc[3];
+        float Mag[3];
+        bool HaveAcc, HaveMag;
+
+        inline static float InvSqrt(float x){
+            return 1.0f / std::sqrt(x);
+        }
+
+        /// @brief How far the accelerometer can be trusted as "up": 1 at exactly 1 g, falling linearly to 0 at
+        /// AccelGate off it. Under thrust, drag or in free fall the specific force is not gravity, and
+        /// correcting towards it would drag the attitude onto the body axis
+        inline float AccelWeight(float Magnitude) const{
+            if(AccelGate <= 0.0f) {return 1.0f;}
+            float Weight = 1.0f - std::fabs(Magnitude - float(GRAVITY)) / AccelGate;
+            return Weight > 0.0f ? Weight : 0.0f;
+        }
+
+        /// @brief One Madgwick gradient descent step (MARG when the magnetometer is valid, IMU otherwise)
+        void MadgwickStep(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, float AccWeight, bool UseMag, float dt){
+            float q0 = Attitude.GetW(), q1 = Attitude.GetX(), q2 = Attitude.GetY(), q3 = Attitude.GetZ();
+
+            // Rate of change of quaternion from gyroscope
+            float qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+            float qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+            float qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+            float qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+            if(AccWeight > 0.0f){
+                float Norm = InvSqrt(ax * ax + ay * ay + az * az);
+                ax *= Norm; ay *= Norm; az *= Norm;
+
+                float s0, s1, s2, s3;
+
+                if(UseMag){
+                    Norm = InvSqrt(mx * mx + my * my + mz * mz);
+                    mx *= Norm; my *= Norm; mz *= Norm;
+
+                    float _2q0mx = 2.0f * q0 * mx, _2q0my = 2.0f * q0 * my, _2q0mz = 2.0f * q0 * mz, _2q1mx = 2.0f * q1 * mx;
+                    float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+                    float _2q0q2 = 2.0f * q0 * q2, _2q2q3 = 2.0f * q2 * q3;
+                    float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+                    float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+                    float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+                    // Reference direction of the earth's magnetic field
+                    float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+                    float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+                    float _2bx = std::sqrt(hx * hx + hy * hy);
+                    float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+                    float _4bx = 2.0f * _2bx, _4bz = 2.0f * _2bz;
+
+                    float Fx = 2.0f * q1q3 - _2q0q2 - ax;
+                    float Fy = 2.0f * q0q1 + _2q2q3 - ay;
+                    float Fz = 1.0f - 2.0f * q1q1 - 2.0f * q2q2 - az;
+                    float Mx = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+                    float My = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+                    float Mz = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+                    // Gradient descent corrective step
+                    s0 = -_2q2 * Fx + _2q1 * Fy - _2bz * q2 * Mx + (-_2bx * q3 + _2bz * q1) * My + _2bx * q2 * Mz;
+                    s1 = _2q3 * Fx + _2q0 * Fy - 2.0f * _2q1 * Fz + _2bz * q3 * Mx + (_2bx * q2 + _2bz * q0) * My + (_2bx * q3 - _4bz * q1) * Mz;
+                    s2 = -_2q0 * Fx + _2q3 * Fy - 2.0f * _2q2 * Fz + (-_4bx * q2 - _2bz * q0) * Mx + (_2bx * q1 + _2bz * q3) * My + (_2bx * q0 - _4bz * q2) * Mz;
+                    s3 = _2q1 * Fx + _2q2 * Fy + (-_4bx * q3 + _2bz * q1) * Mx + (-_2bx * q0 + _2bz * q2) * My + _2bx * q1 * Mz;
+                }
+                else{
+                    float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+                    float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+                    float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+                    float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+                    s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+                    s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+                    s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+                    s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+                }
+
+                float SNorm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+                if(SNorm > 0.0f){
+                    SNorm = AccWeight * InvSqrt(SNorm);
+                    qDot1 -= Beta * s0 * SNorm;
+                    qDot2 -= Beta * s1 * SNorm;
+                    qDot3 -= Beta * s2 * SNorm;
+                    qDot4 -= Beta * s3 * SNorm;
+                }
+            }
+
+            Integrate(qDot1, qDot2, qDot3, qDot4, dt);
+        }
+
+        /// @brief One complementary filter step: the gyro is integrated and the tilt (and heading, if available)
+        /// errors against the accelerometer and magnetometer are fed back as a rate correction
+        void ComplementaryStep(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, float AccWeight, bool UseMag, float dt){
+            float q0 = Attitude.GetW(), q1 = Attitude.GetX(), q2 = Attitude.GetY(), q3 = Attitude.GetZ();
+            float ex = 0.0f, ey = 0.0f, ez = 0.0f;
+
+            if(AccWeight > 0.0f){
+                float Norm = InvSqrt(ax * ax + ay * ay + az * az);
+                ax *= Norm; ay *= Norm; az *= Norm;
+
+                // Estimated direction of "up" in the body frame
+                float vx = 2.0f * (q1 * q3 - q0 * q2);
+                float vy = 2.0f * (q0 * q1 + q2 * q3);
+                float vz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+
+                ex += ay * vz - az * vy;
+                ey += az * vx - ax * vz;
+                ez += ax * vy - ay * vx;
+
+                if(UseMag){
+                    Norm = InvSqrt(mx * mx + my * my + mz * mz);
+                    mx *= Norm; my *= Norm; mz *= Norm;
+
+                    // Field in the world frame, then flattened onto the world X/Z plane
+                    float hx = 2.0f * (mx * (0.5f - q2 * q2 - q3 * q3) + my * (q1 * q2 - q0 * q3) + mz * (q1 * q3 + q0 * q2));
+                    float hy = 2.0f * (mx * (q1 * q2 + q0 * q3) + my * (0.5f - q1 * q1 - q3 * q3) + mz * (q2 * q3 - q0 * q1));
+                    float bx = std::sqrt(hx * hx + hy * hy);
+                    float bz = 2.0f * (mx * (q1 * q3 - q0 * q2) + my * (q2 * q3 + q0 * q1) + mz * (0.5f - q1 * q1 - q2 * q2));
+
+                    // Estimated direction of the field in the body frame
+                    float wx = 2.0f * (bx * (0.5f - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2));
+                    float wy = 2.0f * (bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3));
+                    float wz = 2.0f * (bx * (q0 * q2 + q1 * q3) + bz * (0.5f - q1 * q1 - q2 * q2));
+
+                    ex += my * wz - mz * wy;
+                    ey += mz * wx - mx * wz;
+                    ez += mx * wy - my * wx;
+                }
+
+                gx += AccWeight * Kp * ex;
+                gy += AccWeight * Kp * ey;
+                gz += AccWeight * Kp * ez;
+            }
+
+            float qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+            float qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+            float qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+            float qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+            Integrate(qDot1, qDot2, qDot3, qDot4, dt);
+        }
+
+        /// @brief One attitude step. A zero accelerometer or magnetometer sample has no direction and gives no
+        /// correction; the accelerometer correction is scaled by AccelWeight
+        void Filter(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, bool UseAcc, bool UseMag, float dt){
+            float AccNorm = ax * ax + ay * ay + az * az;
+            float AccWeight = UseAcc && AccNorm > 0.0f ? AccelWeight(std::sqrt(AccNorm)) : 0.0f;
+            UseMag = UseMag && (mx * mx + my * my + mz * mz) > 0.0f;
+
+            if(Mode == Madgwick){
+                MadgwickStep(gx, gy, gz, ax, ay, az, mx, my, mz, AccWeight, UseMag, dt);
+            }
+            else{
+                ComplementaryStep(gx, gy, gz, ax, ay, az, mx, my, mz, AccWeight, UseMag, dt);
+            }
+        }
+
+        inline void Integrate(float qDot1, float qDot2, float qDot3, float qDot4, float dt){
+            float q0 = Attitude.GetW() + qDot1 * dt;
+            float q1 = Attitude.GetX() + qDot2 * dt;
+            float q2 = Attitude.GetY() + qDot3 * dt;
+            float q3 = Attitude.GetZ() + qDot4 * dt;
+
+            float Norm = InvSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+            Attitude = RocketPhysics::Quaternion(q0 * Norm, q1 * Norm, q2 * Norm, q3 * Norm);
+        }
+
+        /// @brief Propagates the vertical channel with the accelerometer rotated into the world frame
+        inline void PropagateVertical(float ax, float ay, float az, float dt){
+            LinearAcceleration = Attitude.Rotate(RocketPhysics::Vector3D(ax, ay, az, 'A')) - RocketPhysics::Vector3D(0.0f, 0.0f, float(GRAVITY), 'A');
+            float WorldZ = LinearAcceleration.GetZ();
+
+            Altitude += VerticalVelocity * dt + 0.5f * WorldZ * dt * dt;
+            VerticalVelocity += WorldZ * dt;
+        }
+
+        /// @brief Propagates the vertical channel on its velocity alone, for a period without an accelerometer sample
+        inline void CoastVertical(float dt){
+            Altitude += VerticalVelocity * dt;
+        }
+
+    public:
+        /// @param Mode which attitude filter to run
+        /// @param SampleRateHz the IMU rate Step() will be called at
+        AHRS(FilterMode Mode=Complementary, float SampleRateHz=100.0f):
+            Mode(Mode), SamplePeriod(1.0f / SampleRateHz),
+            Attitude(),
+            Beta(0.1f), Kp(1.0f), AccelGate(1.0f),
+            Altitude(0.0f), VerticalVelocity(0.0f), GroundAltitude(0.0f),
+            AltitudeGain(0.05f), VelocityGain(0.01f), BaroInitialised(false),
+            LinearAcceleration(0.0f, 0.0f, 0.0f, 'A'),
+            GyroRaw(nullptr), AccelRaw(nullptr), MagRaw(nullptr), BaroRaw(nullptr),
+            Acc{0.0f, 0.0f, 0.0f}, Mag{0.0f, 0.0f, 0.0f}, HaveAcc(false), HaveMag(false) {};
+
+        /// @brief Looks the input streams up in the sensor registry once, call this at setup
+        /// @param Sensors the sensor registry
+        /// @return true if at least a gyro stream was found
+        bool Bind(BinarySearchTree& Sensors){
+            Sensor* Found;
+            Found = Sensors.Find('G'); GyroRaw = Found ? &(Found->Raw) : nullptr;
+            Found = Sensors.Find('A'); AccelRaw = Found ? &(Found->Raw) : nullptr;
+            Found = Sensors.Find('M'); MagRaw = Found ? &(Found->Raw) : nullptr;
+            Found = Sensors.Find('B'); BaroRaw = Found ? &(Found->Raw) : nullptr;
+            return GyroRaw != nullptr;
+        }
+
+        /// @brief Runs one IMU period on the latest samples of the bound streams
+        /// Streams without a sample inside their deadline are skipped. Without a gyro sample nothing is popped,
+        /// so the other streams keep their samples for the next period. Otherwise the attitude falls back to the
+        /// last valid accelerometer and magnetometer samples, and the vertical channel coasts on its velocity
+        /// until a new accelerometer sample comes in. Popped nodes are deleted here
+        /// @return false if there was no gyro sample to propagate with
+        bool Step(){
+            Node* Latest;
+            if(!GyroRaw || !(Latest = GyroRaw->TryPop())){
+                return false;
+            }
+            if(Latest->SelectedType != Vect_3D){
+                delete Latest;
+                return false;
+            }
+            float gx = Latest->Data.Vect3D.GetX(), gy = Latest->Data.Vect3D.GetY(), gz = Latest->Data.Vect3D.GetZ();
+            delete Latest;
+            bool FreshAcc = false;
+
+            if(AccelRaw && (Latest = AccelRaw->TryPop())){
+                if(Latest->SelectedType == Vect_3D){
+                    Acc[0] = Latest->Data.Vect3D.GetX(); Acc[1] = Latest->Data.Vect3D.GetY(); Acc[2] = Latest->Data.Vect3D.GetZ();
+                    HaveAcc = FreshAcc = true;
+                }
+                delete Latest;
+            }
+            if(MagRaw && (Latest = MagRaw->TryPop())){
+                if(Latest->SelectedType == Vect_3D){
+                    Mag[0] = Latest->Data.Vect3D.GetX(); Mag[1] = Latest->Data.Vect3D.GetY(); Mag[2] = Latest->Data.Vect3D.GetZ();
+                    HaveMag = true;
+                }
+                delete Latest;
+            }
+            if(BaroRaw && (Latest = BaroRaw->TryPop())){
+                if(Latest->SelectedType == Scalar){
+                    UpdateBarometer(Latest->Data.Scalar);
+                }
+                delete Latest;
+            }
+
+            Filter(gx, gy, gz, Acc[0], Acc[1], Acc[2], Mag[0], Mag[1], Mag[2], HaveAcc, HaveMag, SamplePeriod);
+            if(FreshAcc){
+                PropagateVertical(Acc[0], Acc[1], Acc[2], SamplePeriod);
+            }
+            else{
+                CoastVertical(SamplePeriod);
+            }
+            return true;
+        }
+
+        /// @brief Runs one filter step on explicit samples (for replay or when not using the registry)
+        /// @param Gyro angular rate in rad/s (body)
+        /// @param Accel specific force in m/s^2 (body)
+        /// @param Mag magnetic field (body), pass a zero vector if unavailable
+        /// @param dt time since the previous step in seconds
+        void Update(const RocketPhysics::Vector3D& Gyro, const RocketPhysics::Vector3D& Accel, const RocketPhysics::Vector3D& Mag, float dt){
+            float ax = Accel.GetX(), ay = Accel.GetY(), az = Accel.GetZ();
+            float mx = Mag.GetX(), my = Mag.GetY(), mz = Mag.GetZ();
+            Update(Gyro.GetX(), Gyro.GetY(), Gyro.GetZ(), ax, ay, az, mx, my, mz,
+                   (ax * ax + ay * ay + az * az) > 0.0f, (mx * mx + my * my + mz * mz) > 0.0f, dt);
+        }
+
+        /// @param UseAcc the accelerometer sample is valid; the vertical channel coasts without one
+        /// @param UseMag the magnetometer sample is valid
+        void Update(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, bool UseAcc, bool UseMag, float dt){
+            Filter(gx, gy, gz, ax, ay, az, mx, my, mz, UseAcc, UseMag, dt);
+
+            if(UseAcc){
+                PropagateVertical(ax, ay, az, dt);
+            }
+            else{
+                CoastVertical(dt);
+            }
+        }
+
+        /// @brief Corrects the vertical channel with a barometric altitude
+        /// The first reading sets the ground reference, so altitudes are above the pad
+        /// @param PressureHPa static pressure in hPa
+        void UpdateBarometer(float PressureHPa){
+            if(PressureHPa <= 0.0f) {return;}
+
+            if(!BaroInitialised){
+                GroundAltitude = RocketPhysics::Atmosphere::Altitude(PressureHPa);
+                BaroInitialised = true;
+            }
+
+            // Standard atmosphere pressure altitude, relative to the pad
+            float BaroAltitude = RocketPhysics::Atmosphere::Altitude(PressureHPa) - GroundAltitude;
+            float Error = BaroAltitude - Altitude;
+            Altitude += AltitudeGain * Error;
+            VerticalVelocity += VelocityGain * Error;
+        }
+
+        /// @brief Madgwick gain, higher trusts the accelerometer/magnetometer more
+        inline void SetBeta(float NewBeta) {Beta = NewBeta;}
+
+        /// @brief Complementary filter gain, higher trusts the accelerometer/magnetometer more
+        inline void SetKp(float NewKp) {Kp = NewKp;}
+
+        /// @brief Width of the accelerometer gate in m/s^2, 0 to correct on every sample whatever its magnitude
+        inline void SetAccelGate(float NewAccelGate) {AccelGate = NewAccelGate;}
+
+        /// @brief Vertical channel gains applied on each barometer sample
+        inline void SetBaroGains(float NewAltitudeGain, float NewVelocityGain){
+            AltitudeGain = NewAltitudeGain;
+            VelocityGain = NewVelocityGain;
+        }
+
+        inline void SetMode(FilterMode NewMode) {Mode = NewMode;}
+        inline FilterMode GetMode() const {return Mode;}
+
+        /// @brief Resets the attitude to the pad (identity) and the vertical channel to zero
+        void Reset(){
+            Attitude = RocketPhysics::Quaternion();
+            Altitude = VerticalVelocity = 0.0f;
+            LinearAcceleration = RocketPhysics::Vector3D(0.0f, 0.0f, 0.0f, 'A');
+            BaroInitialised = HaveAcc = HaveMag = false;
+        }
+
+        /// @brief Getter for the attitude
+        /// @return the quaternion rotating body vectors into the world frame
+        inline RocketPhysics::Quaternion GetQuaternion() const{
+            return Attitude;
+        }
+
+        /// @brief Deviation of the nose from vertical about the body Y axis
+        /// @return angle in degrees
+        inline float GetPitch() const{
+            return Attitude.ToEuler().GetY() * 57.2957795f;
+        }
+
+        /// @brief Deviation of the nose from vertical about the body X axis
+        /// @return angle in degrees
+        inline float GetYaw() const{
+            return Attitude.ToEuler().GetX() * 57.2957795f;
+        }
+
+        /// @brief Rotation about the long axis
+        /// @return angle in degrees
+        inline float GetRoll() const{
+            return Attitude.ToEuler().GetZ() * 57.2957795f;
+        }
+
+        /// @return altitude above the pad in meters
+        inline float GetAltitude() const {return Altitude;}
+
+        /// @return vertical velocity in m/s, positive up
+        inline float GetVerticalVelocity() const {return VerticalVelocity;}
+
+        /// @return the last accelerometer sample rotated into the world frame with gravity removed, in m/s^2
+        inline RocketPhysics::Vector3D GetLinearAcceleration() const {return LinearAcceleration;}
+    };
+};
@@ -0,0 +1,221 @@
+// International Standard Atmosphere (ISA), from 1 km below sea level to the top of the lower stratosphere (32 km)
+// The lookup tables are generated by the compiler, so a conversion at run time is one table lookup and
+// one linear interpolation instead of a pow() or exp()
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace RocketPhysics{
+
+/// @brief Constants and compile time equations of the standard atmosphere
+namespace ISA{
+    constexpr double SeaLevelPressure = 101325.0;   // Pa
+    constexpr double SeaLevelTemperature = 288.15;  // K
+    constexpr double GasConstant = 287.05287;       // J/(kg K), dry air
+    constexpr double HeatCapacityRatio = 1.4;
+    constexpr double StandardGravity = 9.80665;     // m/s^2, the ISA value (not GRAVITY)
+
+    // Layers: base geopotential altitude (m) and temperature lapse rate (K/m)
+    constexpr int Layers = 3;
+    constexpr double LayerBase[Layers + 1] = {0.0, 11000.0, 20000.0, 32000.0};
+    constexpr double LayerLapse[Layers] = {-0.0065, 0.0, 0.001};
+
+    constexpr double Ln2 = 0.693147180559945309417;
+
+    /// @brief e^x by range reduction to |r| <= ln(2)/2 and a Taylor series, usable in constant expressions
+    constexpr double Exp(double x){
+        int n = int(x / Ln2 + (x >= 0.0 ? 0.5 : -0.5));
+        double r = x - n * Ln2;
+        double Term = 1.0, Sum = 1.0;
+        for(int i = 1; i < 24; i++){
+            Term *= r / i;
+            Sum += Term;
+        }
+        for(; n > 0; n--) {Sum *= 2.0;}
+        for(; n < 0; n++) {Sum *= 0.5;}
+        return Sum;
+    }
+
+    /// @brief Natural logarithm (x > 0) by reduction to [1, 2] and the series of 2 atanh((x - 1) / (x + 1))
+    constexpr double Log(double x){
+        int e = 0;
+        while(x > 2.0) {x *= 0.5; e++;}
+        while(x < 1.0) {x *= 2.0; e--;}
+        double y = (x - 1.0) / (x + 1.0), y2 = y * y;
+        double Term = y, Sum = 0.0;
+        for(int i = 1; i < 60; i += 2){
+            Sum += Term / i;
+            Term *= y2;
+        }
+        return 2.0 * Sum + e * Ln2;
+    }
+
+    constexpr double Pow(double Base, double Exponent) {return Exp(Exponent * Log(Base));}
+
+    constexpr double Sqrt(double x){
+        if(x <= 0.0) {return 0.0;}
+        double r = x > 1.0 ? x : 1.0;
+        for(int i = 0; i < 100; i++){
+            double Next = 0.5 * (r + x / r);
+            if(Next == r) {break;}
+            r = Next;
+        }
+        return r;
+    }
+
+    constexpr int LayerOfAltitude(double Altitude){
+        int Layer = 0;
+        while(Layer < Layers - 1 && Altitude >= LayerBase[Layer + 1]) {Layer++;}
+        return Layer;
+    }
+
+    constexpr double LayerTemperature(int Layer){
+        double T = SeaLevelTemperature;
+        for(int i = 0; i < Layer; i++) {T += LayerLapse[i] * (LayerBase[i + 1] - LayerBase[i]);}
+        return T;
+    }
+
+    /// @brief Pressure (Pa) at altitude Altitude within Layer, from the pressure at the base of the layer
+    constexpr double PressureInLayer(int Layer, double BasePressure, double Altitude){
+        double T = LayerTemperature(Layer), L = LayerLapse[Layer];
+        double dh = Altitude - LayerBase[Layer];
+        if(L == 0.0) {return BasePressure * Exp(-StandardGravity * dh / (GasConstant * T));}
+        return BasePressure * Pow((T + L * dh) / T, -StandardGravity / (GasConstant * L));
+    }
+
+    constexpr double LayerPressure(int Layer){
+        double p = SeaLevelPressure;
+        for(int i = 0; i < Layer; i++) {p = PressureInLayer(i, p, LayerBase[i + 1]);}
+        return p;
+    }
+
+    /// @return temperature in K
+    constexpr double Temperature(double Altitude){
+        int Layer = LayerOfAltitude(Altitude);
+        return LayerTemperature(Layer) + LayerLapse[Layer] * (Altitude - LayerBase[Layer]);
+    }
+
+    /// @return pressure in Pa
+    constexpr double Pressure(double Altitude){
+        int Layer = LayerOfAltitude(Altitude);
+        return PressureInLayer(Layer, LayerPressure(Layer), Altitude);
+    }
+
+    /// @return density in kg/m^3
+    constexpr double Density(double Altitude) {return Pressure(Altitude) / (GasConstant * Temperature(Altitude));}
+
+    /// @return speed of sound in m/s
+    constexpr double SpeedOfSound(double Altitude) {return Sqrt(HeatCapacityRatio * GasConstant * Temperature(Altitude));}
+
+    /// @param PressurePa static pressure in Pa
+    /// @return pressure altitude in m
+    constexpr double Altitude(double PressurePa){
+        int Layer = 0;
+        while(Layer < Layers - 1 && PressurePa <= LayerPressure(Layer + 1)) {Layer++;}
+        double T = LayerTemperature(Layer), L = LayerLapse[Layer], Ratio = PressurePa / LayerPressure(Layer);
+        if(L == 0.0) {return LayerBase[Layer] - GasConstant * T / StandardGravity * Log(Ratio);}
+        return LayerBase[Layer] + T / L * (Pow(Ratio, -GasConstant * L / StandardGravity) - 1.0);
+    }
+
+    /// @brief Samples F at Start, Start + Step, ... into a table
+    template<size_t N, typename F>
+    constexpr std::array<float, N> Tabulate(double Start, double Step, F Function){
+        std::array<float, N> Table{};
+        for(size_t i = 0; i < N; i++) {Table[i] = float(Function(Start + Step * i));}
+        return Table;
+    }
+};
+
+/// @brief Table driven standard atmosphere.
+/// Pressures are in hPa (as logged), altitudes are ISA pressure altitudes in m above mean sea level.
+/// Outside the table ranges the end segments are extrapolated
+class Atmosphere{
+public:
+    static constexpr float MinPressure = 10.0f;     // hPa, about 31 km
+    static constexpr float MaxPressure = 1100.0f;   // hPa, about 700 m below sea level
+    static constexpr float PressureStep = 1.0f;
+    static constexpr size_t PressureEntries = 1091;
+
+    static constexpr float MinAltitude = -1000.0f;  // m
+    static constexpr float MaxAltitude = 32000.0f;  // m
+    static constexpr float AltitudeStep = 100.0f;
+    static constexpr size_t AltitudeEntries = 331;
+
+private:
+    static constexpr std::array<float, PressureEntries> AltitudeTable = ISA::Tabulate<PressureEntries>(MinPressure, PressureStep,
+        [](double hPa){ return ISA::Altitude(hPa * 100.0); });
+    static constexpr std::array<float, AltitudeEntries> DensityTable = ISA::Tabulate<AltitudeEntries>(MinAltitude, AltitudeStep,
+        [](double h){ return ISA::Density(h); });
+    static constexpr std::array<float, AltitudeEntries> SpeedOfSoundTable = ISA::Tabulate<AltitudeEntries>(MinAltitude, AltitudeStep,
+        [](double h){ return ISA::SpeedOfSound(h); });
+    static constexpr std::array<float, AltitudeEntries> TemperatureTable = ISA::Tabulate<AltitudeEntries>(MinAltitude, AltitudeStep,
+        [](double h){ return ISA::Temperature(h); });
+
+    /// @brief Linear interpolation in a uniformly spaced table
+    template<size_t N>
+    static inline float Interpolate(const std::array<float, N>& Table, float x, float Min, float Step){
+        float Position = (x - Min) / Step;
+        int Index = int(Position);
+        Index = Index < 0 ? 0 : (Index > int(N) - 2 ? int(N) - 2 : Index);
+        float Fraction = Position - Index;
+        return Table[Index] + Fraction * (Table[Index + 1] - Table[Index]);
+    }
+
+    template<size_t N>
+    static inline void InterpolateBatch(const std::array<float, N>& Table, const float* In, float* Out, size_t Count, float Min, float Step){
+        for(size_t i = 0; i < Count; i++) {Out[i] = Interpolate(Table, In[i], Min, Step);}
+    }
+
+public:
+    /// @param PressureHPa static pressure in hPa
+    /// @return pressure altitude in m
+    static inline float Altitude(float PressureHPa) {return Interpolate(AltitudeTable, PressureHPa, MinPressure, PressureStep);}
+
+    /// @return air density in kg/m^3 at an altitude in m
+    static inline float Density(float Altitude) {return Interpolate(DensityTable, Altitude, MinAltitude, AltitudeStep);}
+
+    /// @return speed of sound in m/s at an altitude in m
+    static inline float SpeedOfSound(float Altitude) {return Interpolate(SpeedOfSoundTable, Altitude, MinAltitude, AltitudeStep);}
+
+    /// @return temperature in K at an altitude in m
+    static inline float Temperature(float Altitude) {return Interpolate(TemperatureTable, Altitude, MinAltitude, AltitudeStep);}
+
+    /// @brief Column forms, e.g. for the pressure column of a flight log. In and Out may be the same array
+    static void Altitude(const float* PressuresHPa, float* Altitudes, size_t Count){
+        InterpolateBatch(AltitudeTable, PressuresHPa, Altitudes, Count, MinPressure, PressureStep);
+    }
+
+    static void Density(const float* Altitudes, float* Densities, size_t Count){
+        InterpolateBatch(DensityTable, Altitudes, Densities, Count, MinAltitude, AltitudeStep);
+    }
+
+    static void SpeedOfSound(const float* Altitudes, float* Speeds, size_t Count){
+        InterpolateBatch(SpeedOfSoundTable, Altitudes, Speeds, Count, MinAltitude, AltitudeStep);
+    }
+
+    /// @brief The closed form equations in single precision, as they would be evaluated without the tables.
+    /// Kept as the reference for accuracy and speed comparisons
+    static float ClosedFormAltitude(float PressureHPa){
+        float p = PressureHPa * 100.0f;
+        float p11 = float(ISA::LayerPressure(1)), p20 = float(ISA::LayerPressure(2));
+        if(p > p11) {return 44330.77f * (1.0f - std::pow(p / float(ISA::SeaLevelPressure), 0.190263f));}
+        if(p > p20) {return 11000.0f - 6341.62f * std::log(p / p11);}
+        return 20000.0f + 216650.0f * (std::pow(p / p20, -0.0292712f) - 1.0f);
+    }
+
+    static float ClosedFormDensity(float Altitude){
+        float T = float(ISA::Temperature(Altitude));
+        float p;
+        if(Altitude < 11000.0f) {p = float(ISA::SeaLevelPressure) * std::pow(T / 288.15f, 5.25588f);}
+        else if(Altitude < 20000.0f) {p = float(ISA::LayerPressure(1)) * std::exp(-(Altitude - 11000.0f) / 6341.62f);}
+        else {p = float(ISA::LayerPressure(2)) * std::pow(T / 216.65f, -34.1632f);}
+        return p / (287.05287f * T);
+    }
+
+    static float ClosedFormSpeedOfSound(float Altitude) {return std::sqrt(1.4f * 287.05287f * float(ISA::Temperature(Altitude)));}
+};
+
+};
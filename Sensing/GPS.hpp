@@ -0,0 +1,492 @@
+// Streaming GPS receiver parser
+// Decodes NMEA 0183 GGA and RMC sentences from any constellation talker (GP, GL, GA, GB, GN) and u-blox UBX
+// NAV-PVT messages out of one byte stream, fed in chunks of any size as they come off the serial port.
+// The parser never allocates: a sentence is assembled in a fixed buffer, a UBX payload in another, and every
+// message is checked against its checksum before a single field is used
+
+#pragma once
+
+#include "Physics.hpp"
+#include "SensorData.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+
+namespace RocketSensors{
+
+    /// @brief The message that last updated a fix
+    enum GPSSource {GPS_NONE=0, GPS_GGA, GPS_RMC, GPS_NAV_PVT};
+
+    /// @brief One receiver solution
+    /// GGA carries position, altitude, satellites and HDOP; RMC position and ground velocity; NAV-PVT all of
+    /// them plus the vertical velocity and an accuracy estimate. A message updates the fields it carries and
+    /// leaves the others as the previous messages set them
+    struct GPSFix{
+        bool Valid;                 // a position has been received
+        GPSSource Source;
+        uint32_t TimeOfDay;         // ms since UTC midnight
+        double Latitude;            // degrees, north positive
+        double Longitude;           // degrees, east positive
+        float Altitude;             // m above mean sea level
+        float VelocityNorth, VelocityEast, VelocityUp; // m/s
+        bool HaveVelocity;          // ground velocity received
+        bool HaveClimb;             // vertical velocity received (NAV-PVT only)
+        int Satellites;
+        float DOP;                  // HDOP from GGA, PDOP from NAV-PVT
+        float HorizontalAccuracy;   // m, NAV-PVT only, 0 otherwise
+
+        GPSFix():
+            Valid(false), Source(GPS_NONE), TimeOfDay(0), Latitude(0), Longitude(0), Altitude(0),
+            VelocityNorth(0), VelocityEast(0), VelocityUp(0), HaveVelocity(false), HaveClimb(false),
+            Satellites(0), DOP(0), HorizontalAccuracy(0) {};
+    };
+
+    /// @brief Counters of what the parser has seen
+    struct GPSStats{
+        uint64_t Sentences;         // complete NMEA sentences, any type
+        uint64_t Messages;          // complete UBX messages, any class
+        uint64_t Fixes;             // fixes published
+        uint64_t NoFix;             // GGA, RMC or NAV-PVT reporting that the receiver has no fix
+        uint64_t ChecksumErrors;
+        uint64_t Malformed;         // truncated, oversized or unparsable messages
+        uint64_t Skipped;           // bytes outside any message, line ends aside
+    };
+
+    /// @brief The latest valid fix published by any parser, for code with no parser at hand (getpos())
+    /// Single threaded: written by the thread that feeds the parser
+    inline GPSFix& LatestFix(){
+        static GPSFix Fix;
+        return Fix;
+    }
+
+    /// @brief Called with every fix published, e.g. StoreFix<Coordinates> with &Reading.gps as the context
+    typedef void (*GPSHandler)(const GPSFix& Fix, void* Context);
+
+    /// @brief Handler copying each fix into a record with latitude, longitude and altitude members,
+    /// such as the logger's Coordinates
+    template<typename Record>
+    void StoreFix(const GPSFix& Fix, void* Context){
+        Record* Out = static_cast<Record*>(Context);
+        Out->latitude = Fix.Latitude;
+        Out->longitude = Fix.Longitude;
+        Out->altitude = Fix.Altitude;
+    }
+
+    /// @brief Sensor registry types used by Bind():
+    /// 'N' position (Vector3D: latitude, longitude in degrees, altitude in m; float, so about a metre apart)
+    /// 'K' velocity (Vector3D: north, east, up in m/s), published by messages that carry a velocity
+    class GPSParser{
+    public:
+        static const std::size_t MaxSentence = 82;    // NMEA 0183 limit, '$' to the end of the line
+        static const std::size_t MaxFields = 24;
+        static const std::size_t NavPvtLength = 92;
+        static const std::size_t MaxMessage = 1024;   // longer UBX lengths are taken as a false sync
+
+    private:
+        enum ParseState {Idle=0, NMEABody, NMEAChecksumHigh, NMEAChecksumLow,
+                         UBXSync, UBXHeader, UBXPayload, UBXChecksumA, UBXChecksumB};
+
+        ParseState State;
+
+        // NMEA: the text between '$' and '*', null terminated, and its running XOR
+        char Sentence[MaxSentence + 1];
+        std::size_t SentenceLength;
+        uint8_t SentenceSum, ExpectedSum;
+
+        // UBX: class, id and length, the payload (only the start of a message longer than the buffer is kept)
+        // and the running Fletcher checksum over all of them
+        uint8_t Header[4];
+        std::size_t HeaderLength;
+        uint8_t Payload[NavPvtLength + 8];
+        std::size_t PayloadLength, PayloadRead;
+        uint8_t SumA, SumB, ReceivedA;
+
+        GPSFix Current;
+        GPSStats Stats;
+
+        DeadlineStack* Position;
+        DeadlineStack* Velocity;
+        GPSHandler Handler;
+        void* HandlerContext;
+        bool Shared;
+
+        static int HexValue(uint8_t c){
+            if(c >= '0' && c <= '9') {return c - '0';}
+            if(c >= 'A' && c <= 'F') {return c - 'A' + 10;}
+            if(c >= 'a' && c <= 'f') {return c - 'a' + 10;}
+            return -1;
+        }
+
+        /// @brief Parses an optionally signed decimal number; no exponent, no locale
+        /// @return false for an empty field or any other character
+        static bool ParseNumber(const char* Text, double& Value){
+            static const double Scale[10] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+            bool Negative = *Text == '-';
+            if(*Text == '-' || *Text == '+') {Text++;}
+
+            uint64_t Whole = 0, Fraction = 0;
+            int Digits = 0, FractionDigits = 0;
+            for(; *Text >= '0' && *Text <= '9'; Text++, Digits++) {Whole = Whole * 10 + uint64_t(*Text - '0');}
+            if(*Text == '.'){
+                for(Text++; *Text >= '0' && *Text <= '9'; Text++, Digits++){
+                    if(FractionDigits < 9) {Fraction = Fraction * 10 + uint64_t(*Text - '0'); FractionDigits++;}
+                }
+            }
+            if(*Text != '\0' || Digits == 0 || Digits > 18) {return false;}
+
+            Value = double(Whole) + double(Fraction) / Scale[FractionDigits];
+            if(Negative) {Value = -Value;}
+            return true;
+        }
+
+        /// @brief "hhmmss.ss" to ms since midnight
+        static bool ParseTime(const char* Text, uint32_t& Milliseconds){
+            double v;
+            if(!ParseNumber(Text, v) || v < 0.0 || v >= 240000.0) {return false;}
+            uint32_t Hours = uint32_t(v / 10000.0);
+            uint32_t Minutes = uint32_t(v / 100.0) % 100;
+            double Seconds = v - Hours * 10000.0 - Minutes * 100.0;
+            Milliseconds = (Hours * 60 + Minutes) * 60000 + uint32_t(Seconds * 1000.0 + 0.5);
+            return true;
+        }
+
+        /// @brief "dddmm.mmmm" and its hemisphere to signed degrees
+        static bool ParseAngle(const char* Text, const char* Hemisphere, char Positive, char Negative, double& Degrees){
+            double v;
+            if(!ParseNumber(Text, v) || v < 0.0) {return false;}
+            if(Hemisphere[0] != Positive && Hemisphere[0] != Negative) {return false;}
+            double Whole = std::floor(v / 100.0);
+            Degrees = Whole + (v - Whole * 100.0) / 60.0;
+            if(Hemisphere[0] == Negative) {Degrees = -Degrees;}
+            return true;
+        }
+
+        static int32_t I4(const uint8_t* p) {return int32_t(uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);}
+        static uint32_t U4(const uint8_t* p) {return uint32_t(I4(p));}
+        static uint16_t U2(const uint8_t* p) {return uint16_t(p[0] | p[1] << 8);}
+
+        void Publish(bool WithVelocity){
+            Current.Valid = true;
+            Stats.Fixes++;
+
+            std::chrono::milliseconds Now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch());
+            if(Position) {Position->Insert(RocketPhysics::Vector3D(float(Current.Latitude), float(Current.Longitude), Current.Altitude, 'N'), Now);}
+            if(Velocity && WithVelocity) {Velocity->Insert(RocketPhysics::Vector3D(Current.VelocityNorth, Current.VelocityEast, Current.VelocityUp, 'K'), Now);}
+
+            if(Shared) {LatestFix() = Current;}
+            if(Handler) {Handler(Current, HandlerContext);}
+        }
+
+        // $--GGA,time,lat,N,lon,E,quality,satellites,hdop,altitude,M,separation,M,age,station
+        void ParseGGA(char** Fields, std::size_t Count){
+            if(Count < 10) {Stats.Malformed++; return;}
+            double Quality, Satellites, HDOP, Altitude, Latitude, Longitude;
+            uint32_t Time;
+            if(!ParseNumber(Fields[6], Quality)) {Stats.Malformed++; return;}
+            if(Quality == 0.0) {Stats.NoFix++; return;}
+            if(!ParseTime(Fields[1], Time) || !ParseAngle(Fields[2], Fields[3], 'N', 'S', Latitude) ||
+               !ParseAngle(Fields[4], Fields[5], 'E', 'W', Longitude) || !ParseNumber(Fields[7], Satellites) ||
+               !ParseNumber(Fields[9], Altitude)) {Stats.Malformed++; return;}
+            if(!ParseNumber(Fields[8], HDOP)) {HDOP = 0.0;}
+
+            Current.Source = GPS_GGA;
+            Current.TimeOfDay = Time;
+            Current.Latitude = Latitude;
+            Current.Longitude = Longitude;
+            Current.Altitude = float(Altitude);
+            Current.Satellites = int(Satellites);
+            Current.DOP = float(HDOP);
+            Current.HorizontalAccuracy = 0.0f;
+            Publish(false);
+        }
+
+        // $--RMC,time,status,lat,N,lon,E,knots,course,date,variation,E,mode
+        void ParseRMC(char** Fields, std::size_t Count){
+            if(Count < 9) {Stats.Malformed++; return;}
+            if(Fields[2][0] != 'A') {Stats.NoFix++; return;}
+            double Latitude, Longitude, Knots, Course;
+            uint32_t Time;
+            if(!ParseTime(Fields[1], Time) || !ParseAngle(Fields[3], Fields[4], 'N', 'S', Latitude) ||
+               !ParseAngle(Fields[5], Fields[6], 'E', 'W', Longitude) || !ParseNumber(Fields[7], Knots)) {Stats.Malformed++; return;}
+            if(!ParseNumber(Fields[8], Course)) {Course = 0.0;} // left empty by some receivers when stationary
+
+            const double KnotsToMetres = 1852.0 / 3600.0;
+            const double Radians = Course * 3.14159265358979323846 / 180.0;
+            Current.Source = GPS_RMC;
+            Current.TimeOfDay = Time;
+            Current.Latitude = Latitude;
+            Current.Longitude = Longitude;
+            Current.VelocityNorth = float(Knots * KnotsToMetres * std::cos(Radians));
+            Current.VelocityEast = float(Knots * KnotsToMetres * std::sin(Radians));
+            Current.HaveVelocity = true;
+            Publish(true);
+        }
+
+        void ProcessSentence(){
+            Stats.Sentences++;
+            char* Fields[MaxFields];
+            std::size_t Count = 0;
+            Fields[Count++] = Sentence;
+            for(char* c = Sentence; *c; c++){
+                if(*c != ',') {continue;}
+                *c = '\0';
+                if(Count == MaxFields) {Stats.Malformed++; return;}
+                Fields[Count++] = c + 1;
+            }
+
+            // Address field: two character talker then the sentence type
+            const char* Address = Fields[0];
+            if(Address[0] == '\0' || Address[1] == '\0' || Address[2] == '\0' || Address[3] == '\0' ||
+               Address[4] == '\0' || Address[5] != '\0') {return;}
+            const char* Type = Address + 2;
+            if(Type[0] == 'G' && Type[1] == 'G' && Type[2] == 'A') {ParseGGA(Fields, Count);}
+            else if(Type[0] == 'R' && Type[1] == 'M' && Type[2] == 'C') {ParseRMC(Fields, Count);}
+        }
+
+        void ProcessMessage(){
+            Stats.Messages++;
+            if(Header[0] != 0x01 || Header[1] != 0x07) {return;}   // only NAV-PVT is decoded
+            if(PayloadLength != NavPvtLength) {Stats.Malformed++; return;}
+
+            const uint8_t* p = Payload;
+            uint8_t FixType = p[20];
+            bool FixOK = (p[21] & 0x01) != 0;
+            if(!FixOK || FixType < 2 || FixType > 4) {Stats.NoFix++; return;}
+
+            int64_t Time = ((int64_t(p[8]) * 60 + p[9]) * 60 + p[10]) * 1000 + I4(p + 16) / 1000000;
+            if(Time < 0) {Time += 86400000;}
+
+            Current.Source = GPS_NAV_PVT;
+            Current.TimeOfDay = uint32_t(Time);
+            Current.Satellites = p[23];
+            Current.Longitude = I4(p + 24) * 1e-7;
+            Current.Latitude = I4(p + 28) * 1e-7;
+            Current.Altitude = float(I4(p + 36) * 1e-3);
+            Current.HorizontalAccuracy = float(U4(p + 40) * 1e-3);
+            Current.VelocityNorth = float(I4(p + 48) * 1e-3);
+            Current.VelocityEast = float(I4(p + 52) * 1e-3);
+            Current.VelocityUp = float(-I4(p + 56) * 1e-3);
+            Current.DOP = float(U2(p + 76) * 0.01);
+            Current.HaveVelocity = Current.HaveClimb = true;
+            Publish(true);
+        }
+
+        inline void Fletcher(uint8_t b){
+            SumA = uint8_t(SumA + b);
+            SumB = uint8_t(SumB + SumA);
+        }
+
+        /// @brief Advances the state machine by one byte
+        /// @return false if the byte ended a broken message and must be looked at again from Idle
+        bool Step(uint8_t b){
+            switch(State){
+                case Idle:
+                    if(b == '$') {State = NMEABody; SentenceLength = 0; SentenceSum = 0;}
+                    else if(b == 0xB5) {State = UBXSync;}
+                    else if(b != '\r' && b != '\n') {Stats.Skipped++;}
+                    return true;
+
+                case NMEABody:
+                    if(b == '*') {State = NMEAChecksumHigh; return true;}
+                    if(b < 0x20 || b > 0x7E || b == '$' || SentenceLength == MaxSentence - 6){
+                        Stats.Malformed++;
+                        State = Idle;
+                        return false;
+                    }
+                    Sentence[SentenceLength++] = char(b);
+                    SentenceSum ^= b;
+                    return true;
+
+                case NMEAChecksumHigh:
+                    if(HexValue(b) < 0) {Stats.Malformed++; State = Idle; return false;}
+                    ExpectedSum = uint8_t(HexValue(b) << 4);
+                    State = NMEAChecksumLow;
+                    return true;
+
+                case NMEAChecksumLow:
+                    State = Idle;
+                    if(HexValue(b) < 0) {Stats.Malformed++; return false;}
+                    ExpectedSum |= uint8_t(HexValue(b));
+                    if(ExpectedSum != SentenceSum) {Stats.ChecksumErrors++; return true;}
+                    Sentence[SentenceLength] = '\0';
+                    ProcessSentence();
+                    return true;
+
+                case UBXSync:
+                    if(b != 0x62) {Stats.Skipped++; State = Idle; return false;}
+                    State = UBXHeader;
+                    HeaderLength = 0;
+                    SumA = SumB = 0;
+                    return true;
+
+                case UBXHeader:
+                    Header[HeaderLength++] = b;
+                    Fletcher(b);
+                    if(HeaderLength < 4) {return true;}
+                    PayloadLength = std::size_t(Header[2]) | std::size_t(Header[3]) << 8;
+                    PayloadRead = 0;
+                    if(PayloadLength > MaxMessage) {Stats.Malformed++; State = Idle; return true;}
+                    State = PayloadLength ? UBXPayload : UBXChecksumA;
+                    return true;
+
+                case UBXPayload:
+                    if(PayloadRead < sizeof(Payload)) {Payload[PayloadRead] = b;}
+                    Fletcher(b);
+                    if(++PayloadRead == PayloadLength) {State = UBXChecksumA;}
+                    return true;
+
+                case UBXChecksumA:
+                    ReceivedA = b;
+                    State = UBXChecksumB;
+                    return true;
+
+                case UBXChecksumB:
+                    State = Idle;
+                    if(ReceivedA != SumA || b != SumB) {Stats.ChecksumErrors++; return true;}
+                    ProcessMessage();
+                    return true;
+            }
+            return true;
+        }
+
+    public:
+        GPSParser(): State(Idle), SentenceLength(0), SentenceSum(0), ExpectedSum(0), HeaderLength(0),
+                     PayloadLength(0), PayloadRead(0), SumA(0), SumB(0), ReceivedA(0), Stats(),
+                     Position(nullptr), Velocity(nullptr), Handler(nullptr), HandlerContext(nullptr), Shared(true) {};
+
+        /// @brief Looks up the 'N' and 'K' sensors once
+        /// @return the number of streams found
+        int Bind(BinarySearchTree& Sensors){
+            Sensor* Found = Sensors.Find('N');
+            Position = Found ? &(Found->Raw) : nullptr;
+            Found = Sensors.Find('K');
+            Velocity = Found ? &(Found->Raw) : nullptr;
+            return (Position != nullptr) + (Velocity != nullptr);
+        }
+
+        /// @brief Calls Function(fix, Context) for every fix published; nullptr to stop
+        void SetHandler(GPSHandler Function, void* Context){
+            Handler = Function;
+            HandlerContext = Context;
+        }
+
+        /// @brief Whether fixes also go to LatestFix() (and so getpos()), on by default; turn it off for
+        /// parsers in simulations that run side by side on several threads
+        void SetShared(bool Share) {Shared = Share;}
+
+        /// @brief Consumes a chunk of the receiver stream; a message may straddle any number of chunks
+        /// @return the number of fixes published from this chunk
+        std::size_t Feed(const uint8_t* Data, std::size_t Length){
+            uint64_t Before = Stats.Fixes;
+            for(std::size_t i = 0; i < Length; i++){
+                if(!Step(Data[i])) {Step(Data[i]);}
+            }
+            return std::size_t(Stats.Fixes - Before);
+        }
+
+        std::size_t Feed(const char* Data, std::size_t Length) {return Feed(reinterpret_cast<const uint8_t*>(Data), Length);}
+
+        /// @brief Drops a partly received message, e.g. after the port was reopened
+        void Reset() {State = Idle;}
+
+        inline const GPSFix& GetFix() const {return Current;}
+        inline bool HasFix() const {return Current.Valid;}
+        inline const GPSStats& GetStats() const {return Stats;}
+    };
+
+    // Encoders, the inverse of the parser: for simulated receivers, replaying logged fixes and tests.
+    // Each writes one complete message into Out and returns its length, or 0 if Size is too small
+
+    /// @brief Closes "$<body>" written at Out with "*hh\r\n"
+    inline std::size_t FinishSentence(char* Out, int BodyLength, std::size_t Size){
+        if(BodyLength <= 0 || std::size_t(BodyLength) + 6 > Size) {return 0;}
+        uint8_t Sum = 0;
+        for(int i = 1; i < BodyLength; i++) {Sum ^= uint8_t(Out[i]);}
+        std::snprintf(Out + BodyLength, Size - BodyLength, "*%02X\r\n", Sum);
+        return std::size_t(BodyLength) + 5;
+    }
+
+    /// @brief "ddmm.mmmmm" (Width 2) or "dddmm.mmmmm" (Width 3) of the absolute angle
+    inline void FormatAngle(char* Out, std::size_t Size, double Degrees, int Width){
+        double Absolute = std::fabs(Degrees);
+        if(!(Absolute <= 180.0)) {Absolute = 180.0;}
+        // whole angle in units of 1e-5 minutes, as integers so the text has a known length
+        uint32_t Units = uint32_t(Absolute * 6000000.0 + 0.5);
+        std::snprintf(Out, Size, "%0*u%02u.%05u", Width, unsigned(Units / 6000000), unsigned(Units / 100000 % 60), unsigned(Units % 100000));
+    }
+
+    inline void FormatTime(char* Out, std::size_t Size, uint32_t TimeOfDay){
+        uint32_t Centiseconds = (TimeOfDay % 86400000) / 10;
+        std::snprintf(Out, Size, "%02u%02u%02u.%02u", Centiseconds / 360000, Centiseconds / 6000 % 60,
+                      Centiseconds / 100 % 60, Centiseconds % 100);
+    }
+
+    inline std::size_t FormatGGA(const GPSFix& Fix, char* Out, std::size_t Size, const char* Talker="GN"){
+        char Time[16], Latitude[16], Longitude[16];
+        FormatTime(Time, sizeof(Time), Fix.TimeOfDay);
+        FormatAngle(Latitude, sizeof(Latitude), Fix.Latitude, 2);
+        FormatAngle(Longitude, sizeof(Longitude), Fix.Longitude, 3);
+        int Length = std::snprintf(Out, Size, "$%.2sGGA,%s,%s,%c,%s,%c,%d,%02d,%.1f,%.1f,M,0.0,M,,",
+                                   Talker, Time, Latitude, Fix.Latitude < 0 ? 'S' : 'N', Longitude,
+                                   Fix.Longitude < 0 ? 'W' : 'E', Fix.Valid ? 1 : 0, Fix.Satellites, Fix.DOP, Fix.Altitude);
+        return FinishSentence(Out, Length, Size);
+    }
+
+    inline std::size_t FormatRMC(const GPSFix& Fix, char* Out, std::size_t Size, const char* Talker="GN"){
+        char Time[16], Latitude[16], Longitude[16];
+        FormatTime(Time, sizeof(Time), Fix.TimeOfDay);
+        FormatAngle(Latitude, sizeof(Latitude), Fix.Latitude, 2);
+        FormatAngle(Longitude, sizeof(Longitude), Fix.Longitude, 3);
+        double Speed = std::sqrt(double(Fix.VelocityNorth) * Fix.VelocityNorth + double(Fix.VelocityEast) * Fix.VelocityEast);
+        double Course = std::atan2(double(Fix.VelocityEast), double(Fix.VelocityNorth)) * 180.0 / 3.14159265358979323846;
+        if(Course < 0.0) {Course += 360.0;}
+        int Length = std::snprintf(Out, Size, "$%.2sRMC,%s,%c,%s,%c,%s,%c,%.3f,%.2f,,,,A",
+                                   Talker, Time, Fix.Valid ? 'A' : 'V', Latitude, Fix.Latitude < 0 ? 'S' : 'N',
+                                   Longitude, Fix.Longitude < 0 ? 'W' : 'E', Speed * 3600.0 / 1852.0, Course);
+        return FinishSentence(Out, Length, Size);
+    }
+
+    /// @brief Frames a UBX message: sync, class, id, length, Payload and the Fletcher checksum
+    inline std::size_t EncodeUBX(uint8_t Class, uint8_t Id, const uint8_t* Payload, std::size_t Length, uint8_t* Out, std::size_t Size){
+        if(Length > 0xFFFF || Size < Length + 8) {return 0;}
+        Out[0] = 0xB5; Out[1] = 0x62; Out[2] = Class; Out[3] = Id;
+        Out[4] = uint8_t(Length); Out[5] = uint8_t(Length >> 8);
+        for(std::size_t i = 0; i < Length; i++) {Out[6 + i] = Payload[i];}
+        uint8_t A = 0, B = 0;
+        for(std::size_t i = 2; i < Length + 6; i++) {A = uint8_t(A + Out[i]); B = uint8_t(B + A);}
+        Out[Length + 6] = A;
+        Out[Length + 7] = B;
+        return Length + 8;
+    }
+
+    /// @brief UBX NAV-PVT, 100 bytes. Fields the fix does not hold (date, accuracies but the horizontal one,
+    /// the geoid separation) are left zero
+    inline std::size_t EncodeNavPvt(const GPSFix& Fix, uint8_t* Out, std::size_t Size){
+        uint8_t p[GPSParser::NavPvtLength] = {};
+        auto Put = [&p](std::size_t At, int64_t Value, int Bytes) {for(int i = 0; i < Bytes; i++) {p[At + i] = uint8_t(uint64_t(Value) >> (8 * i));}};
+
+        Put(0, int64_t(Fix.TimeOfDay), 4);                                  // iTOW, ms of the day here
+        p[8] = uint8_t(Fix.TimeOfDay / 3600000 % 24);
+        p[9] = uint8_t(Fix.TimeOfDay / 60000 % 60);
+        p[10] = uint8_t(Fix.TimeOfDay / 1000 % 60);
+        p[11] = 0x07;                                                       // date, time and fully resolved
+        Put(16, int64_t(Fix.TimeOfDay % 1000) * 1000000, 4);                // nano
+        p[20] = Fix.Valid ? 3 : 0;                                          // 3D
+        p[21] = Fix.Valid ? 0x01 : 0x00;                                    // gnssFixOK
+        p[23] = uint8_t(Fix.Satellites);
+        Put(24, std::llround(Fix.Longitude * 1e7), 4);
+        Put(28, std::llround(Fix.Latitude * 1e7), 4);
+        Put(32, std::llround(double(Fix.Altitude) * 1e3), 4);
+        Put(36, std::llround(double(Fix.Altitude) * 1e3), 4);
+        Put(40, std::llround(double(Fix.HorizontalAccuracy) * 1e3), 4);
+        Put(48, std::llround(double(Fix.VelocityNorth) * 1e3), 4);
+        Put(52, std::llround(double(Fix.VelocityEast) * 1e3), 4);
+        Put(56, std::llround(-double(Fix.VelocityUp) * 1e3), 4);
+        Put(76, std::llround(double(Fix.DOP) * 100.0), 2);
+        return EncodeUBX(0x01, 0x07, p, sizeof(p), Out, Size);
+    }
+
+}
@@ -0,0 +1,439 @@
+// Fixed size linear algebra for estimation and control
+// Every size is known at compile time, so everything lives on the stack and loops over the
+// small sizes we use (3x3, 4x4, 6x6, 9x9) are fully unrolled by the compiler
+
+#pragma once
+
+#include <iostream>
+#include <cstddef>
+#include <cmath>
+#include <initializer_list>
+#include <type_traits>
+
+#if defined(__SSE__) && !defined(ROCKET_NO_SIMD)
+    #include <xmmintrin.h>
+    #define ROCKET_SSE
+#endif
+
+namespace RocketPhysics{
+
+/// @brief True while the compiler is evaluating a constant expression, used to keep the SIMD
+/// kernels out of constexpr evaluation
+constexpr bool IsConstantEvaluated(){
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_is_constant_evaluated();
+#else
+    return true;
+#endif
+}
+
+/// @brief Square root that can also run in a constant expression, where std::sqrt is not constexpr.
+/// Compile time evaluation uses Newton's method, run time calls std::sqrt (on compilers without
+/// IsConstantEvaluated support it is always Newton's method)
+template<typename T>
+constexpr T Sqrt(T x){
+    if(IsConstantEvaluated()){
+        if(!(x > T(0))) {return T(0);}
+        // Starting at or above the root, the iterates fall monotonically until they stop changing
+        T Root = x > T(1) ? x : T(1);
+        while(true){
+            T Next = (Root + x / Root) / T(2);
+            if(!(Next < Root)) {return Root;}
+            Root = Next;
+        }
+    }
+    return std::sqrt(x);
+}
+
+template<std::size_t R, std::size_t C, typename T>
+class Matrix;
+
+#ifdef ROCKET_SSE
+/// @brief SSE kernel for the 4x4 float product (row major), one row of the result per iteration
+inline void Multiply4x4SSE(const float* A, const float* B, float* Out){
+    __m128 B0 = _mm_loadu_ps(B);
+    __m128 B1 = _mm_loadu_ps(B + 4);
+    __m128 B2 = _mm_loadu_ps(B + 8);
+    __m128 B3 = _mm_loadu_ps(B + 12);
+    for(int i = 0; i < 4; i++){
+        __m128 Row = _mm_mul_ps(_mm_set1_ps(A[4 * i]), B0);
+        Row = _mm_add_ps(Row, _mm_mul_ps(_mm_set1_ps(A[4 * i + 1]), B1));
+        Row = _mm_add_ps(Row, _mm_mul_ps(_mm_set1_ps(A[4 * i + 2]), B2));
+        Row = _mm_add_ps(Row, _mm_mul_ps(_mm_set1_ps(A[4 * i + 3]), B3));
+        _mm_storeu_ps(Out + 4 * i, Row);
+    }
+}
+
+/// @brief SSE kernel for the 4x4 float matrix times a 4 vector
+inline void MultiplyVector4SSE(const float* A, const float* v, float* Out){
+    __m128 V = _mm_loadu_ps(v);
+    __m128 R0 = _mm_mul_ps(_mm_loadu_ps(A), V);
+    __m128 R1 = _mm_mul_ps(_mm_loadu_ps(A + 4), V);
+    __m128 R2 = _mm_mul_ps(_mm_loadu_ps(A + 8), V);
+    __m128 R3 = _mm_mul_ps(_mm_loadu_ps(A + 12), V);
+    _MM_TRANSPOSE4_PS(R0, R1, R2, R3);
+    _mm_storeu_ps(Out, _mm_add_ps(_mm_add_ps(R0, R1), _mm_add_ps(R2, R3)));
+}
+#endif
+
+/// THE MATRIX PRIMITIVE
+/// @brief A dense R x C matrix stored row major on the stack. Vectors are single column matrices (see Vector)
+template<std::size_t R, std::size_t C, typename T=float>
+class Matrix{
+private:
+    T Data[R * C];
+
+public:
+    /// @brief Creates a zero matrix
+    constexpr Matrix(): Data{} {}
+
+    /// @brief Creates a matrix from its values in row major order, missing values are zero
+    constexpr Matrix(std::initializer_list<T> Values): Data{} {
+        std::size_t i = 0;
+        for(const T& Value : Values){
+            if(i >= R * C) {break;}
+            Data[i++] = Value;
+        }
+    }
+
+    static constexpr Matrix Zero(){
+        return Matrix();
+    }
+
+    static constexpr Matrix Identity(){
+        static_assert(R == C, "Identity is only defined for square matrices");
+        Matrix Result;
+        for(std::size_t i = 0; i < R; i++) {Result(i, i) = T(1);}
+        return Result;
+    }
+
+    static constexpr std::size_t Rows() {return R;}
+    static constexpr std::size_t Cols() {return C;}
+
+    constexpr T& operator()(std::size_t Row, std::size_t Col) {return Data[Row * C + Col];}
+    constexpr const T& operator()(std::size_t Row, std::size_t Col) const {return Data[Row * C + Col];}
+
+    /// @brief Flat (row major) access, mostly useful for vectors
+    constexpr T& operator[](std::size_t i) {return Data[i];}
+    constexpr const T& operator[](std::size_t i) const {return Data[i];}
+
+    /// @brief Raw row major storage, for handing to kernels
+    constexpr T* Raw() {return Data;}
+    constexpr const T* Raw() const {return Data;}
+
+    /// @brief Addition operator
+    constexpr Matrix operator+(const Matrix& m) const{
+        Matrix Result;
+        for(std::size_t i = 0; i < R * C; i++) {Result.Data[i] = Data[i] + m.Data[i];}
+        return Result;
+    }
+
+    /// @brief Subtraction operator
+    constexpr Matrix operator-(const Matrix& m) const{
+        Matrix Result;
+        for(std::size_t i = 0; i < R * C; i++) {Result.Data[i] = Data[i] - m.Data[i];}
+        return Result;
+    }
+
+    /// @brief Negation operator
+    constexpr Matrix operator-() const{
+        Matrix Result;
+        for(std::size_t i = 0; i < R * C; i++) {Result.Data[i] = -Data[i];}
+        return Result;
+    }
+
+    /// @brief Scalar multiplication operator
+    constexpr Matrix operator*(const T& s) const{
+        Matrix Result;
+        for(std::size_t i = 0; i < R * C; i++) {Result.Data[i] = Data[i] * s;}
+        return Result;
+    }
+
+    /// @brief Scalar division operator
+    constexpr Matrix operator/(const T& s) const{
+        Matrix Result;
+        for(std::size_t i = 0; i < R * C; i++) {Result.Data[i] = Data[i] / s;}
+        return Result;
+    }
+
+    constexpr Matrix& operator+=(const Matrix& m){
+        for(std::size_t i = 0; i < R * C; i++) {Data[i] += m.Data[i];}
+        return *this;
+    }
+
+    constexpr Matrix& operator-=(const Matrix& m){
+        for(std::size_t i = 0; i < R * C; i++) {Data[i] -= m.Data[i];}
+        return *this;
+    }
+
+    constexpr Matrix& operator*=(const T& s){
+        for(std::size_t i = 0; i < R * C; i++) {Data[i] *= s;}
+        return *this;
+    }
+
+    /// @brief Matrix product
+    /// @param m a C x K matrix
+    /// @return an R x K matrix
+    template<std::size_t K>
+    constexpr Matrix<R, K, T> operator*(const Matrix<C, K, T>& m) const{
+        Matrix<R, K, T> Result;
+#ifdef ROCKET_SSE
+        if constexpr(std::is_same<T, float>::value && R == 4 && C == 4 && (K == 4 || K == 1)){
+            if(!IsConstantEvaluated()){
+                if constexpr(K == 4) {Multiply4x4SSE(Data, m.Raw(), Result.Raw());}
+                else {MultiplyVector4SSE(Data, m.Raw(), Result.Raw());}
+                return Result;
+            }
+        }
+#endif
+        for(std::size_t i = 0; i < R; i++){
+            for(std::size_t j = 0; j < K; j++){
+                T Sum = T(0);
+                for(std::size_t k = 0; k < C; k++) {Sum += Data[i * C + k] * m(k, j);}
+                Result(i, j) = Sum;
+            }
+        }
+        return Result;
+    }
+
+    constexpr bool operator==(const Matrix& m) const{
+        for(std::size_t i = 0; i < R * C; i++){
+            if(Data[i] != m.Data[i]) {return false;}
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const Matrix& m) const{
+        return !(*this == m);
+    }
+
+    constexpr Matrix<C, R, T> Transpose() const{
+        Matrix<C, R, T> Result;
+        for(std::size_t i = 0; i < R; i++){
+            for(std::size_t j = 0; j < C; j++) {Result(j, i) = Data[i * C + j];}
+        }
+        return Result;
+    }
+
+    constexpr T Trace() const{
+        static_assert(R == C, "Trace is only defined for square matrices");
+        T Sum = T(0);
+        for(std::size_t i = 0; i < R; i++) {Sum += Data[i * C + i];}
+        return Sum;
+    }
+
+    /// @brief Sum of the element wise products, the dot product for vectors
+    constexpr T Dot(const Matrix& m) const{
+        T Sum = T(0);
+        for(std::size_t i = 0; i < R * C; i++) {Sum += Data[i] * m.Data[i];}
+        return Sum;
+    }
+
+    /// @brief Euclidean norm for vectors, Frobenius norm for matrices
+    T Norm() const{
+        return std::sqrt(Dot(*this));
+    }
+
+    /// @brief Copies a sub block out of the matrix
+    template<std::size_t BR, std::size_t BC>
+    constexpr Matrix<BR, BC, T> Block(std::size_t Row, std::size_t Col) const{
+        Matrix<BR, BC, T> Result;
+        for(std::size_t i = 0; i < BR; i++){
+            for(std::size_t j = 0; j < BC; j++) {Result(i, j) = Data[(Row + i) * C + Col + j];}
+        }
+        return Result;
+    }
+
+    /// @brief Writes a sub block into the matrix
+    template<std::size_t BR, std::size_t BC>
+    constexpr void SetBlock(std::size_t Row, std::size_t Col, const Matrix<BR, BC, T>& b){
+        for(std::size_t i = 0; i < BR; i++){
+            for(std::size_t j = 0; j < BC; j++) {Data[(Row + i) * C + Col + j] = b(i, j);}
+        }
+    }
+
+    /// @brief Shows the matrix one row per line
+    void Show() const{
+        for(std::size_t i = 0; i < R; i++){
+            for(std::size_t j = 0; j < C; j++) {std::cout << Data[i * C + j] << (j + 1 < C ? ", " : "");}
+            std::cout << std::endl;
+        }
+    }
+};
+
+/// @brief Column vector of a fixed size
+template<std::size_t N, typename T=float>
+using Vector = Matrix<N, 1, T>;
+
+/// @brief Scalar multiplication with the scalar on the left
+template<std::size_t R, std::size_t C, typename T>
+constexpr Matrix<R, C, T> operator*(const T& s, const Matrix<R, C, T>& m){
+    return m * s;
+}
+
+/// @brief Outer product of two vectors
+template<std::size_t N, std::size_t M, typename T>
+constexpr Matrix<N, M, T> Outer(const Vector<N, T>& a, const Vector<M, T>& b){
+    Matrix<N, M, T> Result;
+    for(std::size_t i = 0; i < N; i++){
+        for(std::size_t j = 0; j < M; j++) {Result(i, j) = a[i] * b[j];}
+    }
+    return Result;
+}
+
+/// @brief Cholesky decomposition A = L * L^T of a symmetric positive definite matrix
+/// Only the lower triangle of A is read
+/// @param A the matrix to decompose
+/// @param L receives the lower triangular factor
+/// @return false if A is not positive definite (L is then left partially written)
+template<std::size_t N, typename T>
+constexpr bool Cholesky(const Matrix<N, N, T>& A, Matrix<N, N, T>& L){
+    L = Matrix<N, N, T>();
+    for(std::size_t j = 0; j < N; j++){
+        T Diagonal = A(j, j);
+        for(std::size_t k = 0; k < j; k++) {Diagonal -= L(j, k) * L(j, k);}
+        if(!(Diagonal > T(0))) {return false;}
+        L(j, j) = Sqrt(Diagonal);
+
+        for(std::size_t i = j + 1; i < N; i++){
+            T Sum = A(i, j);
+            for(std::size_t k = 0; k < j; k++) {Sum -= L(i, k) * L(j, k);}
+            L(i, j) = Sum / L(j, j);
+        }
+    }
+    return true;
+}
+
+/// @brief Solves A * x = b given the Cholesky factor of A
+/// @param L the lower triangular factor from Cholesky()
+/// @param b the right hand side (one or more columns)
+/// @return x
+template<std::size_t N, std::size_t K, typename T>
+constexpr Matrix<N, K, T> CholeskySolve(const Matrix<N, N, T>& L, const Matrix<N, K, T>& b){
+    Matrix<N, K, T> x = b;
+    for(std::size_t c = 0; c < K; c++){
+        // Forward substitution, L * y = b
+        for(std::size_t i = 0; i < N; i++){
+            T Sum = x(i, c);
+            for(std::size_t k = 0; k < i; k++) {Sum -= L(i, k) * x(k, c);}
+            x(i, c) = Sum / L(i, i);
+        }
+        // Back substitution, L^T * x = y
+        for(std::size_t i = N; i-- > 0;){
+            T Sum = x(i, c);
+            for(std::size_t k = i + 1; k < N; k++) {Sum -= L(k, i) * x(k, c);}
+            x(i, c) = Sum / L(i, i);
+        }
+    }
+    return x;
+}
+
+/// @brief LU decomposition with partial pivoting, P * A = L * U
+/// L (unit diagonal) and U are packed into one matrix
+template<std::size_t N, typename T=float>
+class LUDecomposition{
+private:
+    Matrix<N, N, T> LU;
+    std::size_t Pivot[N];
+    int PivotSign;
+    bool Singular;
+
+public:
+    constexpr LUDecomposition(): LU(), Pivot{}, PivotSign(1), Singular(true) {}
+
+    /// @param A the matrix to decompose
+    constexpr explicit LUDecomposition(const Matrix<N, N, T>& A): LU(), Pivot{}, PivotSign(1), Singular(true) {
+        Factor(A);
+    }
+
+    /// @brief Decomposes A, replacing any previous factorisation
+    /// @return false if A is singular
+    constexpr bool Factor(const Matrix<N, N, T>& A){
+        LU = A;
+        PivotSign = 1;
+        Singular = false;
+        for(std::size_t i = 0; i < N; i++) {Pivot[i] = i;}
+
+        for(std::size_t k = 0; k < N; k++){
+            // Pick the largest pivot in this column
+            std::size_t Best = k;
+            T BestValue = LU(k, k) < T(0) ? -LU(k, k) : LU(k, k);
+            for(std::size_t i = k + 1; i < N; i++){
+                T Value = LU(i, k) < T(0) ? -LU(i, k) : LU(i, k);
+                if(Value > BestValue) {Best = i; BestValue = Value;}
+            }
+
+            if(BestValue == T(0)){
+                Singular = true;
+                return false;
+            }
+
+            if(Best != k){
+                for(std::size_t j = 0; j < N; j++){
+                    T Temp = LU(k, j);
+                    LU(k, j) = LU(Best, j);
+                    LU(Best, j) = Temp;
+                }
+                std::size_t Temp = Pivot[k];
+                Pivot[k] = Pivot[Best];
+                Pivot[Best] = Temp;
+                PivotSign = -PivotSign;
+            }
+
+            for(std::size_t i = k + 1; i < N; i++){
+                LU(i, k) /= LU(k, k);
+                for(std::size_t j = k + 1; j < N; j++) {LU(i, j) -= LU(i, k) * LU(k, j);}
+            }
+        }
+        return true;
+    }
+
+    constexpr bool IsSingular() const {return Singular;}
+
+    constexpr T Determinant() const{
+        if(Singular) {return T(0);}
+        T Result = T(PivotSign);
+        for(std::size_t i = 0; i < N; i++) {Result *= LU(i, i);}
+        return Result;
+    }
+
+    /// @brief Solves A * x = b
+    /// @param b the right hand side (one or more columns)
+    /// @return x, or zero if A was singular
+    template<std::size_t K>
+    constexpr Matrix<N, K, T> Solve(const Matrix<N, K, T>& b) const{
+        Matrix<N, K, T> x;
+        if(Singular) {return x;}
+
+        for(std::size_t c = 0; c < K; c++){
+            for(std::size_t i = 0; i < N; i++){
+                T Sum = b(Pivot[i], c);
+                for(std::size_t k = 0; k < i; k++) {Sum -= LU(i, k) * x(k, c);}
+                x(i, c) = Sum;
+            }
+            for(std::size_t i = N; i-- > 0;){
+                T Sum = x(i, c);
+                for(std::size_t k = i + 1; k < N; k++) {Sum -= LU(i, k) * x(k, c);}
+                x(i, c) = Sum / LU(i, i);
+            }
+        }
+        return x;
+    }
+
+    /// @return the inverse of A, or zero if A was singular
+    constexpr Matrix<N, N, T> Inverse() const{
+        return Solve(Matrix<N, N, T>::Identity());
+    }
+};
+
+/// @brief Inverse of a square matrix through LU decomposition
+/// @return false if the matrix is singular
+template<std::size_t N, typename T>
+constexpr bool Inverse(const Matrix<N, N, T>& A, Matrix<N, N, T>& Result){
+    LUDecomposition<N, T> Decomposition(A);
+    if(Decomposition.IsSingular()) {return false;}
+    Result = Decomposition.Inverse();
+    return true;
+}
+
+};
@@ -8,6 +8,11 @@
 
 #include <iostream>
 #include <cmath>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include "Matrix.hpp"
 
 
 namespace RocketPhysics{
@@ -30,16 +35,19 @@ public:
     ///@param DataB float, EITHER a magnitude OR a direction (degrees)
     ///@param Angle boolean, true if the second value is an angle
     ///@param DType character, the datatype of the value
-    Vector2D(const float& DataA, const float& DataB, const bool& Angle, const char& DType='X') {
+    constexpr Vector2D(const float& DataA, const float& DataB, const bool& Angle, const char& DType='X'): DataX(0), DataY(0), DataType(DType) {
         Set(DataA, DataB, Angle, DType); 
     }   
 
+    /// @brief Creates a zero vector of an undefined datatype
+    constexpr Vector2D(): DataX(0), DataY(0), DataType('X') {}
+
     /// @brief Sets all the values for the vector
     /// @param DataA float, a magnitude
     /// @param DataB float, EITHER a magnitude OR a direction (degrees)
     /// @param Angle boolean, true if the second value is an angle
     /// @param DType character, the datatype of the value
-    void Set(const float& DataA, const float& DataB, const bool& Angle, const char& DType='X'){
+    constexpr void Set(const float& DataA, const float& DataB, const bool& Angle, const char& DType='X'){
         DataType = DType;
         // If both values are magnitudes, enter them directly
         if(!Angle){
@@ -49,97 +57,98 @@ public:
         }
 
         // If the second value is an angle, calculate the actual direction
-        DataX = DataA * cos(DataB);
-        DataY = DataA * sin(DataB);
+        DataX = DataA * std::cos(DataB);
+        DataY = DataA * std::sin(DataB);
     }    
 
     /// @brief Setter for the datatype
     /// @param newType What the datatype should be (character)
-    inline void SetType(const char& newType){
+    constexpr void SetType(const char& newType){
         DataType = newType;
     }
 
     /// @brief Getter for the datatype
     /// @return A copy of the datatype (character)
-    inline char GetType() const{
+    constexpr char GetType() const{
         return DataType;
     }
 
     /// @brief Getter for the data (in radial format)
     /// @return a pair of floats, where the first value is the magnitude and the second value is an angle
-    inline float* GetRadial() const{
-        return new float[2] {sqrt(float(pow(DataX, 2) + pow(DataY, 2))), atan2(DataY, DataX)};
+    inline std::array<float, 2> GetRadial() const{
+        return {std::sqrt(DataX * DataX + DataY * DataY), std::atan2(DataY, DataX)};
     }
 
     /// @brief Getter for the data (in magnitude X, Y format)
     /// @return a pair of floats, where the first value is the magnitude X and the second value is the magnitude Y
-    inline float* GetCartesian() const{
-        return new float[2] {DataX, DataY};
+    constexpr std::array<float, 2> GetCartesian() const{
+        return {DataX, DataY};
     }
 
     /// @brief Getter for the X coordinate
     /// @return The x coordinate raw
-    inline float GetX() const{
+    constexpr float GetX() const{
         return DataX;
     }
 
     /// @brief Getter for the Y coordinate
     /// @return The y coordinate raw
-    inline float GetY() const{
+    constexpr float GetY() const{
         return DataY;
     }
 
     /// @brief Addition operator
     /// @param v The vector to add 
     /// @return A new vector as the result
-    inline Vector2D operator+(const Vector2D& v) const{
+    constexpr Vector2D operator+(const Vector2D& v) const{
         return Vector2D(DataX + v.GetX(), DataY + v.GetY(), false, DataType);
     }
 
     /// @brief Subtraction operator
     /// @param v The vector to subtract
     /// @return A new vector as the result
-    inline Vector2D operator-(const Vector2D& v) const {
+    constexpr Vector2D operator-(const Vector2D& v) const {
         return Vector2D(DataX - v.GetX(), DataY - v.GetY(), false, DataType);
     }
 
     /// @brief Division operator
     /// @param s The scalar to divide by
     /// @return A new vector as the result
-    inline Vector2D operator/(const float& s){
-        return Vector2D(DataX/s, DataY/s, false, 'X');
+    constexpr Vector2D operator/(const float& s) const{
+        return Vector2D(DataX/s, DataY/s, false, DataType);
     }
 
     
     /// @brief Multiplication operator
-    /// @param s The scalar to divide by
+    /// @param s The scalar to multiply by
     /// @return A new vector as the result
-    inline Vector2D operator*(const float& s){
-        return Vector2D(DataX*s, DataY*s, false, 'X');
+    constexpr Vector2D operator*(const float& s) const{
+        return Vector2D(DataX*s, DataY*s, false, DataType);
     }
 
     /// @brief Dot product
     /// @param v The vector to multiply by
     /// @return A floating point result of the dot product
-    inline float operator*(const Vector2D& v){
+    constexpr float operator*(const Vector2D& v) const{
         return DataX * v.GetX() + DataY * v.GetY();
     }
 
     /// @brief Cross product
     /// @param v The vector to multiply by
     /// @return A floating point result of the cross product
-    inline float operator^(const Vector2D& v){
+    constexpr float operator^(const Vector2D& v) const{
         return DataX * v.GetY() - DataY * v.GetX();
     }
 
     /// @brief Shows the vector in X/Y format
-    inline void ShowCartesian(){
+    inline void ShowCartesian() const{
         std::cout << "X: " << DataX << ", Y: " << DataY;
     }
 
     /// @brief Shows the vector in Magnitude/Theta format
-    inline void ShowRadial(){
-        std::cout << "Magnitude: " << GetRadial()[0] << ", Theta: " << GetRadial()[1];
+    inline void ShowRadial() const{
+        auto [Magnitude, Theta] = GetRadial();
+        std::cout << "Magnitude: " << Magnitude << ", Theta: " << Theta;
     }
 };
 
@@ -159,16 +168,17 @@ public:
     /// @param DataB float, EITHER a magnitude OR a direction (degrees) 
     /// @param DataC float, EITHER a magnitude OR an angle (degrees) 
     /// @param DType character, the datatype of the value
-    Vector3D(const float& DataA, const float& DataB, const float& DataC, const char& DType='X') {
-        Set(DataA, DataB, DataC, DType);
-    }
+    constexpr Vector3D(const float& DataA, const float& DataB, const float& DataC, const char& DType='X'): DataX(DataA), DataY(DataB), DataZ(DataC), DataType(DType) {}
+
+    /// @brief Creates a zero vector of an undefined datatype
+    constexpr Vector3D(): DataX(0), DataY(0), DataZ(0), DataType('X') {}
 
     /// @brief Sets all the values for the vector
     /// @param DataA float, a magnitude
     /// @param DataB float, EITHER a magnitude OR a direction (degrees) 
     /// @param DataC float, EITHER a magnitude OR an angle (degrees) 
     /// @param DType character, the datatype of the value
-    void Set(const float& DataA, const float& DataB, const float& DataC, const char& DType='X') {
+    constexpr void Set(const float& DataA, const float& DataB, const float& DataC, const char& DType='X') {
         DataType = DType;
         DataX = DataA;
         DataY = DataB;
@@ -177,80 +187,92 @@ public:
 
     /// @brief Setter for the datatype
     /// @param newType What the datatype should be (character)
-    inline void SetType(const char& newType) {
+    constexpr void SetType(const char& newType) {
         DataType = newType;
     }
 
     /// @brief Getter for the datatype
     /// @return A copy of the datatype (character)
-    inline char GetType() const {
+    constexpr char GetType() const {
         return DataType;
     }
 
     /// @brief Getter for the data (in magnitude X, Y, Z format)
-    /// @return a pair of floats, where the first value is the magnitude X, 
+    /// @return three floats, where the first value is the magnitude X, 
     /// the second value is the magnitude Y, and the third value is the magnitude Z
-    inline float* GetAll() const {
-        return new float[3] {DataX, DataY, DataZ}; 
+    constexpr std::array<float, 3> GetAll() const {
+        return {DataX, DataY, DataZ}; 
     }
 
     /// @brief Getter for the X coordinate
     /// @return The x coordinate raw
-    inline float GetX() const {
+    constexpr float GetX() const {
         return DataX;
     }
 
     /// @brief Getter for the Y coordinate
     /// @return The y coordinate raw
-    inline float GetY() const {
+    constexpr float GetY() const {
         return DataY;
     }
 
     /// @brief Getter for the Z coordinate
     /// @return The z coordinate raw
-    inline float GetZ() const {
+    constexpr float GetZ() const {
         return DataZ;
     }
 
+    /// @brief Getter for the length of the vector
+    /// @return The magnitude
+    inline float Magnitude() const {
+        return std::sqrt(DataX * DataX + DataY * DataY + DataZ * DataZ);
+    }
+
     /// @brief Addition operator
     /// @param v The vector to add
     /// @return A new vector as the result
-    inline Vector3D operator+(const Vector3D& v) const {
+    constexpr Vector3D operator+(const Vector3D& v) const {
         return Vector3D(DataX + v.GetX(), DataY + v.GetY(), DataZ + v.GetZ(), DataType);
     }
 
     /// @brief Subtraction operator
     /// @param v The vector to subtract
     /// @return A new vector as the result
-    inline Vector3D operator-(const Vector3D& v) const {
+    constexpr Vector3D operator-(const Vector3D& v) const {
         return Vector3D(DataX - v.GetX(), DataY - v.GetY(), DataZ - v.GetZ(), DataType);
     }
 
+    /// @brief Negation operator
+    /// @return A new vector pointing the other way
+    constexpr Vector3D operator-() const {
+        return Vector3D(-DataX, -DataY, -DataZ, DataType);
+    }
+
     /// @brief Division operator
     /// @param s The scalar to divide by
     /// @return A new vector as the result
-    inline Vector3D operator/(const float& s) {
-        return Vector3D(DataX / s, DataY / s, DataZ / s, 'X');
+    constexpr Vector3D operator/(const float& s) const {
+        return Vector3D(DataX / s, DataY / s, DataZ / s, DataType);
     }
 
     /// @brief Multiplication operator
-    /// @param s The scalar to divide by
+    /// @param s The scalar to multiply by
     /// @return A new vector as the result
-    inline Vector3D operator*(const float& s) {
-        return Vector3D(DataX * s, DataY * s, DataZ * s, 'X');
+    constexpr Vector3D operator*(const float& s) const {
+        return Vector3D(DataX * s, DataY * s, DataZ * s, DataType);
     }
 
     /// @brief Dot product
     /// @param v The vector to multiply by
     /// @return A floating point result of the dot product
-    inline float operator*(const Vector3D& v) {
+    constexpr float operator*(const Vector3D& v) const {
         return DataX * v.GetX() + DataY * v.GetY() + DataZ * v.GetZ();
     }
 
     /// @brief Cross product
     /// @param v The vector to multiply by
     /// @return A new Vector3D as the result of the cross product
-    inline Vector3D operator^(const Vector3D& v) const {
+    constexpr Vector3D operator^(const Vector3D& v) const {
         return Vector3D(
             DataY * v.GetZ() - DataZ * v.GetY(),
             DataZ * v.GetX() - DataX * v.GetZ(),
@@ -264,4 +286,502 @@ public:
         std::cout << "X: " << DataX << ", Y: " << DataY << ", Z: " << DataZ;
     }
 };
+
+/// @brief Converts a Vector3D into a column vector for use with the matrix primitives
+constexpr Vector<3> ToColumn(const Vector3D& v) {
+    return Vector<3>{v.GetX(), v.GetY(), v.GetZ()};
+}
+
+/// @brief Converts a column vector back into a Vector3D
+/// @param DType character, the datatype of the result
+constexpr Vector3D ToVector3D(const Vector<3>& v, const char& DType='X') {
+    return Vector3D(v[0], v[1], v[2], DType);
+}
+
+/// THE VECTOR BATCH
+/// @brief Structure of arrays storage for a whole stream of 3D vectors (X, Y and Z each in their own
+/// contiguous array) so post-processing can run four samples per instruction.
+/// Storage is allocated once, at construction; nothing after that allocates
+class VectorBatch3D {
+private:
+    std::vector<float> DataX;
+    std::vector<float> DataY;
+    std::vector<float> DataZ;
+    std::size_t Count;
+    /// @brief This contains the unit for the values in this batch. There are no guidelines except that 'X' means undefined
+    char DataType;
+
+    /// @brief Number of samples an element wise operation with v can produce into Result
+    inline std::size_t Common(const VectorBatch3D& v, const VectorBatch3D& Result) const {
+        std::size_t n = Count < v.Count ? Count : v.Count;
+        return n < Result.Capacity() ? n : Result.Capacity();
+    }
+
+public:
+    /// @param Capacity the maximum number of samples the batch can hold
+    /// @param DType character, the datatype of the values
+    explicit VectorBatch3D(std::size_t Capacity, const char& DType='X'):
+        DataX(Capacity), DataY(Capacity), DataZ(Capacity), Count(0), DataType(DType) {}
+
+    inline std::size_t Size() const { return Count; }
+    inline std::size_t Capacity() const { return DataX.size(); }
+    inline char GetType() const { return DataType; }
+    inline void SetType(const char& newType) { DataType = newType; }
+
+    /// @brief Forgets every sample (keeps the storage)
+    inline void Clear() { Count = 0; }
+
+    /// @brief Sets the number of valid samples, e.g. after writing through X(), Y() and Z()
+    /// @return false if the batch cannot hold that many samples
+    inline bool Resize(std::size_t NewCount) {
+        if (NewCount > Capacity()) { return false; }
+        Count = NewCount;
+        return true;
+    }
+
+    /// @brief Appends a sample
+    /// @return false if the batch is full
+    inline bool Insert(const Vector3D& v) {
+        if (Count >= Capacity()) { return false; }
+        DataX[Count] = v.GetX();
+        DataY[Count] = v.GetY();
+        DataZ[Count] = v.GetZ();
+        Count++;
+        return true;
+    }
+
+    inline Vector3D Get(std::size_t i) const {
+        return Vector3D(DataX[i], DataY[i], DataZ[i], DataType);
+    }
+
+    inline void Set(std::size_t i, const Vector3D& v) {
+        DataX[i] = v.GetX();
+        DataY[i] = v.GetY();
+        DataZ[i] = v.GetZ();
+    }
+
+    /// @brief Raw component arrays, for filling the batch straight from a sensor stream
+    inline float* X() { return DataX.data(); }
+    inline float* Y() { return DataY.data(); }
+    inline float* Z() { return DataZ.data(); }
+    inline const float* X() const { return DataX.data(); }
+    inline const float* Y() const { return DataY.data(); }
+    inline const float* Z() const { return DataZ.data(); }
+
+    /// @brief Element wise addition, Result may be this batch or v
+    void Add(const VectorBatch3D& v, VectorBatch3D& Result) const {
+        std::size_t n = Common(v, Result), i = 0;
+        const float *ax = X(), *ay = Y(), *az = Z(), *bx = v.X(), *by = v.Y(), *bz = v.Z();
+        float *rx = Result.X(), *ry = Result.Y(), *rz = Result.Z();
+#ifdef ROCKET_SSE
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(rx + i, _mm_add_ps(_mm_loadu_ps(ax + i), _mm_loadu_ps(bx + i)));
+            _mm_storeu_ps(ry + i, _mm_add_ps(_mm_loadu_ps(ay + i), _mm_loadu_ps(by + i)));
+            _mm_storeu_ps(rz + i, _mm_add_ps(_mm_loadu_ps(az + i), _mm_loadu_ps(bz + i)));
+        }
+#endif
+        for (; i < n; i++) {
+            rx[i] = ax[i] + bx[i];
+            ry[i] = ay[i] + by[i];
+            rz[i] = az[i] + bz[i];
+        }
+        Result.Count = n;
+        Result.DataType = DataType;
+    }
+
+    /// @brief Element wise subtraction, Result may be this batch or v
+    void Subtract(const VectorBatch3D& v, VectorBatch3D& Result) const {
+        std::size_t n = Common(v, Result), i = 0;
+        const float *ax = X(), *ay = Y(), *az = Z(), *bx = v.X(), *by = v.Y(), *bz = v.Z();
+        float *rx = Result.X(), *ry = Result.Y(), *rz = Result.Z();
+#ifdef ROCKET_SSE
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(rx + i, _mm_sub_ps(_mm_loadu_ps(ax + i), _mm_loadu_ps(bx + i)));
+            _mm_storeu_ps(ry + i, _mm_sub_ps(_mm_loadu_ps(ay + i), _mm_loadu_ps(by + i)));
+            _mm_storeu_ps(rz + i, _mm_sub_ps(_mm_loadu_ps(az + i), _mm_loadu_ps(bz + i)));
+        }
+#endif
+        for (; i < n; i++) {
+            rx[i] = ax[i] - bx[i];
+            ry[i] = ay[i] - by[i];
+            rz[i] = az[i] - bz[i];
+        }
+        Result.Count = n;
+        Result.DataType = DataType;
+    }
+
+    /// @brief Multiplies every sample by a scalar, Result may be this batch
+    void Scale(const float& s, VectorBatch3D& Result) const {
+        std::size_t n = Common(*this, Result), i = 0;
+        const float *ax = X(), *ay = Y(), *az = Z();
+        float *rx = Result.X(), *ry = Result.Y(), *rz = Result.Z();
+#ifdef ROCKET_SSE
+        __m128 S = _mm_set1_ps(s);
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(rx + i, _mm_mul_ps(_mm_loadu_ps(ax + i), S));
+            _mm_storeu_ps(ry + i, _mm_mul_ps(_mm_loadu_ps(ay + i), S));
+            _mm_storeu_ps(rz + i, _mm_mul_ps(_mm_loadu_ps(az + i), S));
+        }
+#endif
+        for (; i < n; i++) {
+            rx[i] = ax[i] * s;
+            ry[i] = ay[i] * s;
+            rz[i] = az[i] * s;
+        }
+        Result.Count = n;
+        Result.DataType = DataType;
+    }
+
+    /// @brief Element wise dot product
+    /// @param Result receives one float per sample, must hold min(Size(), v.Size()) values
+    void Dot(const VectorBatch3D& v, float* Result) const {
+        std::size_t n = Count < v.Count ? Count : v.Count, i = 0;
+        const float *ax = X(), *ay = Y(), *az = Z(), *bx = v.X(), *by = v.Y(), *bz = v.Z();
+#ifdef ROCKET_SSE
+        for (; i + 4 <= n; i += 4) {
+            __m128 Sum = _mm_mul_ps(_mm_loadu_ps(ax + i), _mm_loadu_ps(bx + i));
+            Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(ay + i), _mm_loadu_ps(by + i)));
+            Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(az + i), _mm_loadu_ps(bz + i)));
+            _mm_storeu_ps(Result + i, Sum);
+        }
+#endif
+        for (; i < n; i++) {
+            Result[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+        }
+    }
+
+    /// @brief Element wise cross product, Result may be this batch or v
+    void Cross(const VectorBatch3D& v, VectorBatch3D& Result) const {
+        std::size_t n = Common(v, Result), i = 0;
+        const float *ax = X(), *ay = Y(), *az = Z(), *bx = v.X(), *by = v.Y(), *bz = v.Z();
+        float *rx = Result.X(), *ry = Result.Y(), *rz = Result.Z();
+#ifdef ROCKET_SSE
+        for (; i + 4 <= n; i += 4) {
+            __m128 Ax = _mm_loadu_ps(ax + i), Ay = _mm_loadu_ps(ay + i), Az = _mm_loadu_ps(az + i);
+            __m128 Bx = _mm_loadu_ps(bx + i), By = _mm_loadu_ps(by + i), Bz = _mm_loadu_ps(bz + i);
+            _mm_storeu_ps(rx + i, _mm_sub_ps(_mm_mul_ps(Ay, Bz), _mm_mul_ps(Az, By)));
+            _mm_storeu_ps(ry + i, _mm_sub_ps(_mm_mul_ps(Az, Bx), _mm_mul_ps(Ax, Bz)));
+            _mm_storeu_ps(rz + i, _mm_sub_ps(_mm_mul_ps(Ax, By), _mm_mul_ps(Ay, Bx)));
+        }
+#endif
+        for (; i < n; i++) {
+            float x = ay[i] * bz[i] - az[i] * by[i];
+            float y = az[i] * bx[i] - ax[i] * bz[i];
+            float z = ax[i] * by[i] - ay[i] * bx[i];
+            rx[i] = x; ry[i] = y; rz[i] = z;
+        }
+        Result.Count = n;
+        Result.DataType = 'X';
+    }
+
+    /// @brief Length of every sample
+    /// @param Result receives one float per sample, must hold Size() values
+    void Norm(float* Result) const {
+        std::size_t n = Count, i = 0;
+        const float *ax = X(), *ay = Y(), *az = Z();
+#ifdef ROCKET_SSE
+        for (; i + 4 <= n; i += 4) {
+            __m128 Ax = _mm_loadu_ps(ax + i), Ay = _mm_loadu_ps(ay + i), Az = _mm_loadu_ps(az + i);
+            __m128 Sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Ax, Ax), _mm_mul_ps(Ay, Ay)), _mm_mul_ps(Az, Az));
+            _mm_storeu_ps(Result + i, _mm_sqrt_ps(Sum));
+        }
+#endif
+        for (; i < n; i++) {
+            Result[i] = std::sqrt(ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i]);
+        }
+    }
+
+    /// @brief Scales every sample to unit length, zero samples stay zero. Result may be this batch
+    void Normalize(VectorBatch3D& Result) const {
+        std::size_t n = Common(*this, Result), i = 0;
+        const float *ax = X(), *ay = Y(), *az = Z();
+        float *rx = Result.X(), *ry = Result.Y(), *rz = Result.Z();
+#ifdef ROCKET_SSE
+        __m128 Zero = _mm_setzero_ps(), One = _mm_set1_ps(1.0f);
+        for (; i + 4 <= n; i += 4) {
+            __m128 Ax = _mm_loadu_ps(ax + i), Ay = _mm_loadu_ps(ay + i), Az = _mm_loadu_ps(az + i);
+            __m128 Length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Ax, Ax), _mm_mul_ps(Ay, Ay)), _mm_mul_ps(Az, Az)));
+            // 1/length where the length is non zero, 0 elsewhere
+            __m128 NonZero = _mm_cmpgt_ps(Length, Zero);
+            __m128 Inverse = _mm_and_ps(NonZero, _mm_div_ps(One, _mm_or_ps(Length, _mm_andnot_ps(NonZero, One))));
+            _mm_storeu_ps(rx + i, _mm_mul_ps(Ax, Inverse));
+            _mm_storeu_ps(ry + i, _mm_mul_ps(Ay, Inverse));
+            _mm_storeu_ps(rz + i, _mm_mul_ps(Az, Inverse));
+        }
+#endif
+        for (; i < n; i++) {
+            float Length = std::sqrt(ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i]);
+            float Inverse = Length > 0.0f ? 1.0f / Length : 0.0f;
+            rx[i] = ax[i] * Inverse;
+            ry[i] = ay[i] * Inverse;
+            rz[i] = az[i] * Inverse;
+        }
+        Result.Count = n;
+        Result.DataType = 'X';
+    }
+};
+
+/// THE ROTATION PRIMITIVE
+/// @brief A unit quaternion describing the rotation from one frame to another (for the AHRS: body to world).
+/// Rotate() takes a vector expressed in the first frame and returns it expressed in the second one
+class Quaternion {
+private:
+    float DataW;
+    float DataX;
+    float DataY;
+    float DataZ;
+
+public:
+    /// @brief Creates the identity rotation
+    constexpr Quaternion(): DataW(1), DataX(0), DataY(0), DataZ(0) {}
+
+    /// @param W float, the scalar part
+    /// @param X, Y, Z float, the vector part
+    constexpr Quaternion(const float& W, const float& X, const float& Y, const float& Z): DataW(W), DataX(X), DataY(Y), DataZ(Z) {}
+
+    /// @brief Creates a rotation about an axis
+    /// @param Axis the axis to rotate about (does not need to be unit length)
+    /// @param Angle the angle in radians
+    static Quaternion FromAxisAngle(const Vector3D& Axis, const float& Angle) {
+        float Length = Axis.Magnitude();
+        if (Length <= 0.0f) { return Quaternion(); }
+        float s = std::sin(0.5f * Angle) / Length;
+        return Quaternion(std::cos(0.5f * Angle), Axis.GetX() * s, Axis.GetY() * s, Axis.GetZ() * s);
+    }
+
+    /// @brief Creates a rotation from Euler angles applied in Z, Y, X order (q = qZ * qY * qX)
+    /// @param AboutX, AboutY, AboutZ angles in radians
+    static Quaternion FromEuler(const float& AboutX, const float& AboutY, const float& AboutZ) {
+        float cx = std::cos(0.5f * AboutX), sx = std::sin(0.5f * AboutX);
+        float cy = std::cos(0.5f * AboutY), sy = std::sin(0.5f * AboutY);
+        float cz = std::cos(0.5f * AboutZ), sz = std::sin(0.5f * AboutZ);
+        return Quaternion(
+            cx * cy * cz + sx * sy * sz,
+            sx * cy * cz - cx * sy * sz,
+            cx * sy * cz + sx * cy * sz,
+            cx * cy * sz - sx * sy * cz
+        );
+    }
+
+    /// @brief Creates a rotation from a direction cosine matrix (Shepperd's method)
+    /// @param m a proper rotation matrix, the same convention as ToDCM()
+    static Quaternion FromDCM(const Matrix<3, 3>& m) {
+        float Trace = m(0, 0) + m(1, 1) + m(2, 2);
+        Quaternion q;
+        if (Trace > 0.0f) {
+            float s = 0.5f / std::sqrt(Trace + 1.0f);
+            q = Quaternion(0.25f / s, (m(2, 1) - m(1, 2)) * s, (m(0, 2) - m(2, 0)) * s, (m(1, 0) - m(0, 1)) * s);
+        }
+        else if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2)) {
+            float s = 2.0f * std::sqrt(1.0f + m(0, 0) - m(1, 1) - m(2, 2));
+            q = Quaternion((m(2, 1) - m(1, 2)) / s, 0.25f * s, (m(0, 1) + m(1, 0)) / s, (m(0, 2) + m(2, 0)) / s);
+        }
+        else if (m(1, 1) > m(2, 2)) {
+            float s = 2.0f * std::sqrt(1.0f + m(1, 1) - m(0, 0) - m(2, 2));
+            q = Quaternion((m(0, 2) - m(2, 0)) / s, (m(0, 1) + m(1, 0)) / s, 0.25f * s, (m(1, 2) + m(2, 1)) / s);
+        }
+        else {
+            float s = 2.0f * std::sqrt(1.0f + m(2, 2) - m(0, 0) - m(1, 1));
+            q = Quaternion((m(1, 0) - m(0, 1)) / s, (m(0, 2) + m(2, 0)) / s, (m(1, 2) + m(2, 1)) / s, 0.25f * s);
+        }
+        return q.Normalized();
+    }
+
+    constexpr float GetW() const { return DataW; }
+    constexpr float GetX() const { return DataX; }
+    constexpr float GetY() const { return DataY; }
+    constexpr float GetZ() const { return DataZ; }
+
+    /// @brief Getter for all four components
+    /// @return W, X, Y, Z
+    constexpr std::array<float, 4> GetAll() const {
+        return {DataW, DataX, DataY, DataZ};
+    }
+
+    /// @brief Composition, (a * b).Rotate(v) == a.Rotate(b.Rotate(v))
+    constexpr Quaternion operator*(const Quaternion& q) const {
+        return Quaternion(
+            DataW * q.DataW - DataX * q.DataX - DataY * q.DataY - DataZ * q.DataZ,
+            DataW * q.DataX + DataX * q.DataW + DataY * q.DataZ - DataZ * q.DataY,
+            DataW * q.DataY - DataX * q.DataZ + DataY * q.DataW + DataZ * q.DataX,
+            DataW * q.DataZ + DataX * q.DataY - DataY * q.DataX + DataZ * q.DataW
+        );
+    }
+
+    constexpr float Dot(const Quaternion& q) const {
+        return DataW * q.DataW + DataX * q.DataX + DataY * q.DataY + DataZ * q.DataZ;
+    }
+
+    inline float Norm() const {
+        return std::sqrt(Dot(*this));
+    }
+
+    inline Quaternion Normalized() const {
+        float Length = Norm();
+        if (Length <= 0.0f) { return Quaternion(); }
+        return Quaternion(DataW / Length, DataX / Length, DataY / Length, DataZ / Length);
+    }
+
+    /// @brief The inverse of a unit quaternion
+    constexpr Quaternion Conjugate() const {
+        return Quaternion(DataW, -DataX, -DataY, -DataZ);
+    }
+
+    /// @brief The inverse of any non zero quaternion, the reverse rotation
+    constexpr Quaternion Inverse() const {
+        float Squared = Dot(*this);
+        return Quaternion(DataW / Squared, -DataX / Squared, -DataY / Squared, -DataZ / Squared);
+    }
+
+    /// @brief Rotates a vector, assumes a unit quaternion
+    /// @param v the vector in the source frame
+    /// @return the vector in the destination frame, keeping the datatype
+    constexpr Vector3D Rotate(const Vector3D& v) const {
+        // t = 2 * (q_v x v), v' = v + w * t + q_v x t
+        float tx = 2.0f * (DataY * v.GetZ() - DataZ * v.GetY());
+        float ty = 2.0f * (DataZ * v.GetX() - DataX * v.GetZ());
+        float tz = 2.0f * (DataX * v.GetY() - DataY * v.GetX());
+        return Vector3D(
+            v.GetX() + DataW * tx + DataY * tz - DataZ * ty,
+            v.GetY() + DataW * ty + DataZ * tx - DataX * tz,
+            v.GetZ() + DataW * tz + DataX * ty - DataY * tx,
+            v.GetType()
+        );
+    }
+
+    /// @brief Rotates every sample of a batch by this quaternion (through its DCM). Result may be In
+    void Rotate(const VectorBatch3D& In, VectorBatch3D& Result) const;
+
+    /// @brief Rotates every sample of a batch by its own attitude, e.g. body to world for an IMU stream.
+    /// Result may be In
+    /// @param Attitudes one unit quaternion per sample
+    static void Rotate(const Quaternion* Attitudes, const VectorBatch3D& In, VectorBatch3D& Result);
+
+    /// @brief The equivalent direction cosine matrix, Rotate(v) == ToDCM() * v
+    constexpr Matrix<3, 3> ToDCM() const {
+        float xx = DataX * DataX, yy = DataY * DataY, zz = DataZ * DataZ;
+        float xy = DataX * DataY, xz = DataX * DataZ, yz = DataY * DataZ;
+        float wx = DataW * DataX, wy = DataW * DataY, wz = DataW * DataZ;
+        return Matrix<3, 3>{
+            1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy),
+            2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx),
+            2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy)
+        };
+    }
+
+    /// @brief Euler angles in the same convention as FromEuler()
+    /// @return angles about X, Y and Z in radians (the Y angle is limited to +-90 degrees)
+    inline Vector3D ToEuler() const {
+        float s = 2.0f * (DataW * DataY - DataZ * DataX);
+        s = s > 1.0f ? 1.0f : (s < -1.0f ? -1.0f : s);
+        return Vector3D(
+            std::atan2(2.0f * (DataW * DataX + DataY * DataZ), 1.0f - 2.0f * (DataX * DataX + DataY * DataY)),
+            std::asin(s),
+            std::atan2(2.0f * (DataW * DataZ + DataX * DataY), 1.0f - 2.0f * (DataY * DataY + DataZ * DataZ)),
+            'R'
+        );
+    }
+
+    /// @brief Spherical linear interpolation along the shortest path
+    /// @param a the rotation at t = 0
+    /// @param b the rotation at t = 1
+    /// @param t the interpolation parameter
+    static Quaternion Slerp(const Quaternion& a, const Quaternion& b, const float& t) {
+        float Cosine = a.Dot(b);
+        Quaternion End = b;
+        if (Cosine < 0.0f) {
+            Cosine = -Cosine;
+            End = Quaternion(-b.DataW, -b.DataX, -b.DataY, -b.DataZ);
+        }
+
+        float Wa, Wb;
+        if (Cosine > 0.9995f) {
+            // Nearly parallel, a normalised linear interpolation is accurate and avoids dividing by sin(~0)
+            Wa = 1.0f - t;
+            Wb = t;
+        }
+        else {
+            float Theta = std::acos(Cosine);
+            float Sine = std::sin(Theta);
+            Wa = std::sin((1.0f - t) * Theta) / Sine;
+            Wb = std::sin(t * Theta) / Sine;
+        }
+        return Quaternion(
+            Wa * a.DataW + Wb * End.DataW,
+            Wa * a.DataX + Wb * End.DataX,
+            Wa * a.DataY + Wb * End.DataY,
+            Wa * a.DataZ + Wb * End.DataZ
+        ).Normalized();
+    }
+
+    /// @brief Shows the quaternion in W/X/Y/Z format
+    inline void Show() const {
+        std::cout << "W: " << DataW << ", X: " << DataX << ", Y: " << DataY << ", Z: " << DataZ;
+    }
+};
+
+static_assert(sizeof(Quaternion) == 4 * sizeof(float) && std::is_trivially_copyable<Quaternion>::value,
+              "the batched rotation copies quaternions out as four packed floats");
+
+inline void Quaternion::Rotate(const VectorBatch3D& In, VectorBatch3D& Result) const {
+    std::size_t n = In.Size() < Result.Capacity() ? In.Size() : Result.Capacity(), i = 0;
+    Matrix<3, 3> m = ToDCM();
+    const float *ax = In.X(), *ay = In.Y(), *az = In.Z();
+    float *rx = Result.X(), *ry = Result.Y(), *rz = Result.Z();
+#ifdef ROCKET_SSE
+    __m128 M00 = _mm_set1_ps(m(0, 0)), M01 = _mm_set1_ps(m(0, 1)), M02 = _mm_set1_ps(m(0, 2));
+    __m128 M10 = _mm_set1_ps(m(1, 0)), M11 = _mm_set1_ps(m(1, 1)), M12 = _mm_set1_ps(m(1, 2));
+    __m128 M20 = _mm_set1_ps(m(2, 0)), M21 = _mm_set1_ps(m(2, 1)), M22 = _mm_set1_ps(m(2, 2));
+    for (; i + 4 <= n; i += 4) {
+        __m128 Vx = _mm_loadu_ps(ax + i), Vy = _mm_loadu_ps(ay + i), Vz = _mm_loadu_ps(az + i);
+        _mm_storeu_ps(rx + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(M00, Vx), _mm_mul_ps(M01, Vy)), _mm_mul_ps(M02, Vz)));
+        _mm_storeu_ps(ry + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(M10, Vx), _mm_mul_ps(M11, Vy)), _mm_mul_ps(M12, Vz)));
+        _mm_storeu_ps(rz + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(M20, Vx), _mm_mul_ps(M21, Vy)), _mm_mul_ps(M22, Vz)));
+    }
+#endif
+    for (; i < n; i++) {
+        float x = ax[i], y = ay[i], z = az[i];
+        rx[i] = m(0, 0) * x + m(0, 1) * y + m(0, 2) * z;
+        ry[i] = m(1, 0) * x + m(1, 1) * y + m(1, 2) * z;
+        rz[i] = m(2, 0) * x + m(2, 1) * y + m(2, 2) * z;
+    }
+    Result.Resize(n);
+    Result.SetType(In.GetType());
+}
+
+inline void Quaternion::Rotate(const Quaternion* Attitudes, const VectorBatch3D& In, VectorBatch3D& Result) {
+    std::size_t n = In.Size() < Result.Capacity() ? In.Size() : Result.Capacity(), i = 0;
+    const float *ax = In.X(), *ay = In.Y(), *az = In.Z();
+    float *rx = Result.X(), *ry = Result.Y(), *rz = Result.Z();
+#ifdef ROCKET_SSE
+    __m128 Two = _mm_set1_ps(2.0f);
+    for (; i + 4 <= n; i += 4) {
+        // Four quaternions copied out as sixteen floats (a load may not span the members of one object),
+        // then transposed into W, X, Y and Z lanes
+        float Packed[16];
+        std::memcpy(Packed, Attitudes + i, sizeof(Packed));
+        __m128 Qw = _mm_loadu_ps(Packed);
+        __m128 Qx = _mm_loadu_ps(Packed + 4);
+        __m128 Qy = _mm_loadu_ps(Packed + 8);
+        __m128 Qz = _mm_loadu_ps(Packed + 12);
+        _MM_TRANSPOSE4_PS(Qw, Qx, Qy, Qz);
+
+        __m128 Vx = _mm_loadu_ps(ax + i), Vy = _mm_loadu_ps(ay + i), Vz = _mm_loadu_ps(az + i);
+        __m128 Tx = _mm_mul_ps(Two, _mm_sub_ps(_mm_mul_ps(Qy, Vz), _mm_mul_ps(Qz, Vy)));
+        __m128 Ty = _mm_mul_ps(Two, _mm_sub_ps(_mm_mul_ps(Qz, Vx), _mm_mul_ps(Qx, Vz)));
+        __m128 Tz = _mm_mul_ps(Two, _mm_sub_ps(_mm_mul_ps(Qx, Vy), _mm_mul_ps(Qy, Vx)));
+        _mm_storeu_ps(rx + i, _mm_add_ps(_mm_add_ps(Vx, _mm_mul_ps(Qw, Tx)), _mm_sub_ps(_mm_mul_ps(Qy, Tz), _mm_mul_ps(Qz, Ty))));
+        _mm_storeu_ps(ry + i, _mm_add_ps(_mm_add_ps(Vy, _mm_mul_ps(Qw, Ty)), _mm_sub_ps(_mm_mul_ps(Qz, Tx), _mm_mul_ps(Qx, Tz))));
+        _mm_storeu_ps(rz + i, _mm_add_ps(_mm_add_ps(Vz, _mm_mul_ps(Qw, Tz)), _mm_sub_ps(_mm_mul_ps(Qx, Ty), _mm_mul_ps(Qy, Tx))));
+    }
+#endif
+    for (; i < n; i++) {
+        Vector3D v = Attitudes[i].Rotate(Vector3D(ax[i], ay[i], az[i]));
+        rx[i] = v.GetX();
+        ry[i] = v.GetY();
+        rz[i] = v.GetZ();
+    }
+    Result.Resize(n);
+    Result.SetType(In.GetType());
+}
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Physics.hpp"
 #include <chrono>
+#include <cstdint>
 
 #pragma once
 
@@ -183,10 +184,11 @@ namespace RocketSensors{
             Node* head;
             Node* tail;
             float DeadlineSeconds;
+            uint64_t StaleCount;
 
         public:
-            DeadlineStack(): head(nullptr), tail(nullptr), DeadlineSeconds(0.1) {};
-            DeadlineStack(float DeadlineSeconds): head(nullptr), tail(nullptr), DeadlineSeconds(DeadlineSeconds) {};
+            DeadlineStack(): head(nullptr), tail(nullptr), DeadlineSeconds(0.1), StaleCount(0) {};
+            DeadlineStack(float DeadlineSeconds): head(nullptr), tail(nullptr), DeadlineSeconds(DeadlineSeconds), StaleCount(0) {};
 
             /// @brief Add a 3D vector to the stack
             /// @param data the vector to insert
@@ -245,13 +247,14 @@ namespace RocketSensors{
                 return *tail;
             }
 
-            /// @brief The deadline stack allows us to discard old values based on a preset deadline,
-            /// This ensures that only recent data is passed on for further processing
-            Node* Pop() {
+            /// @brief Non-throwing variant of Pop, meant for loops that run at sensor rate
+            /// The popped node is unlinked from the stack and belongs to the caller, which deletes it when done
+            /// @return the latest node if it is within the deadline, nullptr otherwise
+            Node* TryPop() {
                 Node* result = tail;
 
                 if (!tail) {
-                    throw 0;
+                    return nullptr;
                 }
 
                 // Check if the current tail node is outdated
@@ -261,11 +264,35 @@ namespace RocketSensors{
                     < int(DeadlineSeconds * 1000)) {
 
                     tail = tail->Prev;
+                    if (!tail) {
+                        head = nullptr; // popped the last node, the next Insert starts a new list
+                    }
+                    else {
+                        tail->Next = nullptr;
+                    }
+                    result->Prev = nullptr;
 
                     return result; 
                 }
 
-                throw 0;
+                StaleCount++;
+                return nullptr;
+            }
+
+            /// @brief How many times TryPop (or Pop) found a latest sample outside the deadline window
+            /// Counted by the thread that pops; read it from that thread or once it has stopped
+            inline uint64_t GetStaleCount() const {return StaleCount;}
+
+            /// @brief The deadline stack allows us to discard old values based on a preset deadline,
+            /// This ensures that only recent data is passed on for further processing
+            Node* Pop() {
+                Node* result = TryPop();
+
+                if (!result) {
+                    throw 0;
+                }
+
+                return result;
             }
     };
 
@@ -414,6 +441,14 @@ namespace RocketSensors{
 
             return Traverse(CurrPosition->Right, TargetPosition);
         }
+
+        Sensor* Find(Sensor* Position, char Type){
+            if(!Position) {return nullptr;}
+            if(Position->getType() == Type) {return Position;}
+            Sensor* Found = Find(Position->Left, Type);
+            if(Found) {return Found;}
+            return Find(Position->Right, Type);
+        }
         public:
         
         BinarySearchTree(): Root(nullptr) {};
@@ -440,6 +475,8 @@ namespace RocketSensors{
                 }
             }
 
+            Insertion->Parent = Position;
+
             if(Position->getID() < Insertion->getID()){
                 Position->Right = Insertion;
             }
@@ -506,6 +543,8 @@ namespace RocketSensors{
                 }
             }
 
+            Insertion->Parent = Position;
+
             if(Position->getID() < Insertion->getID()){
                 Position->Right = Insertion;
             }
@@ -532,6 +571,14 @@ namespace RocketSensors{
 
         Sensor* GetRoot()
         { return Root;}
+
+        /// @brief Finds the first sensor of a given type, meant to be called once at setup so that
+        /// hot loops can hold on to the sensor's stacks directly
+        /// @param Type the sensor type to look for
+        /// @return Sensor pointer, or nullptr if no sensor of that type exists
+        Sensor* Find(char Type){
+            return Find(Root, Type);
+        }
     };
 
 
@@ -0,0 +1,338 @@
+// Trajectory integration
+// Integrates world frame acceleration into velocity and position with RK4, and pulls the result
+// back towards GPS and barometric measurements when they arrive
+
+#pragma once
+
+#include "Physics.hpp"
+#include "AHRS.hpp"
+#include <cmath>
+
+namespace RocketSensors{
+
+    /// @brief Position (m) and velocity (m/s) in the world frame of the AHRS (X magnetic north, Z up)
+    struct KinematicState{
+        RocketPhysics::Vector3D Position;
+        RocketPhysics::Vector3D Velocity;
+
+        KinematicState(): Position(0, 0, 0, 'D'), Velocity(0, 0, 0, 'V') {};
+        KinematicState(RocketPhysics::Vector3D Position, RocketPhysics::Vector3D Velocity): Position(Position), Velocity(Velocity) {};
+    };
+
+    /// @brief One classic Runge-Kutta step of dp/dt = v, dv/dt = a(t, p, v)
+    /// @param State the state at time t
+    /// @param t the time at the start of the step
+    /// @param h the step length in seconds
+    /// @param Acceleration callable (float t, const Vector3D& p, const Vector3D& v) -> Vector3D
+    /// @return the state at time t + h
+    template<typename AccelerationModel>
+    KinematicState RK4Step(const KinematicState& State, float t, float h, AccelerationModel&& Acceleration){
+        const RocketPhysics::Vector3D& p = State.Position;
+        const RocketPhysics::Vector3D& v = State.Velocity;
+        float Half = 0.5f * h;
+
+        RocketPhysics::Vector3D k1v = Acceleration(t, p, v);
+        RocketPhysics::Vector3D k1p = v;
+
+        RocketPhysics::Vector3D k2p = v + k1v * Half;
+        RocketPhysics::Vector3D k2v = Acceleration(t + Half, p + k1p * Half, k2p);
+
+        RocketPhysics::Vector3D k3p = v + k2v * Half;
+        RocketPhysics::Vector3D k3v = Acceleration(t + Half, p + k2p * Half, k3p);
+
+        RocketPhysics::Vector3D k4p = v + k3v * h;
+        RocketPhysics::Vector3D k4v = Acceleration(t + h, p + k3p * h, k4p);
+
+        float Sixth = h / 6.0f;
+        return KinematicState(
+            p + (k1p + k2p * 2.0f + k3p * 2.0f + k4p) * Sixth,
+            v + (k1v + k2v * 2.0f + k3v * 2.0f + k4v) * Sixth
+        );
+    }
+
+    /// @brief Covers [t, t + h] with RK4 steps, halving or doubling the step by comparing one full step
+    /// against two half steps (step doubling with Richardson extrapolation).
+    /// The work is bounded: after MaxAttempts steps (accepted or rejected) the rest of the interval is
+    /// finished with a single fixed RK4 step
+    /// @param Tolerance the accepted error per step, absolute near zero and relative to |p| and |v| above 1
+    /// @param MaxAttempts the most full/half step comparisons to make
+    /// @param Attempts if not null, receives the number of comparisons made
+    template<typename AccelerationModel>
+    KinematicState AdaptiveRK4Step(const KinematicState& State, float t, float h, AccelerationModel&& Acceleration,
+                                   float Tolerance, int MaxAttempts, int* Attempts=nullptr){
+        KinematicState Current = State;
+        float Time = t, End = t + h, Step = h;
+        int Taken = 0;
+
+        while(End - Time > 1e-6f * h){
+            if(Taken >= MaxAttempts){
+                Current = RK4Step(Current, Time, End - Time, Acceleration);
+                break;
+            }
+            if(Step > End - Time) {Step = End - Time;}
+            Taken++;
+
+            KinematicState Full = RK4Step(Current, Time, Step, Acceleration);
+            KinematicState HalfWay = RK4Step(Current, Time, 0.5f * Step, Acceleration);
+            KinematicState Twice = RK4Step(HalfWay, Time + 0.5f * Step, 0.5f * Step, Acceleration);
+
+            RocketPhysics::Vector3D PositionError = Twice.Position - Full.Position;
+            RocketPhysics::Vector3D VelocityError = Twice.Velocity - Full.Velocity;
+            // Mixed absolute/relative error, so float rounding far from the origin does not force tiny steps
+            float Error = std::fmax(PositionError.Magnitude() / (1.0f + Twice.Position.Magnitude()),
+                                    VelocityError.Magnitude() / (1.0f + Twice.Velocity.Magnitude()));
+
+            if(Error > Tolerance){
+                Step *= 0.5f;
+                continue;
+            }
+
+            // RK4 is fourth order, so the two half steps are 15/16 of the way from the full step to the truth
+            Current = KinematicState(Twice.Position + PositionError / 15.0f, Twice.Velocity + VelocityError / 15.0f);
+            Time += Step;
+            if(Error < Tolerance / 32.0f) {Step *= 2.0f;}
+        }
+
+        if(Attempts) {*Attempts = Taken;}
+        return Current;
+    }
+
+    /// @brief Dead reckoning from the accelerometer stream, corrected by GPS and the barometer.
+    /// Between two samples the acceleration is interpolated through the last three samples (quadratic),
+    /// so the fixed step mode takes one RK4 step per IMU sample, and the adaptive mode subdivides the
+    /// sample period where the acceleration changes quickly (ignition, burnout, deployment).
+    /// Memory use is constant
+    ///
+    /// Sensor registry types used by Bind():
+    /// 'N' GPS position (Vector3D: latitude, longitude in degrees, altitude in m),
+    /// 'K' GPS velocity (Vector3D: north, east, up in m/s)
+    class TrajectoryIntegrator{
+    public:
+        enum StepMode {FixedRK4=0, AdaptiveRK4};
+
+    private:
+        StepMode Mode;
+        KinematicState State;
+        float Time;
+
+        // The two previous acceleration samples and the period between them
+        RocketPhysics::Vector3D PreviousAcceleration;
+        RocketPhysics::Vector3D CurrentAcceleration;
+        float PreviousPeriod;
+        int SampleCount;
+
+        // Adaptive stepping
+        float Tolerance;
+        int MaxAttempts;
+        unsigned long StepCount;
+        unsigned long AttemptCount;
+
+        // Corrections
+        float GPSPositionGain, GPSVelocityGain;
+        float ReceiverVelocityGain; // pull of the velocity towards the receiver's own velocity
+        float BaroAltitudeGain, BaroVelocityGain;
+        double OriginLatitude, OriginLongitude, OriginAltitude;
+        bool HaveOrigin;
+
+        // Bound streams (cached once so Correct() never searches the tree)
+        DeadlineStack* PositionRaw;
+        DeadlineStack* VelocityRaw;
+
+        static constexpr double EarthRadius = 6371000.0; // m, same as DataLogger::Distance
+        static constexpr double DegreesToRadians = 3.14159265358979323846 / 180.0;
+
+    public:
+        /// @param Mode fixed (one RK4 step per sample) or adaptive step
+        TrajectoryIntegrator(StepMode Mode=FixedRK4):
+            Mode(Mode), State(), Time(0.0f),
+            PreviousAcceleration(0, 0, 0, 'A'), CurrentAcceleration(0, 0, 0, 'A'), PreviousPeriod(0.0f), SampleCount(0),
+            Tolerance(1e-5f), MaxAttempts(16), StepCount(0), AttemptCount(0),
+            GPSPositionGain(0.2f), GPSVelocityGain(0.05f), ReceiverVelocityGain(0.2f), BaroAltitudeGain(0.1f), BaroVelocityGain(0.02f),
+            OriginLatitude(0.0), OriginLongitude(0.0), OriginAltitude(0.0), HaveOrigin(false),
+            PositionRaw(nullptr), VelocityRaw(nullptr) {};
+
+        /// @brief Looks the GPS streams up in the sensor registry once, call this at setup
+        /// @param Sensors the sensor registry
+        /// @return true if a position stream was found
+        bool Bind(BinarySearchTree& Sensors){
+            Sensor* Found;
+            Found = Sensors.Find('N'); PositionRaw = Found ? &(Found->Raw) : nullptr;
+            Found = Sensors.Find('K'); VelocityRaw = Found ? &(Found->Raw) : nullptr;
+            return PositionRaw != nullptr;
+        }
+
+        /// @brief Applies the latest samples of the bound GPS streams, call it after Step() each period.
+        /// A stream without a sample inside its deadline is skipped. Only the horizontal part of a velocity
+        /// sample is used: the stream does not say whether the receiver measured the vertical one (RMC does not).
+        /// Popped nodes are deleted here
+        /// @return true if a position sample was applied
+        bool Correct(){
+            Node* Latest;
+            if(VelocityRaw && (Latest = VelocityRaw->TryPop())){
+                if(Latest->SelectedType == Vect_3D){
+                    CorrectVelocity(Latest->Data.Vect3D.GetX(), Latest->Data.Vect3D.GetY());
+                }
+                delete Latest;
+            }
+            if(!PositionRaw || !(Latest = PositionRaw->TryPop())){
+                return false;
+            }
+            bool Applied = Latest->SelectedType == Vect_3D;
+            if(Applied){
+                CorrectGPS(Latest->Data.Vect3D.GetX(), Latest->Data.Vect3D.GetY(), Latest->Data.Vect3D.GetZ());
+            }
+            delete Latest;
+            return Applied;
+        }
+
+        /// @brief Integrates up to a new acceleration sample
+        /// @param Acceleration world frame acceleration with gravity removed, in m/s^2
+        /// @param dt time since the previous sample in seconds
+        void Step(const RocketPhysics::Vector3D& Acceleration, float dt){
+            if(SampleCount == 0 || dt <= 0.0f){
+                // Nothing to integrate over yet
+                CurrentAcceleration = Acceleration;
+                SampleCount = SampleCount == 0 ? 1 : SampleCount;
+                return;
+            }
+
+            RocketPhysics::Vector3D a0 = PreviousAcceleration, a1 = CurrentAcceleration, a2 = Acceleration;
+            float h0 = PreviousPeriod, h1 = dt;
+            bool Quadratic = SampleCount >= 2 && h0 > 0.0f;
+
+            // Lagrange interpolation through (-h0, a0), (0, a1), (h1, a2), or linear through the last two
+            auto Model = [&](float t, const RocketPhysics::Vector3D&, const RocketPhysics::Vector3D&){
+                if(!Quadratic){
+                    return a1 + (a2 - a1) * (t / h1);
+                }
+                float L0 = t * (t - h1) / (h0 * (h0 + h1));
+                float L1 = -(t + h0) * (t - h1) / (h0 * h1);
+                float L2 = (t + h0) * t / ((h0 + h1) * h1);
+                return a0 * L0 + a1 * L1 + a2 * L2;
+            };
+
+            if(Mode == AdaptiveRK4){
+                int Attempts = 0;
+                State = AdaptiveRK4Step(State, 0.0f, dt, Model, Tolerance, MaxAttempts, &Attempts);
+                AttemptCount += Attempts;
+            }
+            else{
+                State = RK4Step(State, 0.0f, dt, Model);
+                AttemptCount++;
+            }
+
+            Time += dt;
+            StepCount++;
+            PreviousAcceleration = CurrentAcceleration;
+            CurrentAcceleration = Acceleration;
+            PreviousPeriod = dt;
+            SampleCount = 2;
+        }
+
+        /// @brief Integrates up to the AHRS's latest sample
+        /// @param Source an AHRS that has just been stepped
+        /// @param dt time since the previous sample in seconds
+        inline void Step(const AHRS& Source, float dt){
+            Step(Source.GetLinearAcceleration(), dt);
+        }
+
+        /// @brief Sets the geodetic position that world (0, 0, 0) corresponds to
+        void SetOrigin(double Latitude, double Longitude, double Altitude){
+            OriginLatitude = Latitude;
+            OriginLongitude = Longitude;
+            OriginAltitude = Altitude;
+            HaveOrigin = true;
+        }
+
+        /// @brief Converts a GPS fix into the world frame (flat earth around the origin, true north used as X)
+        RocketPhysics::Vector3D ToWorld(double Latitude, double Longitude, double Altitude) const{
+            double North = (Latitude - OriginLatitude) * DegreesToRadians * EarthRadius;
+            double East = (Longitude - OriginLongitude) * DegreesToRadians * EarthRadius * std::cos(OriginLatitude * DegreesToRadians);
+            return RocketPhysics::Vector3D(float(North), float(-East), float(Altitude - OriginAltitude), 'D');
+        }
+
+        /// @brief Converts a world frame position back into latitude, longitude and altitude
+        void ToGeodetic(const RocketPhysics::Vector3D& Position, double& Latitude, double& Longitude, double& Altitude) const{
+            Latitude = OriginLatitude + Position.GetX() / EarthRadius / DegreesToRadians;
+            Longitude = OriginLongitude - Position.GetY() / (EarthRadius * std::cos(OriginLatitude * DegreesToRadians)) / DegreesToRadians;
+            Altitude = OriginAltitude + Position.GetZ();
+        }
+
+        /// @brief Pulls the estimate towards a GPS fix.
+        /// Without an origin, the first fix becomes the origin shifted by the current estimate, so the
+        /// dead-reckoned track stays continuous
+        void CorrectGPS(double Latitude, double Longitude, double Altitude){
+            if(!HaveOrigin){
+                SetOrigin(Latitude, Longitude, Altitude);
+                ToGeodetic(RocketPhysics::Vector3D() - State.Position, OriginLatitude, OriginLongitude, OriginAltitude);
+            }
+
+            RocketPhysics::Vector3D Error = ToWorld(Latitude, Longitude, Altitude) - State.Position;
+            State.Position = State.Position + Error * GPSPositionGain;
+            State.Velocity = State.Velocity + Error * GPSVelocityGain;
+        }
+
+        /// @brief Pulls the velocity towards the receiver's ground velocity (RMC speed and course, or NAV-PVT)
+        /// @param North, East velocity in m/s
+        void CorrectVelocity(float North, float East){
+            RocketPhysics::Vector3D Error(North - State.Velocity.GetX(), -East - State.Velocity.GetY(), 0.0f, 'V');
+            State.Velocity = State.Velocity + Error * ReceiverVelocityGain;
+        }
+
+        /// @brief Pulls the velocity towards the receiver's velocity, vertical included (NAV-PVT)
+        /// @param North, East, Up velocity in m/s
+        void CorrectVelocity(float North, float East, float Up){
+            RocketPhysics::Vector3D Error(North - State.Velocity.GetX(), -East - State.Velocity.GetY(), Up - State.Velocity.GetZ(), 'V');
+            State.Velocity = State.Velocity + Error * ReceiverVelocityGain;
+        }
+
+        /// @brief Pulls the vertical channel towards a barometric altitude
+        /// @param AltitudeAboveOrigin altitude in m relative to the world origin
+        void CorrectAltitude(float AltitudeAboveOrigin){
+            float Error = AltitudeAboveOrigin - State.Position.GetZ();
+            State.Position = State.Position + RocketPhysics::Vector3D(0, 0, Error * BaroAltitudeGain);
+            State.Velocity = State.Velocity + RocketPhysics::Vector3D(0, 0, Error * BaroVelocityGain);
+        }
+
+        inline void SetMode(StepMode NewMode) {Mode = NewMode;}
+
+        /// @brief Adaptive mode settings
+        /// @param NewTolerance accepted error per step (absolute below 1 m or 1 m/s, relative above)
+        /// @param NewMaxAttempts bound on the step comparisons per sample
+        inline void SetTolerance(float NewTolerance, int NewMaxAttempts){
+            Tolerance = NewTolerance;
+            MaxAttempts = NewMaxAttempts;
+        }
+
+        /// @brief Complementary gains applied on each correction
+        inline void SetGPSGains(float PositionGain, float VelocityGain){
+            GPSPositionGain = PositionGain;
+            GPSVelocityGain = VelocityGain;
+        }
+
+        /// @brief Gain applied on each receiver velocity, by CorrectVelocity
+        inline void SetReceiverVelocityGain(float Gain) {ReceiverVelocityGain = Gain;}
+
+        inline void SetBaroGains(float AltitudeGain, float VelocityGain){
+            BaroAltitudeGain = AltitudeGain;
+            BaroVelocityGain = VelocityGain;
+        }
+
+        /// @brief Starts again from a known state (e.g. at rest on the pad)
+        void Reset(const KinematicState& Initial=KinematicState()){
+            State = Initial;
+            Time = 0.0f;
+            SampleCount = 0;
+            StepCount = AttemptCount = 0;
+        }
+
+        inline KinematicState GetState() const {return State;}
+        inline RocketPhysics::Vector3D GetPosition() const {return State.Position;}
+        inline RocketPhysics::Vector3D GetVelocity() const {return State.Velocity;}
+        inline float GetTime() const {return Time;}
+        inline bool HasOrigin() const {return HaveOrigin;}
+
+        /// @return the average number of step comparisons per sample in adaptive mode (1 in fixed mode)
+        inline float GetAttemptsPerStep() const {return StepCount ? float(AttemptCount) / StepCount : 0.0f;}
+    };
+};
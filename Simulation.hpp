@@ -0,0 +1,10 @@
+#include "./Simulation/Random.hpp"
+#include "./Simulation/Motor.hpp"
+#include "./Simulation/Environment.hpp"
+#include "./Simulation/Simulator.hpp"
+#include "./Simulation/SensorFeed.hpp"
+#include "./Simulation/GPSReceiver.hpp"
+#include "./Simulation/ClosedLoop.hpp"
+#include "./Simulation/Dispersion.hpp"
+#include "./Simulation/MonteCarlo.hpp"
+#include "./Simulation/RadioLink.hpp"
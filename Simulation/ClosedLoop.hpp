@@ -0,0 +1,232 @@
+// Closed loop flight: the simulator in place of the hardware
+// Synthetic samples go through the sensor registry streams into the AHRS, the AHRS attitude through
+// gkeepvertical and gimbal::keepvertical, the moment those two ask for through the controlAllocator, and the
+// fin and gimbal positions it settles on back into the simulator, once per control period. Parachutes go out
+// when the recoveryController fires them, on the estimated altitude and vertical velocity. A simulated
+// receiver's NAV-PVT stream goes through the GPS parser into the landing predictor
+
+#pragma once
+
+#include "Simulator.hpp"
+#include "SensorFeed.hpp"
+#include "GPSReceiver.hpp"
+#include "../Sensing/AHRS.hpp"
+#include "../Sensing/Atmosphere.hpp"
+#include "../Control/gridfins.hpp"
+#include "../Control/thrustvectoring.hpp"
+#include "../Control/allocation.hpp"
+#include "../Recovery/landing.hpp"
+#include "../config/VehicleConfig.hpp"
+#include <vector>
+#include <algorithm>
+
+namespace RocketSimulation{
+
+    /// @brief Outcome of one closed loop flight
+    struct FlightResult{
+        FlightRecord Record;
+        bool Landed;                // false if MaxTime ran out first
+        int ControlCycles;          // liftoff to the first chute
+        int SaturatedCycles;        // cycles with a fin at its limit or the gimbal clamped, liftoff to the first chute
+        float MaxFinAngle;          // degrees
+        float DrogueTime, MainTime; // s of simulated time, -1 if not deployed
+        float DrogueAltitude;       // m above the pad, true altitude at deployment
+        float DroguePredictionError; // m from the first landing prediction under the drogue to the landing, -1 if none
+        float MainPredictionError;  // m from the prediction at main deployment to the landing, -1 if none
+    };
+
+    class ClosedLoopFlight{
+    private:
+        FlightSimulator Simulator;
+        RocketSensors::BinarySearchTree Sensors; // 'G', 'A', 'M' and 'B' streams, the AHRS reads them
+        SensorFeed Feed;
+        RocketSensors::AHRS Estimator;
+        gridSystem Fins;
+        gimbal Engine;
+        controlAllocator Allocator;
+        Motor Propulsion;           // the thrust curve the flight computer was loaded with
+        std::vector<parachute> Chutes;   // never resized, Recovery points into it
+        recoveryController Recovery;
+        GPSReceiver Receiver;
+        RocketSensors::GPSParser GPS;
+        landingPredictor Landing;
+        float GimbalLimit;
+        int ApogeeChutes, MainChutes;
+
+    public:
+        float PhysicsStep;          // s
+        float ControlPeriod;        // s, a whole number of physics steps
+        float DrogueArea, MainArea; // m^2 of drag area, shared by the chutes triggered at apogee and at main
+
+        /// @param Config fins, gimbal, parachutes, recovery limits and control rate as main would build them
+        ClosedLoopFlight(const VehicleConfig& Config, const VehicleModel& Vehicle, const Motor& Motor, const Wind& Air=Wind(),
+                         const SensorNoise& Noise=SensorNoise(), uint64_t Seed=1):
+            Simulator(Vehicle, Motor, Air, Noise, Seed, 3.0f),
+            Estimator(RocketSensors::AHRS::Complementary, Config.controlRateHz),
+            Fins(Config.finCount),
+            Engine(Config.makeGimbal()),
+            Propulsion(Motor),
+            Chutes(Config.makeParachutes()),
+            Receiver(Seed ^ 0x9E3779B97F4A7C15ull),
+            Landing(Config.makeLandingPredictor()),
+            GimbalLimit(Config.gimbalLimit),
+            ApogeeChutes(0), MainChutes(0),
+            PhysicsStep(0.002f), ControlPeriod(1.0f / Config.controlRateHz),
+            DrogueArea(0.08f), MainArea(0.6f){
+            Sensors.create('G', 1.0f);
+            Sensors.create('A', 1.0f);
+            Sensors.create('M', 1.0f);
+            Sensors.create('B', 1.0f);
+            Feed.Bind(Sensors);
+            Estimator.Bind(Sensors);
+            Config.buildFins(Fins);
+            Config.configureAllocator(Allocator, Fins);
+            for(size_t i = 0; i < Fins.fins.size(); i++){
+                Simulator.SetFinLayout(int(i), Fins.fins[i].mount.left, Fins.fins[i].mount.front);
+            }
+            std::sort(Chutes.begin(), Chutes.end(), [](const parachute& a, const parachute& b){
+                return a.DeploySequence < b.DeploySequence;
+            });
+            Config.buildRecovery(Recovery, Chutes);
+            GPS.SetShared(false);
+            Landing.setPad(Receiver.PadLatitude, Receiver.PadLongitude);
+            for(int i = 0; i < Recovery.actionCount(); i++){
+                if(Recovery.action(i).trigger == PHASE_APOGEE) {ApogeeChutes++;} else {MainChutes++;}
+            }
+        }
+
+        // The estimator and the feed point into Sensors
+        ClosedLoopFlight(const ClosedLoopFlight&) = delete;
+        ClosedLoopFlight& operator=(const ClosedLoopFlight&) = delete;
+
+        inline FlightSimulator& GetSimulator() {return Simulator;}
+        inline const RocketSensors::AHRS& GetEstimator() const {return Estimator;}
+        inline const recoveryController& GetRecovery() const {return Recovery;}
+        inline GPSReceiver& GetReceiver() {return Receiver;}
+        inline const landingPredictor& GetLanding() const {return Landing;}
+
+        /// @brief Flies from the pad until landing or MaxTime seconds of simulated time
+        FlightResult Run(float MaxTime=600.0f){
+            FlightResult Result;
+            Result.Landed = false;
+            Result.ControlCycles = Result.SaturatedCycles = 0;
+            Result.MaxFinAngle = 0.0f;
+            Result.DrogueTime = Result.MainTime = -1.0f;
+            Result.DrogueAltitude = 0.0f;
+            Result.DroguePredictionError = Result.MainPredictionError = -1.0f;
+            float DrogueNorth = 0.0f, DrogueEast = 0.0f, MainNorth = 0.0f, MainEast = 0.0f;
+            uint8_t Message[128];
+
+            int StepsPerCycle = int(ControlPeriod / PhysicsStep + 0.5f);
+            if(StepsPerCycle < 1) {StepsPerCycle = 1;}
+            float dt = ControlPeriod / float(StepsPerCycle);
+
+            bool Flying = false;
+            int Fired = 0;
+
+            while(Simulator.GetTime() < MaxTime){
+                // Sense: the sample goes into the registry streams and the AHRS takes it from there,
+                // as it would from the sensor drivers
+                SensorSample s = Simulator.Sample();
+                Feed.Publish(s);
+                Estimator.Step();
+
+                // Recovery, which also decides liftoff
+                recoveryPhase Phase = Recovery.update(Simulator.GetTime(), Estimator.GetAltitude(),
+                                                      Estimator.GetVerticalVelocity(), s.Accel.Magnitude());
+                if(!Flying && Phase != PHASE_ARMED){
+                    // From here on the accelerometer reads thrust and drag, which the AHRS gate keeps out of the attitude
+                    Flying = true;
+                }
+                bool Drogue = Phase >= PHASE_DROGUE;
+                if(Fired != Recovery.firedCount()){
+                    // Every charge fired this cycle carries this cycle's time
+                    Fired = Recovery.firedCount();
+                    for(int i = 0; i < Recovery.actionCount(); i++){
+                        const deployAction& a = Recovery.action(i);
+                        if(a.firedAt != Simulator.GetTime()) {continue;}
+                        bool AtApogee = a.trigger == PHASE_APOGEE;
+                        Simulator.DeployParachute(AtApogee ? DrogueArea / float(ApogeeChutes) : MainArea / float(MainChutes));
+                        if(AtApogee && Result.DrogueTime < 0.0f){
+                            Fins.mix(0.0f, 0.0f);
+                            Result.DrogueTime = Simulator.GetTime();
+                            Result.DrogueAltitude = Simulator.GetState().Position.GetZ();
+                        }
+                        if(!AtApogee && Result.MainTime < 0.0f) {Result.MainTime = Simulator.GetTime();}
+                    }
+                }
+
+                // Landing prediction, once per fix
+                std::size_t Bytes = Receiver.Sample(Simulator.GetTime(), Simulator.GetState(), Message, sizeof(Message));
+                if(Bytes && GPS.Feed(Message, Bytes) &&
+                   Landing.update(Simulator.GetTime(), GPS.GetFix(), Estimator.GetAltitude(), Estimator.GetVerticalVelocity(), Phase)){
+                    const landingPrediction& p = Landing.prediction();
+                    if(Result.DroguePredictionError < 0.0f && Phase >= PHASE_DROGUE){
+                        DrogueNorth = p.north;
+                        DrogueEast = p.east;
+                        Result.DroguePredictionError = 0.0f;
+                    }
+                    if(Result.MainPredictionError < 0.0f && Phase >= PHASE_MAIN){
+                        MainNorth = p.north;
+                        MainEast = p.east;
+                        Result.MainPredictionError = 0.0f;
+                    }
+                }
+
+                // Control: the fins until the first chute is out, the gimbal while the accelerometer shows thrust.
+                // The two laws give the moment wanted, the allocator shares it by what each actuator can give this
+                // cycle: the gimbal with the thrust of the loaded curve, the fins with the estimated dynamic pressure
+                float Pitch = Estimator.GetPitch();
+                float Yaw = Estimator.GetYaw();
+                bool Boosting = Flying && s.Accel.GetZ() > 0.0f;
+                bool Saturated = false;
+
+                if(Flying && !Drogue){
+                    const VehicleModel& Airframe = Simulator.GetVehicle();
+                    float Thrust = Boosting ? Propulsion.Curve.Thrust(Simulator.GetTime() - Simulator.GetIgnitionTime()) : 0.0f;
+                    float Speed = Estimator.GetVerticalVelocity();
+                    float Q = 0.5f * RocketPhysics::Atmosphere::Density(Airframe.PadAltitude + Estimator.GetAltitude()) * Speed * Speed;
+                    Allocator.setEffectiveness(Fins, Thrust * Airframe.NozzleArm * DegreesToRadians, Airframe.FinMomentPerDegree * Q);
+
+                    gkeepvertical(Fins, Pitch, Yaw);
+                    if(Boosting) {Engine.keepvertical(Pitch, Yaw);}
+                    if(!Allocator.allocate(Allocator.moment(Engine, Fins), ControlPeriod)) {Saturated = true;}
+                    Allocator.apply(Engine, Fins);
+                }
+
+                // Actuate
+                for(size_t i = 0; i < Fins.fins.size(); i++){
+                    float a = Fins.fins[i].angle;
+                    Simulator.SetFinAngle(int(i), a);
+                    if(std::fabs(a) >= Fins.maxAngle) {Saturated = true;}
+                    if(std::fabs(a) > Result.MaxFinAngle) {Result.MaxFinAngle = std::fabs(a);}
+                }
+                float GimbalYaw = std::min(std::max(Engine.axis1, -GimbalLimit), GimbalLimit);
+                float GimbalPitch = std::min(std::max(Engine.axis2, -GimbalLimit), GimbalLimit);
+                if(!Simulator.SetGimbal(GimbalYaw, GimbalPitch) || GimbalYaw != Engine.axis1 || GimbalPitch != Engine.axis2){
+                    Saturated = true;
+                }
+                if(Flying && !Drogue){
+                    Result.ControlCycles++;
+                    if(Saturated) {Result.SaturatedCycles++;}
+                }
+
+                bool Airborne = true;
+                for(int i = 0; i < StepsPerCycle && Airborne; i++) {Airborne = Simulator.Step(dt);}
+                if(!Airborne){
+                    Result.Landed = true;
+                    break;
+                }
+            }
+
+            Result.Record = Simulator.GetRecord();
+            // World X is north and Y west
+            float LandingNorth = Result.Record.Landing.GetX(), LandingEast = -Result.Record.Landing.GetY();
+            if(!Result.Landed) {Result.DroguePredictionError = Result.MainPredictionError = -1.0f;}
+            if(Result.DroguePredictionError >= 0.0f) {Result.DroguePredictionError = std::hypot(DrogueNorth - LandingNorth, DrogueEast - LandingEast);}
+            if(Result.MainPredictionError >= 0.0f) {Result.MainPredictionError = std::hypot(MainNorth - LandingNorth, MainEast - LandingEast);}
+            return Result;
+        }
+    };
+
+}
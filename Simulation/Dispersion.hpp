@@ -0,0 +1,218 @@
+// Dispersed inputs and the statistics of many flights
+// DispersionModel says how far each simulator input strays from nominal; Draw() turns one random stream into one
+// set of inputs. Summarise() reduces the outcomes of a batch of flights to the apogee distribution, the landing
+// footprint and how often the control surfaces ran out of authority
+
+#pragma once
+
+#include "Simulator.hpp"
+#include "../scheduler/Executive.hpp"
+#include <vector>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+#include <cmath>
+
+namespace RocketSimulation{
+
+    /// @brief One sigma spreads around the nominal vehicle, motor, wind and sensors
+    struct DispersionModel{
+        float ImpulseSigma;        // fraction of the nominal thrust curve, motor to motor
+        float MassSigma;           // fraction of the dry mass
+        float WindSpeed;           // m/s at the reference height, mean
+        float WindSpeedSigma;      // m/s, the draw is clamped at zero
+        float WindDirection;       // rad, mean, the way the wind blows to
+        float WindDirectionSigma;  // rad
+        float GustFraction;        // gust amplitude as a fraction of the drawn mean wind
+        float RailTiltSigma;       // degrees, on each of the launch pitch and yaw
+        float NoiseScaleSigma;     // fraction, one factor applied to every sensor noise term
+
+        DispersionModel():
+            ImpulseSigma(0.03f), MassSigma(0.02f), WindSpeed(4.0f), WindSpeedSigma(2.0f),
+            WindDirection(0.0f), WindDirectionSigma(0.5f), GustFraction(0.3f), RailTiltSigma(0.5f),
+            NoiseScaleSigma(0.2f) {};
+
+        /// @brief Every spread zero and no wind: each draw is the nominal flight
+        static DispersionModel None(){
+            DispersionModel d;
+            d.ImpulseSigma = d.MassSigma = d.WindSpeed = d.WindSpeedSigma = d.WindDirectionSigma = 0.0f;
+            d.GustFraction = d.RailTiltSigma = d.NoiseScaleSigma = 0.0f;
+            return d;
+        }
+    };
+
+    /// @brief The inputs of one dispersed flight
+    struct DispersedInputs{
+        VehicleModel Vehicle;
+        Motor Engine;
+        Wind Air;
+        SensorNoise Noise;
+        uint64_t SimulatorSeed;    // for the sensor noise inside FlightSimulator
+    };
+
+    /// @brief Draws one set of inputs; the same generator state always gives the same inputs
+    inline DispersedInputs Draw(const DispersionModel& Model, Random& Generator, const VehicleModel& Vehicle,
+                                const Motor& Engine, const SensorNoise& Noise){
+        DispersedInputs In;
+        In.Vehicle = Vehicle;
+        In.Engine = Engine;
+        In.Noise = Noise;
+
+        In.Engine.Curve.Scale(std::max(0.0f, Generator.Gaussian(1.0f, Model.ImpulseSigma)));
+        In.Vehicle.DryMass *= std::max(0.5f, Generator.Gaussian(1.0f, Model.MassSigma));
+        In.Vehicle.LaunchPitch += Generator.Gaussian(0.0f, Model.RailTiltSigma);
+        In.Vehicle.LaunchYaw += Generator.Gaussian(0.0f, Model.RailTiltSigma);
+
+        float Speed = std::max(0.0f, Generator.Gaussian(Model.WindSpeed, Model.WindSpeedSigma));
+        In.Air = Wind(Speed, Generator.Gaussian(Model.WindDirection, Model.WindDirectionSigma));
+        In.Air.RandomiseGusts(Generator, Model.GustFraction);
+
+        float NoiseScale = std::max(0.0f, Generator.Gaussian(1.0f, Model.NoiseScaleSigma));
+        In.Noise.Gyro *= NoiseScale;
+        In.Noise.GyroBias *= NoiseScale;
+        In.Noise.Accel *= NoiseScale;
+        In.Noise.Mag *= NoiseScale;
+        In.Noise.Pressure *= NoiseScale;
+
+        In.SimulatorSeed = Generator.Next();
+        return In;
+    }
+
+    /// @brief What one dispersed flight is reduced to
+    struct FlightOutcome{
+        bool Landed;
+        float Apogee;              // m above the pad
+        float LandingX, LandingY;  // m from the pad, world frame
+        float LandingSpeed;        // m/s
+        float SaturationFraction;  // saturated control cycles over control cycles, liftoff to the first chute
+        float MaxFinAngle;         // degrees
+        float PredictionError;     // m from the landing prediction at main deployment to the landing, -1 if none
+    };
+
+    /// @brief Mean, spread and percentiles of one quantity over a batch
+    struct Distribution{
+        int Count;
+        float Mean, Sigma, Min, Max;
+        float P05, P50, P95;
+
+        /// @brief Percentiles interpolate between ranks; Values is reordered
+        static Distribution Of(std::vector<float>& Values){
+            Distribution d;
+            d.Count = int(Values.size());
+            d.Mean = d.Sigma = d.Min = d.Max = d.P05 = d.P50 = d.P95 = 0.0f;
+            if(Values.empty()) {return d;}
+
+            std::sort(Values.begin(), Values.end());
+            double Sum = 0.0, SumSquares = 0.0;
+            for(float v : Values) {Sum += v; SumSquares += double(v) * v;}
+            double Mean = Sum / d.Count;
+            d.Mean = float(Mean);
+            d.Sigma = d.Count > 1 ? float(std::sqrt(std::max(0.0, (SumSquares - Sum * Mean) / (d.Count - 1)))) : 0.0f;
+            d.Min = Values.front();
+            d.Max = Values.back();
+            d.P05 = Percentile(Values, 0.05f);
+            d.P50 = Percentile(Values, 0.50f);
+            d.P95 = Percentile(Values, 0.95f);
+            return d;
+        }
+
+        /// @param Sorted ascending, not empty
+        static float Percentile(const std::vector<float>& Sorted, float Fraction){
+            float Rank = Fraction * float(Sorted.size() - 1);
+            std::size_t i = std::size_t(Rank);
+            if(i + 1 >= Sorted.size()) {return Sorted.back();}
+            return Sorted[i] + (Rank - float(i)) * (Sorted[i + 1] - Sorted[i]);
+        }
+    };
+
+    /// @brief Where the landed flights came down
+    struct LandingFootprint{
+        float MeanX, MeanY;        // m from the pad
+        float SigmaX, SigmaY;      // m
+        float CEP50, CEP95;        // m, radius about the mean point holding half / 95 % of the landings
+        float Farthest;            // m from the pad
+    };
+
+    /// @brief Statistics of a batch of flights
+    struct DispersionSummary{
+        int Flights, Landed;
+        int SaturatedFlights;      // flights with at least one saturated control cycle
+        Distribution Apogee;
+        Distribution LandingSpeed;
+        Distribution Saturation;   // of FlightOutcome::SaturationFraction
+        Distribution MaxFinAngle;
+        Distribution PredictionError; // of the flights with a prediction at main deployment
+        LandingFootprint Landing;
+
+        void Report(std::ostream& Out) const{
+            StreamStateGuard Restore(Out);
+            Out << std::fixed << std::setprecision(1);
+            Out << "  flights " << Flights << ", landed " << Landed << std::endl;
+            Out << "  apogee        mean " << Apogee.Mean << " m, sigma " << Apogee.Sigma << ", 5% " << Apogee.P05
+                << ", 50% " << Apogee.P50 << ", 95% " << Apogee.P95 << " (" << Apogee.Min << " to " << Apogee.Max << ")" << std::endl;
+            Out << "  landing       mean (" << Landing.MeanX << ", " << Landing.MeanY << ") m, sigma (" << Landing.SigmaX
+                << ", " << Landing.SigmaY << "), CEP50 " << Landing.CEP50 << " m, CEP95 " << Landing.CEP95
+                << " m, farthest " << Landing.Farthest << " m" << std::endl;
+            Out << "  touchdown     mean " << LandingSpeed.Mean << " m/s, 95% " << LandingSpeed.P95 << " m/s" << std::endl;
+            Out << "  saturation    " << SaturatedFlights << " flights saturated, mean " << 100.0f * Saturation.Mean
+                << "% of cycles, 95% " << 100.0f * Saturation.P95 << "%, max fin " << MaxFinAngle.Max << " deg" << std::endl;
+            if(PredictionError.Count){
+                Out << "  prediction    at main deployment, error mean " << PredictionError.Mean << " m, 95% " << PredictionError.P95
+                    << " m, max " << PredictionError.Max << " m (" << PredictionError.Count << " flights)" << std::endl;
+            }
+        }
+    };
+
+    /// @brief Reduces a batch of outcomes; the landing footprint and touchdown speed count landed flights only
+    inline DispersionSummary Summarise(const std::vector<FlightOutcome>& Outcomes){
+        DispersionSummary s;
+        s.Flights = int(Outcomes.size());
+        s.Landed = s.SaturatedFlights = 0;
+
+        std::vector<float> Apogees, Speeds, Saturations, FinAngles, Xs, Ys, Errors;
+        Apogees.reserve(Outcomes.size());
+        Saturations.reserve(Outcomes.size());
+        FinAngles.reserve(Outcomes.size());
+        for(const FlightOutcome& o : Outcomes){
+            Apogees.push_back(o.Apogee);
+            Saturations.push_back(o.SaturationFraction);
+            FinAngles.push_back(o.MaxFinAngle);
+            if(o.SaturationFraction > 0.0f) {s.SaturatedFlights++;}
+            if(o.Landed){
+                s.Landed++;
+                Speeds.push_back(o.LandingSpeed);
+                Xs.push_back(o.LandingX);
+                Ys.push_back(o.LandingY);
+                if(o.PredictionError >= 0.0f) {Errors.push_back(o.PredictionError);}
+            }
+        }
+
+        LandingFootprint& f = s.Landing;
+        f.MeanX = f.MeanY = f.SigmaX = f.SigmaY = f.CEP50 = f.CEP95 = f.Farthest = 0.0f;
+        if(!Xs.empty()){
+            std::vector<float> Radii(Xs.size());
+            for(std::size_t i = 0; i < Xs.size(); i++) {f.Farthest = std::max(f.Farthest, std::hypot(Xs[i], Ys[i]));}
+            Distribution X = Distribution::Of(Xs), Y = Distribution::Of(Ys);
+            f.MeanX = X.Mean;
+            f.MeanY = Y.Mean;
+            f.SigmaX = X.Sigma;
+            f.SigmaY = Y.Sigma;
+            // Xs and Ys are sorted now, so the radii come from the outcomes again
+            std::size_t k = 0;
+            for(const FlightOutcome& o : Outcomes){
+                if(o.Landed) {Radii[k++] = std::hypot(o.LandingX - f.MeanX, o.LandingY - f.MeanY);}
+            }
+            std::sort(Radii.begin(), Radii.end());
+            f.CEP50 = Distribution::Percentile(Radii, 0.50f);
+            f.CEP95 = Distribution::Percentile(Radii, 0.95f);
+        }
+
+        s.Apogee = Distribution::Of(Apogees);
+        s.LandingSpeed = Distribution::Of(Speeds);
+        s.Saturation = Distribution::Of(Saturations);
+        s.MaxFinAngle = Distribution::Of(FinAngles);
+        s.PredictionError = Distribution::Of(Errors);
+        return s;
+    }
+
+}
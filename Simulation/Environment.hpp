@@ -0,0 +1,72 @@
+// Wind model for the simulator
+// A mean wind growing with height (power law shear) plus a few sinusoidal gusts. It is a pure function of
+// height and time, so every RK4 stage sees the same field and a run is reproducible from its parameters
+
+#pragma once
+
+#include "../Sensing/Physics.hpp"
+#include "Random.hpp"
+#include <cmath>
+
+namespace RocketSimulation{
+
+    class Wind{
+    public:
+        static constexpr int Gusts = 3;
+
+        float ReferenceSpeed;    // m/s at ReferenceHeight
+        float ReferenceHeight;   // m above the pad
+        float Direction;         // radians from world X (magnetic north) towards world Y, the way the wind blows to
+        float ShearExponent;     // 1/7 over open ground
+        float GustAmplitude[Gusts];  // m/s
+        float GustFrequency[Gusts];  // rad/s
+        float GustPhase[Gusts];      // rad
+        float GustDirection[Gusts];  // rad, like Direction
+
+        /// @brief Calm air
+        Wind(): ReferenceSpeed(0.0f), ReferenceHeight(10.0f), Direction(0.0f), ShearExponent(1.0f / 7.0f){
+            for(int i = 0; i < Gusts; i++){
+                GustAmplitude[i] = 0.0f;
+                GustFrequency[i] = 1.0f;
+                GustPhase[i] = 0.0f;
+                GustDirection[i] = 0.0f;
+            }
+        };
+
+        /// @brief Steady wind with the usual shear and no gusts
+        Wind(float Speed, float DirectionRadians): Wind(){
+            ReferenceSpeed = Speed;
+            Direction = DirectionRadians;
+        }
+
+        /// @brief Draws the gust phases and directions, keeping their amplitudes at GustFraction of the mean
+        /// wind spread over periods of about 1 to 10 s
+        void RandomiseGusts(Random& Generator, float GustFraction){
+            for(int i = 0; i < Gusts; i++){
+                GustAmplitude[i] = GustFraction * ReferenceSpeed / float(Gusts);
+                GustFrequency[i] = 6.2831853f / Generator.Uniform(1.0f, 10.0f);
+                GustPhase[i] = Generator.Uniform(0.0f, 6.2831853f);
+                GustDirection[i] = Direction + Generator.Gaussian(0.0f, 0.5f);
+            }
+        }
+
+        /// @brief Air velocity in the world frame (m/s)
+        /// @param Height metres above the pad, the wind is zero at and below the ground
+        /// @param Time seconds since the start of the run
+        RocketPhysics::Vector3D At(float Height, float Time) const{
+            if(Height <= 0.0f || ReferenceSpeed == 0.0f) {return RocketPhysics::Vector3D(0.0f, 0.0f, 0.0f, 'V');}
+
+            float Speed = ReferenceSpeed * std::pow(Height / ReferenceHeight, ShearExponent);
+            float x = Speed * std::cos(Direction);
+            float y = Speed * std::sin(Direction);
+            for(int i = 0; i < Gusts; i++){
+                if(GustAmplitude[i] == 0.0f) {continue;}
+                float g = GustAmplitude[i] * std::sin(GustFrequency[i] * Time + GustPhase[i]);
+                x += g * std::cos(GustDirection[i]);
+                y += g * std::sin(GustDirection[i]);
+            }
+            return RocketPhysics::Vector3D(x, y, 0.0f, 'V');
+        }
+    };
+
+}
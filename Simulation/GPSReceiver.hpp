@@ -0,0 +1,61 @@
+// Simulated GPS receiver
+// Turns the true state into the UBX NAV-PVT stream a u-blox receiver would send at its navigation rate, with
+// white position and velocity noise, so code downstream of RocketSensors::GPSParser runs on the same bytes in
+// simulation as in flight. World X is north and Y west, as in TrajectoryIntegrator
+
+#pragma once
+
+#include "Random.hpp"
+#include "Simulator.hpp"
+#include "../Sensing/GPS.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+namespace RocketSimulation{
+
+    class GPSReceiver{
+    private:
+        Random Generator;
+        float NextFix;
+
+    public:
+        double PadLatitude, PadLongitude;  // degrees, world origin
+        float PadAltitude;                 // m above mean sea level
+        float Period;                      // s between fixes
+        float PositionSigma;               // m, each horizontal axis and altitude
+        float VelocitySigma;               // m/s, each axis
+        int Satellites;
+
+        GPSReceiver(uint64_t Seed=1, float RateHz=10.0f):
+            Generator(Seed), NextFix(0.0f), PadLatitude(34.0691), PadLongitude(72.6441), PadAltitude(350.0f),
+            Period(1.0f / RateHz), PositionSigma(1.5f), VelocitySigma(0.1f), Satellites(24) {};
+
+        /// @brief Writes a NAV-PVT message into Out when a fix is due at Time
+        /// @return the message length, 0 if no fix is due (or Size is too small)
+        std::size_t Sample(float Time, const RigidBodyState& State, uint8_t* Out, std::size_t Size){
+            if(Time < NextFix) {return 0;}
+            NextFix += Period;
+            if(NextFix <= Time) {NextFix = Time + Period;}
+
+            const double Metres = 6371000.0 * 3.14159265358979323846 / 180.0;
+            float North = State.Position.GetX() + Generator.Gaussian(0.0f, PositionSigma);
+            float West = State.Position.GetY() + Generator.Gaussian(0.0f, PositionSigma);
+
+            RocketSensors::GPSFix Fix;
+            Fix.Valid = true;
+            Fix.TimeOfDay = uint32_t(std::lround(double(Time) * 1000.0)) % 86400000;
+            Fix.Latitude = PadLatitude + North / Metres;
+            Fix.Longitude = PadLongitude - West / (Metres * std::cos(PadLatitude * 3.14159265358979323846 / 180.0));
+            Fix.Altitude = PadAltitude + State.Position.GetZ() + Generator.Gaussian(0.0f, PositionSigma);
+            Fix.VelocityNorth = State.Velocity.GetX() + Generator.Gaussian(0.0f, VelocitySigma);
+            Fix.VelocityEast = -State.Velocity.GetY() + Generator.Gaussian(0.0f, VelocitySigma);
+            Fix.VelocityUp = State.Velocity.GetZ() + Generator.Gaussian(0.0f, VelocitySigma);
+            Fix.Satellites = Satellites;
+            Fix.DOP = 1.0f;
+            Fix.HorizontalAccuracy = PositionSigma;
+            return RocketSensors::EncodeNavPvt(Fix, Out, Size);
+        }
+    };
+
+}
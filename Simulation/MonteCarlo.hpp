@@ -0,0 +1,76 @@
+// Monte Carlo dispersion runner
+// Flies many dispersed ClosedLoopFlight instances on a WorkStealingPool. A flight shares nothing with the others:
+// it builds its own fins, gimbal, parachutes, estimator and simulator, and draws everything random from its own
+// stream, seeded from the base seed and its run index alone. The outcomes are therefore the same for any number
+// of threads and any scheduling, and one flight can be flown again on its own from its index
+
+#pragma once
+
+#include "ClosedLoop.hpp"
+#include "Dispersion.hpp"
+#include "../scheduler/WorkStealingPool.hpp"
+#include <vector>
+#include <chrono>
+
+namespace RocketSimulation{
+
+    /// @brief Seed of run Index: output Index of a SplitMix64 sequence started at Base, so nearby runs get
+    /// unrelated streams
+    inline uint64_t StreamSeed(uint64_t Base, uint64_t Index){
+        uint64_t State = Base + Index * 0x9E3779B97F4A7C15ull;
+        return SplitMix64(State);
+    }
+
+    class MonteCarloRunner{
+    private:
+        VehicleConfig Config;
+        VehicleModel Vehicle;
+        Motor Engine;
+        SensorNoise Noise;
+
+    public:
+        DispersionModel Dispersion;
+        float MaxTime;             // s of simulated time per flight
+
+        MonteCarloRunner(const VehicleConfig& Config, const VehicleModel& Vehicle, const Motor& Engine,
+                         const DispersionModel& Dispersion=DispersionModel(), const SensorNoise& Noise=SensorNoise()):
+            Config(Config), Vehicle(Vehicle), Engine(Engine), Noise(Noise), Dispersion(Dispersion), MaxTime(600.0f) {};
+
+        /// @brief Flies one dispersed flight; safe to call from several threads at once
+        FlightOutcome Fly(uint64_t Seed) const{
+            Random Generator(Seed);
+            DispersedInputs In = Draw(Dispersion, Generator, Vehicle, Engine, Noise);
+            ClosedLoopFlight Flight(Config, In.Vehicle, In.Engine, In.Air, In.Noise, In.SimulatorSeed);
+            FlightResult r = Flight.Run(MaxTime);
+
+            FlightOutcome o;
+            o.Landed = r.Landed;
+            o.Apogee = r.Record.Apogee;
+            o.LandingX = r.Record.Landing.GetX();
+            o.LandingY = r.Record.Landing.GetY();
+            o.LandingSpeed = r.Record.LandingSpeed;
+            o.SaturationFraction = r.ControlCycles > 0 ? float(r.SaturatedCycles) / float(r.ControlCycles) : 0.0f;
+            o.MaxFinAngle = r.MaxFinAngle;
+            o.PredictionError = r.MainPredictionError;
+            return o;
+        }
+
+        /// @brief Flies Flights dispersed flights on Pool, one task each
+        /// @return outcome i belongs to run i, seeded with StreamSeed(BaseSeed, i)
+        std::vector<FlightOutcome> Run(int Flights, uint64_t BaseSeed, WorkStealingPool& Pool) const{
+            std::vector<FlightOutcome> Outcomes(Flights > 0 ? Flights : 0);
+            Pool.parallelFor(Outcomes.size(), 1, [&](std::size_t i){
+                Outcomes[i] = Fly(StreamSeed(BaseSeed, i));
+            });
+            return Outcomes;
+        }
+
+        /// @brief The same flights on the calling thread, for comparison and for debugging one run
+        std::vector<FlightOutcome> RunSerial(int Flights, uint64_t BaseSeed) const{
+            std::vector<FlightOutcome> Outcomes(Flights > 0 ? Flights : 0);
+            for(std::size_t i = 0; i < Outcomes.size(); i++) {Outcomes[i] = Fly(StreamSeed(BaseSeed, i));}
+            return Outcomes;
+        }
+    };
+
+}
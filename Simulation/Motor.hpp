@@ -0,0 +1,100 @@
+// Rocket motor model for the simulator
+// A thrust curve sampled at a few points, with the propellant mass burnt in proportion to the
+// impulse delivered so far
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace RocketSimulation{
+
+    /// @brief Thrust (N) against time since ignition (s), linear between points and zero outside them
+    class ThrustCurve{
+    private:
+        std::vector<float> Times;
+        std::vector<float> Thrusts;
+        std::vector<float> Impulses;   // impulse delivered up to each point, N s
+        mutable std::size_t Cursor;    // segment of the last lookup, time only moves a little between calls
+
+        inline std::size_t Segment(float t) const{
+            while(Cursor + 2 < Times.size() && t >= Times[Cursor + 1]) {Cursor++;}
+            while(Cursor > 0 && t < Times[Cursor]) {Cursor--;}
+            return Cursor;
+        }
+
+    public:
+        ThrustCurve(): Cursor(0) {};
+
+        /// @brief Appends a point, times must increase
+        /// @return false if t is not after the previous point or the thrust is negative
+        bool AddPoint(float t, float Thrust){
+            if(Thrust < 0.0f || (!Times.empty() && t <= Times.back())) {return false;}
+            float Impulse = Times.empty() ? 0.0f : Impulses.back() + 0.5f * (Thrusts.back() + Thrust) * (t - Times.back());
+            Times.push_back(t);
+            Thrusts.push_back(Thrust);
+            Impulses.push_back(Impulse);
+            return true;
+        }
+
+        /// @brief Multiplies every thrust by Factor, e.g. for motor to motor spread
+        void Scale(float Factor){
+            for(std::size_t i = 0; i < Thrusts.size(); i++){
+                Thrusts[i] *= Factor;
+                Impulses[i] *= Factor;
+            }
+        }
+
+        float Thrust(float t) const{
+            if(Times.size() < 2 || t < Times.front() || t >= Times.back()) {return 0.0f;}
+            std::size_t i = Segment(t);
+            float f = (t - Times[i]) / (Times[i + 1] - Times[i]);
+            return Thrusts[i] + f * (Thrusts[i + 1] - Thrusts[i]);
+        }
+
+        /// @brief Impulse delivered from ignition up to t, N s
+        float Impulse(float t) const{
+            if(Times.size() < 2 || t <= Times.front()) {return 0.0f;}
+            if(t >= Times.back()) {return Impulses.back();}
+            std::size_t i = Segment(t);
+            float dt = t - Times[i];
+            float f = dt / (Times[i + 1] - Times[i]);
+            float ThrustAtT = Thrusts[i] + f * (Thrusts[i + 1] - Thrusts[i]);
+            return Impulses[i] + 0.5f * (Thrusts[i] + ThrustAtT) * dt;
+        }
+
+        inline float TotalImpulse() const {return Impulses.empty() ? 0.0f : Impulses.back();}
+        inline float BurnTime() const {return Times.empty() ? 0.0f : Times.back();}
+        inline std::size_t Points() const {return Times.size();}
+    };
+
+    /// @brief A motor: its thrust curve and masses
+    struct Motor{
+        ThrustCurve Curve;
+        float PropellantMass;  // kg
+        float CaseMass;        // kg, stays with the vehicle after burnout
+
+        Motor(): PropellantMass(0.0f), CaseMass(0.0f) {};
+
+        /// @brief Propellant left at time t since ignition
+        inline float PropellantRemaining(float t) const{
+            float Total = Curve.TotalImpulse();
+            if(Total <= 0.0f) {return PropellantMass;}
+            return PropellantMass * (1.0f - Curve.Impulse(t) / Total);
+        }
+
+        /// @brief A G class reloadable, about 110 N s over 1.6 s; the default motor of the examples
+        static Motor Example(){
+            Motor m;
+            const float Points[][2] = {
+                {0.00f, 0.0f}, {0.05f, 95.0f}, {0.10f, 102.0f}, {0.30f, 88.0f}, {0.60f, 78.0f},
+                {0.90f, 72.0f}, {1.20f, 64.0f}, {1.40f, 48.0f}, {1.55f, 18.0f}, {1.65f, 0.0f}
+            };
+            for(const auto& p : Points) {m.Curve.AddPoint(p[0], p[1]);}
+            m.PropellantMass = 0.060f;
+            m.CaseMass = 0.070f;
+            return m;
+        }
+    };
+
+}
@@ -0,0 +1,303 @@
+// Simulated telemetry radio
+// A loopback stand-in for the downlink radio, so the telemetry stack can be tuned without hardware: packets
+// handed to RadioChannel come out of it later, in arrival order, after what a real link does to them. FlyLink
+// runs a whole downlink through it in simulated time, the flight's TelemetryScheduler and FecEncoder on one
+// end and a GroundStation on the other. Every channel owns its random stream, so a report is reproducible
+// from its seed
+
+#pragma once
+
+#include "Random.hpp"
+#include "../telemetry/FlightMessages.hpp"
+#include "../telemetry/TelemetryScheduler.hpp"
+#include "../telemetry/FecLink.hpp"
+#include "../telemetry/GroundStation.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+namespace RocketSimulation{
+
+    /// @brief What the channel does to the packets it carries. One packet is one Send(), one wire frame
+    struct RadioSettings{
+        double Bandwidth;       // bytes/s on air, a packet waits for the ones before it to go out
+        double Latency;         // s from the end of a packet on air to its delivery
+        double BitErrorRate;    // independent bit flips
+        double FadeRate;        // fades per second, starting at random
+        double FadeSeconds;     // mean fade length; bytes on air during a fade arrive as noise
+        double ReorderRate;     // fraction of packets held back
+        double ReorderDelay;    // s a held back packet arrives late, at most, uniform
+
+        RadioSettings():
+            Bandwidth(960.0), Latency(0.05), BitErrorRate(0.0), FadeRate(0.0), FadeSeconds(0.1),
+            ReorderRate(0.0), ReorderDelay(0.2) {};
+    };
+
+    struct RadioStats{
+        uint64_t Packets;
+        uint64_t Bytes;
+        uint64_t Flipped;       // bits flipped by noise
+        uint64_t Faded;         // bytes lost to fades
+        uint64_t Reordered;     // packets held back
+        double Queued;          // s the longest wait for the air
+
+        RadioStats(): Packets(0), Bytes(0), Flipped(0), Faded(0), Reordered(0), Queued(0.0) {};
+    };
+
+    class RadioChannel{
+    private:
+        struct Packet{
+            double Arrival;
+            uint64_t Order;
+            std::vector<uint8_t> Bytes;
+        };
+
+        // earliest arrival on top, packets arriving together in the order sent
+        struct Later{
+            bool operator()(const Packet& a, const Packet& b) const{
+                return a.Arrival > b.Arrival || (a.Arrival == b.Arrival && a.Order > b.Order);
+            }
+        };
+
+        RadioSettings Settings;
+        Random Generator;
+        std::vector<Packet> InFlight;
+        RadioStats Counters;
+        double OnAirUntil;
+        double FadeStart, FadeEnd;
+        double NextFlip;        // bits to the next flipped one
+
+        double Exponential(double Mean) {return -Mean * std::log(1.0 - double(Generator.Uniform()));}
+
+        void NextFade(){
+            FadeStart = FadeEnd + (Settings.FadeRate > 0.0 ? Exponential(1.0 / Settings.FadeRate) : 1e300);
+            FadeEnd = FadeStart + Exponential(Settings.FadeSeconds);
+        }
+
+        // Noise on the bytes of a packet, on air from Start at Bandwidth
+        void Corrupt(std::vector<uint8_t>& Bytes, double Start){
+            double ByteTime = 1.0 / Settings.Bandwidth;
+            for(std::size_t i = 0; i < Bytes.size(); i++){
+                double t = Start + double(i) * ByteTime;
+                while(t >= FadeEnd) {NextFade();}
+                if(t >= FadeStart){
+                    Bytes[i] = uint8_t(Generator.Next());
+                    Counters.Faded++;
+                }
+            }
+            if(Settings.BitErrorRate <= 0.0) {return;}
+            // the gaps between flipped bits are geometric, so clean bytes cost nothing
+            double Bits = double(Bytes.size()) * 8.0;
+            for(; NextFlip < Bits; NextFlip += 1.0 + std::floor(Exponential(1.0 / Settings.BitErrorRate))){
+                Bytes[std::size_t(NextFlip) / 8] ^= uint8_t(1u << (std::size_t(NextFlip) % 8));
+                Counters.Flipped++;
+            }
+            NextFlip -= Bits;
+        }
+
+    public:
+        RadioChannel(const RadioSettings& Radio, uint64_t Seed=1):
+            Settings(Radio), Generator(Seed), OnAirUntil(0.0), FadeStart(0.0), FadeEnd(0.0), NextFlip(0.0){
+            NextFade();
+            if(Settings.BitErrorRate > 0.0) {NextFlip = std::floor(Exponential(1.0 / Settings.BitErrorRate));}
+        };
+
+        const RadioSettings& GetSettings() const {return Settings;}
+        const RadioStats& GetStats() const {return Counters;}
+        std::size_t Pending() const {return InFlight.size();}
+
+        /// @brief Hands a packet to the radio at Time
+        /// @return the time it arrives
+        double Send(double Time, const uint8_t* Bytes, std::size_t Length){
+            Packet p;
+            p.Bytes.assign(Bytes, Bytes + Length);
+            double Start = std::max(Time, OnAirUntil);
+            Counters.Queued = std::max(Counters.Queued, Start - Time);
+            OnAirUntil = Start + double(Length) / Settings.Bandwidth;
+            Corrupt(p.Bytes, Start);
+            p.Arrival = OnAirUntil + Settings.Latency;
+            if(Settings.ReorderRate > 0.0 && Generator.Uniform() < Settings.ReorderRate){
+                p.Arrival += Settings.ReorderDelay * Generator.Uniform();
+                Counters.Reordered++;
+            }
+            double Arrival = p.Arrival;
+            p.Order = Counters.Packets++;
+            Counters.Bytes += Length;
+            InFlight.push_back(std::move(p));
+            std::push_heap(InFlight.begin(), InFlight.end(), Later());
+            return Arrival;
+        }
+
+        /// @brief Delivers every packet arrived by Time, in order of arrival, as Deliver(Arrival, Bytes, Length)
+        /// @return the packets delivered
+        template <typename F>
+        std::size_t Receive(double Time, F Deliver){
+            std::size_t Count = 0;
+            while(!InFlight.empty() && InFlight.front().Arrival <= Time){
+                std::pop_heap(InFlight.begin(), InFlight.end(), Later());
+                Packet p = std::move(InFlight.back());
+                InFlight.pop_back();
+                Deliver(p.Arrival, static_cast<const uint8_t*>(p.Bytes.data()), p.Bytes.size());
+                Count++;
+            }
+            return Count;
+        }
+    };
+
+    /// @brief The downlink FlyLink sends, by default the streams of vehicle.ini
+    struct LinkSettings{
+        double Duration;        // s of samples offered
+        double Budget;          // bytes/s the scheduler may send, FEC included; 0 for the radio's bandwidth
+        double SampleRate;      // Hz, samples offered and the scheduler polled, as the control loop does
+        TelemetryCheck Check;
+        int MaxFrame;           // bytes before stuffing
+        double MaxLatency;      // s a sample may wait for its frame to fill
+        int FecData;            // telemetry frames per FEC block, 0 for no FEC
+        int FecParity;
+        int Jitter;             // frames the ground station lets one arrive out of order
+        double AttitudeRate, GPSRate, LogRate, HousekeepingRate;  // Hz
+
+        LinkSettings():
+            Duration(60.0), Budget(0.0), SampleRate(100.0), Check(CHECK_CRC16), MaxFrame(int(TELEMETRY_MAX_FRAME)), MaxLatency(0.1),
+            FecData(0), FecParity(0), Jitter(8), AttitudeRate(50.0), GPSRate(5.0), LogRate(10.0), HousekeepingRate(1.0) {};
+    };
+
+    struct LinkReport{
+        uint64_t Sent;          // samples the scheduler put into frames
+        uint64_t Received;      // samples the ground station decoded
+        double Recovered;       // Received / Sent
+        double Goodput;         // bytes/s of samples received, as packed in the frames, until the queues drained
+        double WireRate;        // bytes/s on air over the same time, parity and framing included
+        double LatencyP50, LatencyP90, LatencyP99, LatencyMax;  // s from the sample to its decoding on the ground
+        int EventsSent, EventsReceived;
+        uint64_t Gaps, Missing; // runs of telemetry frames the ground station gave up on, and the frames in them
+        RadioStats Radio;
+        GroundStats Ground;
+
+        LinkReport():
+            Sent(0), Received(0), Recovered(0.0), Goodput(0.0), WireRate(0.0), LatencyP50(0.0), LatencyP90(0.0),
+            LatencyP99(0.0), LatencyMax(0.0), EventsSent(0), EventsReceived(0), Gaps(0), Missing(0) {};
+    };
+
+    /// @brief When a sample was taken, for its latency to the ground
+    inline double SampleTime(const Logs& l) {return l.timestamp;}
+    inline double SampleTime(const FlightEvent& e) {return e.time;}
+    inline double SampleTime(const AttitudeSample& a) {return a.time;}
+    inline double SampleTime(const RocketSensors::GPSFix& f) {return f.TimeOfDay / 1000.0;}
+    inline double SampleTime(const HousekeepingSample& h) {return h.time;}
+
+    /// @brief Flies a downlink in simulated time: samples of every stream offered at SampleRate, the scheduler
+    /// polled as often and its frames (through FEC when set) sent over a RadioChannel, and every packet handed
+    /// to a GroundStation the moment it arrives. Three events go out, at 1 s, half way and three quarters in.
+    /// After Duration, what is still queued goes out within the budget, for up to 10 s more
+    inline LinkReport FlyLink(const LinkSettings& Link, const RadioSettings& Radio, uint64_t Seed=1){
+        double Budget = Link.Budget > 0.0 ? Link.Budget : Radio.Bandwidth;
+        if(Link.FecData > 0) {Budget /= fecExpansion(Link.FecData, Link.FecParity);}
+        TelemetryScheduler Telemetry(Budget, Link.Check, std::size_t(Link.MaxFrame), Link.MaxLatency);
+        int Events = Telemetry.addStream<EventMessage>("events", 0, 0.0, 16);
+        int Attitude = Telemetry.addStream<AttitudeMessage>("attitude", 1, Link.AttitudeRate);
+        int GPS = Telemetry.addStream<GPSMessage>("gps", 2, Link.GPSRate);
+        int Log = Telemetry.addStream<LogMessage>("log", 2, Link.LogRate);
+        int Housekeeping = Telemetry.addStream<HousekeepingMessage>("housekeeping", 3, Link.HousekeepingRate);
+        FecEncoder Fec(Link.FecData, Link.FecParity);
+        RadioChannel Channel(Radio, Seed);
+        GroundStation Ground(nullptr, Link.Check, Link.FecData, Link.Jitter);
+
+        LinkReport Report;
+        std::vector<double> Latencies;
+        double Bits = 0.0, Now = 0.0, t = 0.0;
+        auto Visit = [&](auto Format, const auto& Record){
+            typedef decltype(Format) Message;
+            if constexpr (Message::ID >= 0){
+                Report.Received++;
+                Bits += Message::MESSAGE_BITS;
+                Latencies.push_back(Now - SampleTime(Record));
+                if constexpr (Message::ID == EventMessage::ID) {Report.EventsReceived++;}
+            }
+        };
+        auto Deliver = [&](double Arrival, const uint8_t* Bytes, std::size_t Length){
+            Now = Arrival;
+            Ground.receive(Bytes, Length, Visit);
+        };
+        auto Send = [&](const uint8_t* Bytes, std::size_t Length) {Channel.Send(t, Bytes, Length);};
+        uint8_t Frame[TELEMETRY_MAX_ENCODED];
+        auto Downlink = [&](std::size_t Length){
+            if(Length == 0) {return;}
+            if(Link.FecData > 0) {Fec.encode(Frame, Length, Send);}
+            else {Send(Frame, Length);}
+        };
+        auto Queued = [&](){
+            int n = 0;
+            for(int i = 0; i < Telemetry.streamCount(); i++) {n += Telemetry.queued(i);}
+            return n;
+        };
+
+        const double EventTimes[3] = {1.0, 0.5 * Link.Duration, 0.75 * Link.Duration};
+        int NextEvent = 0;
+        long Ticks = long(Link.Duration * Link.SampleRate);
+        for(long i = 0; i < Ticks; i++){
+            t = double(i) / Link.SampleRate;
+            Channel.Receive(t, Deliver);
+
+            // a climb and a fall, for values that change from sample to sample
+            double Altitude = 80.0 * t - 0.4 * t * t;
+            if(NextEvent < 3 && t >= EventTimes[NextEvent]){
+                Telemetry.offer<EventMessage>(Events, FlightEvent(t, NextEvent + 1, Altitude), t);
+                Report.EventsSent++;
+                NextEvent++;
+            }
+            Telemetry.offer<AttitudeMessage>(Attitude, AttitudeSample(t, 90.0 - 0.5 * t, std::fmod(3.0 * t, 360.0) - 180.0, 0.1 * t), t);
+            RocketSensors::GPSFix Fix;
+            FixTimeField::set(Fix, t);
+            Fix.Latitude = 34.0691 + 1e-6 * t;
+            Fix.Longitude = 72.6441 + 2e-6 * t;
+            Fix.Altitude = float(350.0 + Altitude);
+            Fix.VelocityUp = float(80.0 - 0.8 * t);
+            Fix.Satellites = 24;
+            Telemetry.offer<GPSMessage>(GPS, Fix, t);
+            Logs Reading;
+            Reading.timestamp = t;
+            Reading.gps = Coordinates(Fix.Latitude, Fix.Longitude, Altitude);
+            Reading.velocity = 80.0 - 0.8 * t;
+            Reading.acceleration = -0.8;
+            Reading.pressure = 970.0 - 0.1 * t;
+            Telemetry.offer<LogMessage>(Log, Reading, t);
+            HousekeepingSample Health;
+            Health.time = t;
+            Telemetry.offer<HousekeepingMessage>(Housekeeping, Health, t);
+
+            Downlink(Telemetry.poll(t, Frame));
+        }
+        for(long i = Ticks; i < Ticks + long(10.0 * Link.SampleRate) && Queued() > 0; i++){
+            t = double(i) / Link.SampleRate;
+            Channel.Receive(t, Deliver);
+            Downlink(Telemetry.flush(t, Frame));
+        }
+        if(Link.FecData > 0) {Fec.flush(Send);}
+        Channel.Receive(1e300, Deliver);
+        Ground.flush(Visit);
+
+        for(int i = 0; i < Telemetry.streamCount(); i++) {Report.Sent += Telemetry.stats(i).sent;}
+        Report.Recovered = Report.Sent ? double(Report.Received) / double(Report.Sent) : 0.0;
+        // over the flight and the time the queues took to drain
+        double Span = t + 1.0 / Link.SampleRate;
+        Report.Goodput = Bits / 8.0 / Span;
+        Report.WireRate = double(Channel.GetStats().Bytes) / Span;
+        if(!Latencies.empty()){
+            std::sort(Latencies.begin(), Latencies.end());
+            auto At = [&](double q) {return Latencies[std::min(Latencies.size() - 1, std::size_t(q * double(Latencies.size())))];};
+            Report.LatencyP50 = At(0.5);
+            Report.LatencyP90 = At(0.9);
+            Report.LatencyP99 = At(0.99);
+            Report.LatencyMax = Latencies.back();
+        }
+        Report.Radio = Channel.GetStats();
+        Report.Ground = Ground.stats();
+        Report.Gaps = Report.Ground.gaps;
+        Report.Missing = Report.Ground.missing;
+        return Report;
+    }
+
+}
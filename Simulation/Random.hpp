@@ -0,0 +1,70 @@
+// Random numbers for the simulator
+// Every simulation owns its generator, so runs are reproducible from their seed and never share state
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+namespace RocketSimulation{
+
+    /// @brief One step of SplitMix64, turns consecutive states into well mixed 64 bit values
+    /// @param State advanced by the call
+    inline uint64_t SplitMix64(uint64_t& State){
+        uint64_t z = (State += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /// @brief xoshiro256** generator, seeded through SplitMix64 so any seed (even 0) gives a good state
+    class Random{
+    private:
+        uint64_t S[4];
+        float Spare;
+        bool HaveSpare;
+
+        static inline uint64_t Rotl(uint64_t x, int k) {return (x << k) | (x >> (64 - k));}
+
+    public:
+        explicit Random(uint64_t Seed=1) {Reseed(Seed);}
+
+        void Reseed(uint64_t Seed){
+            for(int i = 0; i < 4; i++) {S[i] = SplitMix64(Seed);}
+            HaveSpare = false;
+        }
+
+        inline uint64_t Next(){
+            uint64_t Result = Rotl(S[1] * 5, 7) * 9;
+            uint64_t t = S[1] << 17;
+            S[2] ^= S[0]; S[3] ^= S[1]; S[1] ^= S[2]; S[0] ^= S[3];
+            S[2] ^= t;
+            S[3] = Rotl(S[3], 45);
+            return Result;
+        }
+
+        /// @return uniform in [0, 1)
+        inline float Uniform() {return float(Next() >> 40) * (1.0f / 16777216.0f);}
+
+        /// @return uniform in [Low, High)
+        inline float Uniform(float Low, float High) {return Low + (High - Low) * Uniform();}
+
+        /// @return standard normal sample (Box-Muller, the second value of each pair is kept for the next call)
+        float Gaussian(){
+            if(HaveSpare){
+                HaveSpare = false;
+                return Spare;
+            }
+            float u1 = 1.0f - Uniform(); // (0, 1], keeps log() finite
+            float u2 = Uniform();
+            float r = std::sqrt(-2.0f * std::log(u1));
+            Spare = r * std::sin(6.2831853f * u2);
+            HaveSpare = true;
+            return r * std::cos(6.2831853f * u2);
+        }
+
+        /// @return normal sample with the given mean and standard deviation
+        inline float Gaussian(float Mean, float Sigma) {return Mean + Sigma * Gaussian();}
+    };
+
+}
@@ -0,0 +1,51 @@
+// Feeds simulated sensor samples into the sensor registry
+// For code that reads its inputs from the registry streams (AHRS::Bind / Step) rather than taking samples
+// directly. Each sample is stamped with the wall clock, because the stream deadlines are wall clock times;
+// publish right before the consumer steps
+
+#pragma once
+
+#include "Simulator.hpp"
+#include "../Sensing/SensorData.hpp"
+#include <chrono>
+
+namespace RocketSimulation{
+
+    class SensorFeed{
+    private:
+        RocketSensors::DeadlineStack* Gyro;
+        RocketSensors::DeadlineStack* Accel;
+        RocketSensors::DeadlineStack* Mag;
+        RocketSensors::DeadlineStack* Baro;
+
+        static RocketSensors::DeadlineStack* Stream(RocketSensors::BinarySearchTree& Sensors, char Type){
+            RocketSensors::Sensor* Found = Sensors.Find(Type);
+            return Found ? &(Found->Raw) : nullptr;
+        }
+
+    public:
+        SensorFeed(): Gyro(nullptr), Accel(nullptr), Mag(nullptr), Baro(nullptr) {};
+
+        /// @brief Looks up the 'G', 'A', 'M' and 'B' sensors (the AHRS types) once
+        /// @return the number of streams found
+        int Bind(RocketSensors::BinarySearchTree& Sensors){
+            Gyro = Stream(Sensors, 'G');
+            Accel = Stream(Sensors, 'A');
+            Mag = Stream(Sensors, 'M');
+            Baro = Stream(Sensors, 'B');
+            return (Gyro != nullptr) + (Accel != nullptr) + (Mag != nullptr) + (Baro != nullptr);
+        }
+
+        /// @brief Pushes one sample onto every bound stream
+        void Publish(const SensorSample& Sample){
+            std::chrono::milliseconds Now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch());
+
+            if(Baro) {Baro->Insert(Sample.PressureHPa, Now);}
+            if(Mag) {Mag->Insert(Sample.Mag, Now);}
+            if(Accel) {Accel->Insert(Sample.Accel, Now);}
+            if(Gyro) {Gyro->Insert(Sample.Gyro, Now);}
+        }
+    };
+
+}
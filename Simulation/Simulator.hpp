@@ -0,0 +1,413 @@
+// Six degree of freedom flight simulator
+// Rigid body dynamics of the vehicle under thrust, gravity, drag, aerodynamic and control moments and
+// wind, stepped with RK4 in simulated time only: there is no sleep and no wall clock anywhere, so a flight
+// runs as fast as the arithmetic allows. Synthetic sensor samples come out in the units the AHRS takes and
+// actuator positions go back in through SetGimbal / SetFinAngle
+
+#pragma once
+
+#include "../Sensing/Physics.hpp"
+#include "../Sensing/Atmosphere.hpp"
+#include "Motor.hpp"
+#include "Environment.hpp"
+#include "Random.hpp"
+#include <cmath>
+
+namespace RocketSimulation{
+
+    constexpr float DegreesToRadians = 0.0174532925f;
+    constexpr int MaxSimulatedFins = 16;
+
+    /// @brief Mass, aerodynamic and launch properties of the vehicle
+    /// Frames are those of the AHRS: body +Z along the nose; world X magnetic north, Z up, origin at the pad.
+    /// Moments follow controlAllocator: a positive gimbal axis2 (pitch) or front fin angle gives a positive
+    /// moment about body Y, a positive gimbal axis1 (yaw) or left fin angle a positive moment about body X
+    struct VehicleModel{
+        float DryMass;                      // kg, everything but the motor
+        float InertiaTransverse;            // kg m^2 about the CG across the body, without the motor
+        float InertiaRoll;                  // kg m^2 about the long axis, without the motor
+        float PropellantGyrationTransverse; // m^2, inertia added per kg of propellant across the body
+        float PropellantGyrationRoll;       // m^2, inertia added per kg of propellant about the long axis
+
+        float Diameter;                     // m, sets the reference area
+        float Length;                       // m, reference length of the damping moments
+        float DragCoefficient;              // on the reference area
+        float NormalForceSlope;             // CN alpha, per radian of angle of attack
+        float StaticMargin;                 // m, centre of pressure behind the CG
+        float PitchDamping;                 // moment = -PitchDamping * q S L^2 / (2 V) * rate
+        float RollDamping;                  // the same about the long axis
+
+        float NozzleArm;                    // m, nozzle behind the CG
+        float GimbalLimit;                  // degrees
+        float FinMomentPerDegree;           // N m per degree per Pa of dynamic pressure, one fin
+        float FinDragPerDegree;             // m^2 of drag area per degree of deflection, one fin
+
+        float RailLength;                   // m
+        float LaunchPitch, LaunchYaw;       // degrees, rail tilt as the AHRS would read it
+        float PadAltitude;                  // m above sea level
+        float MagneticDip;                  // degrees below horizontal
+
+        /// @brief A 54 mm, 1 m hobby rocket with grid fins and a gimballed G motor
+        VehicleModel():
+            DryMass(0.85f), InertiaTransverse(0.075f), InertiaRoll(0.0004f),
+            PropellantGyrationTransverse(0.02f), PropellantGyrationRoll(0.0002f),
+            Diameter(0.054f), Length(1.0f), DragCoefficient(0.45f), NormalForceSlope(10.0f), StaticMargin(0.08f),
+            PitchDamping(10.0f), RollDamping(2.0f),
+            NozzleArm(0.5f), GimbalLimit(15.0f), FinMomentPerDegree(2.5e-5f), FinDragPerDegree(2.0e-5f),
+            RailLength(1.5f), LaunchPitch(2.0f), LaunchYaw(0.0f), PadAltitude(300.0f), MagneticDip(60.0f) {};
+
+        inline float ReferenceArea() const {return 0.25f * 3.14159265f * Diameter * Diameter;}
+    };
+
+    /// @brief Position, velocity, attitude and body rates; also used for their time derivatives
+    struct RigidBodyState{
+        RocketPhysics::Vector3D Position;   // world, m from the pad
+        RocketPhysics::Vector3D Velocity;   // world, m/s
+        RocketPhysics::Quaternion Attitude; // body to world
+        RocketPhysics::Vector3D Rates;      // body, rad/s
+    };
+
+    /// @brief One sample of every simulated sensor
+    struct SensorSample{
+        float Time;                       // s of simulated time
+        RocketPhysics::Vector3D Gyro;     // rad/s, body
+        RocketPhysics::Vector3D Accel;    // m/s^2 specific force, body
+        RocketPhysics::Vector3D Mag;      // unit field, body
+        float PressureHPa;
+    };
+
+    /// @brief Standard deviations of the sensor errors
+    struct SensorNoise{
+        float Gyro;       // rad/s per sample
+        float GyroBias;   // rad/s, drawn once per run
+        float Accel;      // m/s^2 per sample
+        float Mag;        // per sample, on a unit field
+        float Pressure;   // hPa per sample
+
+        SensorNoise(float Gyro=0.002f, float GyroBias=0.002f, float Accel=0.05f, float Mag=0.01f, float Pressure=0.03f):
+            Gyro(Gyro), GyroBias(GyroBias), Accel(Accel), Mag(Mag), Pressure(Pressure) {};
+
+        static SensorNoise None() {return SensorNoise(0.0f, 0.0f, 0.0f, 0.0f, 0.0f);}
+    };
+
+    /// @brief What happened during a flight, updated every step
+    struct FlightRecord{
+        float Apogee;                       // m above the pad
+        float ApogeeTime;
+        float MaxSpeed;                     // m/s
+        float MaxTilt;                      // degrees of the nose from vertical, while the motor burns
+        float RailExitSpeed;                // m/s
+        RocketPhysics::Vector3D Landing;    // world position when the vehicle came down
+        float LandingSpeed;
+        float LandingTime;
+    };
+
+    class FlightSimulator{
+    private:
+        VehicleModel Vehicle;
+        Motor Engine;
+        Wind Air;
+        SensorNoise Noise;
+        Random Generator;
+
+        RigidBodyState State;
+        float Time;
+        float IgnitionTime;
+        RocketPhysics::Vector3D RailDirection;
+        RocketPhysics::Vector3D MagneticField;
+        RocketPhysics::Vector3D GyroBias;
+        bool LiftedOff, OffRail, Landed;
+
+        float GimbalYaw, GimbalPitch;       // degrees, gimbal axis1 and axis2
+        int FinCount;
+        float FinAngle[MaxSimulatedFins];
+        float FinPitchSign[MaxSimulatedFins];
+        float FinYawSign[MaxSimulatedFins];
+        float ChuteArea;                    // m^2 of drag area from the deployed parachutes
+
+        FlightRecord Record;
+
+        /// @brief s + d * h, renormalising nothing (RK4 stages only)
+        static RigidBodyState Advance(const RigidBodyState& s, const RigidBodyState& d, float h){
+            const RocketPhysics::Quaternion& q = s.Attitude;
+            const RocketPhysics::Quaternion& dq = d.Attitude;
+            return RigidBodyState{
+                s.Position + d.Position * h,
+                s.Velocity + d.Velocity * h,
+                RocketPhysics::Quaternion(q.GetW() + dq.GetW() * h, q.GetX() + dq.GetX() * h,
+                                          q.GetY() + dq.GetY() * h, q.GetZ() + dq.GetZ() * h),
+                s.Rates + d.Rates * h
+            };
+        }
+
+        /// @brief Time derivative of the state
+        /// @param SpecificForce if not null, receives what an accelerometer at the CG would read (body)
+        RigidBodyState Derivative(float t, const RigidBodyState& s, RocketPhysics::Vector3D* SpecificForce=nullptr) const{
+            float BurnTime = t - IgnitionTime;
+            float Propellant = Engine.PropellantRemaining(BurnTime);
+            float Mass = Vehicle.DryMass + Engine.CaseMass + Propellant;
+            float It = Vehicle.InertiaTransverse + Propellant * Vehicle.PropellantGyrationTransverse;
+            float Ir = Vehicle.InertiaRoll + Propellant * Vehicle.PropellantGyrationRoll;
+            float Thrust = Engine.Curve.Thrust(BurnTime);
+
+            const RocketPhysics::Quaternion& q = s.Attitude;
+            float Fx = 0.0f, Fy = 0.0f, Fz = 0.0f;
+            float Mx = 0.0f, My = 0.0f, Mz = 0.0f;
+
+            // Thrust through the gimbal, applied at the nozzle NozzleArm behind the CG
+            if(Thrust > 0.0f){
+                float sp = std::sin(GimbalPitch * DegreesToRadians);
+                float sy = std::sin(GimbalYaw * DegreesToRadians);
+                float Tx = -Thrust * sp;
+                float Ty = Thrust * sy;
+                float Axial = 1.0f - sp * sp - sy * sy;
+                Fx += Tx;
+                Fy += Ty;
+                Fz += Thrust * std::sqrt(Axial > 0.0f ? Axial : 0.0f);
+                Mx += Vehicle.NozzleArm * Ty;
+                My -= Vehicle.NozzleArm * Tx;
+            }
+
+            // Aerodynamics on the velocity relative to the air
+            RocketPhysics::Vector3D AirBody = q.Conjugate().Rotate(s.Velocity - Air.At(s.Position.GetZ(), t));
+            float Speed = AirBody.Magnitude();
+            if(Speed > 0.1f){
+                float Rho = RocketPhysics::Atmosphere::Density(Vehicle.PadAltitude + s.Position.GetZ());
+                float Q = 0.5f * Rho * Speed * Speed;
+                float S = Vehicle.ReferenceArea();
+
+                float FinDrag = 0.0f;
+                for(int i = 0; i < FinCount; i++) {FinDrag += Vehicle.FinDragPerDegree * std::fabs(FinAngle[i]);}
+
+                // Drag against the air velocity
+                float Drag = -Q * (Vehicle.DragCoefficient * S + FinDrag + ChuteArea) / Speed;
+                Fx += Drag * AirBody.GetX();
+                Fy += Drag * AirBody.GetY();
+                Fz += Drag * AirBody.GetZ();
+
+                // Normal force from the angle of attack, at the centre of pressure
+                float Normal = -Q * S * Vehicle.NormalForceSlope / Speed;
+                float Nx = Normal * AirBody.GetX();
+                float Ny = Normal * AirBody.GetY();
+                Fx += Nx;
+                Fy += Ny;
+                Mx += Vehicle.StaticMargin * Ny;
+                My -= Vehicle.StaticMargin * Nx;
+
+                float Damping = Q * S * Vehicle.Length * Vehicle.Length / (2.0f * Speed);
+                Mx -= Vehicle.PitchDamping * Damping * s.Rates.GetX();
+                My -= Vehicle.PitchDamping * Damping * s.Rates.GetY();
+                Mz -= Vehicle.RollDamping * Damping * s.Rates.GetZ();
+
+                for(int i = 0; i < FinCount; i++){
+                    float m = Vehicle.FinMomentPerDegree * Q * FinAngle[i];
+                    My += FinPitchSign[i] * m;
+                    Mx += FinYawSign[i] * m;
+                    Mz += m;
+                }
+            }
+
+            RocketPhysics::Vector3D Gravity(0.0f, 0.0f, -float(GRAVITY), 'A');
+            RocketPhysics::Vector3D Acceleration = q.Rotate(RocketPhysics::Vector3D(Fx, Fy, Fz, 'A')) / Mass + Gravity;
+            RocketPhysics::Vector3D AngularAcceleration(0.0f, 0.0f, 0.0f, 'R');
+
+            if(!OffRail){
+                // Only motion along the rail and no rotation; the pad holds the vehicle until thrust beats weight
+                float Along = Acceleration * RailDirection;
+                if(Along < 0.0f && s.Velocity * RailDirection <= 0.0f) {Along = 0.0f;}
+                Acceleration = RailDirection * Along;
+            }
+            else{
+                // Euler's equations for I = diag(It, It, Ir)
+                float wx = s.Rates.GetX(), wy = s.Rates.GetY(), wz = s.Rates.GetZ();
+                AngularAcceleration.Set((Mx - (Ir - It) * wy * wz) / It, (My - (It - Ir) * wz * wx) / It, Mz / Ir, 'R');
+            }
+
+            if(SpecificForce) {*SpecificForce = q.Conjugate().Rotate(Acceleration - Gravity);}
+
+            // dq/dt = q * (0, w) / 2
+            RocketPhysics::Quaternion Spin = q * RocketPhysics::Quaternion(0.0f, s.Rates.GetX(), s.Rates.GetY(), s.Rates.GetZ());
+            return RigidBodyState{
+                s.Velocity,
+                Acceleration,
+                RocketPhysics::Quaternion(0.5f * Spin.GetW(), 0.5f * Spin.GetX(), 0.5f * Spin.GetY(), 0.5f * Spin.GetZ()),
+                AngularAcceleration
+            };
+        }
+
+        void UpdateRecord(){
+            float z = State.Position.GetZ();
+            if(z > Record.Apogee){
+                Record.Apogee = z;
+                Record.ApogeeTime = Time;
+            }
+
+            float Speed = State.Velocity.Magnitude();
+            if(Speed > Record.MaxSpeed) {Record.MaxSpeed = Speed;}
+
+            if(Engine.Curve.Thrust(Time - IgnitionTime) > 0.0f){
+                float Tilt = GetTilt();
+                if(Tilt > Record.MaxTilt) {Record.MaxTilt = Tilt;}
+            }
+        }
+
+    public:
+        /// @param Seed seeds the sensor noise, the same seed gives the same flight
+        /// @param IgnitionTime seconds of pad time before the motor lights, e.g. to let the AHRS settle
+        FlightSimulator(const VehicleModel& Vehicle, const Motor& Engine, const Wind& Air=Wind(),
+                        const SensorNoise& Noise=SensorNoise(), uint64_t Seed=1, float IgnitionTime=0.0f):
+            Vehicle(Vehicle), Engine(Engine), Air(Air), Noise(Noise), Generator(Seed), IgnitionTime(IgnitionTime){
+            Reset(Seed);
+        };
+
+        /// @brief Puts the vehicle back on the pad, fins and gimbal centred, chutes packed
+        void Reset(uint64_t Seed){
+            Generator.Reseed(Seed);
+            Time = 0.0f;
+
+            RocketPhysics::Quaternion Launch = RocketPhysics::Quaternion::FromEuler(
+                Vehicle.LaunchYaw * DegreesToRadians, Vehicle.LaunchPitch * DegreesToRadians, 0.0f);
+            State = RigidBodyState{
+                RocketPhysics::Vector3D(0.0f, 0.0f, 0.0f, 'D'),
+                RocketPhysics::Vector3D(0.0f, 0.0f, 0.0f, 'V'),
+                Launch,
+                RocketPhysics::Vector3D(0.0f, 0.0f, 0.0f, 'R')
+            };
+            RailDirection = Launch.Rotate(RocketPhysics::Vector3D(0.0f, 0.0f, 1.0f));
+
+            float Dip = Vehicle.MagneticDip * DegreesToRadians;
+            MagneticField = RocketPhysics::Vector3D(std::cos(Dip), 0.0f, -std::sin(Dip), 'M');
+            GyroBias = RocketPhysics::Vector3D(Generator.Gaussian(0.0f, Noise.GyroBias), Generator.Gaussian(0.0f, Noise.GyroBias),
+                                               Generator.Gaussian(0.0f, Noise.GyroBias), 'R');
+
+            LiftedOff = OffRail = Landed = false;
+            GimbalYaw = GimbalPitch = 0.0f;
+            FinCount = 0;
+            for(int i = 0; i < MaxSimulatedFins; i++){
+                FinAngle[i] = 0.0f;
+                FinPitchSign[i] = FinYawSign[i] = 1.0f;
+            }
+            ChuteArea = 0.0f;
+            Record = FlightRecord{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, RocketPhysics::Vector3D(), 0.0f, 0.0f};
+        }
+
+        /// @brief Advances the flight by dt seconds of simulated time with one RK4 step
+        /// @return false once the vehicle is back on the ground
+        bool Step(float dt){
+            if(Landed) {return false;}
+
+            float Half = 0.5f * dt;
+            RigidBodyState k1 = Derivative(Time, State);
+            RigidBodyState k2 = Derivative(Time + Half, Advance(State, k1, Half));
+            RigidBodyState k3 = Derivative(Time + Half, Advance(State, k2, Half));
+            RigidBodyState k4 = Derivative(Time + dt, Advance(State, k3, dt));
+
+            float Sixth = dt / 6.0f;
+            RigidBodyState Sum{
+                k1.Position + (k2.Position + k3.Position) * 2.0f + k4.Position,
+                k1.Velocity + (k2.Velocity + k3.Velocity) * 2.0f + k4.Velocity,
+                RocketPhysics::Quaternion(
+                    k1.Attitude.GetW() + 2.0f * (k2.Attitude.GetW() + k3.Attitude.GetW()) + k4.Attitude.GetW(),
+                    k1.Attitude.GetX() + 2.0f * (k2.Attitude.GetX() + k3.Attitude.GetX()) + k4.Attitude.GetX(),
+                    k1.Attitude.GetY() + 2.0f * (k2.Attitude.GetY() + k3.Attitude.GetY()) + k4.Attitude.GetY(),
+                    k1.Attitude.GetZ() + 2.0f * (k2.Attitude.GetZ() + k3.Attitude.GetZ()) + k4.Attitude.GetZ()),
+                k1.Rates + (k2.Rates + k3.Rates) * 2.0f + k4.Rates
+            };
+            State = Advance(State, Sum, Sixth);
+            State.Attitude = State.Attitude.Normalized();
+            Time += dt;
+
+            // Damped rates decay towards zero under a parachute and would end in slow denormals
+            float w[3] = {State.Rates.GetX(), State.Rates.GetY(), State.Rates.GetZ()};
+            for(float& Rate : w) {if(std::fabs(Rate) < 1e-20f) {Rate = 0.0f;}}
+            State.Rates.Set(w[0], w[1], w[2], 'R');
+
+            if(!OffRail){
+                float Travel = State.Position * RailDirection;
+                if(Travel > 0.0f) {LiftedOff = true;}
+                if(Travel >= Vehicle.RailLength){
+                    OffRail = true;
+                    Record.RailExitSpeed = State.Velocity.Magnitude();
+                }
+            }
+
+            UpdateRecord();
+
+            if(LiftedOff && State.Position.GetZ() < 0.0f){
+                Landed = true;
+                Record.Landing = RocketPhysics::Vector3D(State.Position.GetX(), State.Position.GetY(), 0.0f, 'D');
+                Record.LandingSpeed = State.Velocity.Magnitude();
+                Record.LandingTime = Time;
+                return false;
+            }
+            return true;
+        }
+
+        /// @brief Reads every sensor at the current state, with noise
+        SensorSample Sample(){
+            RocketPhysics::Vector3D SpecificForce;
+            Derivative(Time, State, &SpecificForce);
+
+            SensorSample Out;
+            Out.Time = Time;
+            Out.Gyro = State.Rates + GyroBias + RocketPhysics::Vector3D(Generator.Gaussian(0.0f, Noise.Gyro),
+                Generator.Gaussian(0.0f, Noise.Gyro), Generator.Gaussian(0.0f, Noise.Gyro), 'R');
+            Out.Accel = SpecificForce + RocketPhysics::Vector3D(Generator.Gaussian(0.0f, Noise.Accel),
+                Generator.Gaussian(0.0f, Noise.Accel), Generator.Gaussian(0.0f, Noise.Accel), 'A');
+            Out.Mag = State.Attitude.Conjugate().Rotate(MagneticField) + RocketPhysics::Vector3D(Generator.Gaussian(0.0f, Noise.Mag),
+                Generator.Gaussian(0.0f, Noise.Mag), Generator.Gaussian(0.0f, Noise.Mag), 'M');
+
+            // Troposphere closed form, the pad is well below 11 km
+            float h = Vehicle.PadAltitude + State.Position.GetZ();
+            Out.PressureHPa = 1013.25f * std::pow(1.0f - 2.25577e-5f * h, 5.25588f) + Generator.Gaussian(0.0f, Noise.Pressure);
+            return Out;
+        }
+
+        /// @brief Gimbal positions in degrees, clamped to the gimbal limit
+        /// @return false if either axis had to be clamped
+        bool SetGimbal(float Yaw, float Pitch){
+            float Limit = Vehicle.GimbalLimit;
+            GimbalYaw = Yaw > Limit ? Limit : (Yaw < -Limit ? -Limit : Yaw);
+            GimbalPitch = Pitch > Limit ? Limit : (Pitch < -Limit ? -Limit : Pitch);
+            return GimbalYaw == Yaw && GimbalPitch == Pitch;
+        }
+
+        /// @brief Declares where a fin sits, once before the flight
+        /// @return false if Index is past MaxSimulatedFins
+        bool SetFinLayout(int Index, bool Left, bool Front){
+            if(Index < 0 || Index >= MaxSimulatedFins) {return false;}
+            FinPitchSign[Index] = Front ? 1.0f : -1.0f;
+            FinYawSign[Index] = Left ? 1.0f : -1.0f;
+            if(Index >= FinCount) {FinCount = Index + 1;}
+            return true;
+        }
+
+        /// @brief Fin deflection in degrees
+        inline void SetFinAngle(int Index, float Angle){
+            if(Index >= 0 && Index < FinCount) {FinAngle[Index] = Angle;}
+        }
+
+        /// @brief Adds the drag area (drag coefficient times canopy area, m^2) of a parachute
+        inline void DeployParachute(float DragArea) {ChuteArea += DragArea;}
+
+        inline float GetTime() const {return Time;}
+        inline float GetIgnitionTime() const {return IgnitionTime;}
+        inline const RigidBodyState& GetState() const {return State;}
+        inline const FlightRecord& GetRecord() const {return Record;}
+        inline bool HasLiftedOff() const {return LiftedOff;}
+        inline bool IsOffRail() const {return OffRail;}
+        inline bool HasLanded() const {return Landed;}
+        inline bool IsBurning() const {return Engine.Curve.Thrust(Time - IgnitionTime) > 0.0f;}
+        inline float GetBurnoutTime() const {return IgnitionTime + Engine.Curve.BurnTime();}
+        inline float GetMass() const {return Vehicle.DryMass + Engine.CaseMass + Engine.PropellantRemaining(Time - IgnitionTime);}
+        inline const VehicleModel& GetVehicle() const {return Vehicle;}
+
+        /// @brief Angle of the nose from vertical in degrees
+        inline float GetTilt() const{
+            float z = State.Attitude.Rotate(RocketPhysics::Vector3D(0.0f, 0.0f, 1.0f)).GetZ();
+            z = z > 1.0f ? 1.0f : (z < -1.0f ? -1.0f : z);
+            return std::acos(z) / DegreesToRadians;
+        }
+    };
+
+}
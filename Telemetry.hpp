@@ -0,0 +1,9 @@
+#include "./telemetry/BitPacking.hpp"
+#include "./telemetry/Framing.hpp"
+#include "./telemetry/TelemetryFrame.hpp"
+#include "./telemetry/LogFormat.hpp"
+#include "./telemetry/FlightMessages.hpp"
+#include "./telemetry/TelemetryScheduler.hpp"
+#include "./telemetry/ReedSolomon.hpp"
+#include "./telemetry/FecLink.hpp"
+#include "./telemetry/GroundStation.hpp"
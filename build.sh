@@ -1,4 +1,5 @@
 g++ -c Sensing/Physics.hpp
 g++ -c Sensing/SensorData.hpp
 g++ -c Sensing.hpp
-g++ -o test.exe Sensing.cpp 
\ No newline at end of file
+g++ -pthread -o test.exe Sensing.cpp
+g++ -O2 -pthread -o benchmark.exe Benchmark.cpp
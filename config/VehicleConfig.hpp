@@ -0,0 +1,618 @@
+#ifndef VEHICLE_CONFIG_HPP
+#define VEHICLE_CONFIG_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include "../Control/allocation.hpp"
+#include "../Control/commands.hpp"
+#include "../Recovery/landing.hpp"
+#include "../Sensing/SensorData.hpp"
+#include "../telemetry/FlightMessages.hpp"
+#include "../telemetry/TelemetryScheduler.hpp"
+#include "../telemetry/FecLink.hpp"
+#include "../telemetry/GroundStation.hpp"
+#include "../logger/ErrorLogger.hpp"
+using namespace std;
+
+struct FinSpec {
+    int number;
+    bool left;  // 1 for left mounted, 0 for right
+    bool front; // 1 for front mounted, 0 for back
+};
+
+struct ChuteSpec {
+    string name;
+    int sequence;
+    recoveryPhase trigger; // PHASE_APOGEE or PHASE_MAIN
+    float delay;           // seconds after the trigger
+};
+
+struct SensorSpec {
+    char type;
+    float deadlineSeconds;
+};
+
+struct TelemetryStreamSpec {
+    string name;  // events, log, attitude, gps or housekeeping
+    int priority; // 0 first
+    float rate;   // Hz, 0 for every sample
+};
+
+// A command the bench uplink sends at a set time after the control loop starts
+struct CommandSpec {
+    float time; // s
+    command cmd;
+};
+
+// Stream numbers of the telemetry scheduler built by VehicleConfig::makeTelemetry, -1 for streams not declared
+struct TelemetryStreams {
+    int events, log, attitude, gps, housekeeping;
+};
+
+// Vehicle description read once at startup from an INI style file:
+//
+//   # comment
+//   [section]
+//   key = value
+//   fin = 0, 1, 1        (list keys may repeat)
+//
+// Sections are [vehicle], [fins], [gimbal], [parachutes], [recovery], [sensors], [logger], [control],
+// [telemetry] and [commands]; see vehicle.ini.
+// Parsing is a single pass over the text with no regex or per-line streams. Every problem is collected in
+// errors with its line number, so one boot shows everything that is wrong with the file
+class VehicleConfig {
+public:
+    string name;
+
+    int finCount;
+    float finMaxAngle;                 // degrees
+    float finRate;                     // degrees per second, 0 for no limit
+    float pitchGain, yawGain, rollGain;
+    vector<FinSpec> fins;
+
+    int gimbalConstant;
+    float gimbalYawOffset, gimbalPitchOffset;
+    float gimbalLimit;                 // degrees
+    float gimbalRate;                  // degrees per second, 0 for no limit
+
+    vector<ChuteSpec> parachutes;
+    recoveryLimits recovery;
+    descentModel descent;              // [recovery] descent rates and wind bands for the landing predictor
+    vector<SensorSpec> sensors;
+
+    string flightLog;
+    string errorLog;
+    ErrorLogger::Level logLevel;
+    int replayReadings;                // readings of the last flight log fed to the sensors at startup
+    string groundLog;                  // Logs received by the ground station, empty for none
+
+    float controlRateHz;
+
+    float telemetryBudget;             // bytes per second the radio carries
+    TelemetryCheck telemetryCheck;
+    int telemetryMaxFrame;             // bytes before stuffing
+    float telemetryLatency;            // s a sample may wait for its frame to fill
+    vector<TelemetryStreamSpec> telemetryStreams;
+    int telemetryFecData;              // telemetry frames per FEC block, 0 for no FEC
+    int telemetryFecParity;            // parity frames per block
+    int telemetryJitter;               // frames the ground station lets one arrive out of order
+    vector<CommandSpec> uplink;        // [commands], in file order
+
+    vector<string> errors;
+
+    VehicleConfig() { clear(); }
+
+    void clear() {
+        name = "SENTINEL";
+        finCount = 0;
+        finMaxAngle = 60.0f;
+        finRate = 0.0f;
+        pitchGain = yawGain = rollGain = 60.0f / 360.0f;
+        fins.clear();
+        gimbalConstant = 1;
+        gimbalYawOffset = gimbalPitchOffset = 0.0f;
+        gimbalLimit = 15.0f;
+        gimbalRate = 0.0f;
+        parachutes.clear();
+        recovery = recoveryLimits();
+        descent = descentModel();
+        sensors.clear();
+        flightLog = "LastFlight.log";
+        errorLog = "error_log.txt";
+        logLevel = ErrorLogger::Level::INFO;
+        replayReadings = 10;
+        groundLog.clear();
+        controlRateHz = 100.0f;
+        telemetryBudget = 960.0f;
+        telemetryCheck = CHECK_CRC16;
+        telemetryMaxFrame = int(TELEMETRY_MAX_FRAME);
+        telemetryLatency = 0.1f;
+        telemetryStreams.clear();
+        telemetryFecData = telemetryFecParity = 0;
+        telemetryJitter = 8;
+        uplink.clear();
+        errors.clear();
+    }
+
+    // Reads and validates a vehicle file. Throws if the file cannot be opened, returns false if it is invalid
+    bool load(const string& filePath) {
+        ifstream file(filePath, ios::binary);
+        if (!file) {
+            throw runtime_error("Unable to open vehicle file: " + filePath);
+        }
+        stringstream buffer;
+        buffer << file.rdbuf();
+        return parse(buffer.str());
+    }
+
+    // Parses and validates a vehicle description held in memory, replacing the current one
+    bool parse(const string& text) {
+        clear();
+        section = "";
+        sawFinCount = false;
+
+        const char* p = text.data();
+        const char* end = p + text.size();
+        int line = 0;
+
+        while (p < end) {
+            line++;
+            const char* lineEnd = p;
+            while (lineEnd < end && *lineEnd != '\n') lineEnd++;
+
+            const char* b = p;
+            const char* e = lineEnd;
+            p = lineEnd < end ? lineEnd + 1 : end;
+
+            // Comments run to the end of the line
+            for (const char* c = b; c < e; c++) {
+                if (*c == '#' || *c == ';') { e = c; break; }
+            }
+            trim(b, e);
+            if (b == e) continue;
+
+            if (*b == '[') {
+                if (e[-1] != ']') { error(line, "unterminated section header"); continue; }
+                const char* sb = b + 1;
+                const char* se = e - 1;
+                trim(sb, se);
+                section.assign(sb, se);
+                if (section != "vehicle" && section != "fins" && section != "gimbal" && section != "parachutes" &&
+                    section != "recovery" && section != "sensors" && section != "logger" && section != "control" &&
+                    section != "telemetry" && section != "commands") {
+                    error(line, "unknown section [" + section + "]");
+                }
+                continue;
+            }
+
+            const char* eq = b;
+            while (eq < e && *eq != '=') eq++;
+            if (eq == e) { error(line, "expected key = value"); continue; }
+
+            const char* kb = b;
+            const char* ke = eq;
+            const char* vb = eq + 1;
+            const char* ve = e;
+            trim(kb, ke);
+            trim(vb, ve);
+            if (kb == ke) { error(line, "missing key"); continue; }
+
+            setValue(line, string(kb, ke), vb, ve);
+        }
+
+        validate();
+        return errors.empty();
+    }
+
+    bool ok() const { return errors.empty(); }
+
+    // Adds the fins to a grid system constructed with finCount, false if one is rejected
+    bool buildFins(gridSystem& grid) const {
+        grid.setGains(pitchGain, yawGain, rollGain, finMaxAngle);
+        for (const FinSpec& f : fins) {
+            if (!grid.addFin(f.number, f.left, f.front)) return false;
+        }
+        return true;
+    }
+
+    gimbal makeGimbal() const {
+        return gimbal(gimbalConstant, gimbalYawOffset, gimbalPitchOffset);
+    }
+
+    // Gimbal and fin limits for the allocator, call after buildFins
+    void configureAllocator(controlAllocator& allocator, const gridSystem& grid) const {
+        allocator.configure(grid, gimbalLimit, gimbalRate, finRate);
+    }
+
+    // One parachute per [parachutes] entry, in file order; sort by DeploySequence before deploying
+    vector<parachute> makeParachutes() const {
+        vector<parachute> chutes(parachutes.size());
+        for (size_t i = 0; i < parachutes.size(); i++) chutes[i].DeploySequence = parachutes[i].sequence;
+        return chutes;
+    }
+
+    // Sets the recovery limits and registers every chute with its trigger. chutes must come from
+    // makeParachutes (in any order) and must not be resized afterwards; false if one is missing
+    bool buildRecovery(recoveryController& controller, vector<parachute>& chutes) const {
+        controller.limits = recovery;
+        for (const ChuteSpec& c : parachutes) {
+            parachute* found = nullptr;
+            for (parachute& p : chutes) {
+                if (p.DeploySequence == c.sequence) found = &p;
+            }
+            if (!found || !controller.addAction(*found, c.trigger, c.delay)) return false;
+        }
+        return true;
+    }
+
+    // Landing predictor with the descent model and the main deployment altitude
+    landingPredictor makeLandingPredictor() const {
+        return landingPredictor(descent, recovery.mainAltitude);
+    }
+
+    void buildSensors(RocketSensors::BinarySearchTree& tree) const {
+        for (const SensorSpec& s : sensors) tree.create(s.type, s.deadlineSeconds);
+    }
+
+    // The telemetry scheduler with the [telemetry] streams; ids receives their stream numbers. With FEC, the
+    // scheduler gets what the budget leaves after the parity frames
+    TelemetryScheduler makeTelemetry(TelemetryStreams& ids) const {
+        double budget = telemetryBudget;
+        if (telemetryFecData > 0) budget /= fecExpansion(telemetryFecData, telemetryFecParity);
+        TelemetryScheduler telemetry(budget, telemetryCheck, size_t(telemetryMaxFrame), telemetryLatency);
+        ids = TelemetryStreams{-1, -1, -1, -1, -1};
+        for (const TelemetryStreamSpec& s : telemetryStreams) {
+            // events are rare and must not be lost, so they get a deeper queue
+            if (s.name == "events") ids.events = telemetry.addStream<EventMessage>(s.name, s.priority, s.rate, 16);
+            else if (s.name == "log") ids.log = telemetry.addStream<LogMessage>(s.name, s.priority, s.rate);
+            else if (s.name == "attitude") ids.attitude = telemetry.addStream<AttitudeMessage>(s.name, s.priority, s.rate);
+            else if (s.name == "gps") ids.gps = telemetry.addStream<GPSMessage>(s.name, s.priority, s.rate);
+            else if (s.name == "housekeeping") ids.housekeeping = telemetry.addStream<HousekeepingMessage>(s.name, s.priority, s.rate);
+        }
+        return telemetry;
+    }
+
+    bool telemetryFec() const { return telemetryFecData > 0; }
+    FecEncoder makeFec() const { return FecEncoder(telemetryFecData, telemetryFecParity); }
+
+    // The receiving end of the same link, for the bench loopback or a ground station reading the radio
+    GroundStation makeGroundStation(DataLogger* log) const {
+        return GroundStation(log, telemetryCheck, telemetryFecData, telemetryJitter);
+    }
+
+    int64_t controlPeriodNs() const {
+        return int64_t(1e9 / double(controlRateHz) + 0.5);
+    }
+
+    string errorReport() const {
+        string report;
+        for (const string& e : errors) report += e + "\n";
+        return report;
+    }
+
+private:
+    string section;
+    bool sawFinCount;
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    static void trim(const char*& b, const char*& e) {
+        while (b < e && isSpace(*b)) b++;
+        while (e > b && isSpace(e[-1])) e--;
+    }
+
+    void error(int line, const string& message) {
+        if (line > 0) errors.push_back("line " + to_string(line) + ": " + message);
+        else errors.push_back(message);
+    }
+
+    // Splits a comma separated value into at most maxFields trimmed fields, returns the field count
+    static int split(const char* b, const char* e, const char** fb, const char** fe, int maxFields) {
+        int n = 0;
+        while (true) {
+            const char* c = b;
+            while (c < e && *c != ',') c++;
+            if (n == maxFields) return maxFields + 1;
+            fb[n] = b;
+            fe[n] = c;
+            trim(fb[n], fe[n]);
+            n++;
+            if (c == e) return n;
+            b = c + 1;
+        }
+    }
+
+    static bool toFloat(const char* b, const char* e, float& out) {
+        if (b == e || e - b > 63) return false;
+        char buffer[64];
+        size_t n = size_t(e - b);
+        for (size_t i = 0; i < n; i++) buffer[i] = b[i];
+        buffer[n] = '\0';
+        char* stop;
+        double v = strtod(buffer, &stop);
+        if (stop != buffer + n) return false;
+        out = float(v);
+        return true;
+    }
+
+    static bool toInt(const char* b, const char* e, int& out) {
+        if (b == e || e - b > 11) return false;
+        bool negative = *b == '-';
+        if (*b == '-' || *b == '+') b++;
+        if (b == e) return false;
+        long v = 0;
+        for (; b < e; b++) {
+            if (*b < '0' || *b > '9') return false;
+            v = v * 10 + (*b - '0');
+        }
+        out = int(negative ? -v : v);
+        return true;
+    }
+
+    static bool toBool(const char* b, const char* e, bool& out) {
+        string v(b, e);
+        if (v == "1" || v == "true" || v == "yes") { out = true; return true; }
+        if (v == "0" || v == "false" || v == "no") { out = false; return true; }
+        return false;
+    }
+
+    static bool toOpcode(const char* b, const char* e, uint8_t& out) {
+        static const char* names[] = {"nop", "fin", "gimbal", "pitch", "yaw", "airbrake", "chute", "abort", "auto"};
+        string v(b, e);
+        for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (v == names[i]) { out = i; return true; }
+        }
+        return false;
+    }
+
+    static bool toTrigger(const char* b, const char* e, recoveryPhase& out) {
+        string v(b, e);
+        if (v == "apogee") { out = PHASE_APOGEE; return true; }
+        if (v == "main") { out = PHASE_MAIN; return true; }
+        return false;
+    }
+
+    static bool toSide(const char* b, const char* e, const char* one, const char* zero, bool& out) {
+        string v(b, e);
+        if (v == one) { out = true; return true; }
+        if (v == zero) { out = false; return true; }
+        return toBool(b, e, out);
+    }
+
+    void number(int line, const string& key, const char* b, const char* e, float& out) {
+        if (!toFloat(b, e, out)) error(line, key + " must be a number");
+    }
+
+    void integer(int line, const string& key, const char* b, const char* e, int& out) {
+        if (!toInt(b, e, out)) error(line, key + " must be an integer");
+    }
+
+    void setValue(int line, const string& key, const char* b, const char* e) {
+        const char* fb[4];
+        const char* fe[4];
+
+        if (section == "vehicle" && key == "name") {
+            name.assign(b, e);
+        }
+        else if (section == "fins" && key == "count") {
+            integer(line, key, b, e, finCount);
+            sawFinCount = true;
+        }
+        else if (section == "fins" && key == "max_angle") number(line, key, b, e, finMaxAngle);
+        else if (section == "fins" && key == "rate") number(line, key, b, e, finRate);
+        else if (section == "fins" && key == "pitch_gain") number(line, key, b, e, pitchGain);
+        else if (section == "fins" && key == "yaw_gain") number(line, key, b, e, yawGain);
+        else if (section == "fins" && key == "roll_gain") number(line, key, b, e, rollGain);
+        else if (section == "fins" && key == "fin") {
+            // fin = number, left|right, front|back
+            FinSpec f;
+            if (split(b, e, fb, fe, 4) != 3 || !toInt(fb[0], fe[0], f.number) ||
+                !toSide(fb[1], fe[1], "left", "right", f.left) || !toSide(fb[2], fe[2], "front", "back", f.front)) {
+                error(line, "fin must be: number, left|right, front|back");
+                return;
+            }
+            for (const FinSpec& other : fins) {
+                if (other.number == f.number) {
+                    error(line, "fin " + to_string(f.number) + " declared twice");
+                    return;
+                }
+            }
+            fins.push_back(f);
+        }
+        else if (section == "gimbal" && key == "constant") integer(line, key, b, e, gimbalConstant);
+        else if (section == "gimbal" && key == "yaw_offset") number(line, key, b, e, gimbalYawOffset);
+        else if (section == "gimbal" && key == "pitch_offset") number(line, key, b, e, gimbalPitchOffset);
+        else if (section == "gimbal" && key == "limit") number(line, key, b, e, gimbalLimit);
+        else if (section == "gimbal" && key == "rate") number(line, key, b, e, gimbalRate);
+        else if (section == "parachutes" && key == "chute") {
+            // chute = name, deploy sequence[, apogee|main[, delay]]
+            ChuteSpec c;
+            c.trigger = PHASE_APOGEE;
+            c.delay = 0.0f;
+            int n = split(b, e, fb, fe, 4);
+            if (n < 2 || n > 4 || fb[0] == fe[0] || !toInt(fb[1], fe[1], c.sequence) ||
+                (n >= 3 && !toTrigger(fb[2], fe[2], c.trigger)) || (n == 4 && !toFloat(fb[3], fe[3], c.delay))) {
+                error(line, "chute must be: name, deploy sequence[, apogee|main[, delay in seconds]]");
+                return;
+            }
+            c.name.assign(fb[0], fe[0]);
+            for (const ChuteSpec& other : parachutes) {
+                if (other.sequence == c.sequence) {
+                    error(line, "chute " + c.name + " reuses deploy sequence " + to_string(c.sequence) + " of " + other.name);
+                    return;
+                }
+            }
+            parachutes.push_back(c);
+        }
+        else if (section == "recovery" && key == "main_altitude") number(line, key, b, e, recovery.mainAltitude);
+        else if (section == "recovery" && key == "liftoff_accel") number(line, key, b, e, recovery.liftoffAcceleration);
+        else if (section == "recovery" && key == "confirm_time") number(line, key, b, e, recovery.confirmTime);
+        else if (section == "recovery" && key == "min_apogee") number(line, key, b, e, recovery.minApogeeAltitude);
+        else if (section == "recovery" && key == "apogee_timeout") number(line, key, b, e, recovery.apogeeTimeout);
+        else if (section == "recovery" && key == "landed_speed") number(line, key, b, e, recovery.landedSpeed);
+        else if (section == "recovery" && key == "landed_time") number(line, key, b, e, recovery.landedTime);
+        else if (section == "recovery" && key == "drogue_rate") number(line, key, b, e, descent.drogueRate);
+        else if (section == "recovery" && key == "main_rate") number(line, key, b, e, descent.mainRate);
+        else if (section == "recovery" && key == "wind_band") number(line, key, b, e, descent.binHeight);
+        else if (section == "sensors" && key == "sensor") {
+            // sensor = type letter, deadline in seconds
+            SensorSpec s;
+            if (split(b, e, fb, fe, 4) != 2 || fe[0] - fb[0] != 1 || !toFloat(fb[1], fe[1], s.deadlineSeconds)) {
+                error(line, "sensor must be: type letter, deadline in seconds");
+                return;
+            }
+            s.type = *fb[0];
+            if (!(s.deadlineSeconds > 0.0f)) {
+                error(line, string("sensor ") + s.type + " needs a positive deadline");
+                return;
+            }
+            for (const SensorSpec& other : sensors) {
+                if (other.type == s.type) {
+                    error(line, string("sensor ") + s.type + " declared twice");
+                    return;
+                }
+            }
+            sensors.push_back(s);
+        }
+        else if (section == "logger" && key == "flight_log") flightLog.assign(b, e);
+        else if (section == "logger" && key == "error_log") errorLog.assign(b, e);
+        else if (section == "logger" && key == "min_level") {
+            string v(b, e);
+            if (v == "INFO") logLevel = ErrorLogger::Level::INFO;
+            else if (v == "WARNING") logLevel = ErrorLogger::Level::WARNING;
+            else if (v == "ERROR") logLevel = ErrorLogger::Level::ERROR;
+            else if (v == "CRITICAL") logLevel = ErrorLogger::Level::CRITICAL;
+            else error(line, "min_level must be INFO, WARNING, ERROR or CRITICAL");
+        }
+        else if (section == "logger" && key == "replay") integer(line, key, b, e, replayReadings);
+        else if (section == "logger" && key == "ground_log") groundLog.assign(b, e);
+        else if (section == "control" && key == "rate_hz") number(line, key, b, e, controlRateHz);
+        else if (section == "telemetry" && key == "budget") number(line, key, b, e, telemetryBudget);
+        else if (section == "telemetry" && key == "max_frame") integer(line, key, b, e, telemetryMaxFrame);
+        else if (section == "telemetry" && key == "max_latency") number(line, key, b, e, telemetryLatency);
+        else if (section == "telemetry" && key == "jitter") integer(line, key, b, e, telemetryJitter);
+        else if (section == "telemetry" && key == "check") {
+            string v(b, e);
+            if (v == "crc16") telemetryCheck = CHECK_CRC16;
+            else if (v == "crc32") telemetryCheck = CHECK_CRC32;
+            else error(line, "check must be crc16 or crc32");
+        }
+        else if (section == "telemetry" && key == "fec") {
+            // fec = off, or telemetry frames, parity frames per block
+            if (string(b, e) == "off") telemetryFecData = telemetryFecParity = 0;
+            else if (split(b, e, fb, fe, 3) != 2 || !toInt(fb[0], fe[0], telemetryFecData) || !toInt(fb[1], fe[1], telemetryFecParity)) {
+                error(line, "fec must be off or: telemetry frames, parity frames per block");
+            }
+        }
+        else if (section == "telemetry" && key == "stream") {
+            // stream = events|log|attitude|gps|housekeeping, priority, rate in Hz
+            TelemetryStreamSpec t;
+            if (split(b, e, fb, fe, 4) != 3 || !toInt(fb[1], fe[1], t.priority) || !toFloat(fb[2], fe[2], t.rate)) {
+                error(line, "stream must be: events|log|attitude|gps|housekeeping, priority, rate in Hz");
+                return;
+            }
+            t.name.assign(fb[0], fe[0]);
+            if (t.name != "events" && t.name != "log" && t.name != "attitude" && t.name != "gps" && t.name != "housekeeping") {
+                error(line, "unknown stream " + t.name + ", expected events, log, attitude, gps or housekeeping");
+                return;
+            }
+            if (t.priority < 0 || !(t.rate >= 0.0f)) {
+                error(line, "stream " + t.name + " needs a priority and a rate that are not negative");
+                return;
+            }
+            for (const TelemetryStreamSpec& other : telemetryStreams) {
+                if (other.name == t.name) {
+                    error(line, "stream " + t.name + " declared twice");
+                    return;
+                }
+            }
+            telemetryStreams.push_back(t);
+        }
+        else if (section == "commands" && key == "command") {
+            // command = seconds after the loop starts, opcode, target, value
+            CommandSpec c;
+            int target;
+            if (split(b, e, fb, fe, 4) != 4 || !toFloat(fb[0], fe[0], c.time) || !toOpcode(fb[1], fe[1], c.cmd.opcode) ||
+                !toInt(fb[2], fe[2], target) || !toFloat(fb[3], fe[3], c.cmd.value)) {
+                error(line, "command must be: seconds, nop|fin|gimbal|pitch|yaw|airbrake|chute|abort|auto, target, value");
+                return;
+            }
+            if (!(c.time >= 0.0f) || target < 0 || target > 255) {
+                error(line, "command needs a time that is not negative and a target of 0 to 255");
+                return;
+            }
+            c.cmd.target = uint8_t(target);
+            c.cmd.sequence = uint16_t(uplink.size());
+            c.cmd.issuedNs = 0;
+            uplink.push_back(c);
+        }
+        else if (section.empty()) error(line, key + " is outside any section");
+        else error(line, "unknown key " + key + " in [" + section + "]");
+    }
+
+    // Checks that hold across keys, after the whole file is read
+    void validate() {
+        if (!sawFinCount) error(0, "[fins] count is missing");
+        else if (finCount < 1 || finCount > MAX_FINS) error(0, "[fins] count must be 1 to " + to_string(MAX_FINS));
+        else {
+            if (int(fins.size()) != finCount) {
+                error(0, "[fins] count is " + to_string(finCount) + " but " + to_string(fins.size()) + " fins are declared");
+            }
+            for (const FinSpec& f : fins) {
+                if (f.number < 0 || f.number >= finCount) {
+                    error(0, "fin " + to_string(f.number) + " is out of range 0 to " + to_string(finCount - 1));
+                }
+            }
+        }
+        if (!(finMaxAngle > 0.0f && finMaxAngle <= 90.0f)) error(0, "[fins] max_angle must be in (0, 90]");
+        if (finRate < 0.0f) error(0, "[fins] rate must not be negative");
+
+        if (gimbalConstant == 0) error(0, "[gimbal] constant must not be 0");
+        if (!(gimbalLimit > 0.0f && gimbalLimit <= 45.0f)) error(0, "[gimbal] limit must be in (0, 45]");
+        if (gimbalRate < 0.0f) error(0, "[gimbal] rate must not be negative");
+
+        if (parachutes.empty()) error(0, "[parachutes] declares no chute");
+        for (const ChuteSpec& c : parachutes) {
+            if (c.sequence < 0) error(0, "chute " + c.name + " has a negative deploy sequence");
+            if (!(c.delay >= 0.0f)) error(0, "chute " + c.name + " has a negative delay");
+        }
+        if (!(recovery.liftoffAcceleration > 0.0f)) error(0, "[recovery] liftoff_accel must be positive");
+        if (!(recovery.confirmTime >= 0.0f)) error(0, "[recovery] confirm_time must not be negative");
+        if (!(recovery.mainAltitude >= 0.0f)) error(0, "[recovery] main_altitude must not be negative");
+        if (!(recovery.apogeeTimeout >= 0.0f)) error(0, "[recovery] apogee_timeout must not be negative");
+        if (!(recovery.landedSpeed > 0.0f && recovery.landedTime >= 0.0f)) {
+            error(0, "[recovery] landed_speed must be positive and landed_time not negative");
+        }
+        if (!(descent.drogueRate > 0.0f && descent.mainRate > 0.0f)) error(0, "[recovery] drogue_rate and main_rate must be positive");
+        if (!(descent.binHeight > 0.0f)) error(0, "[recovery] wind_band must be positive");
+
+        if (sensors.empty()) error(0, "[sensors] declares no sensor");
+
+        if (flightLog.empty()) error(0, "[logger] flight_log is empty");
+        if (errorLog.empty()) error(0, "[logger] error_log is empty");
+        if (replayReadings < 0) error(0, "[logger] replay must not be negative");
+
+        if (!(controlRateHz > 0.0f && controlRateHz <= 10000.0f)) error(0, "[control] rate_hz must be in (0, 10000]");
+
+        if (!(telemetryBudget > 0.0f)) error(0, "[telemetry] budget must be positive");
+        if (telemetryMaxFrame < 32 || telemetryMaxFrame > int(TELEMETRY_MAX_FRAME)) {
+            error(0, "[telemetry] max_frame must be 32 to " + to_string(TELEMETRY_MAX_FRAME));
+        }
+        if (!(telemetryLatency >= 0.0f)) error(0, "[telemetry] max_latency must not be negative");
+        if (telemetryFecData != 0 && (telemetryFecData < 1 || telemetryFecData > FEC_MAX_DATA ||
+                                      telemetryFecParity < 1 || telemetryFecParity > FEC_MAX_PARITY)) {
+            error(0, "[telemetry] fec needs 1 to " + to_string(FEC_MAX_DATA) + " telemetry frames and 1 to " +
+                     to_string(FEC_MAX_PARITY) + " parity frames");
+        }
+        if (telemetryJitter < 0 || telemetryJitter > GROUND_MAX_WINDOW) {
+            error(0, "[telemetry] jitter must be 0 to " + to_string(GROUND_MAX_WINDOW) + " frames");
+        }
+    }
+};
+
+#endif // VEHICLE_CONFIG_HPP
@@ -7,6 +7,8 @@
 #include <vector>
 #include <ctime>
 #include <iomanip>
+#include <sstream>
+#include <cmath>
 using namespace std;
 
 struct Coordinates{
@@ -90,6 +92,17 @@ class DataLogger{
     file << formatDataForFile(node->logs) << endl;
     }
 
+    // Writes a free text summary (e.g. loop latencies), replacing the file's contents. Give it a file of
+    // its own: ReadFromFile parses every line of a flight log as a reading
+    void writeSummary(const string& text){
+    ofstream file(logFilePath, ios::trunc);
+    if (!file) {
+        throw runtime_error("Unable to open file for writing: " + logFilePath);
+    }
+
+    file << text;
+    }
+
     Logs parseDataFromFile(const string& line) const {
         stringstream ss(line);
         string token;
@@ -2,22 +2,43 @@
 #include "ControlLoop.hpp"
 #include "Sensing.hpp"
 #include "Logger.hpp"
+#include "Scheduler.hpp"
+#include "Config.hpp"
 
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
 
-    int choice, num;
+    int choice;
     bool landed = false;
     float yaw,pitch;
-    ControlQueue commands;
+    mpscRing<command, 64> commands; // from the ground / command thread to the control loop
+    commandLatency commandTimes;
+    LatencyMonitor latency; // sample timestamp to fin output, readable from any thread while the loop runs
+
+    // The vehicle description decides everything below: fins, gimbal, chutes, sensors and logs
+    VehicleConfig Vehicle;
+    string VehicleFile = argc > 1 ? argv[1] : "vehicle.ini";
+    try
+    {
+        if (!Vehicle.load(VehicleFile))
+        {
+            cerr << VehicleFile << " is invalid:" << endl << Vehicle.errorReport();
+            return 1;
+        }
+    }
+    catch (const exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
 
     // First we load the file
-    DataLogger Example("LastFlight.log");
+    DataLogger Example(Vehicle.flightLog);
     Example.ReadFromFile();
 
-    ErrorLogger Errors;
+    ErrorLogger Errors(Vehicle.errorLog, Vehicle.logLevel);
 
     Errors.warning("Auto-generated warning (for demo) -- SAFE TO IGNORE");
     Errors.critical("Auto-generated critical error (for demo) -- SAFE TO IGNORE");
@@ -26,10 +47,13 @@ int main()
     // but this system can be extended for as many data points as you like
     RocketSensors::FastList PitchList, YawList;
     RocketSensors::BinarySearchTree Sensors;
-    Sensors.create('P', 10000);
-    Sensors.create('Y', 10000);
-    RocketSensors::DeadlineStack *PitchRaw;
-    RocketSensors::DeadlineStack *YawRaw;
+    Vehicle.buildSensors(Sensors);
+    RocketSensors::DeadlineStack *PitchRaw = nullptr;
+    RocketSensors::DeadlineStack *YawRaw = nullptr;
+    RocketSensors::DeadlineStack *AltitudeRaw = nullptr;     // optional, recovery runs only with all three
+    RocketSensors::DeadlineStack *VelocityRaw = nullptr;
+    RocketSensors::DeadlineStack *AccelerationRaw = nullptr;
+    RocketSensors::DeadlineStack *PositionRaw = nullptr;     // optional GPS position, for the landing prediction
 
     RocketSensors::Sensor *SensorRoot = Sensors.GetRoot();
     RocketSensors::Sensor *SensorPosition = SensorRoot;
@@ -44,11 +68,37 @@ int main()
         {
             YawRaw = &(SensorPosition->Raw);
         }
+        else if (SensorPosition->getType() == 'H')
+        {
+            AltitudeRaw = &(SensorPosition->Raw);
+        }
+        else if (SensorPosition->getType() == 'V')
+        {
+            VelocityRaw = &(SensorPosition->Raw);
+        }
+        else if (SensorPosition->getType() == 'L')
+        {
+            AccelerationRaw = &(SensorPosition->Raw);
+        }
+        else if (SensorPosition->getType() == 'N')
+        {
+            PositionRaw = &(SensorPosition->Raw);
+        }
 
         SensorPosition = Sensors.Traverse(SensorPosition);
     }
 
-    vector<Logs> LastTenReadings = Example.getLastNReadings(10);
+    if (!PitchRaw || !YawRaw)
+    {
+        cerr << VehicleFile << " must declare a pitch (P) and a yaw (Y) sensor" << endl;
+        return 1;
+    }
+
+    bool recoveryStreams = AltitudeRaw && VelocityRaw && AccelerationRaw;
+    RocketSensors::FastList AltitudeList, VelocityList, AccelerationList;
+
+    // Newest reading first, so the stacks pop them back in flight order
+    vector<Logs> LastTenReadings = Example.getLastNReadings(Vehicle.replayReadings);
 
     for (Logs Reading : LastTenReadings)
     {
@@ -57,9 +107,27 @@ int main()
 
         RocketSensors::TransferToDeadlineStack(PitchList, *PitchRaw);
         RocketSensors::TransferToDeadlineStack(YawList, *YawRaw);
+
+        if (recoveryStreams)
+        {
+            AltitudeList.Insert(float(Reading.gps.altitude));
+            VelocityList.Insert(float(Reading.velocity));
+            AccelerationList.Insert(float(Reading.acceleration));
+
+            RocketSensors::TransferToDeadlineStack(AltitudeList, *AltitudeRaw);
+            RocketSensors::TransferToDeadlineStack(VelocityList, *VelocityRaw);
+            RocketSensors::TransferToDeadlineStack(AccelerationList, *AccelerationRaw);
+        }
+
+        // The fixes GPSParser would publish in flight
+        if (PositionRaw)
+        {
+            PositionRaw->Insert(RocketPhysics::Vector3D(float(Reading.gps.latitude), float(Reading.gps.longitude), float(Reading.gps.altitude), 'N'),
+                                chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()));
+        }
     }
 
-    cout << "Welcome to Project SENTINEL" << endl;
+    cout << "Welcome to Project " << Vehicle.name << endl;
     cout << "Please select 1 to intitiate preloaded flight sequence, 0 to terminate: ";
     cin >> choice;
 
@@ -68,45 +136,296 @@ int main()
         cout << "Initiating flight sequence." << endl;
         sleep_for(1000);
         cout << "Initialising control surfaces" << endl;
-        cout << "Please enter number of grid fins: ";
-        cin >> num;
 
-        gridSystem fins(num);
-        parachute Chutes[5];
-        Chutes[0].DeploySequence = 1;
-        Chutes[1].DeploySequence = 2;
-        Chutes[2].DeploySequence = 0;
-        Chutes[3].DeploySequence = 3;
-        Chutes[4].DeploySequence = 4;
+        gridSystem fins(Vehicle.finCount);
+        if (!Vehicle.buildFins(fins))
+        {
+            cerr << VehicleFile << ": the fins do not fit a " << Vehicle.finCount << " fin grid" << endl;
+            return 1;
+        }
+        gimbal engine = Vehicle.makeGimbal();
+        bool manualFins = false; // set by fin commands from the ground, cleared by CMD_AUTO
+        vector<parachute> Chutes = Vehicle.makeParachutes();
+        int numChutes = int(Chutes.size());
+        bubbleSort(Chutes.data(), numChutes);
+
+        // Apogee and main charges fire from the live altitude, velocity and acceleration, not after the loop
+        recoveryController recovery;
+        Vehicle.buildRecovery(recovery, Chutes);
+        float flightTime = 0.0f, altitude = 0.0f, verticalVelocity = 0.0f, acceleration = 0.0f;
+        bool haveRecoveryData = false;
 
+        // Where the vehicle will come down, updated with every fix once the chutes are out
+        landingPredictor landing = Vehicle.makeLandingPredictor();
+        RocketSensors::GPSFix fix;
+        bool haveFix = false;
 
-        for (int i = 0; i < num; i++)
+        // Downlink: the [telemetry] streams, as much as the radio budget carries, events first
+        TelemetryStreams streams;
+        TelemetryScheduler telemetry = Vehicle.makeTelemetry(streams);
+        uint8_t frame[TELEMETRY_MAX_ENCODED];
+        FecEncoder fec = Vehicle.makeFec();
+        // On the bench the radio is a loopback. The driver stub only queues the bytes, as a UART would; a ground
+        // thread takes them off the queue into the ground station, which decodes and logs them, so nothing on
+        // the control loop's side allocates or writes files
+        DataLogger GroundLog(Vehicle.groundLog);
+        GroundStation ground = Vehicle.makeGroundStation(Vehicle.groundLog.empty() ? nullptr : &GroundLog);
+        spscRing<uint8_t, 1 << 16> air;
+        uint64_t airOverflow = 0; // bytes the queue had no room for, lost as on a radio
+        auto radio = [&](const uint8_t* wire, size_t length)
         {
-            fins.addNew();
-        }
-        while (landed == false)
+            for (size_t i = 0; i < length; i++)
+            {
+                if (!air.tryPush(wire[i]))
+                    airOverflow++;
+            }
+        };
+        atomic<bool> airOpen(true);
+        bool groundFailed = false; // set by the ground thread, read after it is joined
+        thread groundThread([&]()
         {
+            uint8_t chunk[256];
             try
             {
-                RocketSensors::Node* PitchLatest = PitchRaw->Pop();
-                RocketSensors::Node* YawLatest = YawRaw->Pop();
-
-                pitch = PitchLatest->Get1D();
-                yaw = YawLatest->Get1D();
+                while (true)
+                {
+                    bool open = airOpen.load();
+                    size_t length = 0;
+                    while (length < sizeof(chunk) && air.tryPop(chunk[length]))
+                        length++;
+                    if (length)
+                        ground.receive(chunk, length);
+                    else if (!open)
+                        return;
+                    else
+                        this_thread::sleep_for(chrono::milliseconds(1));
+                }
             }
-            catch(...)
+            catch (const runtime_error& e)
+            {
+                // The ground log cannot be written: report it and stop draining. Once the queue is full the
+                // radio stub counts the rest of the downlink as overflow, and the flight goes on
+                Errors.error(e.what());
+                groundFailed = true;
+            }
+        });
+        auto downlink = [&](size_t length)
+        {
+            if (length == 0)
+                return;
+            if (Vehicle.telemetryFec())
+                fec.encode(frame, length, radio);
+            else
+                radio(frame, length);
+        };
+        recoveryPhase reportedPhase = PHASE_ARMED;
+
+        // Sense -> control cycle at the configured rate, until the sensor streams run dry
+        ControlExecutive executive(Vehicle.controlPeriodNs());
+
+        executive.setStage(ControlExecutive::SENSE, [&]()
+        {
+            RocketSensors::Node* PitchLatest = PitchRaw->TryPop();
+            RocketSensors::Node* YawLatest = YawRaw->TryPop();
+
+            latency.setStaleSamples(PitchRaw->GetStaleCount() + YawRaw->GetStaleCount());
+
+            if (!PitchLatest || !YawLatest)
             {
+                delete PitchLatest;
+                delete YawLatest;
                 landed = true;
+                executive.requestStop();
+                return;
             }
 
-            gkeepvertical(fins,pitch,yaw);
-        }
+            pitch = PitchLatest->Get1D();
+            yaw = YawLatest->Get1D();
+
+            int64_t oldest = min(PitchLatest->TimeStamp, YawLatest->TimeStamp).count() * 1000000LL;
+            latency.sensed(wallClockNs() - oldest, monotonicNs());
+            delete PitchLatest;
+            delete YawLatest;
+
+            haveRecoveryData = false;
+            if (recoveryStreams)
+            {
+                RocketSensors::Node* AltitudeLatest = AltitudeRaw->TryPop();
+                RocketSensors::Node* VelocityLatest = VelocityRaw->TryPop();
+                RocketSensors::Node* AccelerationLatest = AccelerationRaw->TryPop();
+                if (AltitudeLatest && VelocityLatest && AccelerationLatest)
+                {
+                    altitude = AltitudeLatest->Get1D();
+                    verticalVelocity = VelocityLatest->Get1D();
+                    acceleration = AccelerationLatest->Get1D();
+                    haveRecoveryData = true;
+                }
+                delete AltitudeLatest;
+                delete VelocityLatest;
+                delete AccelerationLatest;
+            }
+
+            haveFix = false;
+            if (PositionRaw)
+            {
+                RocketSensors::Node* PositionLatest = PositionRaw->TryPop();
+                if (PositionLatest)
+                {
+                    fix.Valid = true;
+                    fix.Latitude = PositionLatest->Data.Vect3D.GetX();
+                    fix.Longitude = PositionLatest->Data.Vect3D.GetY();
+                    fix.Altitude = PositionLatest->Data.Vect3D.GetZ();
+                    haveFix = true;
+                }
+                delete PositionLatest;
+            }
+        });
+
+        executive.setStage(ControlExecutive::CONTROL, [&]()
+        {
+            if (!landed)
+            {
+                if (!manualFins)
+                    gkeepvertical(fins, pitch, yaw);
+                if (haveRecoveryData)
+                    recovery.update(flightTime, altitude, verticalVelocity, acceleration);
+                if (haveFix && haveRecoveryData)
+                    landing.update(flightTime, fix, altitude, verticalVelocity, recovery.getPhase());
+                latency.controlled(monotonicNs());
+            }
+            flightTime += float(executive.getPeriod()) * 1e-9f;
+        });
+
+        executive.setStage(ControlExecutive::ACTUATE, [&]()
+        {
+            // The fin angles set by the control stage go out here
+            latency.actuated(monotonicNs());
+            command c;
+            while (commands.tryPop(c))
+            {
+                commandTimes.record(monotonicNs() - c.issuedNs);
+                if (!executeCommand(c, fins, engine, Vehicle.gimbalLimit, recovery, flightTime, manualFins))
+                {
+                    landed = true;
+                    executive.requestStop();
+                }
+            }
+        });
 
-        bubbleSort(Chutes, 5);
+        executive.setStage(ControlExecutive::LOG, [&]()
+        {
+            double t = flightTime;
+            if (recovery.getPhase() != reportedPhase)
+            {
+                reportedPhase = recovery.getPhase();
+                telemetry.offer<EventMessage>(streams.events, FlightEvent(t, reportedPhase, altitude), t);
+            }
+            telemetry.offer<AttitudeMessage>(streams.attitude, AttitudeSample(t, pitch, yaw, 0.0), t);
+            if (haveFix)
+                telemetry.offer<GPSMessage>(streams.gps, fix, t);
+            if (haveRecoveryData)
+            {
+                // no temperature or pressure sensor feeds the loop, those stay 0
+                Logs reading;
+                reading.timestamp = t;
+                reading.gps = Coordinates(haveFix ? fix.Latitude : 0.0, haveFix ? fix.Longitude : 0.0, altitude);
+                reading.velocity = verticalVelocity;
+                reading.acceleration = acceleration;
+                telemetry.offer<LogMessage>(streams.log, reading, t);
+            }
 
-        for (auto& chute: Chutes){
-            sleep_for(1000);
-            chute.deploychute();
+            HousekeepingSample health;
+            health.time = t;
+            health.phase = recovery.getPhase();
+            health.chargesFired = recovery.firedCount();
+            health.overruns = executive.getStats().overruns;
+            health.staleSamples = PitchRaw->GetStaleCount() + YawRaw->GetStaleCount();
+            health.maxExecutionMs = executive.getStats().maxExecutionNs / 1e6;
+            telemetry.offer<HousekeepingMessage>(streams.housekeeping, health, t);
+
+            // The radio driver sends the frame, if one is due
+            downlink(telemetry.poll(t, frame));
+        });
+
+        // Bench uplink: sends the [commands] of the vehicle file while the loop runs, as the ground station would
+        atomic<bool> loopRunning(true);
+        thread uplink([&]()
+        {
+            int64_t start = monotonicNs();
+            for (const CommandSpec& spec : Vehicle.uplink)
+            {
+                int64_t due = start + int64_t(double(spec.time) * 1e9);
+                while (loopRunning.load() && monotonicNs() < due)
+                    sleepUntilNs(min(due, monotonicNs() + executive.getPeriod()));
+                command c = spec.cmd;
+                c.issuedNs = monotonicNs();
+                while (loopRunning.load() && !commands.tryPush(c))
+                    this_thread::yield();
+                if (!loopRunning.load())
+                    return;
+            }
+        });
+
+        cout << "Control loop engaged." << endl;
+        executive.run();
+        loopRunning = false;
+        uplink.join();
+        // What the loop left queued goes down after it, within the budget
+        while (size_t length = telemetry.flush(flightTime, frame))
+            downlink(length);
+        if (Vehicle.telemetryFec())
+            fec.flush(radio);
+        airOpen = false;
+        groundThread.join();
+        if (!groundFailed)
+            ground.flush();
+        executive.report(cout);
+        if (commandTimes.count)
+            cout << commandTimes.count << " commands, enqueue to execute mean " << commandTimes.meanNs() / 1000.0
+                 << " us, max " << commandTimes.maxNs / 1000.0 << " us; gimbal at " << engine.axis1 << ", "
+                 << engine.axis2 << " degrees" << endl;
+
+        LatencyMonitor::Snapshot loopLatency = latency.snapshot();
+        LatencyMonitor::report(loopLatency, cout);
+        if (recoveryStreams)
+            recovery.report(cout);
+        else
+            cout << "Recovery not run: " << VehicleFile << " declares no altitude (H), velocity (V) and acceleration (L) sensors" << endl;
+        if (PositionRaw)
+            landing.report(cout);
+        telemetry.report(cout);
+        if (Vehicle.telemetryFec())
+            fec.report(cout);
+        ground.report(cout);
+        if (airOverflow)
+            cout << "  " << airOverflow << " bytes lost: the radio queue was full" << endl;
+
+        // Announce the charges fired during the flight
+        for (auto& chute : Chutes)
+        {
+            if (chute.pyrocharge)
+                chute.deploychute();
+        }
+
+        // The summary goes beside the flight log, not into it: the flight log is the replay input of the next run
+        try
+        {
+            stringstream summary;
+            LatencyMonitor::report(loopLatency, summary);
+            if (recoveryStreams)
+                recovery.report(summary);
+            if (PositionRaw)
+                landing.report(summary);
+            telemetry.report(summary);
+            if (Vehicle.telemetryFec())
+                fec.report(summary);
+            ground.report(summary);
+            DataLogger SummaryLog(Vehicle.flightLog + ".summary");
+            SummaryLog.writeSummary(summary.str());
+        }
+        catch (const exception& e)
+        {
+            Errors.error(e.what());
         }
 
         cout << "General Information" << endl;
@@ -0,0 +1,66 @@
+#ifndef BINARY_HEAP_HPP
+#define BINARY_HEAP_HPP
+
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+using namespace std;
+
+// Array backed binary min-heap: top() is the element for which Less is true against every other element.
+// Reserve capacity up front and push/pop never allocate
+template <typename T, typename Less>
+class BinaryHeap {
+private:
+    vector<T> items;
+    Less less;
+
+    void siftUp(size_t i) {
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (!less(items[i], items[parent])) break;
+            swap(items[i], items[parent]);
+            i = parent;
+        }
+    }
+
+    void siftDown(size_t i) {
+        size_t n = items.size();
+        while (true) {
+            size_t left = 2 * i + 1, right = left + 1, best = i;
+            if (left < n && less(items[left], items[best])) best = left;
+            if (right < n && less(items[right], items[best])) best = right;
+            if (best == i) break;
+            swap(items[i], items[best]);
+            i = best;
+        }
+    }
+
+public:
+    BinaryHeap(Less comparison = Less()) : less(comparison) {}
+
+    void reserve(size_t capacity) { items.reserve(capacity); }
+    bool empty() const { return items.empty(); }
+    size_t size() const { return items.size(); }
+    void clear() { items.clear(); }
+
+    void push(const T& item) {
+        items.push_back(item);
+        siftUp(items.size() - 1);
+    }
+
+    const T& top() const {
+        if (items.empty()) throw runtime_error("Heap is empty");
+        return items.front();
+    }
+
+    T pop() {
+        if (items.empty()) throw runtime_error("Heap is empty");
+        T result = items.front();
+        items.front() = items.back();
+        items.pop_back();
+        if (!items.empty()) siftDown(0);
+        return result;
+    }
+};
+
+#endif // BINARY_HEAP_HPP
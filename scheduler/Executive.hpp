@@ -0,0 +1,178 @@
+#ifndef EXECUTIVE_HPP
+#define EXECUTIVE_HPP
+
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <iomanip>
+using namespace std;
+
+// Monotonic clock in nanoseconds
+inline int64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// Sleeps until an absolute time on the monotonic clock, resuming after signals
+inline void sleepUntilNs(int64_t wakeNs) {
+    timespec ts;
+    ts.tv_sec = time_t(wakeNs / 1000000000LL);
+    ts.tv_nsec = long(wakeNs % 1000000000LL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+// Moves the calling thread to SCHED_FIFO and locks memory so page faults cannot stall a cycle.
+// Needs root or CAP_SYS_NICE, returns false (and changes nothing) without it
+inline bool enableRealtime(int priority = 80) {
+    sched_param param;
+    param.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) return false;
+    mlockall(MCL_CURRENT | MCL_FUTURE);
+    return true;
+}
+
+// Saves the format flags, precision and fill of a stream and puts them back when it goes out of scope.
+// Every report() takes one first, so fixed/setprecision inside a report do not leak into the caller's output
+class StreamStateGuard {
+private:
+    ostream& out;
+    ios_base::fmtflags flags;
+    streamsize precision;
+    char fill;
+
+public:
+    explicit StreamStateGuard(ostream& stream)
+        : out(stream), flags(stream.flags()), precision(stream.precision()), fill(stream.fill()) {}
+
+    ~StreamStateGuard() {
+        out.flags(flags);
+        out.precision(precision);
+        out.fill(fill);
+    }
+
+    StreamStateGuard(const StreamStateGuard&) = delete;
+    StreamStateGuard& operator=(const StreamStateGuard&) = delete;
+};
+
+struct CycleStats {
+    uint64_t cycles;
+    uint64_t overruns;        // cycles that finished after the next release time
+    uint64_t skippedReleases; // releases dropped to get back in phase after an overrun
+    int64_t minJitterNs;      // wake-up time minus release time
+    int64_t maxJitterNs;
+    double meanJitterNs;
+    int64_t maxExecutionNs;   // release-to-finish time of the slowest cycle
+    int64_t maxStageNs[5];    // slowest run of each stage
+
+    CycleStats():
+        cycles(0), overruns(0), skippedReleases(0), minJitterNs(0), maxJitterNs(0),
+        meanJitterNs(0.0), maxExecutionNs(0), maxStageNs{0, 0, 0, 0, 0} {}
+};
+
+// Fixed rate executive: every period it runs sense -> estimate -> control -> actuate -> log.
+// Releases are absolute (start + n * period), so the rate does not drift with the time spent in the stages.
+// The cycle loop only reads the clock and updates counters; print the statistics with report() afterwards
+class ControlExecutive {
+public:
+    enum Stage {
+        SENSE = 0,
+        ESTIMATE,
+        CONTROL,
+        ACTUATE,
+        LOG,
+        STAGE_COUNT
+    };
+
+private:
+    int64_t periodNs;
+    function<void()> stages[STAGE_COUNT];
+    bool stopRequested;
+    CycleStats stats;
+    double jitterSum;
+
+public:
+    ControlExecutive(int64_t period = 10000000) // 10 ms, 100 Hz
+        : periodNs(period), stopRequested(false), jitterSum(0.0) {}
+
+    // Sets the work done in one stage of every cycle, stages left empty are skipped
+    void setStage(Stage stage, function<void()> work) {
+        stages[stage] = work;
+    }
+
+    void setPeriod(int64_t period) { periodNs = period; }
+    int64_t getPeriod() const { return periodNs; }
+
+    // Can be called from a stage, the current cycle completes and run() returns
+    void requestStop() { stopRequested = true; }
+
+    // Runs cycles until requestStop() or until maxCycles have run (0 for no limit)
+    const CycleStats& run(uint64_t maxCycles = 0) {
+        stopRequested = false;
+        stats = CycleStats();
+        jitterSum = 0.0;
+        stats.minJitterNs = INT64_MAX;
+
+        int64_t release = monotonicNs() + periodNs;
+
+        while (!stopRequested && (maxCycles == 0 || stats.cycles < maxCycles)) {
+            sleepUntilNs(release);
+            int64_t wake = monotonicNs();
+
+            int64_t jitter = wake - release;
+            jitterSum += double(jitter);
+            if (jitter < stats.minJitterNs) stats.minJitterNs = jitter;
+            if (jitter > stats.maxJitterNs) stats.maxJitterNs = jitter;
+
+            int64_t stageStart = wake;
+            for (int s = 0; s < STAGE_COUNT; s++) {
+                if (!stages[s]) continue;
+                stages[s]();
+                int64_t stageEnd = monotonicNs();
+                if (stageEnd - stageStart > stats.maxStageNs[s]) stats.maxStageNs[s] = stageEnd - stageStart;
+                stageStart = stageEnd;
+            }
+
+            int64_t execution = stageStart - release;
+            if (execution > stats.maxExecutionNs) stats.maxExecutionNs = execution;
+            stats.cycles++;
+
+            release += periodNs;
+            if (stageStart > release) {
+                // Overran into the next period: drop the releases already missed instead of running them back to back
+                stats.overruns++;
+                int64_t missed = (stageStart - release) / periodNs + 1;
+                stats.skippedReleases += uint64_t(missed);
+                release += missed * periodNs;
+            }
+        }
+
+        if (stats.cycles == 0) stats.minJitterNs = 0;
+        else stats.meanJitterNs = jitterSum / double(stats.cycles);
+        return stats;
+    }
+
+    const CycleStats& getStats() const { return stats; }
+
+    void report(ostream& out) const {
+        static const char* names[STAGE_COUNT] = {"sense", "estimate", "control", "actuate", "log"};
+        StreamStateGuard restore(out);
+
+        out << fixed << setprecision(1)
+            << "Control executive: " << stats.cycles << " cycles at " << 1e9 / double(periodNs) << " Hz, "
+            << stats.overruns << " overruns (" << stats.skippedReleases << " releases skipped)" << endl
+            << "  jitter  min " << stats.minJitterNs / 1000.0 << " us, mean " << stats.meanJitterNs / 1000.0
+            << " us, max " << stats.maxJitterNs / 1000.0 << " us" << endl
+            << "  worst cycle " << stats.maxExecutionNs / 1000.0 << " us of " << periodNs / 1000.0 << " us" << endl;
+
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            if (stages[s]) out << "  " << left << setw(9) << names[s] << right << stats.maxStageNs[s] / 1000.0 << " us max" << endl;
+        }
+    }
+};
+
+#endif // EXECUTIVE_HPP
@@ -0,0 +1,233 @@
+#ifndef LATENCY_MONITOR_HPP
+#define LATENCY_MONITOR_HPP
+
+#include "Executive.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <iomanip>
+using namespace std;
+
+// Wall clock in nanoseconds, the clock sensor timestamps (Node::TimeStamp) are taken on
+inline int64_t wallClockNs() {
+    return int64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count());
+}
+
+struct LatencySnapshot {
+    uint64_t count;
+    int64_t minNs, maxNs;
+    double meanNs;
+    int64_t p50Ns, p90Ns, p99Ns, p999Ns;
+};
+
+// Log-linear latency histogram in the style of HdrHistogram: exact below 64 ns, then 32 buckets per power
+// of two, so a percentile is never more than 1/32 (about 3%) above the true value. Fixed size, no allocation.
+// One thread records (relaxed loads and stores, no locked instructions), any thread may read at any time;
+// a reader racing the writer can be one sample behind on some counters, never torn
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int64_t SUB_COUNT = 1 << SUB_BITS;   // buckets per power of two
+    static const int MAX_BITS = 40;                   // about 18 minutes, longer latencies share the last bucket
+    static const size_t BUCKETS = size_t(MAX_BITS - SUB_BITS + 1) * SUB_COUNT + SUB_COUNT;
+
+private:
+    atomic<uint64_t> counts[BUCKETS];
+    atomic<uint64_t> total;
+    atomic<int64_t> sumNs;
+    atomic<int64_t> minNs, maxNs;
+
+    static void bump(atomic<uint64_t>& counter) {
+        counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+public:
+    LatencyHistogram() { reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    static size_t bucketOf(int64_t ns) {
+        uint64_t v = ns < 0 ? 0 : uint64_t(ns);
+        if (v < uint64_t(2 * SUB_COUNT)) return size_t(v);
+        int msb = 63 - __builtin_clzll(v);
+        if (msb > MAX_BITS) return BUCKETS - 1;
+        int shift = msb - SUB_BITS;
+        return size_t(shift) * SUB_COUNT + size_t(v >> shift);
+    }
+
+    // Largest latency that falls in bucket i
+    static int64_t highestIn(size_t i) {
+        if (i < size_t(2 * SUB_COUNT)) return int64_t(i);
+        int shift = int(i / SUB_COUNT) - 1;
+        int64_t mantissa = int64_t(i) - int64_t(shift) * SUB_COUNT;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    // Hot path: a few relaxed loads and stores, no branches on the data beyond min/max
+    void record(int64_t ns) {
+        if (ns < 0) ns = 0;
+        bump(counts[bucketOf(ns)]);
+        sumNs.store(sumNs.load(memory_order_relaxed) + ns, memory_order_relaxed);
+        if (ns > maxNs.load(memory_order_relaxed)) maxNs.store(ns, memory_order_relaxed);
+        if (ns < minNs.load(memory_order_relaxed)) minNs.store(ns, memory_order_relaxed);
+        total.store(total.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+    // Not safe against a concurrent record(), call while the loop is stopped
+    void reset() {
+        for (size_t i = 0; i < BUCKETS; i++) counts[i].store(0, memory_order_relaxed);
+        total.store(0, memory_order_relaxed);
+        sumNs.store(0, memory_order_relaxed);
+        minNs.store(INT64_MAX, memory_order_relaxed);
+        maxNs.store(0, memory_order_relaxed);
+    }
+
+    uint64_t count() const { return total.load(memory_order_acquire); }
+
+    // For each fraction (0..1, ascending) the smallest latency at or above that fraction of the samples,
+    // as the top of its bucket but never above the largest latency recorded. One pass over the buckets
+    void percentiles(const double* fractions, int64_t* out, int k) const {
+        uint64_t n = 0;
+        for (size_t i = 0; i < BUCKETS; i++) n += counts[i].load(memory_order_relaxed);
+        int64_t largest = maxNs.load(memory_order_relaxed);
+
+        uint64_t seen = 0;
+        size_t i = 0;
+        for (int j = 0; j < k; j++) {
+            if (n == 0) { out[j] = 0; continue; }
+            uint64_t target = uint64_t(fractions[j] * double(n) + 0.999999);
+            if (target < 1) target = 1;
+            if (target > n) target = n;
+            while (i < BUCKETS && seen + counts[i].load(memory_order_relaxed) < target) seen += counts[i++].load(memory_order_relaxed);
+            out[j] = i < BUCKETS && highestIn(i) < largest ? highestIn(i) : largest;
+        }
+    }
+
+    int64_t percentile(double fraction) const {
+        int64_t value;
+        percentiles(&fraction, &value, 1);
+        return value;
+    }
+
+    LatencySnapshot snapshot() const {
+        LatencySnapshot s;
+        s.count = count();
+        s.minNs = s.count ? minNs.load(memory_order_relaxed) : 0;
+        s.maxNs = maxNs.load(memory_order_relaxed);
+        s.meanNs = s.count ? double(sumNs.load(memory_order_relaxed)) / double(s.count) : 0.0;
+        const double fractions[4] = {0.50, 0.90, 0.99, 0.999};
+        int64_t values[4];
+        percentiles(fractions, values, 4);
+        s.p50Ns = values[0];
+        s.p90Ns = values[1];
+        s.p99Ns = values[2];
+        s.p999Ns = values[3];
+        return s;
+    }
+};
+
+// Sensor-to-actuator latency of the control loop, broken into stages:
+//   sample age          sample timestamp (wall clock) to the sense stage reading it
+//   sense to control    the sense stage to the control law finishing
+//   control to actuate  the control law to the actuator outputs being written
+//   end to end          sample timestamp to actuator output, the sum of the three
+// plus the number of cycles and of samples the deadline windows rejected as stale.
+// The loop thread calls sensed / controlled / actuated once each per cycle; snapshot() can be called from
+// any thread while it runs, e.g. by telemetry
+class LatencyMonitor {
+public:
+    enum Stage {
+        SAMPLE_AGE = 0,
+        SENSE_TO_CONTROL,
+        CONTROL_TO_ACTUATE,
+        END_TO_END,
+        STAGE_COUNT
+    };
+
+    struct Snapshot {
+        LatencySnapshot stages[STAGE_COUNT];
+        uint64_t cycles;
+        uint64_t staleSamples;
+    };
+
+private:
+    LatencyHistogram histograms[STAGE_COUNT];
+    atomic<uint64_t> cycles;
+    atomic<uint64_t> stale;
+
+    // Loop thread only
+    int64_t ageNs, senseNs, controlNs;
+    bool haveSense, haveControl;
+
+public:
+    LatencyMonitor() : cycles(0), stale(0), ageNs(0), senseNs(0), controlNs(0), haveSense(false), haveControl(false) {}
+
+    // sampleAgeNs: how old the oldest sample used this cycle was when read; nowNs on the monotonic clock
+    void sensed(int64_t sampleAgeNs, int64_t nowNs) {
+        histograms[SAMPLE_AGE].record(sampleAgeNs);
+        ageNs = sampleAgeNs;
+        senseNs = nowNs;
+        haveSense = true;
+        haveControl = false;
+    }
+
+    void controlled(int64_t nowNs) {
+        if (!haveSense) return;
+        histograms[SENSE_TO_CONTROL].record(nowNs - senseNs);
+        controlNs = nowNs;
+        haveControl = true;
+    }
+
+    // Closes the cycle; cycles without a fresh sense are counted but add no latency
+    void actuated(int64_t nowNs) {
+        if (haveSense) {
+            if (haveControl) histograms[CONTROL_TO_ACTUATE].record(nowNs - controlNs);
+            histograms[END_TO_END].record(ageNs + nowNs - senseNs);
+        }
+        haveSense = haveControl = false;
+        cycles.store(cycles.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    // Total stale rejections of the streams the loop reads, e.g. the sum of their DeadlineStack::GetStaleCount()
+    void setStaleSamples(uint64_t total) { stale.store(total, memory_order_relaxed); }
+
+    const LatencyHistogram& histogram(Stage stage) const { return histograms[stage]; }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        for (int i = 0; i < STAGE_COUNT; i++) s.stages[i] = histograms[i].snapshot();
+        s.cycles = cycles.load(memory_order_relaxed);
+        s.staleSamples = stale.load(memory_order_relaxed);
+        return s;
+    }
+
+    // Call while the loop is stopped
+    void reset() {
+        for (int i = 0; i < STAGE_COUNT; i++) histograms[i].reset();
+        cycles.store(0, memory_order_relaxed);
+        stale.store(0, memory_order_relaxed);
+        haveSense = haveControl = false;
+    }
+
+    static void report(const Snapshot& s, ostream& out) {
+        static const char* names[STAGE_COUNT] = {"sample age", "sense to control", "control to actuate", "end to end"};
+        StreamStateGuard restore(out);
+
+        out << fixed << setprecision(1)
+            << "Sensor to actuator latency: " << s.cycles << " cycles, " << s.staleSamples << " stale samples rejected" << endl;
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            const LatencySnapshot& l = s.stages[i];
+            if (l.count == 0) continue;
+            out << "  " << left << setw(19) << names[i] << right
+                << "p50 " << l.p50Ns / 1000.0 << " us, p99 " << l.p99Ns / 1000.0 << " us, p99.9 " << l.p999Ns / 1000.0
+                << " us, max " << l.maxNs / 1000.0 << " us" << endl;
+        }
+    }
+
+    void report(ostream& out) const { report(snapshot(), out); }
+};
+
+#endif // LATENCY_MONITOR_HPP
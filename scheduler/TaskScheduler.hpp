@@ -0,0 +1,277 @@
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+
+#include "Executive.hpp"
+#include "BinaryHeap.hpp"
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+struct TaskStats {
+    uint64_t releases;
+    uint64_t completed;
+    uint64_t deadlineMisses;  // jobs finished after their deadline, plus skipped releases
+    uint64_t skippedReleases; // released while the previous job had not run yet
+    uint64_t budgetOverruns;  // jobs that ran longer than the declared WCET
+    int64_t maxExecutionNs;
+    int64_t maxResponseNs;    // release to finish
+    double totalExecutionNs;
+
+    TaskStats():
+        releases(0), completed(0), deadlineMisses(0), skippedReleases(0), budgetOverruns(0),
+        maxExecutionNs(0), maxResponseNs(0), totalExecutionNs(0.0) {}
+};
+
+// Cooperative (non-preemptive) multi-rate scheduler. Each task declares a period, a relative deadline and a
+// worst case execution time; released jobs wait in a binary heap ordered by absolute deadline (EDF) or by
+// rate-monotonic priority, with release order breaking ties so equal priorities take turns (round robin).
+// Tasks are admitted only if the set stays schedulable, counting the blocking a non-preemptive job causes
+class TaskScheduler {
+public:
+    enum class Policy {
+        EDF,
+        RATE_MONOTONIC
+    };
+
+private:
+    struct Task {
+        string name;
+        int64_t periodNs, deadlineNs, wcetNs;
+        function<void()> work;
+        int priority; // rate-monotonic rank, 0 is the highest
+        bool pending;
+        TaskStats stats;
+    };
+
+    struct Job {
+        int task;
+        int64_t release;
+        int64_t deadline;
+        uint64_t sequence;
+        int priority;
+    };
+
+    struct JobOrder {
+        Policy policy;
+        JobOrder(Policy p = Policy::EDF) : policy(p) {}
+        bool operator()(const Job& a, const Job& b) const {
+            if (policy == Policy::EDF) {
+                if (a.deadline != b.deadline) return a.deadline < b.deadline;
+            }
+            else if (a.priority != b.priority) {
+                return a.priority < b.priority;
+            }
+            return a.sequence < b.sequence;
+        }
+    };
+
+    struct Release {
+        int64_t time;
+        int task;
+    };
+
+    struct ReleaseOrder {
+        bool operator()(const Release& a, const Release& b) const { return a.time < b.time; }
+    };
+
+    Policy policy;
+    vector<Task> tasks;
+    BinaryHeap<Job, JobOrder> ready;
+    BinaryHeap<Release, ReleaseOrder> releases;
+    bool stopRequested;
+
+    uint64_t dispatches;
+    double dispatchOverheadNs;
+    double busyNs;
+    int64_t elapsedNs;
+
+    static int64_t effectiveDeadline(const Task& t) { return min(t.deadlineNs, t.periodNs); }
+
+    // Rate-monotonic ranks: shorter period first, shorter deadline breaks ties
+    static void assignPriorities(vector<Task>& set) {
+        vector<int> order(set.size());
+        for (size_t i = 0; i < set.size(); i++) order[i] = int(i);
+        sort(order.begin(), order.end(), [&](int a, int b) {
+            if (set[a].periodNs != set[b].periodNs) return set[a].periodNs < set[b].periodNs;
+            return set[a].deadlineNs < set[b].deadlineNs;
+        });
+        for (size_t rank = 0; rank < order.size(); rank++) set[order[rank]].priority = int(rank);
+    }
+
+    // Sufficient test for non-preemptive EDF: for every task, the demand of the tasks with shorter or equal
+    // deadlines plus the longest job that may already be running must fit in its deadline
+    bool edfSchedulable(const vector<Task>& set) const {
+        double utilization = 0.0;
+        for (const Task& t : set) utilization += double(t.wcetNs) / double(t.periodNs);
+        if (utilization > 1.0) return false;
+
+        for (const Task& i : set) {
+            double density = 0.0;
+            int64_t blocking = 0;
+            for (const Task& j : set) {
+                if (effectiveDeadline(j) <= effectiveDeadline(i)) density += double(j.wcetNs) / double(effectiveDeadline(j));
+                else blocking = max(blocking, j.wcetNs);
+            }
+            if (density + double(blocking) / double(effectiveDeadline(i)) > 1.0) return false;
+        }
+        return true;
+    }
+
+    // Response time analysis for non-preemptive fixed priorities: a job waits for one lower priority job
+    // already running and for every higher priority release up to its own start
+    bool rmSchedulable(const vector<Task>& set) const {
+        for (const Task& i : set) {
+            int64_t blocking = 0;
+            for (const Task& j : set) {
+                if (j.priority > i.priority) blocking = max(blocking, j.wcetNs);
+            }
+
+            int64_t start = blocking, next = 0;
+            while (true) {
+                next = blocking;
+                for (const Task& j : set) {
+                    if (j.priority < i.priority) next += (start / j.periodNs + 1) * j.wcetNs;
+                }
+                if (next + i.wcetNs > effectiveDeadline(i)) return false;
+                if (next == start) break;
+                start = next;
+            }
+        }
+        return true;
+    }
+
+public:
+    TaskScheduler(Policy schedulingPolicy = Policy::EDF)
+        : policy(schedulingPolicy), ready(JobOrder(schedulingPolicy)), stopRequested(false),
+          dispatches(0), dispatchOverheadNs(0.0), busyNs(0.0), elapsedNs(0) {}
+
+    // Checks whether the current tasks plus one more would stay schedulable under the policy
+    bool admissible(int64_t periodNs, int64_t deadlineNs, int64_t wcetNs) const {
+        if (periodNs <= 0 || deadlineNs <= 0 || wcetNs <= 0) return false;
+
+        vector<Task> candidate = tasks;
+        candidate.push_back(Task{"", periodNs, deadlineNs, wcetNs, nullptr, 0, false, TaskStats()});
+        assignPriorities(candidate);
+        return policy == Policy::EDF ? edfSchedulable(candidate) : rmSchedulable(candidate);
+    }
+
+    // Registers a periodic task, returns its id or -1 if admission control rejects it.
+    // Register every task before run()
+    int addTask(const string& name, int64_t periodNs, int64_t deadlineNs, int64_t wcetNs, function<void()> work) {
+        if (!admissible(periodNs, deadlineNs, wcetNs)) return -1;
+
+        tasks.push_back(Task{name, periodNs, deadlineNs, wcetNs, work, 0, false, TaskStats()});
+        assignPriorities(tasks);
+        ready.reserve(tasks.size());
+        releases.reserve(tasks.size() + 1);
+        return int(tasks.size()) - 1;
+    }
+
+    // Sum of WCET / period over the registered tasks
+    double declaredUtilization() const {
+        double utilization = 0.0;
+        for (const Task& t : tasks) utilization += double(t.wcetNs) / double(t.periodNs);
+        return utilization;
+    }
+
+    // Fraction of the last run() spent inside jobs
+    double measuredUtilization() const { return elapsedNs > 0 ? busyNs / double(elapsedNs) : 0.0; }
+
+    double meanDispatchOverheadNs() const { return dispatches ? dispatchOverheadNs / double(dispatches) : 0.0; }
+
+    size_t taskCount() const { return tasks.size(); }
+    const TaskStats& getStats(int id) const { return tasks.at(id).stats; }
+
+    void requestStop() { stopRequested = true; }
+
+    // Runs the task set for durationNs, all tasks released together 1 ms after the call
+    void run(int64_t durationNs) {
+        stopRequested = false;
+        ready.clear();
+        releases.clear();
+        dispatches = 0;
+        dispatchOverheadNs = busyNs = 0.0;
+
+        int64_t start = monotonicNs() + 1000000;
+        int64_t end = start + durationNs;
+        uint64_t sequence = 0;
+
+        for (size_t i = 0; i < tasks.size(); i++) {
+            tasks[i].pending = false;
+            tasks[i].stats = TaskStats();
+            releases.push(Release{start, int(i)});
+        }
+
+        while (!stopRequested) {
+            int64_t now = monotonicNs();
+
+            while (!releases.empty() && releases.top().time <= now) {
+                Release r = releases.pop();
+                if (r.time >= end) continue;
+
+                Task& t = tasks[r.task];
+                releases.push(Release{r.time + t.periodNs, r.task});
+                t.stats.releases++;
+
+                if (t.pending) {
+                    // The previous job has not even started, keep it and drop this release
+                    t.stats.skippedReleases++;
+                    t.stats.deadlineMisses++;
+                    continue;
+                }
+                t.pending = true;
+                ready.push(Job{r.task, r.time, r.time + t.deadlineNs, sequence++, t.priority});
+            }
+
+            if (ready.empty()) {
+                if (releases.empty()) break;
+                sleepUntilNs(releases.top().time);
+                continue;
+            }
+
+            Job job = ready.pop();
+            Task& t = tasks[job.task];
+
+            int64_t begin = monotonicNs();
+            dispatchOverheadNs += double(begin - now);
+            dispatches++;
+
+            t.work();
+
+            int64_t finish = monotonicNs();
+            int64_t execution = finish - begin;
+            t.pending = false;
+            t.stats.completed++;
+            t.stats.totalExecutionNs += double(execution);
+            busyNs += double(execution);
+            if (execution > t.stats.maxExecutionNs) t.stats.maxExecutionNs = execution;
+            if (finish - job.release > t.stats.maxResponseNs) t.stats.maxResponseNs = finish - job.release;
+            if (execution > t.wcetNs) t.stats.budgetOverruns++;
+            if (finish > job.deadline) t.stats.deadlineMisses++;
+        }
+
+        elapsedNs = monotonicNs() - start;
+    }
+
+    void report(ostream& out) const {
+        StreamStateGuard restore(out);
+
+        out << fixed << setprecision(1)
+            << (policy == Policy::EDF ? "EDF" : "Rate monotonic") << " scheduler: declared utilization "
+            << 100.0 * declaredUtilization() << "%, measured " << 100.0 * measuredUtilization() << "%, "
+            << meanDispatchOverheadNs() << " ns per dispatch" << endl;
+
+        for (const Task& t : tasks) {
+            out << "  " << left << setw(12) << t.name << right
+                << " jobs " << setw(7) << t.stats.completed
+                << "  misses " << setw(5) << t.stats.deadlineMisses
+                << "  skipped " << setw(5) << t.stats.skippedReleases
+                << "  over budget " << setw(5) << t.stats.budgetOverruns
+                << "  max exec " << setw(8) << t.stats.maxExecutionNs / 1000.0 << " us"
+                << "  max response " << setw(8) << t.stats.maxResponseNs / 1000.0 << " us" << endl;
+        }
+    }
+};
+
+#endif // TASK_SCHEDULER_HPP
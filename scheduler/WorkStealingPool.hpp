@@ -0,0 +1,158 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// Thread pool for batch work off the flight path (Monte Carlo runs, log processing), never the control loop.
+// Every worker owns a deque: it pushes and pops its own work at the back, and when that runs dry it steals
+// from the front of another worker's deque, so uneven jobs still spread over all cores without a shared queue.
+// The deques are guarded by a mutex each; the jobs this is meant for take milliseconds, so the lock is noise
+class WorkStealingPool {
+private:
+    struct Queue {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> workers;
+
+    atomic<size_t> queued;    // tasks sitting in a deque
+    atomic<size_t> pending;   // tasks submitted and not finished yet
+    atomic<uint64_t> stolen;
+    atomic<unsigned> nextQueue;
+
+    mutex idleLock;
+    condition_variable wake;  // workers wait here for work
+    condition_variable done;  // wait() waits here for pending to reach zero
+    bool stopping;
+
+    // Index of the calling thread's queue if it is one of this pool's workers, -1 otherwise
+    struct Identity {
+        const WorkStealingPool* pool;
+        int index;
+    };
+    static Identity& self() {
+        thread_local Identity id = {nullptr, -1};
+        return id;
+    }
+
+    bool popLocal(int index, function<void()>& task) {
+        Queue& q = *queues[index];
+        lock_guard<mutex> guard(q.lock);
+        if (q.tasks.empty()) return false;
+        task = move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int thief, function<void()>& task) {
+        int n = int(queues.size());
+        for (int k = 1; k < n; k++) {
+            Queue& q = *queues[(thief + k) % n];
+            lock_guard<mutex> guard(q.lock);
+            if (q.tasks.empty()) continue;
+            task = move(q.tasks.front());
+            q.tasks.pop_front();
+            stolen++;
+            return true;
+        }
+        return false;
+    }
+
+    void run(int index) {
+        self() = {this, index};
+        while (true) {
+            function<void()> task;
+            if (popLocal(index, task) || steal(index, task)) {
+                queued--;
+                task();
+                if (--pending == 0) {
+                    lock_guard<mutex> guard(idleLock);
+                    done.notify_all();
+                }
+                continue;
+            }
+            unique_lock<mutex> lk(idleLock);
+            wake.wait(lk, [&] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) return;
+        }
+    }
+
+public:
+    // threads = 0 uses one worker per hardware thread
+    explicit WorkStealingPool(unsigned threads = 0)
+        : queued(0), pending(0), stolen(0), nextQueue(0), stopping(false) {
+        if (threads == 0) threads = thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+        for (unsigned i = 0; i < threads; i++) queues.emplace_back(new Queue());
+        for (unsigned i = 0; i < threads; i++) workers.emplace_back(&WorkStealingPool::run, this, int(i));
+    }
+
+    // Finishes the queued work, then joins the workers
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> guard(idleLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& t : workers) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Queues a task. From inside a task it goes on the caller's own deque (depth first, cache warm);
+    // from any other thread the deques are filled in turn
+    void submit(function<void()> task) {
+        Identity& id = self();
+        int index = id.pool == this ? id.index : int(nextQueue++ % queues.size());
+        pending++;
+        {
+            // Counted before it is pushed, so a worker that takes it straight away cannot drive queued below zero
+            lock_guard<mutex> guard(idleLock);
+            queued++;
+        }
+        {
+            Queue& q = *queues[index];
+            lock_guard<mutex> guard(q.lock);
+            q.tasks.push_back(move(task));
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until every submitted task has finished. Call it from outside the pool: a worker waiting
+    // on its own pool would never finish
+    void wait() {
+        unique_lock<mutex> lk(idleLock);
+        done.wait(lk, [&] { return pending.load() == 0; });
+    }
+
+    // Runs body(i) for i in [0, count), in chunks of grain indices, and returns when all are done
+    template <typename Body>
+    void parallelFor(size_t count, size_t grain, Body body) {
+        if (grain == 0) grain = 1;
+        for (size_t begin = 0; begin < count; begin += grain) {
+            size_t end = begin + grain < count ? begin + grain : count;
+            submit([begin, end, &body] {
+                for (size_t i = begin; i < end; i++) body(i);
+            });
+        }
+        wait();
+    }
+
+    size_t size() const { return workers.size(); }
+    uint64_t steals() const { return stolen.load(); }
+};
+
+#endif
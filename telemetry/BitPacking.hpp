@@ -0,0 +1,106 @@
+#ifndef BIT_PACKING_HPP
+#define BIT_PACKING_HPP
+
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// Packs fields of 1 to 32 bits back to back into a byte buffer, least significant bit first, with no padding
+// between fields. Bits go through a 64 bit accumulator and whole bytes are stored as they fill. Writing past
+// the buffer drops the bytes and sets overflowed(); the caller is expected to check the room first
+class BitWriter {
+private:
+    uint8_t* out;
+    size_t capacity; // bytes
+    size_t stored;   // whole bytes written
+    uint64_t pending;
+    int pendingBits;
+    bool overflow;
+
+public:
+    BitWriter(uint8_t* buffer = nullptr, size_t size = 0) { reset(buffer, size); }
+
+    void reset(uint8_t* buffer, size_t size) {
+        out = buffer;
+        capacity = size;
+        stored = 0;
+        pending = 0;
+        pendingBits = 0;
+        overflow = false;
+    }
+
+    // The low bits of value; higher bits are ignored
+    void write(uint32_t value, int bits) {
+        pending |= uint64_t(value & (bits >= 32 ? 0xFFFFFFFFu : (1u << bits) - 1u)) << pendingBits;
+        pendingBits += bits;
+        while (pendingBits >= 8) {
+            if (stored < capacity) out[stored++] = uint8_t(pending);
+            else overflow = true;
+            pending >>= 8;
+            pendingBits -= 8;
+        }
+    }
+
+    // Appends bits packed by another BitWriter, e.g. a message encoded ahead of time
+    void copy(const uint8_t* in, int bits) {
+        int whole = bits / 8;
+        for (int i = 0; i < whole; i++) write(in[i], 8);
+        if (bits % 8) write(in[whole], bits % 8);
+    }
+
+    // Stores the last partial byte, zero padded. Returns the bytes used
+    size_t flush() {
+        if (pendingBits > 0) {
+            if (stored < capacity) out[stored++] = uint8_t(pending);
+            else overflow = true;
+            pending = 0;
+            pendingBits = 0;
+        }
+        return stored;
+    }
+
+    size_t bitCount() const { return stored * 8 + size_t(pendingBits); }
+    size_t bitCapacity() const { return capacity * 8; }
+    bool overflowed() const { return overflow; }
+};
+
+// Reads back what BitWriter wrote. Reading past the end returns zero bits and sets overrun()
+class BitReader {
+private:
+    const uint8_t* in;
+    size_t size;     // bytes
+    size_t consumed; // bytes loaded into the accumulator
+    uint64_t pending;
+    int pendingBits;
+    bool overrunFlag;
+
+public:
+    BitReader(const uint8_t* buffer = nullptr, size_t length = 0) { reset(buffer, length); }
+
+    void reset(const uint8_t* buffer, size_t length) {
+        in = buffer;
+        size = length;
+        consumed = 0;
+        pending = 0;
+        pendingBits = 0;
+        overrunFlag = false;
+    }
+
+    uint32_t read(int bits) {
+        while (pendingBits < bits) {
+            if (consumed < size) pending |= uint64_t(in[consumed++]) << pendingBits;
+            else overrunFlag = true;
+            pendingBits += 8;
+        }
+        uint32_t value = uint32_t(pending & (bits >= 32 ? 0xFFFFFFFFull : (1ull << bits) - 1ull));
+        pending >>= bits;
+        pendingBits -= bits;
+        return value;
+    }
+
+    // Bits not read yet, including the padding of the last byte
+    size_t remaining() const { return overrunFlag ? 0 : (size - consumed) * 8 + size_t(pendingBits); }
+    bool overrun() const { return overrunFlag; }
+};
+
+#endif // BIT_PACKING_HPP
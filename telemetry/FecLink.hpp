@@ -0,0 +1,421 @@
+#ifndef FEC_LINK_HPP
+#define FEC_LINK_HPP
+
+#include "TelemetryFrame.hpp"
+#include "ReedSolomon.hpp"
+#include "../scheduler/Executive.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <iomanip>
+using namespace std;
+
+// Optional forward error correction under the telemetry frames, for a downlink that loses frames and cannot
+// ask for them again. Telemetry frames go out in blocks of k, each followed by p parity frames; any k of the
+// k + p frames of a block give back all k telemetry frames.
+//
+// The Reed-Solomon codewords run across the frames of a block: byte j of every frame of the block is one
+// codeword of k + p symbols. A frame lost to a burst, or failing its check, is then one erasure in every
+// codeword, and a burst as long as p frames costs nothing. Within a frame nothing is spread out, because the
+// CRC throws away a damaged frame whole anyway.
+//
+// Each frame on the wire, before stuffing, is
+//   block      1 byte, one more per block
+//   index      1 byte, 0 .. k-1 for telemetry frames, k .. k+p-1 for parity
+//   shape      1 byte, k in the high nibble and p in the low one
+//   shard      a telemetry frame as stuffed, without its zero; or parity, as long as the longest shard
+//   check      CRC-16 of everything above, little endian
+// then COBS stuffed with a closing zero. A telemetry frame has no zero bytes once stuffed, so in the codeword
+// it is followed by zeros up to the block's longest shard, and the first zero is where a rebuilt one ends.
+//
+// Telemetry frames go out as they come, so FEC adds no delay while nothing is lost; a lost one comes back
+// once k frames of its block have arrived. The cost is p frames of the longest size per k, plus 6 bytes a frame
+
+static const int FEC_MAX_DATA = 15;
+static const int FEC_MAX_PARITY = 15;
+static const size_t FEC_HEADER_BYTES = 3;
+static const size_t FEC_MAX_SHARD = TELEMETRY_MAX_ENCODED;   // a stuffed telemetry frame with its zero
+static const size_t FEC_MAX_FRAME = FEC_HEADER_BYTES + FEC_MAX_SHARD + 2;
+static const size_t FEC_MAX_ENCODED = FEC_MAX_FRAME + FEC_MAX_FRAME / 254 + 2;
+
+// Bytes on the wire per byte of telemetry, worst case, for sizing the scheduler's budget
+inline double fecExpansion(int dataFrames, int parityFrames) {
+    double frame = double(TELEMETRY_MAX_ENCODED);
+    double overhead = double(FEC_MAX_ENCODED - FEC_MAX_SHARD);
+    return (dataFrames + parityFrames) * (frame + overhead) / (dataFrames * frame);
+}
+
+struct FecStats {
+    uint64_t frames;     // frames given to the encoder, or received by the decoder
+    uint64_t rejected;   // received frames that failed stuffing, length or check
+    uint64_t late;       // received after their block was given up
+    uint64_t delivered;  // telemetry frames passed on as they arrived
+    uint64_t recovered;  // telemetry frames rebuilt from parity
+    uint64_t lost;       // telemetry frames of blocks given up on, neither arrived nor rebuilt; a block
+                         // of which nothing arrived is not counted, the telemetry sequence numbers show it
+    uint64_t blocks;
+    uint64_t bytes;      // on the wire, sent or received
+
+    FecStats() : frames(0), rejected(0), late(0), delivered(0), recovered(0), lost(0), blocks(0), bytes(0) {}
+};
+
+// Sender side. Holds one block, p + k shards of FEC_MAX_SHARD bytes, and never allocates
+class FecEncoder {
+private:
+    ReedSolomon code;
+    int dataFrames;
+    uint8_t shards[FEC_MAX_DATA + FEC_MAX_PARITY][FEC_MAX_SHARD];
+    size_t lengths[FEC_MAX_DATA];  // stuffed, without the zero
+    size_t longest;                // shard bytes, zero included
+    int count;
+    uint8_t block;
+    uint8_t raw[FEC_MAX_FRAME];
+    FecStats counters;
+
+    template <typename Send>
+    void sendShard(int index, const uint8_t* shard, size_t length, Send& send) {
+        raw[0] = block;
+        raw[1] = uint8_t(index);
+        raw[2] = uint8_t(dataFrames << 4 | code.paritySymbols());
+        memcpy(raw + FEC_HEADER_BYTES, shard, length);
+        size_t size = FEC_HEADER_BYTES + length;
+        uint16_t crc = crc16(raw, size);
+        raw[size++] = uint8_t(crc);
+        raw[size++] = uint8_t(crc >> 8);
+        uint8_t wire[FEC_MAX_ENCODED];
+        size_t encoded = cobsEncode(raw, size, wire);
+        wire[encoded++] = 0;
+        counters.bytes += encoded;
+        send(static_cast<const uint8_t*>(wire), encoded);
+    }
+
+public:
+    // dataFrames 1 to FEC_MAX_DATA, parityFrames 1 to FEC_MAX_PARITY
+    FecEncoder(int dataFramesPerBlock = 4, int parityFrames = 2)
+        : code(parityFrames < 1 ? 1 : parityFrames > FEC_MAX_PARITY ? FEC_MAX_PARITY : parityFrames),
+          dataFrames(dataFramesPerBlock < 1 ? 1 : dataFramesPerBlock > FEC_MAX_DATA ? FEC_MAX_DATA : dataFramesPerBlock),
+          longest(0), count(0), block(0) {}
+
+    int dataPerBlock() const { return dataFrames; }
+    int parityPerBlock() const { return code.paritySymbols(); }
+
+    // A telemetry frame as TelemetryFrameWriter::finish() wrote it, closing zero included. Hands
+    // send(wire, length) the frame that carries it and, when it completes a block, the block's parity frames
+    template <typename Send>
+    void encode(const uint8_t* frame, size_t length, Send send) {
+        if (length > 0 && frame[length - 1] == 0) length--;
+        if (length == 0 || length >= FEC_MAX_SHARD) return;
+        counters.frames++;
+        memcpy(shards[count], frame, length);
+        lengths[count] = length;
+        if (length + 1 > longest) longest = length + 1;
+        count++;
+        sendShard(count - 1, shards[count - 1], length, send);
+        if (count == dataFrames) flush(send);
+    }
+
+    // Closes a block not yet full, e.g. after landing, so its frames can still be rebuilt: the frames it is
+    // short of go out empty, header and check only, then the parity
+    template <typename Send>
+    void flush(Send send) {
+        if (count == 0) return;
+        for (int i = count; i < dataFrames; i++) sendShard(i, shards[i], 0, send);
+        uint8_t* data[FEC_MAX_DATA];
+        uint8_t* parity[FEC_MAX_PARITY];
+        for (int i = 0; i < dataFrames; i++) {
+            if (i >= count) lengths[i] = 0;
+            memset(shards[i] + lengths[i], 0, longest - lengths[i]);
+            data[i] = shards[i];
+        }
+        for (int j = 0; j < code.paritySymbols(); j++) parity[j] = shards[FEC_MAX_DATA + j];
+        code.encodeShards(data, dataFrames, parity, longest);
+        for (int j = 0; j < code.paritySymbols(); j++) sendShard(dataFrames + j, parity[j], longest, send);
+        counters.blocks++;
+        block++;
+        count = 0;
+        longest = 0;
+    }
+
+    const FecStats& stats() const { return counters; }
+
+    void report(ostream& out) const {
+        out << "FEC " << dataFrames << "+" << code.paritySymbols() << ": " << counters.frames << " telemetry frames in "
+            << counters.blocks << " blocks, " << counters.bytes << " bytes on the wire" << endl;
+    }
+};
+
+// Receiver side. Takes FEC frames in any order and passes on telemetry frames, stuffed and without their
+// zero as TelemetryFrameReader::open() takes them: each one as it arrives, and the lost ones of a block as
+// soon as enough of the block is in.
+//
+// A frame that fails its check is usually one or two bytes wrong, not lost, so the decoder keeps it when its
+// header still makes sense. While k good frames of the block are in, damaged ones are erasures like the
+// missing ones. Short of that, every codeword of the block is decoded for errors too, with the missing frames
+// as erasures and the damaged ones as they came, which mends the damaged frames and rebuilds the missing
+// ones as long as no codeword holds more than (p - missing) / 2 wrong bytes. Frames mended this way are only
+// passed on when every codeword decodes and the telemetry frame passes its own check.
+//
+// Keeps a few blocks open for frames that arrive out of order; a block is given up on when a frame of a
+// block that many newer arrives. Never allocates
+class FecDecoder {
+private:
+    static const int OPEN_BLOCKS = 4;
+    static const int MAX_SHARDS = FEC_MAX_DATA + FEC_MAX_PARITY;
+
+    struct openBlock {
+        bool used, done;
+        uint8_t id;
+        int dataFrames, parityFrames;
+        int received;            // frames that passed their check
+        int damagedCount;
+        size_t longest;          // 0 until a parity frame says it
+        bool longestDamaged;     // and that frame failed its check
+        bool present[MAX_SHARDS];
+        bool damaged[MAX_SHARDS];
+        bool passed[FEC_MAX_DATA];
+        uint8_t shards[MAX_SHARDS][FEC_MAX_SHARD];
+    };
+
+    openBlock blocks[OPEN_BLOCKS];
+    uint8_t raw[FEC_MAX_ENCODED];
+    uint8_t scratch[FEC_MAX_DATA][FEC_MAX_SHARD];
+    TelemetryFrameReader verify;
+    FecStats counters;
+    bool started;
+    uint8_t newest;
+
+    void close(openBlock& b) {
+        if (b.used && !b.done)
+            for (int i = 0; i < b.dataFrames; i++)
+                if (!b.passed[i]) counters.lost++;
+        b.used = false;
+    }
+
+    // Decodes every codeword of the block for errors and erasures into scratch, the data frames only. False
+    // if any codeword has more errors than it can correct
+    bool decodeColumns(openBlock& b) {
+        int n = b.dataFrames + b.parityFrames;
+        int erasures[FEC_MAX_PARITY], m = 0;
+        for (int i = 0; i < n; i++)
+            if (!b.present[i] && !b.damaged[i]) erasures[m++] = i;
+        ReedSolomon code(b.parityFrames);
+        uint8_t column[MAX_SHARDS];
+        for (size_t j = 0; j < b.longest; j++) {
+            for (int i = 0; i < n; i++) column[i] = b.shards[i][j];
+            if (code.decode(column, n, erasures, m) < 0) return false;
+            for (int i = 0; i < b.dataFrames; i++) scratch[i][j] = column[i];
+        }
+        return true;
+    }
+
+    template <typename Deliver>
+    void pass(openBlock& b, int index, const uint8_t* shard, Deliver& deliver) {
+        b.passed[index] = true;
+        const uint8_t* end = static_cast<const uint8_t*>(memchr(shard, 0, b.longest));
+        size_t length = end ? size_t(end - shard) : b.longest;
+        if (length == 0) return;
+        counters.recovered++;
+        deliver(shard, length);
+    }
+
+    template <typename Deliver>
+    void recover(openBlock& b, Deliver& deliver) {
+        if (b.done || b.longest == 0) return;
+        int n = b.dataFrames + b.parityFrames;
+        if (b.received >= b.dataFrames) {
+            if (b.longestDamaged) return;
+            uint8_t* shards[MAX_SHARDS];
+            for (int i = 0; i < n; i++) shards[i] = b.shards[i];
+            ReedSolomon code(b.parityFrames);
+            if (!code.recoverShards(shards, b.dataFrames, b.present, b.longest)) return;
+            for (int i = 0; i < b.dataFrames; i++)
+                if (!b.passed[i]) pass(b, i, b.shards[i], deliver);
+            b.done = true;
+            return;
+        }
+
+        // Damaged frames in: needs the true shard length, from a parity frame that passed its check. What
+        // comes out is only as good as the damaged frames, so each telemetry frame must pass its own check
+        if (b.longestDamaged || b.damagedCount == 0 || n - b.received - b.damagedCount > b.parityFrames) return;
+        if (!decodeColumns(b)) return;
+        bool all = true;
+        for (int i = 0; i < b.dataFrames; i++) {
+            if (b.passed[i]) continue;
+            const uint8_t* end = static_cast<const uint8_t*>(memchr(scratch[i], 0, b.longest));
+            size_t length = end ? size_t(end - scratch[i]) : b.longest;
+            if (length == 0 || verify.open(scratch[i], length) == FRAME_OK) pass(b, i, scratch[i], deliver);
+            else all = false;
+        }
+        b.done = all;
+    }
+
+    void open(openBlock& b, uint8_t id, int k, int p) {
+        close(b);
+        b.used = true;
+        b.done = false;
+        b.id = id;
+        b.dataFrames = k;
+        b.parityFrames = p;
+        b.received = 0;
+        b.damagedCount = 0;
+        b.longest = 0;
+        b.longestDamaged = false;
+        memset(b.present, 0, sizeof(b.present));
+        memset(b.damaged, 0, sizeof(b.damaged));
+        memset(b.passed, 0, sizeof(b.passed));
+        counters.blocks++;
+    }
+
+    // Starts using block id: opens it, giving up on blocks OPEN_BLOCKS older, unless it is itself that old
+    openBlock* find(uint8_t id, int k, int p) {
+        if (!started || int8_t(id - newest) > 0) {
+            for (openBlock& b : blocks)
+                if (b.used && int8_t(id - b.id) >= OPEN_BLOCKS) close(b);
+            started = true;
+            newest = id;
+        } else if (int8_t(newest - id) >= OPEN_BLOCKS) {
+            return nullptr;
+        }
+        openBlock& b = blocks[id % OPEN_BLOCKS];
+        if (!b.used || b.id != id) open(b, id, k, p);
+        return &b;
+    }
+
+    // A frame that failed its check, kept if its header fits the block it names
+    template <typename Deliver>
+    void keepDamaged(size_t body, Deliver& deliver) {
+        uint8_t id = raw[0];
+        int index = raw[1], k = raw[2] >> 4, p = raw[2] & 0x0F;
+        size_t shardLength = body - FEC_HEADER_BYTES;
+        if (k < 1 || p < 1 || index >= k + p || shardLength > FEC_MAX_SHARD || !started) return;
+        openBlock& slot = blocks[id % OPEN_BLOCKS];
+        bool known = slot.used && slot.id == id;
+        // a damaged block number must not give up on open blocks, so only the block after the newest opens
+        if (!known && int8_t(id - newest) != 1) return;
+        openBlock* b = find(id, k, p);
+        if (!b || b->done || b->present[index] || b->damaged[index] || k != b->dataFrames || p != b->parityFrames) return;
+        if (index >= k && b->longest == 0) {
+            b->longest = shardLength;
+            b->longestDamaged = true;
+        }
+        memcpy(b->shards[index], raw + FEC_HEADER_BYTES, shardLength);
+        memset(b->shards[index] + shardLength, 0, FEC_MAX_SHARD - shardLength);
+        b->damaged[index] = true;
+        b->damagedCount++;
+        recover(*b, deliver);
+    }
+
+public:
+    // check: the telemetry frames' own check, for frames mended from damaged ones
+    explicit FecDecoder(TelemetryCheck check = CHECK_CRC16) : verify(check), started(false), newest(0) {
+        for (openBlock& b : blocks) b.used = false;
+    }
+
+    // One frame as received, without its closing zero
+    template <typename Deliver>
+    TelemetryFrameStatus receive(const uint8_t* wire, size_t length, Deliver deliver) {
+        counters.frames++;
+        counters.bytes += length + 1;
+        size_t size;
+        if (length > FEC_MAX_ENCODED) {
+            counters.rejected++;
+            return FRAME_TOO_LONG;
+        }
+        if (!cobsDecode(wire, length, raw, size)) {
+            counters.rejected++;
+            return FRAME_BAD_STUFFING;
+        }
+        if (size < FEC_HEADER_BYTES + 2 || size > FEC_MAX_FRAME) {
+            counters.rejected++;
+            return size > FEC_MAX_FRAME ? FRAME_TOO_LONG : FRAME_TOO_SHORT;
+        }
+        size_t body = size - 2;
+        if (uint16_t(raw[body] | raw[body + 1] << 8) != crc16(raw, body)) {
+            counters.rejected++;
+            keepDamaged(body, deliver);
+            return FRAME_BAD_CHECK;
+        }
+        uint8_t id = raw[0];
+        int index = raw[1], k = raw[2] >> 4, p = raw[2] & 0x0F;
+        size_t shardLength = body - FEC_HEADER_BYTES;
+        if (k < 1 || p < 1 || index >= k + p) {
+            counters.rejected++;
+            return FRAME_UNKNOWN_FORMAT;
+        }
+
+        openBlock* found = find(id, k, p);
+        if (!found) {
+            counters.late++;
+            if (index < k && shardLength > 0) {
+                counters.delivered++;
+                deliver(static_cast<const uint8_t*>(raw + FEC_HEADER_BYTES), shardLength);
+            }
+            return FRAME_OK;
+        }
+        openBlock& b = *found;
+        if (k != b.dataFrames || p != b.parityFrames) {
+            if (b.received > 0) return FRAME_OK;
+            // opened by a damaged frame with a damaged shape: start the block again
+            b.used = false;
+            counters.blocks--;
+            open(b, id, k, p);
+        }
+        if (b.done || b.present[index]) return FRAME_OK;
+
+        if (index >= k) {
+            // every parity frame of a block is as long as its longest shard
+            if (shardLength > FEC_MAX_SHARD || (b.longest != 0 && !b.longestDamaged && shardLength != b.longest)) {
+                counters.rejected++;
+                return FRAME_TOO_LONG;
+            }
+            b.longest = shardLength;
+            b.longestDamaged = false;
+        } else if (shardLength + 1 > FEC_MAX_SHARD) {
+            counters.rejected++;
+            return FRAME_TOO_LONG;
+        }
+
+        memcpy(b.shards[index], raw + FEC_HEADER_BYTES, shardLength);
+        memset(b.shards[index] + shardLength, 0, FEC_MAX_SHARD - shardLength);
+        if (b.damaged[index]) {
+            b.damaged[index] = false;
+            b.damagedCount--;
+        }
+        b.present[index] = true;
+        b.received++;
+        if (index < k) {
+            b.passed[index] = true;
+            if (shardLength > 0) {
+                counters.delivered++;
+                deliver(static_cast<const uint8_t*>(b.shards[index]), shardLength);
+            }
+            bool all = true;
+            for (int i = 0; i < k; i++) all = all && b.passed[i];
+            if (all) b.done = true;
+        }
+        recover(b, deliver);
+        return FRAME_OK;
+    }
+
+    // Gives up on the open blocks, counting what they lost, e.g. at the end of a pass
+    void flush() {
+        for (openBlock& b : blocks) close(b);
+    }
+
+    const FecStats& stats() const { return counters; }
+
+    void report(ostream& out) const {
+        const FecStats& s = counters;
+        uint64_t wanted = s.delivered + s.recovered + s.lost;
+        StreamStateGuard restore(out);
+
+        out << fixed << setprecision(1) << "FEC: " << s.frames << " frames, " << s.rejected << " failed their check, "
+            << s.late << " late; telemetry frames " << s.delivered << " as sent, " << s.recovered << " rebuilt, "
+            << s.lost << " lost";
+        if (wanted) out << " (" << 100.0 * double(s.delivered + s.recovered) / double(wanted) << "% through)";
+        out << endl;
+    }
+};
+
+#endif // FEC_LINK_HPP
@@ -0,0 +1,167 @@
+#ifndef FLIGHT_MESSAGES_HPP
+#define FLIGHT_MESSAGES_HPP
+
+#include "TelemetryFrame.hpp"
+#include "LogFormat.hpp"
+#include "../Sensing/GPS.hpp"
+#include <cstdint>
+
+// What the vehicle sends down in flight, one format per stream of the telemetry scheduler:
+//   0  event         54 bits   a phase change or a charge fired, sent ahead of everything else
+//   1  log record   180 bits   Logs, see LogFormat.hpp
+//   2  attitude      74 bits   pitch, yaw and roll to 0.0055 deg
+//   3  GPS fix      159 bits   RocketSensors::GPSFix
+//   4  housekeeping  82 bits   control loop health and recovery progress
+// Times are flight time in seconds to 1 ms, the GPS fix carries its own UTC time of day instead
+
+struct FlightEvent {
+    double time;
+    int code;        // the sender's event number, main sends the recoveryPhase entered
+    double altitude; // m above the pad
+
+    FlightEvent() : time(0), code(0), altitude(0) {}
+    FlightEvent(double t, int eventCode, double eventAltitude) : time(t), code(eventCode), altitude(eventAltitude) {}
+};
+
+struct AttitudeSample {
+    double time;
+    double pitch, yaw, roll; // degrees
+
+    AttitudeSample() : time(0), pitch(0), yaw(0), roll(0) {}
+    AttitudeSample(double t, double p, double y, double r) : time(t), pitch(p), yaw(y), roll(r) {}
+};
+
+struct HousekeepingSample {
+    double time;
+    int phase;               // recoveryPhase
+    int chargesFired;
+    uint64_t overruns;       // control cycles that missed their deadline
+    uint64_t staleSamples;   // samples the deadline windows rejected
+    double maxExecutionMs;   // slowest control cycle so far
+
+    HousekeepingSample() : time(0), phase(0), chargesFired(0), overruns(0), staleSamples(0), maxExecutionMs(0) {}
+};
+
+struct EventTimeField {
+    static double get(const FlightEvent& e) { return e.time; }
+    static void set(FlightEvent& e, double v) { e.time = v; }
+};
+struct EventCodeField {
+    static double get(const FlightEvent& e) { return e.code; }
+    static void set(FlightEvent& e, double v) { e.code = int(v + 0.5); }
+};
+struct EventAltitudeField {
+    static double get(const FlightEvent& e) { return e.altitude; }
+    static void set(FlightEvent& e, double v) { e.altitude = v; }
+};
+
+struct AttitudeTimeField {
+    static double get(const AttitudeSample& a) { return a.time; }
+    static void set(AttitudeSample& a, double v) { a.time = v; }
+};
+struct AttitudePitchField {
+    static double get(const AttitudeSample& a) { return a.pitch; }
+    static void set(AttitudeSample& a, double v) { a.pitch = v; }
+};
+struct AttitudeYawField {
+    static double get(const AttitudeSample& a) { return a.yaw; }
+    static void set(AttitudeSample& a, double v) { a.yaw = v; }
+};
+struct AttitudeRollField {
+    static double get(const AttitudeSample& a) { return a.roll; }
+    static void set(AttitudeSample& a, double v) { a.roll = v; }
+};
+
+struct FixTimeField {
+    static double get(const RocketSensors::GPSFix& f) { return f.TimeOfDay / 1000.0; }
+    static void set(RocketSensors::GPSFix& f, double v) { f.TimeOfDay = uint32_t(v * 1000.0 + 0.5); f.Valid = true; }
+};
+struct FixLatitudeField {
+    static double get(const RocketSensors::GPSFix& f) { return f.Latitude; }
+    static void set(RocketSensors::GPSFix& f, double v) { f.Latitude = v; }
+};
+struct FixLongitudeField {
+    static double get(const RocketSensors::GPSFix& f) { return f.Longitude; }
+    static void set(RocketSensors::GPSFix& f, double v) { f.Longitude = v; }
+};
+struct FixAltitudeField {
+    static double get(const RocketSensors::GPSFix& f) { return f.Altitude; }
+    static void set(RocketSensors::GPSFix& f, double v) { f.Altitude = float(v); }
+};
+struct FixNorthField {
+    static double get(const RocketSensors::GPSFix& f) { return f.VelocityNorth; }
+    static void set(RocketSensors::GPSFix& f, double v) { f.VelocityNorth = float(v); f.HaveVelocity = true; }
+};
+struct FixEastField {
+    static double get(const RocketSensors::GPSFix& f) { return f.VelocityEast; }
+    static void set(RocketSensors::GPSFix& f, double v) { f.VelocityEast = float(v); }
+};
+struct FixUpField {
+    static double get(const RocketSensors::GPSFix& f) { return f.VelocityUp; }
+    static void set(RocketSensors::GPSFix& f, double v) { f.VelocityUp = float(v); f.HaveClimb = true; }
+};
+struct FixSatellitesField {
+    static double get(const RocketSensors::GPSFix& f) { return f.Satellites; }
+    static void set(RocketSensors::GPSFix& f, double v) { f.Satellites = int(v + 0.5); }
+};
+
+struct HousekeepingTimeField {
+    static double get(const HousekeepingSample& h) { return h.time; }
+    static void set(HousekeepingSample& h, double v) { h.time = v; }
+};
+struct HousekeepingPhaseField {
+    static double get(const HousekeepingSample& h) { return h.phase; }
+    static void set(HousekeepingSample& h, double v) { h.phase = int(v + 0.5); }
+};
+struct HousekeepingChargesField {
+    static double get(const HousekeepingSample& h) { return h.chargesFired; }
+    static void set(HousekeepingSample& h, double v) { h.chargesFired = int(v + 0.5); }
+};
+struct HousekeepingOverrunsField {
+    static double get(const HousekeepingSample& h) { return double(h.overruns); }
+    static void set(HousekeepingSample& h, double v) { h.overruns = uint64_t(v + 0.5); }
+};
+struct HousekeepingStaleField {
+    static double get(const HousekeepingSample& h) { return double(h.staleSamples); }
+    static void set(HousekeepingSample& h, double v) { h.staleSamples = uint64_t(v + 0.5); }
+};
+struct HousekeepingExecutionField {
+    static double get(const HousekeepingSample& h) { return h.maxExecutionMs; }
+    static void set(HousekeepingSample& h, double v) { h.maxExecutionMs = v; }
+};
+
+typedef TelemetryFormat<0, FlightEvent,
+    TelemetryChannel<EventTimeField, 26, 0, 65535>,
+    TelemetryChannel<EventCodeField, 8, 0, 255>,
+    TelemetryChannel<EventAltitudeField, 20, -1000, 31000>> EventMessage;
+
+typedef TelemetryFormat<2, AttitudeSample,
+    TelemetryChannel<AttitudeTimeField, 26, 0, 65535>,
+    TelemetryChannel<AttitudePitchField, 16, -180, 180>,
+    TelemetryChannel<AttitudeYawField, 16, -180, 180>,
+    TelemetryChannel<AttitudeRollField, 16, -180, 180>> AttitudeMessage;
+
+// Time of day to 0.6 ms, velocities to 6 cm/s over +-500 m/s
+typedef TelemetryFormat<3, RocketSensors::GPSFix,
+    TelemetryChannel<FixTimeField, 27, 0, 86400>,
+    TelemetryChannel<FixLatitudeField, 32, -90, 90>,
+    TelemetryChannel<FixLongitudeField, 32, -180, 180>,
+    TelemetryChannel<FixAltitudeField, 20, -1000, 31000>,
+    TelemetryChannel<FixNorthField, 14, -500, 500>,
+    TelemetryChannel<FixEastField, 14, -500, 500>,
+    TelemetryChannel<FixUpField, 14, -500, 500>,
+    TelemetryChannel<FixSatellitesField, 6, 0, 63>> GPSMessage;
+
+// Counters saturate at 65535, the execution time at 65.5 ms in 1 us steps
+typedef TelemetryFormat<4, HousekeepingSample,
+    TelemetryChannel<HousekeepingTimeField, 26, 0, 65535>,
+    TelemetryChannel<HousekeepingPhaseField, 3, 0, 7>,
+    TelemetryChannel<HousekeepingChargesField, 5, 0, 31>,
+    TelemetryChannel<HousekeepingOverrunsField, 16, 0, 65535>,
+    TelemetryChannel<HousekeepingStaleField, 16, 0, 65535>,
+    TelemetryChannel<HousekeepingExecutionField, 16, 0, 65535, 1000>> HousekeepingMessage;
+
+// Everything the flight software sends, for the ground station
+typedef TelemetryCodec<EventMessage, LogMessage, AttitudeMessage, GPSMessage, HousekeepingMessage> FlightCodec;
+
+#endif // FLIGHT_MESSAGES_HPP
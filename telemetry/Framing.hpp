@@ -0,0 +1,96 @@
+#ifndef FRAMING_HPP
+#define FRAMING_HPP
+
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// Checksums and byte stuffing for the telemetry link
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, not reflected): 0x29B1 for "123456789"
+// CRC-32 (IEEE 802.3, reflected, as in zlib and Ethernet): 0xCBF43926 for "123456789"
+// Both are one table lookup per byte; the tables are built at compile time
+struct Crc16Table {
+    uint16_t entries[256];
+
+    constexpr Crc16Table() : entries() {
+        for (int i = 0; i < 256; i++) {
+            uint16_t crc = uint16_t(i << 8);
+            for (int bit = 0; bit < 8; bit++)
+                crc = uint16_t(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+            entries[i] = crc;
+        }
+    }
+};
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+                crc = crc & 1u ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            entries[i] = crc;
+        }
+    }
+};
+
+inline uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) {
+    static constexpr Crc16Table table;
+    for (size_t i = 0; i < length; i++)
+        crc = uint16_t((crc << 8) ^ table.entries[(crc >> 8) ^ data[i]]);
+    return crc;
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t length) {
+    static constexpr Crc32Table table;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++)
+        crc = (crc >> 8) ^ table.entries[(crc ^ data[i]) & 0xFF];
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Consistent Overhead Byte Stuffing: removes every zero byte from a frame so that a zero can mark the end of
+// each frame on the wire. A receiver that joins mid-stream, or loses bytes, is back in step at the next zero.
+// The cost is one byte per 254, plus one
+inline size_t cobsMaxEncoded(size_t length) { return length + length / 254 + 1; }
+
+// Writes cobsMaxEncoded(length) bytes at most to out, no delimiter. Returns the encoded length
+inline size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t code = 0, written = 1;
+    uint8_t run = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] != 0) {
+            out[written++] = in[i];
+            run++;
+        }
+        if (in[i] == 0 || run == 0xFF) {
+            out[code] = run;
+            code = written++;
+            run = 1;
+        }
+    }
+    out[code] = run;
+    return written;
+}
+
+// Decodes one frame, without its delimiter, into out (length bytes at most are written). False if the frame
+// holds a zero or a run runs past the end, which is how a damaged frame usually shows
+inline bool cobsDecode(const uint8_t* in, size_t length, uint8_t* out, size_t& decoded) {
+    size_t i = 0, written = 0;
+    decoded = 0;
+    while (i < length) {
+        uint8_t run = in[i++];
+        if (run == 0 || i + run - 1 > length) return false;
+        for (int k = 1; k < run; k++) {
+            if (in[i] == 0) return false;
+            out[written++] = in[i++];
+        }
+        if (run != 0xFF && i < length) out[written++] = 0;
+    }
+    decoded = written;
+    return true;
+}
+
+#endif // FRAMING_HPP
@@ -0,0 +1,335 @@
+#ifndef GROUND_STATION_HPP
+#define GROUND_STATION_HPP
+
+#include "FlightMessages.hpp"
+#include "FecLink.hpp"
+#include "../logger/ActualLogger.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <iomanip>
+using namespace std;
+
+// The receiving end of the downlink: takes the bytes the radio hands over, in chunks of any size, and turns
+// them back into flight records, in the order they were sent.
+//
+//   bytes      split at every zero, which ends a frame on the wire. A run longer than any frame (a lost zero,
+//              or noise between packets) is thrown away up to the next zero, so a receiver that starts
+//              mid-stream or loses bytes is back in step one frame later
+//   FEC        with k > 0, the frames are FEC frames and go through a FecDecoder first
+//   frames     opened and checked; a frame that fails is dropped
+//   order      frames are released by sequence number. One that arrives ahead of its turn waits in a jitter
+//              window of W frames for the ones before it; those still missing when a frame W newer arrives
+//              are given up on, and the frames lost are flagged as a gap
+//   records    Logs go to the DataLogger as they are released, and into the running analysis (maximum
+//              altitude, average velocity over the whole flight, where the logger's cache only holds the
+//              last few readings); every message, and every gap, also goes to the caller's visitor
+//
+// A frame rebuilt from parity comes up to k frames behind its successors, so with FEC the window grows by k.
+// Frames in order, the usual case, are decoded as they are opened and never copied into the window.
+//
+// Holds the largest frame, the window and the FEC blocks in fixed buffers. Only the DataLogger allocates,
+// one node per Logs record
+
+static const int GROUND_MAX_WINDOW = 32;   // frames, a power of two
+static const int GROUND_RESTART = 1024;    // a frame this far behind means the sender started again
+
+// Frames lost for good, as a message of the visitor: format TelemetryGap, whose ID matches no real format
+struct FrameGap {
+    uint16_t first;  // sequence number of the first frame lost
+    int frames;
+
+    FrameGap() : first(0), frames(0) {}
+    FrameGap(uint16_t firstLost, int lost) : first(firstLost), frames(lost) {}
+};
+
+struct TelemetryGap {
+    typedef FrameGap Record;
+    static const int ID = -1;
+};
+
+struct GroundStats {
+    uint64_t bytes;       // received, zeros included
+    uint64_t frames;      // telemetry frames opened, passed on by the FEC decoder with FEC
+    uint64_t rejected;    // frames that failed stuffing, length, check or decoding
+    uint64_t discarded;   // runs longer than any frame, thrown away to the next zero
+    uint64_t waited;      // frames that arrived ahead of their turn, behind a lost or late one, and waited
+    uint64_t late;        // frames that arrived after their turn was given up on, or twice
+    uint64_t restarts;    // the sequence numbers jumped back, the sender started again
+    uint64_t gaps;        // runs of frames given up on
+    uint64_t missing;     // frames in those runs
+    int largestGap;
+    uint64_t messages;    // messages decoded, of every format
+    uint64_t logs;        // Logs records among them
+    uint64_t events;
+
+    GroundStats()
+        : bytes(0), frames(0), rejected(0), discarded(0), waited(0), late(0), restarts(0), gaps(0),
+          missing(0), largestGap(0), messages(0), logs(0), events(0) {}
+};
+
+class GroundStation {
+private:
+    DataLogger* logger;
+    TelemetryFrameReader reader;   // the frame as it arrives
+    TelemetryFrameReader released; // frames leaving the window
+    FecDecoder fec;
+    bool useFec;
+
+    // frame being gathered from the bytes, up to its zero
+    uint8_t line[FEC_MAX_ENCODED];
+    size_t lineLength;
+    bool discarding;
+
+    // jitter window, frames as received (stuffed, without their zero) in slot sequence % window
+    int window;
+    uint8_t held[GROUND_MAX_WINDOW][TELEMETRY_MAX_ENCODED];
+    size_t heldLength[GROUND_MAX_WINDOW];
+    bool heldUsed[GROUND_MAX_WINDOW];
+    uint16_t heldSequence[GROUND_MAX_WINDOW];
+    int heldCount;
+    bool started;
+    bool joined;          // started mid-stream: frames before the first released are not missing, just unseen
+    uint16_t expected;    // next sequence number to release
+    int pendingLost;      // frames given up on just before expected, not reported yet
+
+    GroundStats counters;
+    Logs latestLog;
+    FlightEvent latestEvent;
+    AttitudeSample latestAttitude;
+    RocketSensors::GPSFix latestFix;
+    HousekeepingSample latestHealth;
+    double maxAltitude, velocitySum;
+
+    void take(const Logs& l) {
+        if (logger) logger->addDataPoint(l);
+        if (counters.logs == 0 || l.gps.altitude > maxAltitude) maxAltitude = l.gps.altitude;
+        velocitySum += l.velocity;
+        latestLog = l;
+        counters.logs++;
+    }
+    void take(const FlightEvent& e) {
+        latestEvent = e;
+        counters.events++;
+    }
+    void take(const AttitudeSample& a) { latestAttitude = a; }
+    void take(const RocketSensors::GPSFix& f) { latestFix = f; }
+    void take(const HousekeepingSample& h) { latestHealth = h; }
+
+    template <typename Visitor>
+    void reportGap(Visitor& visit) {
+        if (pendingLost == 0) return;
+        if (joined) {
+            pendingLost = 0;
+            return;
+        }
+        counters.gaps++;
+        counters.missing += uint64_t(pendingLost);
+        if (pendingLost > counters.largestGap) counters.largestGap = pendingLost;
+        visit(TelemetryGap(), FrameGap(uint16_t(expected - pendingLost), pendingLost));
+        pendingLost = 0;
+    }
+
+    // The messages of the frame opened by frame
+    template <typename Visitor>
+    void decodeOpen(TelemetryFrameReader& frame, Visitor& visit) {
+        reportGap(visit);
+        joined = false;
+        TelemetryFrameStatus status = FlightCodec::decode(frame, [&](auto format, const auto& record) {
+            counters.messages++;
+            take(record);
+            visit(format, record);
+        });
+        if (status != FRAME_OK) counters.rejected++;
+    }
+
+    template <typename Visitor>
+    void release(int slot, Visitor& visit) {
+        heldUsed[slot] = false;
+        heldCount--;
+        if (released.open(held[slot], heldLength[slot]) == FRAME_OK) decodeOpen(released, visit);
+        else counters.rejected++;
+    }
+
+    // Releases or gives up on every frame before first. The frames given up on are flagged with the next
+    // frame released, so a run of them is one gap
+    template <typename Visitor>
+    void advanceTo(uint16_t first, Visitor& visit) {
+        int distance = int16_t(uint16_t(first - expected));
+        int steps = distance < window ? distance : window;
+        for (int i = 0; i < steps; i++, expected++) {
+            int slot = expected & (window - 1);
+            if (heldUsed[slot] && heldSequence[slot] == expected) release(slot, visit);
+            else pendingLost++;
+        }
+        if (distance > steps) {
+            pendingLost += distance - steps;
+            expected = first;
+        }
+    }
+
+    // Releases every frame the window holds, flagging the gaps before and between them but not after the last
+    template <typename Visitor>
+    void releaseAll(Visitor& visit) {
+        for (; heldCount > 0; expected++) {
+            int slot = expected & (window - 1);
+            if (heldUsed[slot] && heldSequence[slot] == expected) release(slot, visit);
+            else pendingLost++;
+        }
+        reportGap(visit);
+    }
+
+    template <typename Visitor>
+    void drain(Visitor& visit) {
+        while (heldCount > 0) {
+            int slot = expected & (window - 1);
+            if (!heldUsed[slot] || heldSequence[slot] != expected) return;
+            release(slot, visit);
+            expected++;
+        }
+    }
+
+    // A telemetry frame, stuffed, without its zero
+    template <typename Visitor>
+    void accept(const uint8_t* frame, size_t length, Visitor& visit) {
+        if (reader.open(frame, length) != FRAME_OK) {
+            counters.rejected++;
+            return;
+        }
+        counters.frames++;
+        uint16_t sequence = reader.sequence();
+        if (!started) {
+            // the sender counts from 0: a frame early in the flight may have been overtaken by ones before it,
+            // later on it may be anywhere in the window
+            started = true;
+            joined = sequence >= window;
+            expected = joined ? uint16_t(sequence - window + 1) : 0;
+        }
+        int ahead = int16_t(uint16_t(sequence - expected));
+        if (ahead < 0) {
+            if (ahead > -GROUND_RESTART) {
+                counters.late++;
+                return;
+            }
+            // far behind: the old stream is over, what it still holds goes first
+            counters.restarts++;
+            releaseAll(visit);
+            expected = sequence;
+            ahead = 0;
+        }
+        if (ahead >= window) {
+            advanceTo(uint16_t(sequence - window + 1), visit);
+            ahead = window - 1;
+        }
+        if (ahead == 0) {
+            decodeOpen(reader, visit);
+            expected++;
+            drain(visit);
+            return;
+        }
+        int slot = sequence & (window - 1);
+        if (heldUsed[slot]) {
+            counters.late++;
+            return;
+        }
+        memcpy(held[slot], frame, length);
+        heldLength[slot] = length;
+        heldUsed[slot] = true;
+        heldSequence[slot] = sequence;
+        heldCount++;
+        counters.waited++;
+        drain(visit);
+    }
+
+    // One frame from the wire, without its zero
+    template <typename Visitor>
+    void frameEnd(const uint8_t* wire, size_t length, Visitor& visit) {
+        if (length == 0) return;
+        if (useFec) fec.receive(wire, length, [&](const uint8_t* frame, size_t size) { accept(frame, size, visit); });
+        else accept(wire, length, visit);
+    }
+
+public:
+    // logger: where Logs records go, nullptr for none. fecDataFrames: k of the link's FEC, 0 without FEC.
+    // jitter: frames one may arrive out of order, rounded up to a power of two, at most GROUND_MAX_WINDOW
+    GroundStation(DataLogger* log = nullptr, TelemetryCheck check = CHECK_CRC16, int fecDataFrames = 0, int jitter = 8)
+        : logger(log), reader(check), released(check), fec(check), useFec(fecDataFrames > 0), lineLength(0), discarding(false),
+          window(1), heldCount(0), started(false), joined(false), expected(0), pendingLost(0), maxAltitude(0), velocitySum(0) {
+        int wanted = jitter + (fecDataFrames > 0 ? fecDataFrames : 0);
+        while (window < wanted && window < GROUND_MAX_WINDOW) window *= 2;
+        for (bool& used : heldUsed) used = false;
+    }
+
+    int jitterWindow() const { return window; }
+
+    // Bytes as the radio hands them over. visit(format, record) gets every message once its frame's turn
+    // comes, as FlightCodec::decode() passes them, and visit(TelemetryGap(), gap) for frames lost in between
+    template <typename Visitor>
+    void receive(const uint8_t* bytes, size_t length, Visitor visit) {
+        counters.bytes += length;
+        while (length > 0) {
+            const uint8_t* zero = static_cast<const uint8_t*>(memchr(bytes, 0, length));
+            size_t run = zero ? size_t(zero - bytes) : length;
+            if (!discarding) {
+                if (lineLength + run > sizeof(line)) {
+                    counters.discarded++;
+                    discarding = true;
+                } else {
+                    memcpy(line + lineLength, bytes, run);
+                    lineLength += run;
+                }
+            }
+            if (!zero) return;
+            if (!discarding) frameEnd(line, lineLength, visit);
+            lineLength = 0;
+            discarding = false;
+            bytes += run + 1;
+            length -= run + 1;
+        }
+    }
+
+    void receive(const uint8_t* bytes, size_t length) {
+        receive(bytes, length, [](auto, const auto&) {});
+    }
+
+    // End of the pass: gives up on the FEC blocks still open, then releases what the window holds
+    template <typename Visitor>
+    void flush(Visitor visit) {
+        if (useFec) fec.flush();
+        releaseAll(visit);
+    }
+
+    void flush() {
+        flush([](auto, const auto&) {});
+    }
+
+    const GroundStats& stats() const { return counters; }
+    const FecStats& fecStats() const { return fec.stats(); }
+
+    // The latest of each record, default constructed until one arrives
+    const Logs& latestLogs() const { return latestLog; }
+    const FlightEvent& latestFlightEvent() const { return latestEvent; }
+    const AttitudeSample& latestAttitudeSample() const { return latestAttitude; }
+    const RocketSensors::GPSFix& latestGPSFix() const { return latestFix; }
+    const HousekeepingSample& latestHousekeeping() const { return latestHealth; }
+
+    // Over every Logs record received, 0 before the first
+    double MaxAltitude() const { return maxAltitude; }
+    double AverageVelocity() const { return counters.logs ? velocitySum / double(counters.logs) : 0.0; }
+
+    void report(ostream& out) const {
+        const GroundStats& s = counters;
+        StreamStateGuard restore(out);
+
+        out << fixed << setprecision(1) << "Ground station: " << s.frames << " frames, " << s.rejected << " rejected, "
+            << s.discarded << " overlong runs, " << s.waited << " waited, " << s.late << " late; " << s.gaps
+            << " gaps, " << s.missing << " frames missing, largest " << s.largestGap << endl;
+        out << "  " << s.messages << " messages, " << s.logs << " logs, " << s.events << " events";
+        if (s.logs) out << "; max altitude " << maxAltitude << " m, average velocity " << AverageVelocity() << " m/s";
+        out << endl;
+        if (useFec) fec.report(out);
+    }
+};
+
+#endif // GROUND_STATION_HPP
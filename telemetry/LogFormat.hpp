@@ -0,0 +1,67 @@
+#ifndef LOG_FORMAT_HPP
+#define LOG_FORMAT_HPP
+
+#include "TelemetryFrame.hpp"
+#include "../logger/ActualLogger.hpp"
+
+// The flight log record (Logs) as a telemetry message: 180 bits, 23 bytes with its id, against about 90 for
+// the same record as a line of formatDataForFile. Ranges and steps:
+//   timestamp      0 to 65535 s           1 ms
+//   latitude       -90 to 90 deg          4.2e-8 deg, 5 mm
+//   longitude      -180 to 180 deg        8.4e-8 deg, 9 mm at the equator
+//   altitude       -1000 to 31000 m       3 cm
+//   bearing        0 to 360 deg           0.09 deg
+//   velocity       -1000 to 1000 m/s      3 cm/s
+//   acceleration   -200 to 200 m/s^2      6 mm/s^2
+//   temperature    -60 to 100 C           0.16 C
+//   pressure       0 to 1100 hPa          0.017 hPa
+
+struct LogTimestampField {
+    static double get(const Logs& l) { return l.timestamp; }
+    static void set(Logs& l, double v) { l.timestamp = v; }
+};
+struct LogLatitudeField {
+    static double get(const Logs& l) { return l.gps.latitude; }
+    static void set(Logs& l, double v) { l.gps.latitude = v; }
+};
+struct LogLongitudeField {
+    static double get(const Logs& l) { return l.gps.longitude; }
+    static void set(Logs& l, double v) { l.gps.longitude = v; }
+};
+struct LogAltitudeField {
+    static double get(const Logs& l) { return l.gps.altitude; }
+    static void set(Logs& l, double v) { l.gps.altitude = v; }
+};
+struct LogBearingField {
+    static double get(const Logs& l) { return l.bearing; }
+    static void set(Logs& l, double v) { l.bearing = v; }
+};
+struct LogVelocityField {
+    static double get(const Logs& l) { return l.velocity; }
+    static void set(Logs& l, double v) { l.velocity = v; }
+};
+struct LogAccelerationField {
+    static double get(const Logs& l) { return l.acceleration; }
+    static void set(Logs& l, double v) { l.acceleration = v; }
+};
+struct LogTemperatureField {
+    static double get(const Logs& l) { return l.temperature; }
+    static void set(Logs& l, double v) { l.temperature = v; }
+};
+struct LogPressureField {
+    static double get(const Logs& l) { return l.pressure; }
+    static void set(Logs& l, double v) { l.pressure = v; }
+};
+
+typedef TelemetryFormat<1, Logs,
+    TelemetryChannel<LogTimestampField, 26, 0, 65535>,
+    TelemetryChannel<LogLatitudeField, 32, -90, 90>,
+    TelemetryChannel<LogLongitudeField, 32, -180, 180>,
+    TelemetryChannel<LogAltitudeField, 20, -1000, 31000>,
+    TelemetryChannel<LogBearingField, 12, 0, 360>,
+    TelemetryChannel<LogVelocityField, 16, -1000, 1000>,
+    TelemetryChannel<LogAccelerationField, 16, -200, 200>,
+    TelemetryChannel<LogTemperatureField, 10, -60, 100>,
+    TelemetryChannel<LogPressureField, 16, 0, 1100>> LogMessage;
+
+#endif // LOG_FORMAT_HPP
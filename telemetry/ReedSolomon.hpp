@@ -0,0 +1,362 @@
+#ifndef REED_SOLOMON_HPP
+#define REED_SOLOMON_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+using namespace std;
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && !defined(ROCKET_NO_SIMD)
+    #include <tmmintrin.h>
+    #define ROCKET_GF_SSSE3
+#endif
+
+// Arithmetic in GF(256) for Reed-Solomon codes: bytes are polynomials over GF(2) modulo
+// x^8 + x^4 + x^3 + x^2 + 1 (0x11D), alpha = 2 generates the field. Adding is XOR; multiplying goes through
+// tables built at compile time:
+//   exp / log     alpha^i and its inverse, for single products, inverses and powers
+//   mul           the full 256 x 256 product table, one lookup per byte for the table driven kernel
+//   low / high    c times each low and each high nibble, 16 bytes each, for the SSSE3 kernel: PSHUFB looks
+//                 up 16 nibbles at once, so c * x = low[c][x & 15] ^ high[c][x >> 4] takes two shuffles and
+//                 an XOR per 16 bytes
+struct GaloisTables {
+    uint8_t exp[512];
+    uint8_t log[256];
+    uint8_t mul[256][256];
+    uint8_t low[256][16];
+    uint8_t high[256][16];
+
+    constexpr GaloisTables() : exp(), log(), mul(), low(), high() {
+        int x = 1;
+        for (int i = 0; i < 255; i++) {
+            exp[i] = uint8_t(x);
+            exp[i + 255] = uint8_t(x);
+            log[x] = uint8_t(i);
+            x <<= 1;
+            if (x & 0x100) x ^= 0x11D;
+        }
+        exp[510] = exp[0];
+        exp[511] = exp[1];
+        for (int a = 1; a < 256; a++)
+            for (int b = 1; b < 256; b++)
+                mul[a][b] = exp[log[a] + log[b]];
+        for (int c = 0; c < 256; c++)
+            for (int n = 0; n < 16; n++) {
+                low[c][n] = mul[c][n];
+                high[c][n] = mul[c][n << 4];
+            }
+    }
+};
+
+inline const GaloisTables& galoisTables() {
+    static constexpr GaloisTables tables;
+    return tables;
+}
+
+inline uint8_t gfMul(uint8_t a, uint8_t b) { return galoisTables().mul[a][b]; }
+
+// b must not be zero
+inline uint8_t gfDiv(uint8_t a, uint8_t b) {
+    const GaloisTables& t = galoisTables();
+    return a == 0 ? 0 : t.exp[t.log[a] + 255 - t.log[b]];
+}
+
+inline uint8_t gfInverse(uint8_t a) { return gfDiv(1, a); }
+
+// alpha^power, for any power
+inline uint8_t gfAlpha(int power) {
+    power %= 255;
+    return galoisTables().exp[power < 0 ? power + 255 : power];
+}
+
+// Region kernels: out[i] ^= c * in[i] over length bytes. gfMulAdd picks the fastest one this machine runs;
+// the other two are there to be compared
+inline void gfMulAddTable(uint8_t* out, const uint8_t* in, uint8_t c, size_t length) {
+    const uint8_t* row = galoisTables().mul[c];
+    for (size_t i = 0; i < length; i++) out[i] ^= row[in[i]];
+}
+
+#ifdef ROCKET_GF_SSSE3
+// Built for SSSE3 whatever the compiler flags, and only called where the CPU has it
+__attribute__((target("ssse3"))) inline void gfMulAddShuffle(uint8_t* out, const uint8_t* in, uint8_t c, size_t length) {
+    const GaloisTables& t = galoisTables();
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t.low[c]));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t.high[c]));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i product = _mm_xor_si128(_mm_shuffle_epi8(low, _mm_and_si128(x, nibble)),
+                                        _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(x, 4), nibble)));
+        __m128i* o = reinterpret_cast<__m128i*>(out + i);
+        _mm_storeu_si128(o, _mm_xor_si128(_mm_loadu_si128(o), product));
+    }
+    gfMulAddTable(out + i, in + i, c, length - i);
+}
+
+inline bool gfShuffleAvailable() {
+    static const bool available = __builtin_cpu_supports("ssse3");
+    return available;
+}
+#else
+inline void gfMulAddShuffle(uint8_t* out, const uint8_t* in, uint8_t c, size_t length) { gfMulAddTable(out, in, c, length); }
+inline bool gfShuffleAvailable() { return false; }
+#endif
+
+inline void gfMulAdd(uint8_t* out, const uint8_t* in, uint8_t c, size_t length) {
+    if (c == 0) return;
+    if (c == 1) {
+        for (size_t i = 0; i < length; i++) out[i] ^= in[i];
+    } else if (length >= 16 && gfShuffleAvailable()) {
+        gfMulAddShuffle(out, in, c, length);
+    } else {
+        gfMulAddTable(out, in, c, length);
+    }
+}
+
+static const int RS_MAX_PARITY = 64;
+static const int RS_MAX_LENGTH = 255; // symbols in a codeword, data and parity
+
+// Systematic Reed-Solomon code over GF(256) with a chosen number of parity symbols. A codeword is up to 255
+// symbols, the data first and the parity after it; shorter data gives a shortened code with the same
+// strength. With P parity symbols it corrects any e errors at unknown positions and f erasures at known
+// positions as long as 2e + f <= P. The generator's roots are alpha^0 .. alpha^(P-1).
+//
+// The code is used two ways:
+//   encode / decode               one codeword in a byte buffer, errors and erasures
+//   encodeShards / recoverShards  the codeword runs across shards, e.g. radio frames: symbol i of every
+//                                 codeword is in shard i, so byte j of all the shards is one codeword. A lost
+//                                 shard is one erasure in each codeword, and the work is done a whole shard
+//                                 at a time with gfMulAdd
+// Neither allocates
+class ReedSolomon {
+private:
+    int parity;
+    uint8_t generator[RS_MAX_PARITY + 1]; // low degree first, monic
+
+    // Symbol at index i of an n symbol codeword is the coefficient of x^(n - 1 - i). Horner's rule for all
+    // the syndromes at once, so the P chains of lookups overlap instead of waiting on each other
+    void syndromes(const uint8_t* codeword, int n, uint8_t* s) const {
+        const GaloisTables& t = galoisTables();
+        const uint8_t* rows[RS_MAX_PARITY];
+        for (int i = 0; i < parity; i++) {
+            rows[i] = t.mul[gfAlpha(i)];
+            s[i] = 0;
+        }
+        for (int j = 0; j < n; j++) {
+            uint8_t c = codeword[j];
+            for (int i = 0; i < parity; i++) s[i] = uint8_t(rows[i][s[i]] ^ c);
+        }
+    }
+
+    // a(x) at x, a low degree first
+    static uint8_t evaluate(const uint8_t* a, int terms, uint8_t x) {
+        uint8_t value = 0;
+        for (int i = terms - 1; i >= 0; i--) value = uint8_t(gfMul(value, x) ^ a[i]);
+        return value;
+    }
+
+    // out = a * b truncated to limit terms, returns the terms used
+    static int multiply(const uint8_t* a, int aTerms, const uint8_t* b, int bTerms, uint8_t* out, int limit) {
+        int terms = aTerms + bTerms - 1;
+        if (terms > limit) terms = limit;
+        for (int i = 0; i < terms; i++) out[i] = 0;
+        for (int i = 0; i < aTerms; i++)
+            for (int j = 0; j < bTerms && i + j < terms; j++) out[i + j] ^= gfMul(a[i], b[j]);
+        return terms;
+    }
+
+public:
+    explicit ReedSolomon(int paritySymbols = 2) {
+        parity = paritySymbols < 1 ? 1 : paritySymbols > RS_MAX_PARITY ? RS_MAX_PARITY : paritySymbols;
+        // (x + alpha^0)(x + alpha^1) ... (x + alpha^(P-1))
+        memset(generator, 0, sizeof(generator));
+        generator[0] = 1;
+        for (int i = 0; i < parity; i++) {
+            uint8_t root = gfAlpha(i);
+            for (int j = i + 1; j > 0; j--) generator[j] = uint8_t(generator[j - 1] ^ gfMul(generator[j], root));
+            generator[0] = gfMul(generator[0], root);
+        }
+    }
+
+    int paritySymbols() const { return parity; }
+    int maxData() const { return RS_MAX_LENGTH - parity; }
+
+    // Parity for k data symbols, k <= maxData(): the remainder of data(x) x^P divided by the generator
+    void encode(const uint8_t* data, int k, uint8_t* parityOut) const {
+        uint8_t remainder[RS_MAX_PARITY]; // remainder[P - 1] is the highest degree
+        memset(remainder, 0, sizeof(remainder));
+        for (int i = 0; i < k; i++) {
+            uint8_t feedback = uint8_t(data[i] ^ remainder[parity - 1]);
+            const uint8_t* row = galoisTables().mul[feedback];
+            for (int j = parity - 1; j > 0; j--) remainder[j] = uint8_t(remainder[j - 1] ^ row[generator[j]]);
+            remainder[0] = row[generator[0]];
+        }
+        for (int j = 0; j < parity; j++) parityOut[j] = remainder[parity - 1 - j];
+    }
+
+    // Corrects an n symbol codeword in place, given the indices of the symbols known to be wrong or missing
+    // (their values are ignored). Returns the symbols corrected, or -1, with the codeword unchanged, when there
+    // are more errors than the code can locate. Errors beyond the code's strength can also decode to another
+    // codeword; a check over the data, like the frames' CRC, is what catches that
+    int decode(uint8_t* codeword, int n, const int* erasures = nullptr, int erasureCount = 0) const {
+        if (n <= parity || n > RS_MAX_LENGTH || erasureCount > parity) return -1;
+        uint8_t s[RS_MAX_PARITY];
+        for (int i = 0; i < erasureCount; i++) codeword[erasures[i]] = 0;
+        syndromes(codeword, n, s);
+        bool clean = true;
+        for (int i = 0; i < parity; i++) clean = clean && s[i] == 0;
+        if (clean) return erasureCount;
+
+        // Erasure locator: product of (1 + X x) over the erased positions, X = alpha^degree
+        uint8_t erased[RS_MAX_PARITY + 1] = {1};
+        int erasedTerms = 1;
+        for (int i = 0; i < erasureCount; i++) {
+            uint8_t x = gfAlpha(n - 1 - erasures[i]);
+            for (int j = erasedTerms; j > 0; j--) erased[j] ^= gfMul(erased[j - 1], x);
+            erasedTerms++;
+        }
+
+        // Berlekamp-Massey on the syndromes with the erasures taken out (Forney syndromes) finds the error locator
+        uint8_t forney[RS_MAX_PARITY];
+        multiply(erased, erasedTerms, s, parity, forney, parity);
+        uint8_t locator[RS_MAX_PARITY + 1] = {1}, previous[RS_MAX_PARITY + 1] = {1}, saved[RS_MAX_PARITY + 1];
+        int errors = 0, shift = 1;
+        uint8_t lastDiscrepancy = 1;
+        int length = parity - erasureCount;
+        for (int r = 0; r < length; r++) {
+            uint8_t discrepancy = forney[erasureCount + r];
+            for (int i = 1; i <= errors; i++) discrepancy ^= gfMul(locator[i], forney[erasureCount + r - i]);
+            if (discrepancy == 0) {
+                shift++;
+                continue;
+            }
+            uint8_t scale = gfDiv(discrepancy, lastDiscrepancy);
+            memcpy(saved, locator, sizeof(locator));
+            for (int i = 0; i + shift <= RS_MAX_PARITY; i++) locator[i + shift] ^= gfMul(scale, previous[i]);
+            if (2 * errors <= r) {
+                errors = r + 1 - errors;
+                memcpy(previous, saved, sizeof(saved));
+                lastDiscrepancy = discrepancy;
+                shift = 1;
+            } else {
+                shift++;
+            }
+        }
+        if (2 * errors + erasureCount > parity) return -1;
+
+        // Errata locator and evaluator, then the roots by trying every position (Chien search) and the values
+        // by Forney's formula: e = X * evaluator(1/X) / locator'(1/X)
+        uint8_t errata[RS_MAX_PARITY + 1];
+        int errataTerms = multiply(locator, errors + 1, erased, erasedTerms, errata, RS_MAX_PARITY + 1);
+        uint8_t evaluator[RS_MAX_PARITY];
+        multiply(s, parity, errata, errataTerms, evaluator, parity);
+        uint8_t derivative[RS_MAX_PARITY];
+        for (int i = 1; i < errataTerms; i++) derivative[i - 1] = (i & 1) ? errata[i] : 0;
+
+        int found = 0;
+        int positions[RS_MAX_PARITY];
+        uint8_t values[RS_MAX_PARITY];
+        for (int j = 0; j < n && found <= errataTerms - 1; j++) {
+            int degree = n - 1 - j;
+            uint8_t inverse = gfAlpha(-degree);
+            if (evaluate(errata, errataTerms, inverse) != 0) continue;
+            uint8_t slope = evaluate(derivative, errataTerms - 1, inverse);
+            if (slope == 0 || found == RS_MAX_PARITY) return -1;
+            positions[found] = j;
+            values[found] = gfMul(gfAlpha(degree), gfDiv(evaluate(evaluator, parity, inverse), slope));
+            found++;
+        }
+        if (found != errataTerms - 1) return -1;
+
+        for (int i = 0; i < found; i++) codeword[positions[i]] ^= values[i];
+        syndromes(codeword, n, s);
+        for (int i = 0; i < parity; i++) {
+            if (s[i] != 0) {
+                for (int k = 0; k < found; k++) codeword[positions[k]] ^= values[k];
+                return -1;
+            }
+        }
+        return found;
+    }
+
+    // Parity shards for k data shards of length bytes each: parity shard j is a sum of the data shards, each
+    // times the coefficient of x^(P-1-j) in x^degree mod generator. k * P calls of gfMulAdd
+    void encodeShards(const uint8_t* const* data, int k, uint8_t* const* parityOut, size_t length) const {
+        for (int j = 0; j < parity; j++) memset(parityOut[j], 0, length);
+        // x^P mod generator, then times x for each shard further from the parity
+        uint8_t power[RS_MAX_PARITY];
+        for (int j = 0; j < parity; j++) power[j] = generator[j];
+        for (int i = k - 1; i >= 0; i--) {
+            for (int j = 0; j < parity; j++) gfMulAdd(parityOut[j], data[i], power[parity - 1 - j], length);
+            uint8_t top = power[parity - 1];
+            for (int j = parity - 1; j > 0; j--) power[j] = uint8_t(power[j - 1] ^ gfMul(top, generator[j]));
+            power[0] = gfMul(top, generator[0]);
+        }
+    }
+
+    // Rebuilds the missing data shards of a k + P shard codeword, present[i] telling which arrived. Every
+    // shard is length bytes, missing ones included as buffers to fill. False, with nothing written, if more
+    // than P are missing. With the erased positions known, each missing shard is a fixed sum of the received
+    // ones (the inverse of a Vandermonde system over the syndromes), so the work is again shards times gfMulAdd
+    bool recoverShards(uint8_t* const* shards, int k, const bool* present, size_t length) const {
+        int n = k + parity;
+        if (n > RS_MAX_LENGTH) return false;
+        int missing[RS_MAX_PARITY], m = 0;
+        bool dataMissing = false;
+        for (int i = 0; i < n; i++) {
+            if (present[i]) continue;
+            if (m == parity) return false;
+            missing[m++] = i;
+            dataMissing = dataMissing || i < k;
+        }
+        if (!dataMissing) return true;
+
+        // V[i][e] = X_e^i over the first m syndromes, inverted by Gauss-Jordan elimination
+        uint8_t v[RS_MAX_PARITY][RS_MAX_PARITY], inverse[RS_MAX_PARITY][RS_MAX_PARITY];
+        for (int i = 0; i < m; i++)
+            for (int e = 0; e < m; e++) {
+                v[i][e] = gfAlpha(i * (n - 1 - missing[e]));
+                inverse[i][e] = uint8_t(i == e);
+            }
+        for (int c = 0; c < m; c++) {
+            int pivot = c;
+            while (v[pivot][c] == 0) pivot++; // distinct positions: the matrix is never singular
+            if (pivot != c)
+                for (int j = 0; j < m; j++) {
+                    swap(v[c][j], v[pivot][j]);
+                    swap(inverse[c][j], inverse[pivot][j]);
+                }
+            uint8_t scale = gfInverse(v[c][c]);
+            for (int j = 0; j < m; j++) {
+                v[c][j] = gfMul(v[c][j], scale);
+                inverse[c][j] = gfMul(inverse[c][j], scale);
+            }
+            for (int r = 0; r < m; r++) {
+                uint8_t f = v[r][c];
+                if (r == c || f == 0) continue;
+                for (int j = 0; j < m; j++) {
+                    v[r][j] ^= gfMul(f, v[c][j]);
+                    inverse[r][j] ^= gfMul(f, inverse[c][j]);
+                }
+            }
+        }
+
+        // missing shard e = sum over received shards r of (sum_i inverse[e][i] alpha^(i degree_r)) * r
+        for (int e = 0; e < m && missing[e] < k; e++) {
+            uint8_t* out = shards[missing[e]];
+            memset(out, 0, length);
+            for (int r = 0; r < n; r++) {
+                if (!present[r]) continue;
+                int degree = n - 1 - r;
+                uint8_t coefficient = 0;
+                for (int i = 0; i < m; i++) coefficient ^= gfMul(inverse[e][i], gfAlpha(i * degree));
+                gfMulAdd(out, shards[r], coefficient, length);
+            }
+        }
+        return true;
+    }
+};
+
+#endif // REED_SOLOMON_HPP
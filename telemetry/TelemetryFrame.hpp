@@ -0,0 +1,298 @@
+#ifndef TELEMETRY_FRAME_HPP
+#define TELEMETRY_FRAME_HPP
+
+#include "BitPacking.hpp"
+#include "Framing.hpp"
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// Telemetry frames for the downlink. A frame, before stuffing, is
+//   sequence      2 bytes, little endian, one more per frame sent
+//   messages      1 byte, the number of messages that follow
+//   messages      bit packed back to back: a 4 bit format id, then that format's channels
+//   padding       zero bits to the next byte
+//   check         CRC-16 (2 bytes) or CRC-32 (4 bytes) of everything above, little endian
+// and on the wire it is COBS stuffed and followed by a zero byte.
+//
+// What a message holds is described at compile time. A channel is one field of a record quantised to a fixed
+// point code of Bits bits, linear over [Minimum, Maximum] / Divisor and clamped to it:
+//   TelemetryChannel<AltitudeField, 20, -1000, 31000>  3 cm steps over -1 to 31 km
+// A format is a record type and its channels, e.g. TelemetryFormat<1, Logs, TimestampField ...>; a codec is
+// the set of formats both ends agree on. The packing of every format is generated from these lists, so
+// encoding a message is a run of inlined shifts with no table or loop over channel descriptions
+
+enum TelemetryCheck {
+    CHECK_CRC16 = 0,
+    CHECK_CRC32
+};
+
+inline size_t checkBytes(TelemetryCheck check) { return check == CHECK_CRC32 ? 4 : 2; }
+
+enum TelemetryFrameStatus {
+    FRAME_OK = 0,
+    FRAME_TOO_SHORT,       // shorter than a header and check
+    FRAME_TOO_LONG,        // longer than any frame a writer makes, e.g. two frames run together
+    FRAME_BAD_STUFFING,    // COBS decoding failed
+    FRAME_BAD_CHECK,       // CRC mismatch
+    FRAME_UNKNOWN_FORMAT,  // a message id the codec does not know, the rest of the frame is lost
+    FRAME_TRUNCATED        // fewer bits than the messages it announces
+};
+
+inline const char* frameStatusName(TelemetryFrameStatus s) {
+    static const char* names[] = {"ok", "too short", "too long", "bad stuffing", "bad check", "unknown format", "truncated"};
+    return names[s];
+}
+
+static const size_t TELEMETRY_HEADER_BYTES = 3;
+static const size_t TELEMETRY_MAX_FRAME = 255;   // bytes before stuffing, one radio packet
+static const size_t TELEMETRY_MAX_ENCODED = TELEMETRY_MAX_FRAME + TELEMETRY_MAX_FRAME / 254 + 2; // stuffed, with the zero
+static const int TELEMETRY_ID_BITS = 4;
+static const int TELEMETRY_MAX_MESSAGE = 32;     // bytes of one message with its id, for messages packed ahead of time
+
+// Field accessors: a channel reads and writes its record through one of these
+//   struct AltitudeField { static double get(const Logs& l) {...} static void set(Logs& l, double v) {...} };
+template <typename Field, int Bits, long long Minimum, long long Maximum, long long Divisor = 1>
+struct TelemetryChannel {
+    static_assert(Bits >= 1 && Bits <= 32, "a channel is 1 to 32 bits wide");
+    static_assert(Maximum > Minimum && Divisor > 0, "a channel needs a non empty range");
+
+    static const int BITS = Bits;
+    static constexpr double minimum() { return double(Minimum) / double(Divisor); }
+    static constexpr double maximum() { return double(Maximum) / double(Divisor); }
+    static constexpr double top() { return double((1ull << Bits) - 1ull); }
+    // The step between codes, the worst case error is half of it
+    static constexpr double resolution() { return (maximum() - minimum()) / top(); }
+
+    // Out of range values (and NaN, to the minimum) are clamped
+    static uint32_t quantise(double value) {
+        double code = (value - minimum()) * (top() / (maximum() - minimum()));
+        if (!(code > 0.0)) return 0;
+        if (code >= top()) return uint32_t(top());
+        return uint32_t(code + 0.5);
+    }
+
+    static double restore(uint32_t code) { return minimum() + double(code) * resolution(); }
+
+    template <typename Record>
+    static void write(const Record& record, BitWriter& out) { out.write(quantise(Field::get(record)), Bits); }
+
+    template <typename Record>
+    static void read(BitReader& in, Record& record) { Field::set(record, restore(in.read(Bits))); }
+};
+
+template <int Id, typename RecordType, typename... Channels>
+struct TelemetryFormat {
+    static_assert(Id >= 0 && Id < (1 << TELEMETRY_ID_BITS), "format ids are 4 bits");
+
+    typedef RecordType Record;
+    static const int ID = Id;
+    static const int BITS = (0 + ... + Channels::BITS);          // payload, without the id
+    static const int MESSAGE_BITS = BITS + TELEMETRY_ID_BITS;
+
+    static void encode(const Record& record, BitWriter& out) {
+        out.write(uint32_t(Id), TELEMETRY_ID_BITS);
+        (Channels::write(record, out), ...);
+    }
+
+    // After the id has been read
+    static void decode(BitReader& in, Record& record) { (Channels::read(in, record), ...); }
+
+    // The message on its own, id first, for TelemetryFrameWriter::appendPacked. Returns the bytes used
+    static size_t pack(const Record& record, uint8_t* out) {
+        static_assert(MESSAGE_BITS <= TELEMETRY_MAX_MESSAGE * 8, "message larger than TELEMETRY_MAX_MESSAGE");
+        BitWriter bits(out, TELEMETRY_MAX_MESSAGE);
+        encode(record, bits);
+        return bits.flush();
+    }
+};
+
+// Builds frames. begin(), then append() messages while they fit, then finish() into the wire bytes.
+// Holds one frame in a fixed buffer and never allocates
+class TelemetryFrameWriter {
+private:
+    uint8_t raw[TELEMETRY_MAX_FRAME];
+    BitWriter bits;
+    TelemetryCheck check;
+    size_t limit; // frame bytes before stuffing, header and check included
+    int count;
+
+public:
+    TelemetryFrameWriter(TelemetryCheck frameCheck = CHECK_CRC16, size_t maxFrame = TELEMETRY_MAX_FRAME)
+        : check(frameCheck), count(0) {
+        setMaxFrame(maxFrame);
+        begin(0);
+    }
+
+    // Takes effect at the next begin(), capped at TELEMETRY_MAX_FRAME
+    void setMaxFrame(size_t maxFrame) {
+        limit = maxFrame > TELEMETRY_MAX_FRAME ? TELEMETRY_MAX_FRAME : maxFrame;
+        if (limit < TELEMETRY_HEADER_BYTES + checkBytes(check)) limit = TELEMETRY_HEADER_BYTES + checkBytes(check);
+    }
+
+    size_t maxFrame() const { return limit; }
+    TelemetryCheck frameCheck() const { return check; }
+
+    void begin(uint16_t sequence) {
+        raw[0] = uint8_t(sequence);
+        raw[1] = uint8_t(sequence >> 8);
+        bits.reset(raw + TELEMETRY_HEADER_BYTES, limit - TELEMETRY_HEADER_BYTES - checkBytes(check));
+        count = 0;
+    }
+
+    // Room left for message bits
+    size_t freeBits() const { return bits.bitCapacity() - bits.bitCount(); }
+
+    template <typename Format>
+    bool fits() const { return count < 255 && size_t(Format::MESSAGE_BITS) <= freeBits(); }
+
+    // False, and nothing written, if the message does not fit
+    template <typename Format>
+    bool append(const typename Format::Record& record) {
+        if (!fits<Format>()) return false;
+        Format::encode(record, bits);
+        count++;
+        return true;
+    }
+
+    // A message from Format::pack, bits long with its id
+    bool appendPacked(const uint8_t* message, int messageBits) {
+        if (count >= 255 || size_t(messageBits) > freeBits()) return false;
+        bits.copy(message, messageBits);
+        count++;
+        return true;
+    }
+
+    int messages() const { return count; }
+
+    // Frame bytes before stuffing, with the check, if finished now
+    size_t frameBytes() const { return TELEMETRY_HEADER_BYTES + (bits.bitCount() + 7) / 8 + checkBytes(check); }
+
+    // Stuffs the frame into out, which needs TELEMETRY_MAX_ENCODED bytes, with its closing zero.
+    // Returns the bytes to send
+    size_t finish(uint8_t* out) {
+        raw[2] = uint8_t(count);
+        size_t length = TELEMETRY_HEADER_BYTES + bits.flush();
+        if (check == CHECK_CRC32) {
+            uint32_t crc = crc32(raw, length);
+            for (int i = 0; i < 4; i++) raw[length++] = uint8_t(crc >> (8 * i));
+        } else {
+            uint16_t crc = crc16(raw, length);
+            raw[length++] = uint8_t(crc);
+            raw[length++] = uint8_t(crc >> 8);
+        }
+        size_t encoded = cobsEncode(raw, length, out);
+        out[encoded++] = 0;
+        return encoded;
+    }
+};
+
+// Opens a received frame: unstuffs it, checks it, and reads its messages in order. The codec's decode()
+// is the usual way in; next() and read() are there for a receiver that knows exactly what to expect
+class TelemetryFrameReader {
+private:
+    uint8_t raw[TELEMETRY_MAX_ENCODED];
+    BitReader bits;
+    TelemetryCheck check;
+    uint16_t sequenceNumber;
+    int count, left;
+
+public:
+    TelemetryFrameReader(TelemetryCheck frameCheck = CHECK_CRC16)
+        : check(frameCheck), sequenceNumber(0), count(0), left(0) {}
+
+    // One frame as received, without its closing zero
+    TelemetryFrameStatus open(const uint8_t* encoded, size_t length) {
+        count = left = 0;
+        size_t decoded;
+        if (length > TELEMETRY_MAX_ENCODED) return FRAME_TOO_LONG;
+        if (!cobsDecode(encoded, length, raw, decoded)) return FRAME_BAD_STUFFING;
+        size_t tail = checkBytes(check);
+        if (decoded < TELEMETRY_HEADER_BYTES + tail) return FRAME_TOO_SHORT;
+        size_t body = decoded - tail;
+        if (check == CHECK_CRC32) {
+            uint32_t got = uint32_t(raw[body]) | uint32_t(raw[body + 1]) << 8 | uint32_t(raw[body + 2]) << 16 | uint32_t(raw[body + 3]) << 24;
+            if (got != crc32(raw, body)) return FRAME_BAD_CHECK;
+        } else {
+            uint16_t got = uint16_t(raw[body] | raw[body + 1] << 8);
+            if (got != crc16(raw, body)) return FRAME_BAD_CHECK;
+        }
+        sequenceNumber = uint16_t(raw[0] | raw[1] << 8);
+        count = left = raw[2];
+        bits.reset(raw + TELEMETRY_HEADER_BYTES, body - TELEMETRY_HEADER_BYTES);
+        return FRAME_OK;
+    }
+
+    uint16_t sequence() const { return sequenceNumber; }
+    int messages() const { return count; }
+
+    // The id of the next message, -1 when there are no more
+    int next() {
+        if (left == 0 || bits.remaining() < size_t(TELEMETRY_ID_BITS)) return -1;
+        left--;
+        return int(bits.read(TELEMETRY_ID_BITS));
+    }
+
+    // Decodes the message whose id next() returned. False if the frame ended first
+    template <typename Format>
+    bool read(typename Format::Record& record) {
+        if (bits.remaining() < size_t(Format::BITS)) return false;
+        Format::decode(bits, record);
+        return true;
+    }
+
+    int unread() const { return left; }
+};
+
+// The formats a link carries. decode() opens a frame and hands each message to visit(format, record), where
+// format is a default constructed Format, so one generic lambda can tell the formats apart:
+//   codec.decode(reader, bytes, length, [&](auto format, const auto& record) { ... });
+template <typename... Formats>
+struct TelemetryCodec {
+private:
+    template <typename Format, typename Visitor>
+    static bool tryFormat(int id, TelemetryFrameReader& reader, Visitor& visit, bool& ok) {
+        if (id != Format::ID) return false;
+        typename Format::Record record;
+        ok = reader.template read<Format>(record);
+        if (ok) visit(Format(), record);
+        return true;
+    }
+
+    static constexpr bool uniqueIds() {
+        int ids[] = {Formats::ID...};
+        for (size_t i = 0; i < sizeof...(Formats); i++)
+            for (size_t j = i + 1; j < sizeof...(Formats); j++)
+                if (ids[i] == ids[j]) return false;
+        return true;
+    }
+    static_assert(sizeof...(Formats) > 0 && uniqueIds(), "a codec needs formats with distinct ids");
+
+public:
+    // Bits of the largest message, so a caller can size frames
+    static constexpr int largestMessage() {
+        int largest = 0, sizes[] = {Formats::MESSAGE_BITS...};
+        for (int s : sizes) largest = s > largest ? s : largest;
+        return largest;
+    }
+
+    // Decodes the messages of an opened frame in order
+    template <typename Visitor>
+    static TelemetryFrameStatus decode(TelemetryFrameReader& reader, Visitor visit) {
+        for (int id = reader.next(); id >= 0; id = reader.next()) {
+            bool ok = false;
+            if (!(tryFormat<Formats>(id, reader, visit, ok) || ...)) return FRAME_UNKNOWN_FORMAT;
+            if (!ok) return FRAME_TRUNCATED;
+        }
+        return reader.unread() ? FRAME_TRUNCATED : FRAME_OK;
+    }
+
+    // One frame as received, without its closing zero
+    template <typename Visitor>
+    static TelemetryFrameStatus decode(TelemetryFrameReader& reader, const uint8_t* encoded, size_t length, Visitor visit) {
+        TelemetryFrameStatus status = reader.open(encoded, length);
+        return status == FRAME_OK ? decode(reader, visit) : status;
+    }
+};
+
+#endif // TELEMETRY_FRAME_HPP
@@ -0,0 +1,315 @@
+#ifndef TELEMETRY_SCHEDULER_HPP
+#define TELEMETRY_SCHEDULER_HPP
+
+#include "TelemetryFrame.hpp"
+#include "../scheduler/Executive.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+using namespace std;
+
+struct TelemetryStreamStats {
+    uint64_t offered;    // samples given to offer()
+    uint64_t decimated;  // skipped to hold the stream to its rate, by design
+    uint64_t sent;
+    uint64_t dropped;    // queued, then pushed out by newer samples before a frame had room for them
+    double firstTime;    // s, first sample offered, -1 before
+    double delaySum;     // s from offer to the frame carrying the sample, summed over the samples sent
+    double maxDelay;
+
+    TelemetryStreamStats()
+        : offered(0), decimated(0), sent(0), dropped(0), firstTime(-1.0), delaySum(0.0), maxDelay(0.0) {}
+};
+
+// Decides what goes down the radio. Each stream carries one message format at a set rate and priority:
+//   priority   lower numbers first; a level is served only with the room the levels above it leave.
+//              Priority 0 is for critical events: one pending sends a frame as soon as the budget allows,
+//              without waiting for the frame to fill
+//   rate       Hz, samples offered faster are decimated; 0 keeps every sample
+//   depth      samples queued, by default what the stream offers in maxLatency or in the time the budget takes
+//              to pay for a full frame, whichever is longer, plus one; when the link cannot keep up, the oldest
+//              are dropped, newer data being worth more
+// Streams of one priority share what is left of a frame by deficit round robin, each getting a quantum of bits
+// per round in proportion to the bits per second it asks for. When the budget is short, every stream of the
+// level then gets the same fraction of its rate, and its round robin position carries over from frame to frame.
+//
+// The budget is a token bucket in bytes per second, holding up to two full frames. A frame goes out when it
+// would be full, when its oldest sample has waited maxLatency, or at once for a critical event, and only if
+// the bucket holds its wire bytes (stuffing and the closing zero included). So frames are as large as the
+// traffic allows and the budget is never exceeded over any window longer than two frames.
+//
+// Samples are packed into their stream's queue when offered, so a frame is built by copying bits. Queues are
+// allocated by addStream() at setup; offer() and poll() never allocate. Call both from one thread
+class TelemetryScheduler {
+private:
+    struct stream {
+        string name;
+        int id, bits, priority;
+        double rate, period, nextDue;
+        double quantum, deficit;
+        int depth, head, size;
+        vector<uint8_t> slots;  // depth packed messages of TELEMETRY_MAX_MESSAGE bytes
+        vector<double> times;   // when each was offered
+        TelemetryStreamStats stats;
+    };
+
+    struct level {
+        int priority;
+        vector<int> members;
+        size_t cursor;  // round robin position
+        bool credited;  // the stream at cursor has had its quantum for this visit
+    };
+
+    vector<stream> streams;
+    vector<level> levels; // ascending priority number
+    TelemetryFrameWriter writer;
+    double budget, tokens, burst, maxLatency;
+    double lastTime, startTime;
+    bool started;
+    uint16_t sequence;
+    uint64_t frames, bytesSent;
+
+    static size_t wireBytes(size_t frameBytes) { return frameBytes + frameBytes / 254 + 2; }
+
+    size_t send(double t, uint8_t* out, bool force) {
+        if (!started) {
+            started = true;
+            startTime = lastTime = t;
+        }
+        tokens = min(burst, tokens + budget * (t - lastTime));
+        lastTime = t;
+
+        size_t pendingBits = 0;
+        double oldest = t;
+        int criticalBits = 0;
+        for (const stream& s : streams) {
+            if (s.size == 0) continue;
+            pendingBits += size_t(s.size) * size_t(s.bits);
+            oldest = min(oldest, s.times[s.head]);
+            if (s.priority == 0 && criticalBits == 0) criticalBits = s.bits;
+        }
+        if (pendingBits == 0) return 0;
+
+        size_t overhead = TELEMETRY_HEADER_BYTES + checkBytes(writer.frameCheck());
+        size_t fullBits = (writer.maxFrame() - overhead) * 8;
+        size_t frameBytes = overhead + (min(pendingBits, fullBits) + 7) / 8;
+        size_t limit = writer.maxFrame();
+        if (criticalBits > 0) {
+            // as much as the bucket holds now, as long as the event fits
+            size_t affordable = tokens > 3.0 ? size_t(tokens) - 3 : 0;
+            limit = min(limit, affordable);
+            if (limit < overhead + size_t(criticalBits + 7) / 8) return 0;
+        } else {
+            if (!force && pendingBits < fullBits && t - oldest < maxLatency) return 0;
+            if (tokens < double(wireBytes(frameBytes))) return 0;
+        }
+
+        size_t configured = writer.maxFrame();
+        writer.setMaxFrame(limit);
+        writer.begin(sequence);
+        for (level& l : levels) fill(l, t);
+        writer.setMaxFrame(configured);
+        if (writer.messages() == 0) return 0;
+
+        size_t length = writer.finish(out);
+        tokens -= double(length);
+        sequence++;
+        frames++;
+        bytesSent += length;
+        return length;
+    }
+
+    void requantise(level& l) {
+        double largest = 0.0, smallest = 0.0;
+        for (int i : l.members) {
+            const stream& s = streams[i];
+            double demand = s.bits * (s.rate > 0.0 ? s.rate : 1.0);
+            largest = max(largest, double(s.bits));
+            smallest = smallest == 0.0 ? demand : min(smallest, demand);
+        }
+        // The least demanding stream gets enough for the largest message, so every visit can send
+        for (int i : l.members) {
+            stream& s = streams[i];
+            s.quantum = largest * s.bits * (s.rate > 0.0 ? s.rate : 1.0) / smallest;
+        }
+    }
+
+    void pop(stream& s, double t) {
+        double delay = t - s.times[s.head];
+        s.stats.delaySum += delay;
+        s.stats.maxDelay = max(s.stats.maxDelay, delay);
+        s.stats.sent++;
+        s.head = (s.head + 1) % s.depth;
+        s.size--;
+    }
+
+    // Deficit round robin over one level, until its streams are empty or the next message does not fit
+    void fill(level& l, double t) {
+        size_t n = l.members.size();
+        while (true) {
+            bool pending = false;
+            for (int i : l.members) pending = pending || streams[i].size > 0;
+            if (!pending) return;
+
+            stream& s = streams[l.members[l.cursor]];
+            if (s.size > 0) {
+                if (!l.credited) {
+                    s.deficit += s.quantum;
+                    l.credited = true;
+                }
+                while (s.size > 0 && s.deficit >= s.bits) {
+                    if (!writer.appendPacked(&s.slots[size_t(s.head) * TELEMETRY_MAX_MESSAGE], s.bits)) return;
+                    pop(s, t);
+                    s.deficit -= s.bits;
+                }
+            }
+            if (s.size == 0) s.deficit = 0.0;
+            l.cursor = (l.cursor + 1) % n;
+            l.credited = false;
+        }
+    }
+
+public:
+    // bytesPerSecond: what the radio carries, stuffing and delimiters included. maxLatency: s a sample may wait
+    // for its frame to fill
+    TelemetryScheduler(double bytesPerSecond, TelemetryCheck check = CHECK_CRC16, size_t maxFrame = TELEMETRY_MAX_FRAME,
+                       double latency = 0.1)
+        : writer(check, maxFrame), budget(bytesPerSecond), maxLatency(latency) {
+        burst = 2.0 * double(wireBytes(writer.maxFrame()));
+        reset();
+    }
+
+    // Back to an empty link with a full bucket, keeping the streams
+    void reset() {
+        tokens = burst;
+        lastTime = startTime = 0.0;
+        started = false;
+        sequence = 0;
+        frames = bytesSent = 0;
+        for (stream& s : streams) {
+            s.nextDue = -1.0;
+            s.deficit = 0.0;
+            s.head = s.size = 0;
+            s.stats = TelemetryStreamStats();
+        }
+        for (level& l : levels) {
+            l.cursor = 0;
+            l.credited = false;
+        }
+    }
+
+    // At setup. Returns the stream number for offer(), -1 for a negative rate, priority or depth.
+    // depth 0 sizes the queue from the rate
+    template <typename Format>
+    int addStream(const string& name, int priority, double rateHz, int depth = 0) {
+        if (priority < 0 || !(rateHz >= 0.0) || depth < 0) return -1;
+        if (depth == 0) {
+            double window = max(maxLatency, double(wireBytes(writer.maxFrame())) / budget);
+            depth = max(4, int(rateHz * window) + 2);
+        }
+        stream s;
+        s.name = name;
+        s.id = Format::ID;
+        s.bits = Format::MESSAGE_BITS;
+        s.priority = priority;
+        s.rate = rateHz;
+        s.period = rateHz > 0.0 ? 1.0 / rateHz : 0.0;
+        s.nextDue = -1.0;
+        s.deficit = s.quantum = 0.0;
+        s.depth = depth;
+        s.head = s.size = 0;
+        s.slots.assign(size_t(depth) * TELEMETRY_MAX_MESSAGE, 0);
+        s.times.assign(size_t(depth), 0.0);
+        streams.push_back(s);
+        int index = int(streams.size()) - 1;
+
+        size_t at = 0;
+        while (at < levels.size() && levels[at].priority < priority) at++;
+        if (at == levels.size() || levels[at].priority != priority)
+            levels.insert(levels.begin() + at, level{priority, vector<int>(), 0, false});
+        levels[at].members.push_back(index);
+        requantise(levels[at]);
+        return index;
+    }
+
+    // A sample at time t (s). False if it was decimated, or the stream does not carry Format
+    template <typename Format>
+    bool offer(int index, const typename Format::Record& record, double t) {
+        if (index < 0 || index >= int(streams.size())) return false;
+        stream& s = streams[index];
+        if (s.id != Format::ID || s.bits != Format::MESSAGE_BITS) return false;
+        s.stats.offered++;
+        if (s.stats.firstTime < 0.0) s.stats.firstTime = t;
+        if (s.period > 0.0) {
+            // a thousandth of a period of slack, so 100 Hz offers land on every other 50 Hz slot
+            if (s.nextDue >= 0.0 && t + 1e-3 * s.period < s.nextDue) {
+                s.stats.decimated++;
+                return false;
+            }
+            s.nextDue = s.nextDue < 0.0 || s.nextDue + s.period <= t ? t + s.period : s.nextDue + s.period;
+        }
+        if (s.size == s.depth) {
+            s.head = (s.head + 1) % s.depth;
+            s.size--;
+            s.stats.dropped++;
+        }
+        int tail = (s.head + s.size) % s.depth;
+        Format::pack(record, &s.slots[size_t(tail) * TELEMETRY_MAX_MESSAGE]);
+        s.times[tail] = t;
+        s.size++;
+        return true;
+    }
+
+    // Call regularly, e.g. once per control cycle. Writes at most one frame into out (TELEMETRY_MAX_ENCODED
+    // bytes) and returns its length on the wire, 0 if nothing is due or the budget does not allow it yet
+    size_t poll(double t, uint8_t* out) { return send(t, out, false); }
+
+    // As poll, but sends whatever is queued without waiting for the frame to fill, e.g. after landing
+    size_t flush(double t, uint8_t* out) { return send(t, out, true); }
+
+    int streamCount() const { return int(streams.size()); }
+    const string& streamName(int index) const { return streams[index].name; }
+    double streamRate(int index) const { return streams[index].rate; }
+    int queued(int index) const { return streams[index].size; }
+    const TelemetryStreamStats& stats(int index) const { return streams[index].stats; }
+
+    // Samples per second sent since the stream's first sample, up to the last poll
+    double achievedRate(int index) const {
+        const TelemetryStreamStats& s = streams[index].stats;
+        double elapsed = lastTime - s.firstTime;
+        return s.firstTime >= 0.0 && elapsed > 0.0 ? double(s.sent) / elapsed : 0.0;
+    }
+
+    uint64_t frameCount() const { return frames; }
+    uint64_t bytes() const { return bytesSent; }
+    double bytesPerSecond() const { return budget; }
+
+    // Share of the budget used since the first poll
+    double utilisation() const {
+        double elapsed = lastTime - startTime;
+        return elapsed > 0.0 && budget > 0.0 ? double(bytesSent) / (budget * elapsed) : 0.0;
+    }
+
+    void report(ostream& out) const {
+        StreamStateGuard restore(out);
+
+        out << fixed << setprecision(1) << "Telemetry: " << frames << " frames, " << bytesSent << " bytes, "
+            << 100.0 * utilisation() << "% of " << budget << " B/s over " << lastTime - startTime << " s" << endl;
+        for (int i = 0; i < int(streams.size()); i++) {
+            const stream& s = streams[i];
+            out << "  " << left << setw(13) << s.name << right << "priority " << s.priority << ", ";
+            if (s.rate > 0.0) out << s.rate << " Hz asked, ";
+            else out << "every sample, ";
+            out << achievedRate(i) << " Hz sent, " << s.stats.sent << " sent, " << s.stats.dropped << " dropped, "
+                << s.stats.decimated << " decimated";
+            if (s.stats.sent)
+                out << ", delay mean " << 1000.0 * s.stats.delaySum / double(s.stats.sent) << " ms, max "
+                    << 1000.0 * s.stats.maxDelay << " ms";
+            out << endl;
+        }
+    }
+};
+
+#endif // TELEMETRY_SCHEDULER_HPP